@@ -299,16 +299,17 @@ void Loco<N>::setupProblem() {
 }
 
 template <int N>
-void Loco<N>::solveProblem() {
+bool Loco<N>::solveProblem() {
   // Find the current params.
   mav_trajectory_generation::timing::Timer timer_solve("loco/solve");
-  solveProblemCeres();
+  const bool success = solveProblemCeres();
 
   timer_solve.Stop();
+  return success;
 }
 
 template <int N>
-void Loco<N>::solveProblemCeres() {
+bool Loco<N>::solveProblemCeres() {
   std::vector<Eigen::VectorXd> d_p_vec;
   poly_opt_.getFreeConstraints(&d_p_vec);
 
@@ -331,6 +332,10 @@ void Loco<N>::solveProblemCeres() {
   options.minimizer_progress_to_stdout = false;
 
   options.line_search_interpolation_type = ceres::BISECTION;
+  StopCallback stop_callback(stop_function_);
+  if (stop_function_) {
+    options.callbacks.push_back(&stop_callback);
+  }
   ceres::GradientProblemSolver::Summary summary;
 
   // Fire up CERES!
@@ -355,6 +360,7 @@ void Loco<N>::solveProblemCeres() {
     std::cout << "[Solution]: " << d_p_vec[0].transpose() << " "
               << d_p_vec[1].transpose() << std::endl;
   }
+  return summary.termination_type != ceres::USER_FAILURE;
 }
 
 template <int N>
@@ -581,6 +587,14 @@ double Loco<N>::computeCollisionCostAndGradient(
 
   coll_cost_prep_timer.Stop();
 
+  // First pick out all the samples to evaluate, so that the map lookups can
+  // be done all at once. Which ones only depends on the trajectory.
+  std::vector<Eigen::VectorXd> sample_positions;
+  std::vector<Eigen::VectorXd> sample_velocities;
+  std::vector<Eigen::VectorXd> sample_T_segs;
+  std::vector<int> sample_segments;
+  std::vector<double> sample_time_ints;
+
   Eigen::VectorXd last_position(K_);
   last_position.setZero();
   // int is "integral" in this case, not "integer."
@@ -588,11 +602,8 @@ double Loco<N>::computeCollisionCostAndGradient(
   double distance_int = 0;
   double t = 0.0;
 
-  Eigen::VectorXd T(num_segments * N);
   Eigen::VectorXd T_seg(N);
   for (int i = 0; i < num_segments; ++i) {
-    T.setZero();
-
     // Select a time.
     for (t = 0.0; t < segment_times[i]; t += dt) {
       mav_trajectory_generation::timing::Timer coll_cost_sample_timer(
@@ -601,9 +612,6 @@ double Loco<N>::computeCollisionCostAndGradient(
       // T is the vector for just THIS SEGMENT.
       getTVector(t, &T_seg);
 
-      // Now fill this in for ALL segments.
-      T.segment(i * N, N) = T_seg;
-
       // Calculate the position per axis. Also calculate velocity so we don't
       // have to get p_k_i out again.
       Eigen::VectorXd position(K_);
@@ -632,55 +640,67 @@ double Loco<N>::computeCollisionCostAndGradient(
         continue;
       }
 
-      coll_cost_sample_timer.Stop();
+      sample_positions.push_back(position);
+      sample_velocities.push_back(velocity);
+      sample_T_segs.push_back(T_seg);
+      sample_segments.push_back(i);
+      sample_time_ints.push_back(time_int);
 
-      // Okay figure out the cost and gradient of the potential map at this
-      // point.
-      Eigen::VectorXd d_c_d_f(K_);
+      // Clear the numeric integrals.
+      distance_int = 0.0;
+      time_int = 0.0;
+      last_position = position;
+    }
+    // Make sure the dt is correct for the next step:
+    time_int += -dt + (segment_times[i] - t);
+  }
 
-      mav_trajectory_generation::timing::Timer timer_map_lookup(
-          "loco/map_lookup");
-      double c = 0.0;
-      if (gradients != nullptr) {
-        c = computePotentialCostAndGradient(position, &d_c_d_f);
-      } else {
-        c = computePotentialCostAndGradient(position, nullptr);
-      }
-      timer_map_lookup.Stop();
+  // Okay figure out the cost and gradient of the potential map at these
+  // points.
+  mav_trajectory_generation::timing::Timer timer_map_lookup("loco/map_lookup");
+  std::vector<double> distances;
+  std::vector<Eigen::VectorXd> distance_gradients;
+  getDistancesAndGradients(
+      sample_positions, &distances,
+      gradients != nullptr ? &distance_gradients : nullptr);
+  timer_map_lookup.Stop();
 
-      double cost = c * velocity.norm() * time_int;
+  Eigen::VectorXd T(num_segments * N);
+  Eigen::VectorXd d_c_d_f(K_);
+  for (size_t j = 0; j < sample_positions.size(); ++j) {
+    const Eigen::VectorXd& velocity = sample_velocities[j];
+    const double sample_time_int = sample_time_ints[j];
 
-      J_c += cost;
+    double c = potentialFunction(distances[j]);
+    double cost = c * velocity.norm() * sample_time_int;
 
-      mav_trajectory_generation::timing::Timer coll_cost_grad_timer(
-          "loco/coll_cost_grad");
+    J_c += cost;
 
-      if (gradients != nullptr) {
-        // Gotta make sure the norm is non-zero, since we divide by it later.
-        if (velocity.norm() > 1e-6 && (cost > 0.0 || d_c_d_f.norm() > 0.0)) {
-          // Now calculate the gradient per axis.
-          for (int k = 0; k < K_; ++k) {
-            Eigen::VectorXd grad_c_k =
-                (velocity.norm() * time_int * d_c_d_f(k) * T.transpose() *
-                     L_pp +
-                 time_int * c * velocity(k) / velocity.norm() * T.transpose() *
-                     V_ * L_pp)
-                    .transpose();
+    mav_trajectory_generation::timing::Timer coll_cost_grad_timer(
+        "loco/coll_cost_grad");
 
-            grad_c[k] += grad_c_k;
-          }
+    if (gradients != nullptr) {
+      potentialGradientFunction(distances[j], distance_gradients[j], &d_c_d_f);
+      // Gotta make sure the norm is non-zero, since we divide by it later.
+      if (velocity.norm() > 1e-6 && (cost > 0.0 || d_c_d_f.norm() > 0.0)) {
+        // Only this sample's segment of T is non-zero.
+        T.setZero();
+        T.segment(sample_segments[j] * N, N) = sample_T_segs[j];
+        // Now calculate the gradient per axis.
+        for (int k = 0; k < K_; ++k) {
+          Eigen::VectorXd grad_c_k =
+              (velocity.norm() * sample_time_int * d_c_d_f(k) * T.transpose() *
+                   L_pp +
+               sample_time_int * c * velocity(k) / velocity.norm() *
+                   T.transpose() * V_ * L_pp)
+                  .transpose();
+
+          grad_c[k] += grad_c_k;
         }
       }
-
-      coll_cost_grad_timer.Stop();
-
-      // Clear the numeric integrals.
-      distance_int = 0.0;
-      time_int = 0.0;
-      last_position = position;
     }
-    // Make sure the dt is correct for the next step:
-    time_int += -dt + (segment_times[i] - t);
+
+    coll_cost_grad_timer.Stop();
   }
 
   if (gradients != nullptr) {
@@ -948,6 +968,15 @@ int Loco<N>::NestedCeresFunction::NumParameters() const {
   return num_free_ * K_;
 }
 
+template <int N>
+ceres::CallbackReturnType Loco<N>::StopCallback::operator()(
+    const ceres::IterationSummary& summary) {
+  if (stop_function_()) {
+    return ceres::SOLVER_ABORT;
+  }
+  return ceres::SOLVER_CONTINUE;
+}
+
 template <int N>
 double Loco<N>::getCost() const {
   return computeTotalCostAndGradients(nullptr);
@@ -975,6 +1004,71 @@ double Loco<N>::getNumericalDistanceAndGradient(const Eigen::VectorXd& position,
   }
 }
 
+template <int N>
+void Loco<N>::setBatchDistanceAndGradientFunction(
+    const BatchDistanceAndGradientFunctionType& function) {
+  batch_distance_and_gradient_function_ = function;
+  // Single lookups, like computePotentialCostAndGradient(), go through it
+  // too.
+  distance_and_gradient_function_ = [function](
+      const Eigen::VectorXd& position, Eigen::VectorXd* gradient) {
+    std::vector<double> distances;
+    std::vector<Eigen::VectorXd> gradients;
+    function(std::vector<Eigen::VectorXd>(1, position), &distances,
+             gradient == nullptr ? nullptr : &gradients);
+    if (gradient != nullptr) {
+      *gradient = gradients.front();
+    }
+    return distances.front();
+  };
+}
+
+template <int N>
+template <typename DistanceSource>
+typename Loco<N>::BatchDistanceAndGradientFunctionType
+Loco<N>::makeBatchDistanceAndGradientFunction(const DistanceSource* source) {
+  CHECK_NOTNULL(source);
+  return [source](const std::vector<Eigen::VectorXd>& positions,
+                  std::vector<double>* distances,
+                  std::vector<Eigen::VectorXd>* gradients) {
+    std::vector<Eigen::Vector3d> positions_3d(positions.size());
+    for (size_t i = 0; i < positions.size(); ++i) {
+      CHECK_EQ(positions[i].size(), 3);
+      positions_3d[i] = positions[i];
+    }
+    if (gradients == nullptr) {
+      source->getDistances(positions_3d, distances);
+      return;
+    }
+    std::vector<Eigen::Vector3d> gradients_3d;
+    source->getDistancesAndGradients(positions_3d, distances, &gradients_3d);
+    gradients->resize(positions.size());
+    for (size_t i = 0; i < positions.size(); ++i) {
+      (*gradients)[i] = gradients_3d[i];
+    }
+  };
+}
+
+template <int N>
+void Loco<N>::getDistancesAndGradients(
+    const std::vector<Eigen::VectorXd>& positions,
+    std::vector<double>* distances,
+    std::vector<Eigen::VectorXd>* gradients) const {
+  CHECK_NOTNULL(distances);
+  if (batch_distance_and_gradient_function_) {
+    batch_distance_and_gradient_function_(positions, distances, gradients);
+    return;
+  }
+  distances->resize(positions.size());
+  if (gradients != nullptr) {
+    gradients->assign(positions.size(), Eigen::VectorXd::Zero(K_));
+  }
+  for (size_t i = 0; i < positions.size(); ++i) {
+    (*distances)[i] = distance_and_gradient_function_(
+        positions[i], gradients == nullptr ? nullptr : &(*gradients)[i]);
+  }
+}
+
 }  // namespace loco_planner
 
 #endif  // LOCO_PLANNER_IMPL_LOCO_IMPL_H_
@@ -5,6 +5,7 @@
 #include <glog/logging.h>
 #include <Eigen/Core>
 #include <functional>
+#include <vector>
 
 #include <mav_msgs/eigen_mav_msgs.h>
 #include <mav_trajectory_generation/polynomial_optimization_linear.h>
@@ -39,6 +40,13 @@ class Loco {
   typedef std::function<double(const Eigen::VectorXd& position,
                                Eigen::VectorXd* gradient)>
       DistanceAndGradientFunctionType;
+  // Distances of many positions at once, and their gradients if gradients
+  // isn't nullptr. Outputs are resized to the number of positions.
+  typedef std::function<void(const std::vector<Eigen::VectorXd>& positions,
+                             std::vector<double>* distances,
+                             std::vector<Eigen::VectorXd>* gradients)>
+      BatchDistanceAndGradientFunctionType;
+  typedef std::function<bool()> StopFunctionType;
 
   Loco(size_t dimension);
   Loco(size_t dimension, const Config& config);
@@ -70,23 +78,48 @@ class Loco {
   void setWaypointsFromTrajectory(
       const mav_trajectory_generation::Trajectory& trajectory);
 
-  // Set how to get the distance of a point. ONE OF THESE TWO *MUST* BE SET!
+  // Set how to get the distance of a point. ONE OF THESE *MUST* BE SET!
   void setDistanceFunction(const DistanceFunctionType& function) {
     distance_function_ = function;
     distance_and_gradient_function_ =
         std::bind(&Loco::getNumericalDistanceAndGradient, this,
                   std::placeholders::_1, std::placeholders::_2);
+    batch_distance_and_gradient_function_ = nullptr;
   }
   void setDistanceAndGradientFunction(
       const DistanceAndGradientFunctionType& function) {
     distance_and_gradient_function_ = function;
+    batch_distance_and_gradient_function_ = nullptr;
+  }
+  // All collision samples of a cost evaluation are looked up with one call.
+  void setBatchDistanceAndGradientFunction(
+      const BatchDistanceAndGradientFunctionType& function);
+  // Looks up distances directly in a 3D DistanceSource (see
+  // mav_planning_common/distance_source.h): one std::function call per cost
+  // evaluation instead of one per sample. The source has to outlive this.
+  template <typename DistanceSource>
+  void setDistanceSource(const DistanceSource* source) {
+    CHECK_EQ(K_, 3);
+    setBatchDistanceAndGradientFunction(
+        makeBatchDistanceAndGradientFunction(source));
+  }
+  // The same, for keeping around until there's a Loco to give it to.
+  template <typename DistanceSource>
+  static BatchDistanceAndGradientFunctionType
+  makeBatchDistanceAndGradientFunction(const DistanceSource* source);
+
+  // Optional. Asked after every solver iteration, and the solve gives up once
+  // it returns true. Has to be thread-safe if set from another thread.
+  void setStopFunction(const StopFunctionType& function) {
+    stop_function_ = function;
   }
 
-  // This should probably return something...
-  void solveProblem();
+  // Returns false if the stop function stopped it. The trajectory is then
+  // wherever the solver was at.
+  bool solveProblem();
 
   // Different solver methods.
-  void solveProblemCeres();
+  bool solveProblemCeres();
   void solveProblemGradientDescent();
 
   // Accessors for getting the data back out...
@@ -177,6 +210,10 @@ class Loco {
 
   double getNumericalDistanceAndGradient(const Eigen::VectorXd& position,
                                          Eigen::VectorXd* gradient);
+  // Through the batch function if set, one by one otherwise.
+  void getDistancesAndGradients(const std::vector<Eigen::VectorXd>& positions,
+                                std::vector<double>* distances,
+                                std::vector<Eigen::VectorXd>* gradients) const;
 
   // Private class for ceres evaluations.
   class NestedCeresFunction : public ceres::FirstOrderFunction {
@@ -194,12 +231,27 @@ class Loco {
     Loco* parent_;
   };
 
+  // Aborts the ceres solve once the stop function returns true.
+  class StopCallback : public ceres::IterationCallback {
+   public:
+    explicit StopCallback(const StopFunctionType& stop_function)
+        : stop_function_(stop_function) {}
+
+    virtual ceres::CallbackReturnType operator()(
+        const ceres::IterationSummary& summary);
+
+   private:
+    const StopFunctionType& stop_function_;
+  };
+
   // This is where you store the matrices.
   mav_trajectory_generation::PolynomialOptimization<N> poly_opt_;
 
   // Collision cost functions.
   DistanceFunctionType distance_function_;
   DistanceAndGradientFunctionType distance_and_gradient_function_;
+  BatchDistanceAndGradientFunctionType batch_distance_and_gradient_function_;
+  StopFunctionType stop_function_;
 
   // Most of the configuration settings for the optimization.
   Config config_;
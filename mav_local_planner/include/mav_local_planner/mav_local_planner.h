@@ -24,6 +24,7 @@
 #include <minkindr_conversions/kindr_msg.h>
 #include <voxblox_loco_planner/goal_point_selector.h>
 #include <voxblox_loco_planner/voxblox_loco_planner.h>
+#include <voxblox_planning_common/esdf_distance_source.h>
 #include <voxblox_ros/esdf_server.h>
 
 namespace mav_planning {
@@ -158,6 +159,9 @@ class MavLocalPlanner {
   // for start service call.
   bool plan_to_start_;  // Whether to start planning at the current odometry.
   std::string smoother_name_;
+  // If set, tracing is on and the trace is written here after every planning
+  // step.
+  std::string trace_file_;
 
   // State -- robot state.
   mav_msgs::EigenOdometry odometry_;
@@ -180,6 +184,8 @@ class MavLocalPlanner {
 
   // Map!
   voxblox::EsdfServer esdf_server_;
+  // Lookups in the server's ESDF, for the map access functions and LOCO.
+  EsdfDistanceSource distance_source_;
 
   // Planners -- yaw policy
   YawPolicy yaw_policy_;
@@ -1,4 +1,6 @@
 #include <mav_msgs/default_topics.h>
+#include <mav_planning_common/map_query_scope.h>
+#include <mav_planning_common/scoped_trace.h>
 #include <mav_trajectory_generation/trajectory_sampling.h>
 
 #include "mav_local_planner/mav_local_planner.h"
@@ -31,6 +33,7 @@ MavLocalPlanner::MavLocalPlanner(const ros::NodeHandle& nh,
   // Set up some settings.
   constraints_.setParametersFromRos(nh_private_);
   esdf_server_.setTraversabilityRadius(constraints_.robot_radius);
+  distance_source_.setEsdfMap(esdf_server_.getEsdfMapPtr().get());
   loco_planner_.setEsdfMap(esdf_server_.getEsdfMapPtr());
   goal_selector_.setParametersFromRos(nh_private_);
   goal_selector_.setTsdfMap(esdf_server_.getTsdfMapPtr());
@@ -49,6 +52,10 @@ MavLocalPlanner::MavLocalPlanner(const ros::NodeHandle& nh,
   nh_private_.param("autostart", autostart_, autostart_);
   nh_private_.param("plan_to_start", plan_to_start_, plan_to_start_);
   nh_private_.param("smoother_name", smoother_name_, smoother_name_);
+  nh_private_.param("trace_file", trace_file_, trace_file_);
+  if (!trace_file_.empty()) {
+    setTracingEnabled(true);
+  }
 
   // Publishers and subscribers.
   odometry_sub_ = nh_.subscribe(mav_msgs::default_topics::ODOMETRY, 1,
@@ -111,9 +118,7 @@ MavLocalPlanner::MavLocalPlanner(const ros::NodeHandle& nh,
   // Loco smoother!
   loco_smoother_.setParametersFromRos(nh_private_);
   loco_smoother_.setMinCollisionCheckResolution(voxel_size);
-  loco_smoother_.setDistanceAndGradientFunction(
-      std::bind(&MavLocalPlanner::getMapDistanceAndGradient, this,
-                std::placeholders::_1, std::placeholders::_2));
+  loco_smoother_.setDistanceSource(&distance_source_);
   loco_smoother_.setOptimizeTime(true);
   loco_smoother_.setResampleTrajectory(true);
   loco_smoother_.setResampleVisibility(true);
@@ -177,10 +182,14 @@ void MavLocalPlanner::planningTimerCallback(const ros::TimerEvent& event) {
     }
 
     planningStep();
+    if (!trace_file_.empty()) {
+      writeChromeTrace(trace_file_);
+    }
   }
 }
 
 void MavLocalPlanner::planningStep() {
+  ScopedTrace trace("local_planner/plan_step", "local_planner");
   ROS_INFO(
       "[Mav Local Planner][Plan Step] Waypoint index: %zd Total waypoints: %zu",
       current_waypoint_, waypoints_.size());
@@ -292,6 +301,7 @@ void MavLocalPlanner::planningStep() {
 }
 
 void MavLocalPlanner::avoidCollisionsTowardWaypoint() {
+  ScopedTrace trace("local_planner/avoid_collisions", "local_planner");
   if (current_waypoint_ >= static_cast<int64_t>(waypoints_.size())) {
     return;
   }
@@ -441,6 +451,7 @@ bool MavLocalPlanner::planPathThroughWaypoints(
     const mav_msgs::EigenTrajectoryPointVector& waypoints,
     mav_msgs::EigenTrajectoryPointVector* path) {
   CHECK_NOTNULL(path);
+  ScopedTrace trace("local_planner/smooth", "local_planner");
   bool success = false;
   if (smoother_name_ == "loco") {
     if (waypoints.size() == 2) {
@@ -629,28 +640,18 @@ void MavLocalPlanner::visualizePath() {
 }
 
 double MavLocalPlanner::getMapDistance(const Eigen::Vector3d& position) const {
-  double distance = 0.0;
-  const bool kInterpolate = false;
-  if (!esdf_server_.getEsdfMapPtr()->getDistanceAtPosition(
-          position, kInterpolate, &distance)) {
-    return 0.0;
-  }
-  return distance;
+  return distance_source_.getDistance(position);
 }
 
 double MavLocalPlanner::getMapDistanceAndGradient(
     const Eigen::Vector3d& position, Eigen::Vector3d* gradient) const {
-  double distance = 0.0;
-  const bool kInterpolate = false;
-  if (!esdf_server_.getEsdfMapPtr()->getDistanceAndGradientAtPosition(
-          position, kInterpolate, &distance, gradient)) {
-    return 0.0;
-  }
-  return distance;
+  return distance_source_.getDistanceAndGradient(position, gradient);
 }
 
 bool MavLocalPlanner::isPathCollisionFree(
     const mav_msgs::EigenTrajectoryPointVector& path) const {
+  ScopedTrace trace("local_planner/collision_check", "local_planner");
+  MapQueryScope scope;
   for (const mav_msgs::EigenTrajectoryPoint& point : path) {
     if (getMapDistance(point.position_W) < constraints_.robot_radius - 0.1) {
       return false;
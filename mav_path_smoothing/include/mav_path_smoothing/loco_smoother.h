@@ -2,6 +2,7 @@
 #define MAV_PATH_SMOOTHING_LOCO_SMOOTHER_H_
 
 #include <loco_planner/loco.h>
+#include <mav_planning_common/distance_source.h>
 
 #include "mav_path_smoothing/polynomial_smoother.h"
 
@@ -16,7 +17,22 @@ class LocoSmoother : public PolynomialSmoother {
   LocoSmoother();
   virtual ~LocoSmoother() {}
 
-  virtual void setParametersFromRos(const ros::NodeHandle& nh);
+  virtual void setParametersFromRos(const ros::NodeHandle& nh) {
+    setParameters(nh);
+  }
+  template <typename ParamSource>
+  void setParameters(const ParamSource& params) {
+    PolynomialSmoother::setParameters(params);
+    params.param("resample_trajectory", resample_trajectory_,
+                 resample_trajectory_);
+    params.param("resample_visbility", resample_visibility_,
+                 resample_visibility_);
+    params.param("add_waypoints", add_waypoints_, add_waypoints_);
+    params.param("num_segments", num_segments_, num_segments_);
+
+    // Force some settings.
+    split_at_collisions_ = false;
+  }
 
   virtual bool getTrajectoryBetweenWaypoints(
       const mav_msgs::EigenTrajectoryPoint::Vector& waypoints,
@@ -52,6 +68,17 @@ class LocoSmoother : public PolynomialSmoother {
   void setDistanceAndGradientFunction(
       const DistanceAndGradientFunctionType& function) {
     distance_and_gradient_function_ = function;
+    batch_distance_and_gradient_function_ = nullptr;
+  }
+  // Or look up distances directly in a DistanceSource (see
+  // mav_planning_common/distance_source.h), which makes LOCO look up all the
+  // samples of an evaluation at once. Doesn't touch the map distance
+  // callback. The source has to outlive the smoother.
+  template <typename DistanceSource>
+  void setDistanceSource(const DistanceSource* source) {
+    distance_and_gradient_function_ = makeDistanceAndGradientFunction(source);
+    batch_distance_and_gradient_function_ =
+        loco_planner::Loco<>::makeBatchDistanceAndGradientFunction(source);
   }
 
  protected:
@@ -65,6 +92,8 @@ class LocoSmoother : public PolynomialSmoother {
   bool scale_time_;
 
   DistanceAndGradientFunctionType distance_and_gradient_function_;
+  loco_planner::Loco<>::BatchDistanceAndGradientFunctionType
+      batch_distance_and_gradient_function_;
 };
 
 }  // namespace mav_planning
@@ -3,6 +3,7 @@
 
 #include <mav_msgs/eigen_mav_msgs.h>
 #include <ros/ros.h>
+#include <atomic>
 
 #include <mav_planning_common/physical_constraints.h>
 
@@ -10,16 +11,34 @@ namespace mav_planning {
 
 class PathSmootherBase {
  public:
-  PathSmootherBase() : verbose_(true) {}
+  PathSmootherBase() : verbose_(true), cancel_(nullptr) {}
   virtual ~PathSmootherBase() {}
 
-  virtual void setParametersFromRos(const ros::NodeHandle& nh);
+  virtual void setParametersFromRos(const ros::NodeHandle& nh) {
+    setParameters(nh);
+  }
+  // Same, from anything with a ros::NodeHandle-style param(key, value,
+  // default), i.e. a benchmark ConfigFile. Not virtual, every smoother hides
+  // it with its own that calls its parent's.
+  template <typename ParamSource>
+  void setParameters(const ParamSource& params) {
+    constraints_.setParameters(params);
+    params.param("verbose", verbose_, verbose_);
+  }
   void setPhysicalConstraints(const PhysicalConstraints& constraints);
   const PhysicalConstraints& getPhysicalConstraints() const;
 
   void setVerbose(bool verbose) { verbose_ = verbose; }
   bool getVerbose() const { return verbose_; }
 
+  // Optional, for running smoothers in parallel and dropping the ones that
+  // aren't needed anymore. OWNED BY ANOTHER OBJECT. Once it's set to true,
+  // smoothing gives up at the next point it can and returns false.
+  void setCancelFlag(const std::atomic<bool>* cancel) { cancel_ = cancel; }
+  bool isCancelled() const {
+    return cancel_ != nullptr && cancel_->load(std::memory_order_relaxed);
+  }
+
   // By default, getPathBetweenWaypoints just calls getPathBetweenTwoPoints
   // on consecutive waypoints.
   virtual bool getPathBetweenWaypoints(
@@ -37,6 +56,7 @@ class PathSmootherBase {
   PhysicalConstraints constraints_;
 
   bool verbose_;
+  const std::atomic<bool>* cancel_;
 };
 
 }  // namespace mav_planning
@@ -1,6 +1,7 @@
 #ifndef MAV_PATH_SMOOTHING_POLYNOMIAL_SMOOTHER_H_
 #define MAV_PATH_SMOOTHING_POLYNOMIAL_SMOOTHER_H_
 
+#include <Eigen/Geometry>
 #include <mav_trajectory_generation/trajectory.h>
 
 #include "mav_path_smoothing/path_smoother_base.h"
@@ -12,7 +13,19 @@ class PolynomialSmoother : public PathSmootherBase {
   PolynomialSmoother();
   virtual ~PolynomialSmoother() {}
 
-  virtual void setParametersFromRos(const ros::NodeHandle& nh);
+  virtual void setParametersFromRos(const ros::NodeHandle& nh) {
+    setParameters(nh);
+  }
+  template <typename ParamSource>
+  void setParameters(const ParamSource& params) {
+    PathSmootherBase::setParameters(params);
+    params.param("optimize_time", optimize_time_, optimize_time_);
+    params.param("split_at_collisions", split_at_collisions_,
+                 split_at_collisions_);
+    params.param("incremental_split", incremental_split_, incremental_split_);
+    params.param("min_col_check_resolution", min_col_check_resolution_,
+                 min_col_check_resolution_);
+  }
 
   virtual bool getTrajectoryBetweenWaypoints(
       const mav_msgs::EigenTrajectoryPoint::Vector& waypoints,
@@ -32,6 +45,9 @@ class PolynomialSmoother : public PathSmootherBase {
       MapDistanceFunctionType;
   typedef std::function<bool(const Eigen::Vector3d& position)>
       InCollisionFunctionType;
+  typedef std::function<bool(const Eigen::Vector3d& position,
+                             double min_distance, Eigen::AlignedBox3d* region)>
+      FreeRegionFunctionType;
 
   // If using splitting at collisions, one of these needs to be set.
   // Map distance is compared against the radius in the physical constraints.
@@ -42,6 +58,14 @@ class PolynomialSmoother : public PathSmootherBase {
   void setInCollisionCallback(const InCollisionFunctionType& function) {
     in_collision_func_ = function;
   }
+  // Optional, on top of the map distance callback. Function should return
+  // whether the map distance is above min_distance everywhere in some region
+  // around the position, and set region to it. If not, region should be set
+  // to one where the answer is the same. Path and trajectory checks then skip
+  // the map distance lookups inside free regions.
+  void setFreeRegionCallback(const FreeRegionFunctionType& function) {
+    free_region_func_ = function;
+  }
 
   // Uses whichever collision checking method is set to check for collisions.
   virtual bool isPositionInCollision(const Eigen::Vector3d& pos) const;
@@ -49,6 +73,11 @@ class PolynomialSmoother : public PathSmootherBase {
   // min_col_check_resolution. Returns time of collision in t, if not null.
   virtual bool isPathInCollision(
       const mav_msgs::EigenTrajectoryPoint::Vector& path, double* t) const;
+  // Same, but samples the trajectory lazily every sampling_dt from start_time
+  // on, and stops at the first collision without sampling the rest.
+  virtual bool isTrajectoryInCollision(
+      const mav_trajectory_generation::Trajectory& trajectory,
+      double start_time, double* t) const;
 
   // Parameters.
   bool getOptimizeTime() const { return optimize_time_; }
@@ -57,6 +86,10 @@ class PolynomialSmoother : public PathSmootherBase {
   void setSplitAtCollisions(bool split_at_collisions) {
     split_at_collisions_ = split_at_collisions;
   }
+  bool getIncrementalSplit() const { return incremental_split_; }
+  void setIncrementalSplit(bool incremental_split) {
+    incremental_split_ = incremental_split;
+  }
   double getMinCollisionCheckResolution() const {
     return min_col_check_resolution_;
   }
@@ -65,11 +98,35 @@ class PolynomialSmoother : public PathSmootherBase {
   }
 
  protected:
-  // Add intermediate vertex for splitting.
+  // Polynomial order and number of dimensions used for smoothing.
+  static constexpr int kN = 10;
+  static constexpr int kD = 3;
+
+  // Add intermediate vertex for splitting. Returns the index of the new vertex
+  // in new_vertex_index, if not null.
   bool addVertex(double t,
                  const mav_trajectory_generation::Trajectory& trajectory,
                  mav_trajectory_generation::Vertex::Vector* vertices,
-                 std::vector<double>* segment_times) const;
+                 std::vector<double>* segment_times,
+                 size_t* new_vertex_index) const;
+
+  // After addVertex, re-solve only the segments next to the new vertex, with
+  // the derivatives at the ends of that window pinned to the current
+  // trajectory, and splice them into the trajectory. Everything outside the
+  // window stays the same. Returns the time the window starts at.
+  bool resolveAroundVertex(
+      const mav_trajectory_generation::Vertex::Vector& vertices,
+      const std::vector<double>& segment_times, size_t new_vertex_index,
+      int derivative_to_optimize,
+      mav_trajectory_generation::Trajectory* trajectory,
+      double* window_start_time) const;
+
+  // Same as isPositionInCollision(), but asks the free region callback first,
+  // if there is one. region and region_free are its last answer, kept between
+  // calls, and only asked again for positions outside of the region.
+  bool isPositionInCollisionUsingRegions(const Eigen::Vector3d& pos,
+                                         Eigen::AlignedBox3d* region,
+                                         bool* region_free) const;
 
   // Figure out what kind of polynomial smoothing to do...
 
@@ -81,12 +138,17 @@ class PolynomialSmoother : public PathSmootherBase {
   // the map are found.
   bool split_at_collisions_;
 
+  // Whether to only re-solve and re-check the part of the trajectory around
+  // each added vertex, rather than the whole thing.
+  bool incremental_split_;
+
   // Minimum distance between collision checks.
   double min_col_check_resolution_;
 
   // Functions for collision checking.
   MapDistanceFunctionType map_distance_func_;
   InCollisionFunctionType in_collision_func_;
+  FreeRegionFunctionType free_region_func_;
 };
 
 }  // namespace mav_planning
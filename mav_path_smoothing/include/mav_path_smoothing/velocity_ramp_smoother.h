@@ -5,13 +5,52 @@
 
 namespace mav_planning {
 
+// Lazily steps through a 1D velocity ramp (accelerate, cruise, decelerate)
+// along the straight line from start to goal, one sampling_dt at a time.
+// Produces the same points as VelocityRampSmoother, without storing them.
+class VelocityRampSampler {
+ public:
+  VelocityRampSampler(const mav_msgs::EigenTrajectoryPoint& start,
+                      const mav_msgs::EigenTrajectoryPoint& goal,
+                      const PhysicalConstraints& constraints);
+
+  // Fills in the next point and returns true, or false once past the goal.
+  bool next(mav_msgs::EigenTrajectoryPoint* point);
+
+  size_t getNumSamples() const { return num_elements_ + 1; }
+  double getTotalTime() const { return total_segment_time_; }
+  double getTotalDistance() const { return total_segment_distance_; }
+  double getMinAccelerationDistance() const {
+    return min_acceleration_distance_;
+  }
+  double getMinAccelerationTime() const { return min_acceleration_time_; }
+
+ private:
+  mav_msgs::EigenTrajectoryPoint start_;
+  mav_msgs::EigenTrajectoryPoint goal_;
+  PhysicalConstraints constraints_;
+
+  Eigen::Vector3d path_direction_;
+  double total_segment_distance_;
+  double total_segment_time_;
+  double min_acceleration_time_;
+  double min_acceleration_distance_;
+  size_t num_elements_;
+  int64_t dt_ns_;
+
+  // 1D state along the ramp.
+  size_t index_;
+  double position_;
+  double velocity_;
+  int64_t current_time_ns_;
+  int64_t last_time_ns_;
+};
+
 class VelocityRampSmoother : public PathSmootherBase {
  public:
   VelocityRampSmoother() : PathSmootherBase() {}
   virtual ~VelocityRampSmoother() {}
 
-  virtual void setParametersFromRos(const ros::NodeHandle& nh);
-
   virtual bool getPathBetweenTwoPoints(
       const mav_msgs::EigenTrajectoryPoint& start,
       const mav_msgs::EigenTrajectoryPoint& goal,
@@ -1,4 +1,5 @@
 #include <loco_planner/loco.h>
+#include <mav_planning_common/scoped_trace.h>
 #include <mav_planning_common/visibility_resampling.h>
 #include <mav_trajectory_generation/trajectory_sampling.h>
 
@@ -16,17 +17,6 @@ LocoSmoother::LocoSmoother()
   split_at_collisions_ = false;
 }
 
-void LocoSmoother::setParametersFromRos(const ros::NodeHandle& nh) {
-  PolynomialSmoother::setParametersFromRos(nh);
-  nh.param("resample_trajectory", resample_trajectory_, resample_trajectory_);
-  nh.param("resample_visbility", resample_visibility_, resample_visibility_);
-  nh.param("add_waypoints", add_waypoints_, add_waypoints_);
-  nh.param("num_segments", num_segments_, num_segments_);
-
-  // Force some settings.
-  split_at_collisions_ = false;
-}
-
 bool LocoSmoother::getTrajectoryBetweenWaypoints(
     const mav_msgs::EigenTrajectoryPoint::Vector& waypoints,
     mav_trajectory_generation::Trajectory* trajectory) const {
@@ -39,6 +29,7 @@ bool LocoSmoother::getTrajectoryBetweenWaypoints(
                                                              trajectory);
   }
   mav_trajectory_generation::timing::Timer loco_timer("smoothing/poly_loco");
+  ScopedTrace trace("smoothing/loco", "smoothing");
 
   // Create a loco object! So Loco!
   mav_trajectory_generation::Trajectory traj_initial;
@@ -62,13 +53,19 @@ bool LocoSmoother::getTrajectoryBetweenWaypoints(
 
   loco.setRobotRadius(constraints_.robot_radius);
   loco.setMapResolution(min_col_check_resolution_);
-  if (distance_and_gradient_function_) {
+  if (batch_distance_and_gradient_function_) {
+    loco.setBatchDistanceAndGradientFunction(
+        batch_distance_and_gradient_function_);
+  } else if (distance_and_gradient_function_) {
     loco.setDistanceAndGradientFunction(
         std::bind(&LocoSmoother::getMapDistanceAndGradient, this,
                   std::placeholders::_1, std::placeholders::_2));
   } else {
     loco.setDistanceFunction(map_distance_func_);
   }
+  if (cancel_ != nullptr) {
+    loco.setStopFunction(std::bind(&LocoSmoother::isCancelled, this));
+  }
 
   if (resample_trajectory_ && !resample_visibility_) {
     loco.setupFromTrajectoryAndResample(traj_initial, num_segments_);
@@ -79,7 +76,9 @@ bool LocoSmoother::getTrajectoryBetweenWaypoints(
     loco.setWaypointsFromTrajectory(traj_initial);
   }
 
-  loco.solveProblem();
+  if (!loco.solveProblem()) {
+    return false;
+  }
   loco.getTrajectory(trajectory);
 
   if (scale_time_) {
@@ -95,6 +94,7 @@ bool LocoSmoother::getTrajectoryBetweenTwoPoints(
     const mav_msgs::EigenTrajectoryPoint& goal,
     mav_trajectory_generation::Trajectory* trajectory) const {
   mav_trajectory_generation::timing::Timer loco_timer("smoothing/poly_loco");
+  ScopedTrace trace("smoothing/loco", "smoothing");
 
   CHECK_NOTNULL(trajectory);
   constexpr int N = 10;
@@ -104,19 +104,27 @@ bool LocoSmoother::getTrajectoryBetweenTwoPoints(
 
   loco.setRobotRadius(constraints_.robot_radius);
   loco.setMapResolution(min_col_check_resolution_);
-  if (distance_and_gradient_function_) {
+  if (batch_distance_and_gradient_function_) {
+    loco.setBatchDistanceAndGradientFunction(
+        batch_distance_and_gradient_function_);
+  } else if (distance_and_gradient_function_) {
     loco.setDistanceAndGradientFunction(
         std::bind(&LocoSmoother::getMapDistanceAndGradient, this,
                   std::placeholders::_1, std::placeholders::_2));
   } else {
     loco.setDistanceFunction(map_distance_func_);
   }
+  if (cancel_ != nullptr) {
+    loco.setStopFunction(std::bind(&LocoSmoother::isCancelled, this));
+  }
 
   double total_time = mav_trajectory_generation::computeTimeVelocityRamp(
       start.position_W, goal.position_W, constraints_.v_max,
       constraints_.a_max);
   loco.setupFromTrajectoryPoints(start, goal, num_segments_, total_time);
-  loco.solveProblem();
+  if (!loco.solveProblem()) {
+    return false;
+  }
   loco.getTrajectory(trajectory);
 
   if (optimize_time_) {
@@ -4,11 +4,6 @@
 
 namespace mav_planning {
 
-void PathSmootherBase::setParametersFromRos(const ros::NodeHandle& nh) {
-  constraints_.setParametersFromRos(nh);
-  nh.param("verbose", verbose_, verbose_);
-}
-
 void PathSmootherBase::setPhysicalConstraints(
     const PhysicalConstraints& constraints) {
   constraints_ = constraints;
@@ -27,6 +22,9 @@ bool PathSmootherBase::getPathBetweenWaypoints(
   mav_msgs::EigenTrajectoryPointVector path_segment;
 
   for (size_t i = 1; i < waypoints.size(); i++) {
+    if (isCancelled()) {
+      return false;
+    }
     const mav_msgs::EigenTrajectoryPoint& goal = waypoints[i];
     if (getPathBetweenTwoPoints(start, goal, &path_segment)) {
       path->insert(path->end(), path_segment.begin(), path_segment.end());
@@ -1,3 +1,7 @@
+#include <mav_planning_common/map_query_scope.h>
+#include <mav_planning_common/planning_counters.h>
+#include <mav_planning_common/scoped_trace.h>
+#include <mav_planning_common/trajectory_sampler.h>
 #include <mav_trajectory_generation/polynomial_optimization_nonlinear.h>
 #include <mav_trajectory_generation/timing.h>
 #include <mav_trajectory_generation/trajectory_sampling.h>
@@ -11,16 +15,9 @@ PolynomialSmoother::PolynomialSmoother()
     : PathSmootherBase(),
       optimize_time_(true),
       split_at_collisions_(false),
+      incremental_split_(true),
       min_col_check_resolution_(0.1) {}
 
-void PolynomialSmoother::setParametersFromRos(const ros::NodeHandle& nh) {
-  PathSmootherBase::setParametersFromRos(nh);
-  nh.param("optimize_time", optimize_time_, optimize_time_);
-  nh.param("split_at_collisions", split_at_collisions_, split_at_collisions_);
-  nh.param("min_col_check_resolution", min_col_check_resolution_,
-           min_col_check_resolution_);
-}
-
 bool PolynomialSmoother::getTrajectoryBetweenWaypoints(
     const mav_msgs::EigenTrajectoryPoint::Vector& waypoints,
     mav_trajectory_generation::Trajectory* trajectory) const {
@@ -31,9 +28,10 @@ bool PolynomialSmoother::getTrajectoryBetweenWaypoints(
   // I guess this is only if method is linear.
   mav_trajectory_generation::timing::Timer linear_timer(
       "smoothing/poly_linear");
+  ScopedTrace trace("smoothing/poly", "smoothing");
 
-  constexpr int N = 10;
-  constexpr int D = 3;
+  constexpr int N = kN;
+  constexpr int D = kD;
   mav_trajectory_generation::PolynomialOptimization<N> poly_opt(D);
 
   int num_vertices = waypoints.size();
@@ -96,34 +94,55 @@ bool PolynomialSmoother::getTrajectoryBetweenWaypoints(
     nlopt.getTrajectory(trajectory);
   }
 
+  if (isCancelled()) {
+    return false;
+  }
+
   // Ok now do more stuff, if the method requires.
   if (split_at_collisions_) {
     mav_trajectory_generation::timing::Timer split_timer(
         "smoothing/poly_split");
-
-    mav_msgs::EigenTrajectoryPoint::Vector path;
-
-    // Sample it!
-    double dt = constraints_.sampling_dt;
-    mav_trajectory_generation::sampleWholeTrajectory(*trajectory, dt, &path);
+    ScopedTrace split_trace("smoothing/poly_split", "smoothing");
 
     // Check if it's in collision.
     double t = 0.0;
-    bool path_in_collision = isPathInCollision(path, &t);
+    bool path_in_collision = isTrajectoryInCollision(*trajectory, 0.0, &t);
+
+    // The time optimization may have changed the segment times, and local
+    // re-solves have to match the trajectory we actually have.
+    if (incremental_split_) {
+      segment_times = trajectory->getSegmentTimes();
+    }
 
     const int kMaxNumberOfAdditionalVertices = 10;
     int num_added = 0;
     while (path_in_collision) {
-      if (!addVertex(t, *trajectory, &vertices, &segment_times)) {
+      if (isCancelled()) {
+        return false;
+      }
+      size_t new_vertex_index = 0;
+      if (!addVertex(t, *trajectory, &vertices, &segment_times,
+                     &new_vertex_index)) {
         // Well this isn't going anywhere.
         return false;
       }
-      poly_opt.setupFromVertices(vertices, segment_times,
-                                 derivative_to_optimize);
-      poly_opt.solveLinear();
-      poly_opt.getTrajectory(trajectory);
-      mav_trajectory_generation::sampleWholeTrajectory(*trajectory, dt, &path);
-      path_in_collision = isPathInCollision(path, &t);
+
+      // Everything before the changed window was already checked, so only
+      // check from there on. Fall back to the full solve if the local one
+      // doesn't work out.
+      double check_start_time = 0.0;
+      if (!incremental_split_ ||
+          !resolveAroundVertex(vertices, segment_times, new_vertex_index,
+                               derivative_to_optimize, trajectory,
+                               &check_start_time)) {
+        poly_opt.setupFromVertices(vertices, segment_times,
+                                   derivative_to_optimize);
+        poly_opt.solveLinear();
+        poly_opt.getTrajectory(trajectory);
+        check_start_time = 0.0;
+      }
+      path_in_collision =
+          isTrajectoryInCollision(*trajectory, check_start_time, &t);
       num_added++;
       if (num_added > kMaxNumberOfAdditionalVertices) {
         break;
@@ -175,7 +194,7 @@ bool PolynomialSmoother::getPathBetweenTwoPoints(
 bool PolynomialSmoother::addVertex(
     double t, const mav_trajectory_generation::Trajectory& trajectory,
     mav_trajectory_generation::Vertex::Vector* vertices,
-    std::vector<double>* segment_times) const {
+    std::vector<double>* segment_times, size_t* new_vertex_index) const {
   // First, go through the trajectory segments and figure out between which two
   // segments the new vertex will lie.
   const mav_trajectory_generation::Segment::Vector& segments =
@@ -229,9 +248,136 @@ bool PolynomialSmoother::addVertex(
   (*segment_times)[seg_ind + 1] =
       std::max(seg_max_time - rel_time_sec, kMinTimeSec);
 
+  if (new_vertex_index != NULL) {
+    *new_vertex_index = seg_ind + 1;
+  }
+  return true;
+}
+
+bool PolynomialSmoother::resolveAroundVertex(
+    const mav_trajectory_generation::Vertex::Vector& vertices,
+    const std::vector<double>& segment_times, size_t new_vertex_index,
+    int derivative_to_optimize,
+    mav_trajectory_generation::Trajectory* trajectory,
+    double* window_start_time) const {
+  CHECK_NOTNULL(trajectory);
+  CHECK_NOTNULL(window_start_time);
+  mav_trajectory_generation::timing::Timer local_timer(
+      "smoothing/poly_split_local");
+
+  // How many segments on either side of the split one to re-solve as well.
+  constexpr size_t kNeighborSegments = 1;
+  // Highest derivative that's kept continuous between segments.
+  constexpr int kMaxContinuousDerivative = kN / 2 - 1;
+
+  const mav_trajectory_generation::Segment::Vector& old_segments =
+      trajectory->segments();
+  const size_t num_segments = segment_times.size();
+  // The trajectory should be exactly one segment short of the vertices now.
+  if (new_vertex_index == 0 || old_segments.size() + 1 != num_segments) {
+    return false;
+  }
+
+  // The old segment new_vertex_index - 1 got split in two. Segments after it
+  // are shifted back by one compared to the old trajectory.
+  const size_t split_segment = new_vertex_index - 1;
+  const size_t first_segment =
+      split_segment > kNeighborSegments ? split_segment - kNeighborSegments
+                                        : 0;
+  const size_t last_segment =
+      std::min(new_vertex_index + kNeighborSegments, num_segments - 1);
+
+  mav_trajectory_generation::Vertex::Vector window_vertices(
+      vertices.begin() + first_segment, vertices.begin() + last_segment + 2);
+  std::vector<double> window_times(segment_times.begin() + first_segment,
+                                   segment_times.begin() + last_segment + 1);
+
+  // Pin the ends of the window to whatever the trajectory does there now,
+  // unless they're the actual start or end.
+  if (first_segment > 0) {
+    const mav_trajectory_generation::Segment& old_segment =
+        old_segments[first_segment];
+    mav_trajectory_generation::Vertex start_vertex(kD);
+    for (int i = 0; i <= kMaxContinuousDerivative; ++i) {
+      start_vertex.addConstraint(i, old_segment.evaluate(0.0, i));
+    }
+    window_vertices.front() = start_vertex;
+  }
+  if (last_segment + 1 < num_segments) {
+    const mav_trajectory_generation::Segment& old_segment =
+        old_segments[last_segment - 1];
+    mav_trajectory_generation::Vertex end_vertex(kD);
+    for (int i = 0; i <= kMaxContinuousDerivative; ++i) {
+      end_vertex.addConstraint(i,
+                               old_segment.evaluate(old_segment.getTime(), i));
+    }
+    window_vertices.back() = end_vertex;
+  }
+
+  mav_trajectory_generation::PolynomialOptimization<kN> poly_opt(kD);
+  poly_opt.setupFromVertices(window_vertices, window_times,
+                             derivative_to_optimize);
+  if (!poly_opt.solveLinear()) {
+    return false;
+  }
+  mav_trajectory_generation::Segment::Vector window_segments;
+  poly_opt.getSegments(&window_segments);
+
+  // Splice the window back in.
+  mav_trajectory_generation::Segment::Vector segments(
+      old_segments.begin(), old_segments.begin() + first_segment);
+  segments.insert(segments.end(), window_segments.begin(),
+                  window_segments.end());
+  segments.insert(segments.end(), old_segments.begin() + last_segment,
+                  old_segments.end());
+
+  double start_time = 0.0;
+  for (size_t i = 0; i < first_segment; ++i) {
+    start_time += segments[i].getTime();
+  }
+
+  trajectory->clear();
+  trajectory->addSegments(segments);
+  *window_start_time = start_time;
   return true;
 }
 
+bool PolynomialSmoother::isTrajectoryInCollision(
+    const mav_trajectory_generation::Trajectory& trajectory, double start_time,
+    double* t) const {
+  if (trajectory.empty()) {
+    return true;
+  }
+  ++getPlanningCounters().collision_checks;
+  MapQueryScope scope;
+  TrajectorySampler sampler(trajectory, constraints_.sampling_dt, start_time,
+                            trajectory.getMaxTime());
+  mav_msgs::EigenTrajectoryPoint point;
+  if (!sampler.next(&point)) {
+    return false;
+  }
+  double distance_since_last_check = 0.0;
+  Eigen::Vector3d last_pos = point.position_W;
+  Eigen::AlignedBox3d region;
+  bool region_free = false;
+
+  do {
+    distance_since_last_check += (point.position_W - last_pos).norm();
+    if (distance_since_last_check > min_col_check_resolution_) {
+      if (isPositionInCollisionUsingRegions(point.position_W, &region,
+                                            &region_free)) {
+        if (t != NULL) {
+          *t = mav_msgs::nanosecondsToSeconds(point.time_from_start_ns);
+        }
+        return true;
+      }
+      last_pos = point.position_W;
+      distance_since_last_check = 0.0;
+    }
+  } while (sampler.next(&point));
+  return false;
+}
+
 // Uses whichever collision checking method is set to check for collisions.
 bool PolynomialSmoother::isPositionInCollision(
     const Eigen::Vector3d& pos) const {
@@ -244,18 +390,41 @@ bool PolynomialSmoother::isPositionInCollision(
   return false;
 }
 
+bool PolynomialSmoother::isPositionInCollisionUsingRegions(
+    const Eigen::Vector3d& pos, Eigen::AlignedBox3d* region,
+    bool* region_free) const {
+  CHECK_NOTNULL(region);
+  CHECK_NOTNULL(region_free);
+  if (!free_region_func_ || !map_distance_func_) {
+    return isPositionInCollision(pos);
+  }
+  // An empty region (the default) doesn't contain anything.
+  if (!region->contains(pos)) {
+    *region_free = free_region_func_(pos, constraints_.robot_radius, region);
+  }
+  if (*region_free && region->contains(pos)) {
+    return false;
+  }
+  return isPositionInCollision(pos);
+}
+
 bool PolynomialSmoother::isPathInCollision(
     const mav_msgs::EigenTrajectoryPoint::Vector& path, double* t) const {
   if (path.size() < 1) {
     return true;
   }
+  ++getPlanningCounters().collision_checks;
+  MapQueryScope scope;
   double distance_since_last_check = 0.0;
   Eigen::Vector3d last_pos = path[0].position_W;
+  Eigen::AlignedBox3d region;
+  bool region_free = false;
 
   for (const mav_msgs::EigenTrajectoryPoint& point : path) {
     distance_since_last_check += (point.position_W - last_pos).norm();
     if (distance_since_last_check > min_col_check_resolution_) {
-      if (isPositionInCollision(point.position_W)) {
+      if (isPositionInCollisionUsingRegions(point.position_W, &region,
+                                            &region_free)) {
         if (t != NULL) {
           *t = mav_msgs::nanosecondsToSeconds(point.time_from_start_ns);
         }
@@ -0,0 +1,71 @@
+#ifndef MAV_PLANNING_BENCHMKARK_BENCHMARK_UTILS_H_
+#define MAV_PLANNING_BENCHMKARK_BENCHMARK_UTILS_H_
+
+#include <stdio.h>
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace mav_planning {
+
+// Percentile (0-100) of already sorted values, linearly interpolated between
+// the closest ranks. 0 if there are no values.
+inline double computeSortedPercentile(const std::vector<double>& sorted_values,
+                                      double percentile) {
+  if (sorted_values.empty()) {
+    return 0.0;
+  }
+  const double rank = percentile / 100.0 * (sorted_values.size() - 1);
+  const size_t lower = static_cast<size_t>(std::floor(rank));
+  const size_t upper = std::min(lower + 1, sorted_values.size() - 1);
+  return sorted_values[lower] +
+         (rank - lower) * (sorted_values[upper] - sorted_values[lower]);
+}
+
+// Percentiles the summary files report for every metric.
+const double kSummaryPercentiles[] = {50.0, 90.0, 99.0};
+
+// Header columns for the percentiles of one metric: ",name_p50,name_p90,...".
+inline void writePercentileHeader(FILE* fp, const std::string& name) {
+  for (double percentile : kSummaryPercentiles) {
+    fprintf(fp, ",%s_p%d", name.c_str(), static_cast<int>(percentile));
+  }
+}
+
+// Writes ",p50,p90,p99" of the values.
+inline void writePercentiles(FILE* fp, std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  for (double percentile : kSummaryPercentiles) {
+    fprintf(fp, ",%f", computeSortedPercentile(values, percentile));
+  }
+}
+
+// Results files are named *.csv, everything else that belongs to the same run
+// goes next to it with a different ending.
+inline std::string getResultsPathPrefix(const std::string& results_path) {
+  const std::string kExtension = ".csv";
+  if (results_path.size() >= kExtension.size() &&
+      results_path.compare(results_path.size() - kExtension.size(),
+                           kExtension.size(), kExtension) == 0) {
+    return results_path.substr(0, results_path.size() - kExtension.size());
+  }
+  return results_path;
+}
+
+// The value as a quoted JSON string, with quotes and backslashes escaped.
+inline std::string toJsonString(const std::string& value) {
+  std::string json = "\"";
+  for (const char c : value) {
+    if (c == '"' || c == '\\') {
+      json += '\\';
+    }
+    json += c;
+  }
+  json += '"';
+  return json;
+}
+
+}  // namespace mav_planning
+
+#endif  // MAV_PLANNING_BENCHMKARK_BENCHMARK_UTILS_H_
@@ -0,0 +1,191 @@
+#ifndef MAV_PLANNING_BENCHMKARK_COLLISION_CHECKER_BENCHMARK_H_
+#define MAV_PLANNING_BENCHMKARK_COLLISION_CHECKER_BENCHMARK_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <mav_msgs/eigen_mav_msgs.h>
+#include <mav_path_smoothing/polynomial_smoother.h>
+#include <mav_planning_common/physical_constraints.h>
+#include <ompl/base/ScopedState.h>
+#include <voxblox/core/esdf_map.h>
+#include <voxblox/core/tsdf_map.h>
+#include <voxblox_planning_common/esdf_distance_source.h>
+#include <voxblox_planning_common/path_shortening.h>
+#include <voxblox_planning_common/synthetic_world.h>
+#include <voxblox_rrt_planner/ompl/ompl_voxblox.h>
+
+namespace mav_planning {
+
+struct CollisionCheckerBenchmarkConfig {
+  // Map files: base_path/esdf_name and, optionally, base_path/tsdf_name (can
+  // be the same file). The TSDF checkers are skipped without a TSDF.
+  std::string base_path;
+  std::string esdf_name;
+  std::string tsdf_name;
+  // Without an esdf_name, runs on this synthetic world instead, TSDF
+  // included. Generated maps are kept in the cache directory, if set.
+  SyntheticWorldSpec world;
+  std::string world_cache_directory;
+  // Results go to base_path/results_name_points.csv,
+  // base_path/results_name_segments.csv and
+  // base_path/results_name_distances.csv (without the .csv, if any).
+  std::string results_name;
+
+  int num_points = 100000;
+  int num_segments = 10000;
+  double max_segment_length_m = 5.0;
+  // Point-only checkers check segments at samples this far apart. 0 uses
+  // half a voxel.
+  double segment_sample_distance_m = 0.0;
+  // Every checker goes over the whole set this many times, the fastest run
+  // counts.
+  int num_repetitions = 3;
+  int seed = 0;
+
+  PhysicalConstraints constraints;
+
+  template <typename ParamSource>
+  void setParameters(const ParamSource& params) {
+    params.param("base_path", base_path, base_path);
+    params.param("esdf_name", esdf_name, esdf_name);
+    params.param("tsdf_name", tsdf_name, tsdf_name);
+    world.setParameters(params);
+    params.param("world_cache_directory", world_cache_directory,
+                 world_cache_directory);
+    params.param("results_name", results_name, results_name);
+    params.param("num_points", num_points, num_points);
+    params.param("num_segments", num_segments, num_segments);
+    params.param("max_segment_length", max_segment_length_m,
+                 max_segment_length_m);
+    params.param("segment_sample_distance", segment_sample_distance_m,
+                 segment_sample_distance_m);
+    params.param("num_repetitions", num_repetitions, num_repetitions);
+    params.param("seed", seed, seed);
+    params.param("robot_radius", constraints.robot_radius,
+                 constraints.robot_radius);
+  }
+};
+
+// Runs every collision predicate in the repo on the same random points and
+// segments over a saved or synthetic map, and reports how fast each one is
+// and how often each pair of them agrees. All of them answer "is the robot in
+// collision", but with different maps (TSDF sphere vs. ESDF distance),
+// lookups (interpolated or not) and treatment of unknown space, so they don't
+// always agree.
+// Also times the same distance lookups on the points through a std::function
+// and through EsdfDistanceSource directly, one by one and as a batch.
+class CollisionCheckerBenchmark {
+ public:
+  typedef std::function<bool(const Eigen::Vector3d& position)> PointChecker;
+  typedef std::function<bool(const Eigen::Vector3d& start,
+                             const Eigen::Vector3d& end)>
+      SegmentChecker;
+
+  struct CheckerResult {
+    std::string name;
+    size_t num_queries = 0;
+    // Fastest of all repetitions.
+    double time_sec = 0.0;
+    double collision_rate = 0.0;
+    // Fraction of queries on which this and every other checker (in the
+    // same order as the results) give the same answer.
+    std::vector<double> agreement;
+  };
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  CollisionCheckerBenchmark() {}
+
+  void setConfig(const CollisionCheckerBenchmarkConfig& config) {
+    config_ = config;
+  }
+  const CollisionCheckerBenchmarkConfig& getConfig() const { return config_; }
+
+  bool loadMap();
+  void runBenchmark();
+
+  const std::vector<CheckerResult>& getPointResults() const {
+    return point_results_;
+  }
+  const std::vector<CheckerResult>& getSegmentResults() const {
+    return segment_results_;
+  }
+  // Collision here is distance < robot radius.
+  const std::vector<CheckerResult>& getDistanceResults() const {
+    return distance_results_;
+  }
+
+  bool outputResultsCsv(const std::string& filename,
+                        const std::vector<CheckerResult>& results) const;
+  void printResults(FILE* fp) const;
+
+ private:
+  void setupCheckers();
+  void generateQueries();
+
+  // Puts start and end into the states the motion validators check.
+  void setMotionStates(const Eigen::Vector3d& start,
+                       const Eigen::Vector3d& end);
+  // Samples of the segment from start to end, including both ends.
+  void sampleSegment(const Eigen::Vector3d& start, const Eigen::Vector3d& end,
+                     mav_msgs::EigenTrajectoryPointVector* samples) const;
+  SegmentChecker makeSampledSegmentChecker(const PointChecker& checker) const;
+
+  // Runs checker(i) for all i < num_queries, for every checker.
+  typedef std::function<bool(size_t query_index)> IndexedChecker;
+  std::vector<CheckerResult> runCheckers(
+      const std::vector<std::pair<std::string, IndexedChecker> >& checkers,
+      size_t num_queries) const;
+  // Distance and gradient of every point, all lookups of a run in one call.
+  typedef std::function<void(std::vector<double>* distances,
+                             std::vector<Eigen::Vector3d>* gradients)>
+      DistanceLookup;
+  std::vector<CheckerResult> runDistanceLookups(
+      const std::vector<std::pair<std::string, DistanceLookup> >& lookups)
+      const;
+
+  // Distance the way the planners look it up: 0 for unknown space.
+  double getMapDistance(const Eigen::Vector3d& position,
+                        bool interpolate) const;
+
+  CollisionCheckerBenchmarkConfig config_;
+
+  std::unique_ptr<voxblox::EsdfMap> esdf_map_;
+  std::unique_ptr<voxblox::TsdfMap> tsdf_map_;
+  Eigen::Vector3d lower_bound_;
+  Eigen::Vector3d upper_bound_;
+
+  // The checkers under test.
+  ompl::base::SpaceInformationPtr space_info_;
+  std::shared_ptr<ompl::mav::TsdfVoxbloxValidityChecker> tsdf_checker_;
+  std::shared_ptr<ompl::mav::EsdfVoxbloxValidityChecker> esdf_checker_;
+  std::unique_ptr<ompl::mav::VoxbloxMotionValidator<voxblox::TsdfVoxel> >
+      tsdf_motion_validator_;
+  std::unique_ptr<ompl::mav::VoxbloxMotionValidator<voxblox::EsdfVoxel> >
+      esdf_motion_validator_;
+  // Allocated once, so the motion validators aren't timed with allocations.
+  std::unique_ptr<ompl::base::ScopedState<ompl::mav::StateSpace> >
+      motion_start_;
+  std::unique_ptr<ompl::base::ScopedState<ompl::mav::StateSpace> >
+      motion_end_;
+  EsdfPathShortener path_shortener_;
+  PolynomialSmoother poly_smoother_;
+
+  std::vector<std::pair<std::string, PointChecker> > point_checkers_;
+  std::vector<std::pair<std::string, SegmentChecker> > segment_checkers_;
+
+  // Same queries for every checker.
+  std::vector<Eigen::Vector3d> points_;
+  std::vector<std::pair<Eigen::Vector3d, Eigen::Vector3d> > segments_;
+
+  std::vector<CheckerResult> point_results_;
+  std::vector<CheckerResult> segment_results_;
+  std::vector<CheckerResult> distance_results_;
+};
+
+}  // namespace mav_planning
+
+#endif  // MAV_PLANNING_BENCHMKARK_COLLISION_CHECKER_BENCHMARK_H_
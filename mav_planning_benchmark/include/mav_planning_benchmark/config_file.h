@@ -0,0 +1,48 @@
+#ifndef MAV_PLANNING_BENCHMKARK_CONFIG_FILE_H_
+#define MAV_PLANNING_BENCHMKARK_CONFIG_FILE_H_
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace mav_planning {
+
+// Reads benchmark settings from a flat "key: value" file (a small subset of
+// YAML: one key per line, '#' comments, lists as "[a, b]" or "a, b"), so the
+// benchmarks can run without a ROS master. param() has the same signature as
+// ros::NodeHandle::param(), so settings can be read with the same code from
+// either one.
+class ConfigFile {
+ public:
+  ConfigFile() {}
+
+  // Returns false if the file can't be opened or has malformed lines.
+  bool load(const std::string& filename);
+  // Sets or overrides a single value, i.e. from the command line.
+  void set(const std::string& key, const std::string& value);
+
+  bool hasParam(const std::string& key) const;
+
+  void param(const std::string& key, std::string& value,
+             const std::string& default_value) const;
+  void param(const std::string& key, double& value,
+             double default_value) const;
+  void param(const std::string& key, int& value, int default_value) const;
+  void param(const std::string& key, bool& value, bool default_value) const;
+  void param(const std::string& key, std::vector<std::string>& value,
+             const std::vector<std::string>& default_value) const;
+
+  // Keys that were in the file but never read, most likely typos.
+  std::vector<std::string> getUnusedKeys() const;
+
+ private:
+  bool getString(const std::string& key, std::string* value) const;
+
+  std::map<std::string, std::string> values_;
+  mutable std::set<std::string> used_keys_;
+};
+
+}  // namespace mav_planning
+
+#endif  // MAV_PLANNING_BENCHMKARK_CONFIG_FILE_H_
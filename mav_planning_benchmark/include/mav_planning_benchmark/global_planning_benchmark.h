@@ -1,19 +1,163 @@
 #ifndef MAV_PLANNING_BENCHMKARK_GLOBAL_PLANNING_BENCHMARK_H_
 #define MAV_PLANNING_BENCHMKARK_GLOBAL_PLANNING_BENCHMARK_H_
 
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include <mav_path_smoothing/loco_smoother.h>
 #include <mav_path_smoothing/polynomial_smoother.h>
 #include <mav_path_smoothing/velocity_ramp_smoother.h>
 #include <mav_planning_common/physical_constraints.h>
-#include <voxblox_ros/esdf_server.h>
+#include <voxblox/core/esdf_map.h>
+#include <voxblox_planning_common/esdf_distance_source.h>
 #include <voxblox_rrt_planner/voxblox_ompl_rrt.h>
 #include <voxblox_skeleton/io/skeleton_io.h>
 #include <voxblox_skeleton/skeleton_planner.h>
+#include <voxblox_skeleton/skeleton_attachment.h>
 #include <voxblox_skeleton/sparse_graph_planner.h>
 #include <voxblox_skeleton_planner/skeleton_graph_planner.h>
 
 namespace mav_planning {
 
+// One global planner setup to benchmark. Every entry is run and reported as
+// its own method, so the same planner with a few different time budgets gives
+// a time vs. quality curve instead of a single point.
+// Read from keys under the name, i.e. rrt_star_5s/type, rrt_star_5s/plan_time.
+struct GlobalPlannerConfig {
+  std::string name;
+  // Any of the global planning method names, defaults to the name so that
+  // plain "rrt_star" still works.
+  std::string type;
+  // Only for the OMPL planners.
+  double plan_time_sec = 1.0;
+  bool simplify_solution = true;
+  // Optimistic planners check collisions against the TSDF (unknown is free),
+  // pessimistic ones against the ESDF.
+  bool optimistic = false;
+  // Runs this many planners on the same query in parallel and keeps the
+  // shortest path.
+  int num_threads = 1;
+  // PRM only: the roadmap is grown once for the whole map before the trials.
+  double roadmap_time_sec = 2.0;
+
+  explicit GlobalPlannerConfig(const std::string& name = "",
+                               double plan_time_sec = 1.0)
+      : name(name), type(name), plan_time_sec(plan_time_sec) {}
+
+  template <typename ParamSource>
+  void setParameters(const ParamSource& params) {
+    const std::string prefix = name + "/";
+    params.param(prefix + "type", type, type);
+    // Shared by all planners of a type, i.e. rrt_star_plan_time.
+    params.param(type + "_plan_time", plan_time_sec, plan_time_sec);
+    params.param(prefix + "plan_time", plan_time_sec, plan_time_sec);
+    params.param(prefix + "simplify_solution", simplify_solution,
+                 simplify_solution);
+    params.param(prefix + "optimistic", optimistic, optimistic);
+    params.param(prefix + "num_threads", num_threads, num_threads);
+    params.param(type + "_roadmap_time", roadmap_time_sec, roadmap_time_sec);
+    params.param(prefix + "roadmap_time", roadmap_time_sec, roadmap_time_sec);
+  }
+};
+
+// Everything the global benchmark needs to know to run. Can be filled in by
+// hand, or with setParameters() from anything that has a
+// ros::NodeHandle-style param(key, value, default): a ROS node handle or a
+// ConfigFile.
+struct GlobalBenchmarkConfig {
+  // Map files: base_path/esdf_name and base_path/sparse_graph_name. Results
+  // go to base_path/results_name.
+  std::string base_path;
+  std::string esdf_name;
+  std::string sparse_graph_name;
+  std::string results_name;
+
+  int num_trials = 100;
+  // Trials are spread over this many workers, each with its own planners and
+  // smoothers. 0 uses one per core.
+  int num_threads = 1;
+  double min_start_goal_distance_m = 2.0;
+  bool verbose = false;
+  // Record how the path cost of the OMPL planners improves over the planning
+  // time, see VoxbloxOmplRrt::setRecordCostTrace(). Slows them down, so don't
+  // compare computation times of runs with it against runs without.
+  bool record_cost_traces = false;
+  // Connect the skeleton planner's start and goal through an attachment
+  // field, built when the map is loaded, instead of by A*.
+  bool use_skeleton_attachment = true;
+
+  PhysicalConstraints constraints;
+
+  // Which global planners to run. Set with the global_planning_methods list
+  // of names, each of which can have its own settings (see
+  // GlobalPlannerConfig).
+  std::vector<GlobalPlannerConfig> global_planners = {
+      GlobalPlannerConfig("straight_line"),
+      GlobalPlannerConfig("rrt_connect", 1.0),
+      GlobalPlannerConfig("rrt_star", 2.0),
+      GlobalPlannerConfig("skeleton_graph"),
+      GlobalPlannerConfig("prm", 0.01)};
+  // Which smoothers to run on every global plan, by name (see the
+  // *FromString functions).
+  std::vector<std::string> path_smoothing_methods = {
+      "none", "velocity_ramp", "polynomial", "loco"};
+
+  template <typename ParamSource>
+  void setParameters(const ParamSource& params) {
+    params.param("base_path", base_path, base_path);
+    params.param("esdf_name", esdf_name, esdf_name);
+    params.param("sparse_graph_name", sparse_graph_name, sparse_graph_name);
+    params.param("results_name", results_name, results_name);
+    params.param("num_trials", num_trials, num_trials);
+    params.param("num_threads", num_threads, num_threads);
+    params.param("min_start_goal_distance", min_start_goal_distance_m,
+                 min_start_goal_distance_m);
+    params.param("verbose", verbose, verbose);
+    params.param("record_cost_traces", record_cost_traces, record_cost_traces);
+    params.param("use_skeleton_attachment", use_skeleton_attachment,
+                 use_skeleton_attachment);
+
+    params.param("v_max", constraints.v_max, constraints.v_max);
+    params.param("a_max", constraints.a_max, constraints.a_max);
+    params.param("yaw_rate_max", constraints.yaw_rate_max,
+                 constraints.yaw_rate_max);
+    params.param("robot_radius", constraints.robot_radius,
+                 constraints.robot_radius);
+    params.param("sampling_dt", constraints.sampling_dt,
+                 constraints.sampling_dt);
+
+    std::vector<std::string> planner_names;
+    for (const GlobalPlannerConfig& planner : global_planners) {
+      planner_names.push_back(planner.name);
+    }
+    params.param("global_planning_methods", planner_names, planner_names);
+    std::vector<GlobalPlannerConfig> planners;
+    for (const std::string& name : planner_names) {
+      GlobalPlannerConfig planner(name);
+      // Start from the current settings if there are any.
+      for (const GlobalPlannerConfig& existing_planner : global_planners) {
+        if (existing_planner.name == name) {
+          planner = existing_planner;
+        }
+      }
+      planner.setParameters(params);
+      planners.push_back(planner);
+    }
+    global_planners.swap(planners);
+
+    params.param("path_smoothing_methods", path_smoothing_methods,
+                 path_smoothing_methods);
+  }
+};
+
+// Runs every global planner x path smoother combination between random start
+// and goal points in a saved map. Doesn't need ROS to be running; see
+// GlobalPlanningBenchmarkRos for visualization.
+// Trials can run in parallel: every trial is seeded with its trial number, so
+// the results are the same as a serial run, in the same order (except for the
+// time-limited OMPL planners, which never were repeatable).
 class GlobalPlanningBenchmark {
  public:
   enum GlobalPlanningMethod {
@@ -22,7 +166,8 @@ class GlobalPlanningBenchmark {
     kRrtStar,
     kSkeletonGraph,
     kPrm,
-    kBitStar
+    kBitStar,
+    kInformedRrtStar
   };
 
   enum PathSmoothingMethod { kNone = 0, kVelocityRamp, kPolynomial, kLoco, kLoco2, kLoco3 };
@@ -33,36 +178,154 @@ class GlobalPlanningBenchmark {
     double v_max = 0.0;
     double a_max = 0.0;
     GlobalPlanningMethod global_planning_method;
+    // Index into the config's global_planners, there can be several of the
+    // same method.
+    int global_planner = 0;
     PathSmoothingMethod path_smoothing_method;
     bool planning_success = false;
     bool is_collision_free = false;
     bool is_feasible = false;
+    // Global planning + smoothing.
     double computation_time_sec = 0.0;
     double total_path_time_sec = 0.0;
     double total_path_length_m = 0.0;
     double straight_line_path_length_m = 0.0;
+
+    // Per stage. Shortening is part of global planning, collision check is
+    // the evaluation of the final path and not part of the computation time.
+    double global_plan_time_sec = 0.0;
+    double shortening_time_sec = 0.0;
+    double smoothing_time_sec = 0.0;
+    double collision_check_time_sec = 0.0;
+    // Work done by the planner and smoother (see PlanningCounters).
+    size_t num_distance_queries = 0;
+    size_t num_collision_checks = 0;
+    size_t num_allocations = 0;
+    // How much planning + smoothing raised the peak RSS of the process. With
+    // several threads, this can't tell which trial did it.
+    size_t peak_rss_delta_kb = 0;
+    // Of the global planner, if recorded. Same for every smoother.
+    VoxbloxOmplRrt::CostTrace cost_trace;
   };
 
-  GlobalPlanningBenchmark(const ros::NodeHandle& nh,
-                          const ros::NodeHandle& nh_private);
+  // Called after every trial, in trial order and from the calling thread,
+  // with the results and paths of all the method combinations in that trial.
+  // Return false to stop the benchmark.
+  typedef std::function<bool(
+      int trial, const std::vector<GlobalBenchmarkResult>& results,
+      const std::vector<mav_msgs::EigenTrajectoryPointVector>& paths)>
+      TrialCallback;
+
+  GlobalPlanningBenchmark();
+
+  // Returns false if any of the method names are unknown or the planner
+  // settings don't make sense.
+  bool setConfig(const GlobalBenchmarkConfig& config);
+  const GlobalBenchmarkConfig& getConfig() const { return config_; }
+
+  void setTrialCallback(const TrialCallback& callback) {
+    trial_callback_ = callback;
+  }
 
-  void loadMap(const std::string& base_path, const std::string& esdf_name,
+  // For the settings of the skeleton planner and the smoothers that aren't
+  // in the config (i.e. shorten_path, shortening_method, add_waypoints,
+  // incremental_split): read with their setParameters() from the same kind
+  // of param source as the config, a ROS node handle or a ConfigFile. Read
+  // for every worker when the planners are set up, before the config is
+  // applied to them, so the config wins where both set something. The params
+  // are OWNED BY ANOTHER OBJECT and have to outlive loadMap(). Set before
+  // loadMap().
+  template <typename ParamSource>
+  void setComponentParameters(const ParamSource* params) {
+    CHECK_NOTNULL(params);
+    component_setup_ = [params](TrialWorker* worker) {
+      worker->skeleton_planner.setParameters(*params);
+      worker->ramp_smoother.setParameters(*params);
+      worker->poly_smoother.setParameters(*params);
+      worker->loco_smoother.setParameters(*params);
+      worker->loco2_smoother.setParameters(*params);
+      worker->loco3_smoother.setParameters(*params);
+    };
+  }
+
+  // Loads the map and graph from the paths in the config and sets up all the
+  // planners.
+  bool loadMap();
+  bool loadMap(const std::string& base_path, const std::string& esdf_name,
                const std::string& sparse_graph_name);
 
+  void runBenchmark();
   void runBenchmark(int num_trials);
 
-  void outputResults(const std::string& filename);
+  const std::vector<GlobalBenchmarkResult>& getResults() const {
+    return results_;
+  }
+  bool outputResultsCsv(const std::string& filename) const;
+  bool outputResultsJson(const std::string& filename) const;
+  // One line per configured global planner x smoother, with success rates and
+  // p50/p90/p99 of the timings and counters over all trials.
+  bool outputSummaryCsv(const std::string& filename) const;
+  // One line per cost trace point, per trial and global planner. Empty unless
+  // record_cost_traces is set.
+  bool outputCostTracesCsv(const std::string& filename) const;
+
+  // Map accessors, so that wrappers can visualize.
+  const voxblox::EsdfMap* getEsdfMap() const { return esdf_map_.get(); }
+  const voxblox::SparseSkeletonGraph& getSkeletonGraph() const {
+    return skeleton_graph_;
+  }
+
+  // Names as used in the config.
+  static std::string globalPlanningMethodToString(GlobalPlanningMethod method);
+  static std::string pathSmoothingMethodToString(PathSmoothingMethod method);
+  static bool globalPlanningMethodFromString(const std::string& name,
+                                             GlobalPlanningMethod* method);
+  static bool pathSmoothingMethodFromString(const std::string& name,
+                                            PathSmoothingMethod* method);
 
  private:
+  // Everything a trial modifies while running, one per thread. The map and
+  // the sparse graph are shared and read-only.
+  struct TrialWorker {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    // Global Planners! One list per entry in the config's global_planners,
+    // with one planner per planning thread for the OMPL ones and empty for
+    // everything else.
+    std::vector<std::vector<std::unique_ptr<VoxbloxOmplRrt>>> ompl_planners;
+    SkeletonGraphPlanner skeleton_planner;
+
+    // Path Smoothers!
+    VelocityRampSmoother ramp_smoother;
+    PolynomialSmoother poly_smoother;
+    LocoSmoother loco_smoother;
+    LocoSmoother loco2_smoother;
+    LocoSmoother loco3_smoother;
+  };
+
   void setupPlanners();
+  void setupWorker(TrialWorker* worker);
+  int getNumThreads() const;
+
+  // Runs all the method combinations for one trial. Returns false if there's
+  // no valid start and goal.
+  bool runTrial(int trial, TrialWorker* worker,
+                std::vector<GlobalBenchmarkResult>* results,
+                std::vector<mav_msgs::EigenTrajectoryPointVector>* paths) const;
+  void runTrialsSerial(int num_trials);
+  void runTrialsParallel(int num_trials, int num_threads);
+  // Adds the trial to the results and calls the callback. Returns false if
+  // the benchmark should stop.
+  bool finishTrial(
+      int trial, const std::vector<GlobalBenchmarkResult>& trial_results,
+      const std::vector<mav_msgs::EigenTrajectoryPointVector>& trial_paths);
+
   bool selectRandomStartAndGoal(double minimum_distance, Eigen::Vector3d* start,
                                 Eigen::Vector3d* goal) const;
 
   double getMapDistance(const Eigen::Vector3d& position) const;
   double getMapDistanceWithoutInterpolation(
       const Eigen::Vector3d& position) const;
-  double getMapDistanceAndGradient(const Eigen::Vector3d& position,
-                                   Eigen::Vector3d* gradient) const;
 
   // Evaluate what we've got here.
   void fillInPathResults(const mav_msgs::EigenTrajectoryPointVector& path,
@@ -71,51 +334,57 @@ class GlobalPlanningBenchmark {
       const mav_msgs::EigenTrajectoryPointVector& path) const;
   bool isPathFeasible(const mav_msgs::EigenTrajectoryPointVector& path) const;
 
-  // Functions to actually run the planners.
-  bool runGlobalPlanner(const GlobalPlanningMethod planning_method,
+  // Functions to actually run the planners. The global planner is an index
+  // into the config's global_planners. The cost trace is left empty for
+  // anything that isn't OMPL.
+  bool runGlobalPlanner(size_t planner_index,
                         const mav_msgs::EigenTrajectoryPoint& start,
                         const mav_msgs::EigenTrajectoryPoint& goal,
-                        mav_msgs::EigenTrajectoryPointVector* waypoints);
+                        TrialWorker* worker,
+                        mav_msgs::EigenTrajectoryPointVector* waypoints,
+                        VoxbloxOmplRrt::CostTrace* cost_trace) const;
+  // Runs all the planners at once on the same query and keeps the shortest
+  // path, and its cost trace. Their counters are added to this thread's.
+  bool runParallelOmplPlanners(
+      const std::vector<std::unique_ptr<VoxbloxOmplRrt>>& planners,
+      const mav_msgs::EigenTrajectoryPoint& start,
+      const mav_msgs::EigenTrajectoryPoint& goal,
+      mav_msgs::EigenTrajectoryPointVector* waypoints,
+      VoxbloxOmplRrt::CostTrace* cost_trace) const;
   bool runPathSmoother(const PathSmoothingMethod smoothing_method,
                        const mav_msgs::EigenTrajectoryPointVector& waypoints,
-                       mav_msgs::EigenTrajectoryPointVector* path);
-
-  ros::NodeHandle nh_;
-  ros::NodeHandle nh_private_;
+                       TrialWorker* worker,
+                       mav_msgs::EigenTrajectoryPointVector* path) const;
 
-  // ROS stuff.
-  ros::Publisher path_marker_pub_;
+  GlobalBenchmarkConfig config_;
+  TrialCallback trial_callback_;
+  // See setComponentParameters(). Only ever called from one thread at a
+  // time, ConfigFile keeps track of which keys were read.
+  std::function<void(TrialWorker* worker)> component_setup_;
 
   // Settings for physical constriants.
   PhysicalConstraints constraints_;
 
   // General settings.
   bool verbose_;
-  bool visualize_;
-  std::string frame_id_;
 
-  // Voxblox Server!
-  std::unique_ptr<voxblox::EsdfServer> esdf_server_;
+  // The map!
+  std::unique_ptr<voxblox::EsdfMap> esdf_map_;
+  // Lookups in it, for getMapDistance() and LOCO.
+  EsdfDistanceSource distance_source_;
+  // Only loaded if there are optimistic planners.
+  voxblox::Layer<voxblox::TsdfVoxel>::Ptr tsdf_layer_;
   // Skeleton sparse graph!
   voxblox::SparseSkeletonGraph skeleton_graph_;
+  std::unique_ptr<voxblox::Layer<voxblox::SkeletonAttachmentVoxel> >
+      skeleton_attachment_layer_;
 
   // Map settings.
   Eigen::Vector3d lower_bound_;
   Eigen::Vector3d upper_bound_;
 
-  // Global Planners!
-  VoxbloxOmplRrt rrt_connect_planner_;
-  VoxbloxOmplRrt rrt_star_planner_;
-  VoxbloxOmplRrt bit_star_planner_;
-  VoxbloxOmplRrt prm_planner_;
-  SkeletonGraphPlanner skeleton_planner_;
-
-  // Path Smoothers!
-  VelocityRampSmoother ramp_smoother_;
-  PolynomialSmoother poly_smoother_;
-  LocoSmoother loco_smoother_;
-  LocoSmoother loco2_smoother_;
-  LocoSmoother loco3_smoother_;
+  // One per thread.
+  std::vector<std::unique_ptr<TrialWorker>> workers_;
 
   // Which methods to use.
   std::vector<GlobalPlanningMethod> global_planning_methods_;
@@ -0,0 +1,51 @@
+#ifndef MAV_PLANNING_BENCHMKARK_GLOBAL_PLANNING_BENCHMARK_ROS_H_
+#define MAV_PLANNING_BENCHMKARK_GLOBAL_PLANNING_BENCHMARK_ROS_H_
+
+#include <ros/ros.h>
+#include <visualization_msgs/MarkerArray.h>
+#include <voxblox_ros/esdf_server.h>
+
+#include "mav_planning_benchmark/global_planning_benchmark.h"
+
+namespace mav_planning {
+
+// Thin ROS wrapper around GlobalPlanningBenchmark: reads the config from ROS
+// params, and optionally publishes the map and the paths of every trial.
+class GlobalPlanningBenchmarkRos {
+ public:
+  GlobalPlanningBenchmarkRos(const ros::NodeHandle& nh,
+                             const ros::NodeHandle& nh_private);
+
+  bool loadMap();
+  void runBenchmark();
+  // Writes base_path/results_name as CSV, and next to it the same as JSON
+  // and a summary CSV.
+  void outputResults();
+
+  GlobalPlanningBenchmark& getBenchmark() { return benchmark_; }
+
+ private:
+  bool publishTrial(
+      int trial,
+      const std::vector<GlobalPlanningBenchmark::GlobalBenchmarkResult>&
+          results,
+      const std::vector<mav_msgs::EigenTrajectoryPointVector>& paths);
+
+  ros::NodeHandle nh_;
+  ros::NodeHandle nh_private_;
+
+  // ROS stuff.
+  ros::Publisher path_marker_pub_;
+
+  bool visualize_;
+  std::string frame_id_;
+
+  GlobalPlanningBenchmark benchmark_;
+
+  // Only used for visualizing the map.
+  std::unique_ptr<voxblox::EsdfServer> esdf_server_;
+};
+
+}  // namespace mav_planning
+
+#endif  // MAV_PLANNING_BENCHMKARK_GLOBAL_PLANNING_BENCHMARK_ROS_H_
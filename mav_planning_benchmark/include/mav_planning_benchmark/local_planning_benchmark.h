@@ -1,8 +1,14 @@
 #ifndef MAV_PLANNING_BENCHMKARK_LOCAL_PLANNING_BENCHMARK_H_
 #define MAV_PLANNING_BENCHMKARK_LOCAL_PLANNING_BENCHMARK_H_
 
+#include <memory>
+
 #include <mav_msgs/eigen_mav_msgs.h>
 #include <mav_planning_common/physical_constraints.h>
+#include <voxblox/core/esdf_map.h>
+#include <voxblox/core/tsdf_map.h>
+#include <voxblox/integrator/esdf_integrator.h>
+#include <voxblox/integrator/tsdf_integrator.h>
 #include <voxblox/simulation/simulation_world.h>
 #include <voxblox_loco_planner/goal_point_selector.h>
 #include <voxblox_loco_planner/voxblox_loco_planner.h>
@@ -27,27 +33,72 @@ class LocalPlanningBenchmark {
     bool is_feasible = false;
     int num_replans = 0;
     double distance_from_goal = 0.0;
+    // Sum over all replans.
     double computation_time_sec = 0.0;
     double total_path_time_sec = 0.0;
     double total_path_length_m = 0.0;
     double straight_line_path_length_m = 0.0;
+
+    // Per stage, summed over all replans. Map update is the simulated sensor
+    // integration and ESDF update, collision check the evaluation of the
+    // executed path; neither is in the computation time.
+    double map_update_time_sec = 0.0;
+    double shortening_time_sec = 0.0;
+    double goal_selection_time_sec = 0.0;
+    double collision_check_time_sec = 0.0;
+    // Latency of the single slowest replan.
+    double max_replan_time_sec = 0.0;
+    // Work done by the planner and goal selector (see PlanningCounters).
+    size_t num_distance_queries = 0;
+    size_t num_collision_checks = 0;
+    size_t num_allocations = 0;
+    size_t peak_rss_delta_kb = 0;
+
+    // Planning time of every replan, for the summary. Not in the CSV.
+    std::vector<double> replan_times_sec;
   };
 
+  // Settings come from nh_private. Headless if either headless or the
+  // headless param is set.
   LocalPlanningBenchmark(const ros::NodeHandle& nh,
-                         const ros::NodeHandle& nh_private);
+                         const ros::NodeHandle& nh_private,
+                         bool headless = false);
 
   // General trajectory benchmark tools: call these in order.
-  void generateWorld(double density);
+  // Same density and seed, same world.
+  void generateWorld(double density, int seed);
   void runBenchmark(int trial_number);
   void outputResults(const std::string& filename);
+  // One line per method and density, with the success rate and p50/p90/p99
+  // of the per-replan latency and per-trial costs.
+  void outputSummary(const std::string& filename);
 
   // Accessors.
   bool visualize() const { return visualize_; }
+  bool headless() const { return headless_; }
+
+  // Results so far, to merge the results of several benchmark instances.
+  const std::vector<LocalBenchmarkResult>& getResults() const {
+    return results_;
+  }
+  void appendResults(const std::vector<LocalBenchmarkResult>& results) {
+    results_.insert(results_.end(), results.begin(), results.end());
+  }
+  void clearResults() { results_.clear(); }
 
  private:
   void setupPlanners();
 
-  void generateCustomWorld(const Eigen::Vector3d& size, double density);
+  // The map goes through the server if there is one, and is updated
+  // directly otherwise.
+  void setupMap();
+  void clearMap();
+  void integrateIntoMap(const voxblox::Transformation& T_G_C,
+                        const voxblox::Pointcloud& ptcloud_C,
+                        const voxblox::Colors& colors);
+
+  void generateCustomWorld(const Eigen::Vector3d& size, double density,
+                           int seed);
   // Generates a synthetic viewpoint, and adds it to the voxblox map.
   void addViewpointToMap(const mav_msgs::EigenTrajectoryPoint& viewpoint);
 
@@ -98,6 +149,11 @@ class LocalPlanningBenchmark {
   // General settings.
   bool verbose_;
   bool visualize_;
+  // Nothing is advertised or published (there's no voxblox server either)
+  // and nothing waits for the viewer, so trials run as fast as the planner
+  // and map updates allow, and several instances can run side by side.
+  // Overrides visualize.
+  bool headless_;
   std::string frame_id_;
 
   // Planning settings.
@@ -121,8 +177,13 @@ class LocalPlanningBenchmark {
   double voxel_size_;
   double density_;
 
-  // Voxblox Server!
-  voxblox::EsdfServer esdf_server_;
+  // Voxblox Server! Only if not headless, and then the maps are its own.
+  std::unique_ptr<voxblox::EsdfServer> esdf_server_;
+  std::shared_ptr<voxblox::TsdfMap> tsdf_map_;
+  std::shared_ptr<voxblox::EsdfMap> esdf_map_;
+  // Only if headless.
+  std::unique_ptr<voxblox::TsdfIntegratorBase> tsdf_integrator_;
+  std::unique_ptr<voxblox::EsdfIntegrator> esdf_integrator_;
   voxblox::SimulationWorld world_;
 
   // Planners will go here!
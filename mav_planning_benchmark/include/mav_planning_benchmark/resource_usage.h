@@ -0,0 +1,23 @@
+#ifndef MAV_PLANNING_BENCHMKARK_RESOURCE_USAGE_H_
+#define MAV_PLANNING_BENCHMKARK_RESOURCE_USAGE_H_
+
+#include <stddef.h>
+
+namespace mav_planning {
+
+// Number of operator new calls made by the calling thread so far. Counted by
+// the global operator new in src/allocation_counter.cpp, which only the
+// benchmark executables are built with; always 0 anywhere else. Allocations
+// that go straight to malloc (e.g. Eigen's aligned allocator) are not counted.
+size_t getThreadAllocationCount();
+// Called by the replaced operator new, for every allocation.
+void countThreadAllocation();
+
+// Peak resident set size of the whole process so far, in kilobytes. Only
+// ever goes up, so the difference over a call is how much that call grew the
+// peak (which is 0 if it stayed under an earlier peak).
+size_t getPeakRssKb();
+
+}  // namespace mav_planning
+
+#endif  // MAV_PLANNING_BENCHMKARK_RESOURCE_USAGE_H_
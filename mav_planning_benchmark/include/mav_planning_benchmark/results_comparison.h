@@ -0,0 +1,143 @@
+#ifndef MAV_PLANNING_BENCHMKARK_RESULTS_COMPARISON_H_
+#define MAV_PLANNING_BENCHMKARK_RESULTS_COMPARISON_H_
+
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace mav_planning {
+
+// A results CSV as written by the benchmarks: one '#'-prefixed header line,
+// then only numeric columns.
+class ResultsTable {
+ public:
+  ResultsTable() {}
+  // For results that aren't in a file, every row needs a value per column.
+  ResultsTable(const std::vector<std::string>& columns,
+               const std::vector<std::vector<double> >& rows);
+
+  bool load(const std::string& filename);
+
+  // -1 if there is no such column.
+  int getColumnIndex(const std::string& name) const;
+  bool hasColumn(const std::string& name) const {
+    return getColumnIndex(name) >= 0;
+  }
+
+  const std::vector<std::string>& getColumns() const { return columns_; }
+  const std::vector<std::vector<double> >& getRows() const { return rows_; }
+
+ private:
+  std::vector<std::string> columns_;
+  std::vector<std::vector<double> > rows_;
+};
+
+struct ResultsComparisonConfig {
+  // Lower is better for all of these.
+  std::vector<std::string> metrics = {
+      "computation_time_sec", "total_path_time_sec", "total_path_length_m"};
+  // A metric regresses if the median new/baseline ratio is above this and
+  // the whole confidence interval is above 1, so noise alone can't fail...
+  double max_ratio = 1.1;
+  // ...unless overridden per metric.
+  std::map<std::string, double> max_ratio_per_metric;
+  // Largest allowed drop in success rate (0-1) over the matched trials.
+  double max_success_rate_drop = 0.05;
+  // Only compare metrics on trials that succeeded in both runs, failed
+  // trials don't have meaningful paths.
+  bool only_successful = true;
+  // Groups with fewer matched trials are reported but can't fail.
+  int min_matched_trials = 5;
+
+  int num_bootstrap_samples = 2000;
+  double confidence = 0.95;
+  int bootstrap_seed = 0;
+
+  template <typename ParamSource>
+  void setParameters(const ParamSource& params) {
+    params.param("metrics", metrics, metrics);
+    params.param("max_ratio", max_ratio, max_ratio);
+    for (const std::string& metric : metrics) {
+      const std::string key = "max_ratio_" + metric;
+      if (params.hasParam(key)) {
+        params.param(key, max_ratio_per_metric[metric], max_ratio);
+      }
+    }
+    params.param("max_success_rate_drop", max_success_rate_drop,
+                 max_success_rate_drop);
+    params.param("only_successful", only_successful, only_successful);
+    params.param("min_matched_trials", min_matched_trials, min_matched_trials);
+    params.param("num_bootstrap_samples", num_bootstrap_samples,
+                 num_bootstrap_samples);
+    params.param("confidence", confidence, confidence);
+    params.param("bootstrap_seed", bootstrap_seed, bootstrap_seed);
+  }
+
+  double getMaxRatio(const std::string& metric) const;
+};
+
+// Compares a new benchmark run against a baseline. Trials are matched by seed
+// and by every *_method column (and global_planner or density, for the global
+// and local benchmark), and each method combination is compared on its own so
+// that a regression in one planner doesn't drown in the others.
+class ResultsComparison {
+ public:
+  struct MetricComparison {
+    std::string metric;
+    size_t num_pairs = 0;
+    // Median of new / baseline over the matched trials, and its bootstrap
+    // confidence interval.
+    double median_ratio = 1.0;
+    double ratio_lower = 1.0;
+    double ratio_upper = 1.0;
+    bool is_regression = false;
+  };
+
+  struct GroupComparison {
+    // Values of the key columns (except seed) that define this group.
+    std::vector<double> key;
+    size_t num_matched_trials = 0;
+    double baseline_success_rate = 0.0;
+    double new_success_rate = 0.0;
+    bool is_regression = false;
+    std::vector<MetricComparison> metrics;
+  };
+
+  ResultsComparison() {}
+
+  void setConfig(const ResultsComparisonConfig& config) { config_ = config; }
+  const ResultsComparisonConfig& getConfig() const { return config_; }
+
+  // Returns false if the tables can't be compared at all (no seed column,
+  // different key columns, no metric present in both).
+  bool compare(const ResultsTable& baseline, const ResultsTable& current);
+
+  const std::vector<std::string>& getGroupColumns() const {
+    return group_columns_;
+  }
+  const std::vector<GroupComparison>& getGroups() const { return groups_; }
+  bool hasRegression() const;
+
+  void printReport(FILE* fp) const;
+
+  // What compare_benchmark_results exits with: compares the two, prints the
+  // report to fp (unless null), and returns 0 if nothing regressed, 1 if
+  // anything did, and 2 if they can't be compared.
+  int compareAndReport(const ResultsTable& baseline,
+                       const ResultsTable& current, FILE* fp);
+
+ private:
+  // Median ratio and its percentile bootstrap interval.
+  void computeRatioStatistics(const std::vector<double>& ratios,
+                              MetricComparison* comparison) const;
+
+  ResultsComparisonConfig config_;
+
+  std::vector<std::string> group_columns_;
+  std::vector<GroupComparison> groups_;
+};
+
+}  // namespace mav_planning
+
+#endif  // MAV_PLANNING_BENCHMKARK_RESULTS_COMPARISON_H_
@@ -0,0 +1,46 @@
+#include <stdlib.h>
+#include <new>
+
+#include "mav_planning_benchmark/resource_usage.h"
+
+// Replaces the global operator new to count allocations, see
+// getThreadAllocationCount(). Only compiled into the benchmark executables,
+// so nothing else that links the benchmark libraries gets this allocator.
+
+namespace {
+
+void* countedAllocate(size_t size) {
+  mav_planning::countThreadAllocation();
+  // malloc(0) may return nullptr, new has to return something unique.
+  return malloc(size == 0 ? 1 : size);
+}
+
+}  // namespace
+
+void* operator new(size_t size) {
+  void* ptr = countedAllocate(size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return countedAllocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return countedAllocate(size);
+}
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+
+void operator delete[](void* ptr) noexcept { free(ptr); }
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { free(ptr); }
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+  free(ptr);
+}
@@ -0,0 +1,469 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#include <mav_planning_common/utils.h>
+#include <voxblox/io/layer_io.h>
+
+#include "mav_planning_benchmark/collision_checker_benchmark.h"
+
+namespace mav_planning {
+
+namespace {
+
+// Fills in how often every pair of answers agrees.
+void computeAgreement(
+    const std::vector<std::vector<char> >& answers,
+    std::vector<CollisionCheckerBenchmark::CheckerResult>* results) {
+  CHECK_NOTNULL(results);
+  CHECK_EQ(answers.size(), results->size());
+  for (size_t i = 0; i < answers.size(); ++i) {
+    const size_t num_queries = answers[i].size();
+    for (size_t j = 0; j < answers.size(); ++j) {
+      size_t num_agree = 0;
+      for (size_t query = 0; query < num_queries; ++query) {
+        num_agree += answers[i][query] == answers[j][query];
+      }
+      (*results)[i].agreement.push_back(
+          num_queries == 0 ? 1.0
+                           : static_cast<double>(num_agree) / num_queries);
+    }
+  }
+}
+
+// One lookup at a time, the way a planner templated on the source would.
+template <typename DistanceSource>
+void lookUpDistances(const DistanceSource& source,
+                     const std::vector<Eigen::Vector3d>& points,
+                     std::vector<double>* distances,
+                     std::vector<Eigen::Vector3d>* gradients) {
+  distances->resize(points.size());
+  gradients->resize(points.size());
+  for (size_t i = 0; i < points.size(); ++i) {
+    (*distances)[i] =
+        source.getDistanceAndGradient(points[i], &(*gradients)[i]);
+  }
+}
+
+}  // namespace
+
+bool CollisionCheckerBenchmark::loadMap() {
+  // Saved maps usually have both layers in one file, so skip over any other
+  // layers.
+  const bool kMultipleLayerSupport = true;
+  const std::string esdf_path = config_.base_path + "/" + config_.esdf_name;
+  voxblox::Layer<voxblox::EsdfVoxel>::Ptr esdf_layer;
+  tsdf_map_.reset();
+  if (config_.esdf_name.empty()) {
+    voxblox::Layer<voxblox::TsdfVoxel>::Ptr tsdf_layer;
+    SyntheticWorldGenerator generator;
+    generator.setCacheDirectory(config_.world_cache_directory);
+    generator.generate(config_.world, &tsdf_layer, &esdf_layer);
+    LOG(INFO) << (generator.wasLoadedFromCache() ? "Loaded" : "Generated")
+              << " synthetic world " << config_.world.getHash();
+    tsdf_map_.reset(new voxblox::TsdfMap(tsdf_layer));
+  } else if (!voxblox::io::LoadLayer<voxblox::EsdfVoxel>(
+                 esdf_path, kMultipleLayerSupport, &esdf_layer)) {
+    LOG(ERROR) << "Couldn't load ESDF from file: " << esdf_path;
+    return false;
+  }
+  esdf_map_.reset(new voxblox::EsdfMap(esdf_layer));
+
+  if (!config_.esdf_name.empty() && !config_.tsdf_name.empty()) {
+    const std::string tsdf_path = config_.base_path + "/" + config_.tsdf_name;
+    voxblox::Layer<voxblox::TsdfVoxel>::Ptr tsdf_layer;
+    if (!voxblox::io::LoadLayer<voxblox::TsdfVoxel>(
+            tsdf_path, kMultipleLayerSupport, &tsdf_layer)) {
+      LOG(ERROR) << "Couldn't load TSDF from file: " << tsdf_path;
+      return false;
+    }
+    tsdf_map_.reset(new voxblox::TsdfMap(tsdf_layer));
+  }
+
+  // Queries go anywhere in the allocated part of the ESDF.
+  voxblox::BlockIndexList blocks;
+  esdf_layer->getAllAllocatedBlocks(&blocks);
+  if (blocks.empty()) {
+    LOG(ERROR) << "ESDF is empty: " << esdf_path;
+    return false;
+  }
+  const double block_size = esdf_layer->block_size();
+  lower_bound_.setConstant(std::numeric_limits<double>::max());
+  upper_bound_.setConstant(std::numeric_limits<double>::lowest());
+  for (const voxblox::BlockIndex& block_index : blocks) {
+    const Eigen::Vector3d block_origin =
+        block_index.cast<double>() * block_size;
+    lower_bound_ = lower_bound_.cwiseMin(block_origin);
+    upper_bound_ = upper_bound_.cwiseMax(
+        block_origin + Eigen::Vector3d::Constant(block_size));
+  }
+
+  setupCheckers();
+  return true;
+}
+
+double CollisionCheckerBenchmark::getMapDistance(
+    const Eigen::Vector3d& position, bool interpolate) const {
+  double distance = 0.0;
+  if (!esdf_map_->getDistanceAtPosition(position, interpolate, &distance)) {
+    return 0.0;
+  }
+  return distance;
+}
+
+void CollisionCheckerBenchmark::setupCheckers() {
+  const double robot_radius = config_.constraints.robot_radius;
+  const double voxel_size = esdf_map_->voxel_size();
+
+  // The OMPL checkers only need the space for their base classes.
+  ompl::base::StateSpacePtr space(new ompl::mav::StateSpace(3));
+  ompl::base::RealVectorBounds bounds(3);
+  for (int i = 0; i < 3; ++i) {
+    bounds.setLow(i, lower_bound_[i]);
+    bounds.setHigh(i, upper_bound_[i]);
+  }
+  space->as<ompl::mav::StateSpace>()->setBounds(bounds);
+  space_info_.reset(new ompl::base::SpaceInformation(space));
+  motion_start_.reset(
+      new ompl::base::ScopedState<ompl::mav::StateSpace>(space_info_));
+  motion_end_.reset(
+      new ompl::base::ScopedState<ompl::mav::StateSpace>(space_info_));
+
+  esdf_checker_.reset(new ompl::mav::EsdfVoxbloxValidityChecker(
+      space_info_, robot_radius, esdf_map_->getEsdfLayerPtr()));
+  esdf_motion_validator_.reset(
+      new ompl::mav::VoxbloxMotionValidator<voxblox::EsdfVoxel>(
+          space_info_, esdf_checker_));
+  if (tsdf_map_) {
+    tsdf_checker_.reset(new ompl::mav::TsdfVoxbloxValidityChecker(
+        space_info_, robot_radius, tsdf_map_->getTsdfLayerPtr()));
+    tsdf_motion_validator_.reset(
+        new ompl::mav::VoxbloxMotionValidator<voxblox::TsdfVoxel>(
+            space_info_, tsdf_checker_));
+  }
+
+  path_shortener_.setConstraints(config_.constraints);
+  path_shortener_.setEsdfLayer(esdf_map_->getEsdfLayerPtr());
+
+  // Same setup as the global benchmark.
+  poly_smoother_.setPhysicalConstraints(config_.constraints);
+  poly_smoother_.setMinCollisionCheckResolution(voxel_size);
+  poly_smoother_.setMapDistanceCallback(
+      std::bind(&CollisionCheckerBenchmark::getMapDistance, this,
+                std::placeholders::_1, false));
+
+  // Point checkers.
+  point_checkers_.clear();
+  if (tsdf_checker_) {
+    point_checkers_.emplace_back(
+        "tsdf_sphere", [this](const Eigen::Vector3d& position) {
+          return tsdf_checker_->checkCollisionWithRobot(position);
+        });
+  }
+  point_checkers_.emplace_back(
+      "esdf", [this](const Eigen::Vector3d& position) {
+        return esdf_checker_->checkCollisionWithRobot(position);
+      });
+  // What the local benchmark evaluates paths with.
+  point_checkers_.emplace_back(
+      "esdf_interpolated",
+      [this, robot_radius](const Eigen::Vector3d& position) {
+        return getMapDistance(position, true) < robot_radius;
+      });
+  point_checkers_.emplace_back(
+      "poly_smoother", [this](const Eigen::Vector3d& position) {
+        return poly_smoother_.isPositionInCollision(position);
+      });
+  // VoxbloxLocoPlanner::getMapDistance() against the radius, as in
+  // isPathCollisionFree(). The planner itself needs ROS to be constructed.
+  point_checkers_.emplace_back(
+      "loco_map_distance",
+      [this, robot_radius](const Eigen::Vector3d& position) {
+        return getMapDistance(position, false) < robot_radius;
+      });
+
+  // Segment checkers: the ones that check lines themselves...
+  segment_checkers_.clear();
+  if (tsdf_motion_validator_) {
+    segment_checkers_.emplace_back(
+        "tsdf_motion",
+        [this](const Eigen::Vector3d& start, const Eigen::Vector3d& end) {
+          setMotionStates(start, end);
+          return !tsdf_motion_validator_->checkMotion(motion_start_->get(),
+                                                      motion_end_->get());
+        });
+  }
+  segment_checkers_.emplace_back(
+      "esdf_motion",
+      [this](const Eigen::Vector3d& start, const Eigen::Vector3d& end) {
+        setMotionStates(start, end);
+        return !esdf_motion_validator_->checkMotion(motion_start_->get(),
+                                                    motion_end_->get());
+      });
+  segment_checkers_.emplace_back(
+      "shortener_line",
+      [this](const Eigen::Vector3d& start, const Eigen::Vector3d& end) {
+        return path_shortener_.isLineInCollision(start, end);
+      });
+  segment_checkers_.emplace_back(
+      "poly_smoother_path",
+      [this](const Eigen::Vector3d& start, const Eigen::Vector3d& end) {
+        mav_msgs::EigenTrajectoryPointVector samples;
+        sampleSegment(start, end, &samples);
+        return poly_smoother_.isPathInCollision(samples, nullptr);
+      });
+  // ...and the point checkers on samples along the line.
+  for (const std::pair<std::string, PointChecker>& checker : point_checkers_) {
+    if (checker.first == "poly_smoother") {
+      continue;
+    }
+    segment_checkers_.emplace_back(checker.first + "_samples",
+                                   makeSampledSegmentChecker(checker.second));
+  }
+}
+
+void CollisionCheckerBenchmark::setMotionStates(const Eigen::Vector3d& start,
+                                                const Eigen::Vector3d& end) {
+  for (int i = 0; i < 3; ++i) {
+    (*motion_start_)[i] = start[i];
+    (*motion_end_)[i] = end[i];
+  }
+}
+
+void CollisionCheckerBenchmark::sampleSegment(
+    const Eigen::Vector3d& start, const Eigen::Vector3d& end,
+    mav_msgs::EigenTrajectoryPointVector* samples) const {
+  CHECK_NOTNULL(samples);
+  double sample_distance = config_.segment_sample_distance_m;
+  if (sample_distance <= 0.0) {
+    sample_distance = esdf_map_->voxel_size() / 2.0;
+  }
+  const int num_steps = std::max(
+      1, static_cast<int>(std::ceil((end - start).norm() / sample_distance)));
+
+  samples->resize(num_steps + 1);
+  for (int i = 0; i <= num_steps; ++i) {
+    (*samples)[i].position_W =
+        start + (end - start) * static_cast<double>(i) / num_steps;
+  }
+}
+
+CollisionCheckerBenchmark::SegmentChecker
+CollisionCheckerBenchmark::makeSampledSegmentChecker(
+    const PointChecker& checker) const {
+  return [this, checker](const Eigen::Vector3d& start,
+                         const Eigen::Vector3d& end) {
+    mav_msgs::EigenTrajectoryPointVector samples;
+    sampleSegment(start, end, &samples);
+    for (const mav_msgs::EigenTrajectoryPoint& sample : samples) {
+      if (checker(sample.position_W)) {
+        return true;
+      }
+    }
+    return false;
+  };
+}
+
+void CollisionCheckerBenchmark::generateQueries() {
+  seedRandom(config_.seed);
+  points_.resize(config_.num_points);
+  for (Eigen::Vector3d& point : points_) {
+    for (int i = 0; i < 3; ++i) {
+      point[i] = randMToN(lower_bound_[i], upper_bound_[i]);
+    }
+  }
+
+  segments_.resize(config_.num_segments);
+  for (std::pair<Eigen::Vector3d, Eigen::Vector3d>& segment : segments_) {
+    Eigen::Vector3d direction;
+    do {
+      for (int i = 0; i < 3; ++i) {
+        segment.first[i] = randMToN(lower_bound_[i], upper_bound_[i]);
+        direction[i] = randMToN(-1.0, 1.0);
+      }
+    } while (direction.norm() < 1e-3);
+    segment.second =
+        segment.first + direction.normalized() *
+                            randMToN(0.0, config_.max_segment_length_m);
+    segment.second =
+        segment.second.cwiseMax(lower_bound_).cwiseMin(upper_bound_);
+  }
+}
+
+std::vector<CollisionCheckerBenchmark::CheckerResult>
+CollisionCheckerBenchmark::runCheckers(
+    const std::vector<std::pair<std::string, IndexedChecker> >& checkers,
+    size_t num_queries) const {
+  std::vector<CheckerResult> results(checkers.size());
+  std::vector<std::vector<char> > answers(checkers.size());
+  for (size_t i = 0; i < checkers.size(); ++i) {
+    CheckerResult& result = results[i];
+    result.name = checkers[i].first;
+    result.num_queries = num_queries;
+    result.time_sec = std::numeric_limits<double>::max();
+    answers[i].resize(num_queries);
+
+    for (int repetition = 0; repetition < std::max(config_.num_repetitions, 1);
+         ++repetition) {
+      const std::chrono::steady_clock::time_point start =
+          std::chrono::steady_clock::now();
+      for (size_t query = 0; query < num_queries; ++query) {
+        answers[i][query] = checkers[i].second(query);
+      }
+      result.time_sec = std::min(
+          result.time_sec, std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - start)
+                               .count());
+    }
+    result.collision_rate =
+        num_queries == 0
+            ? 0.0
+            : static_cast<double>(std::count(answers[i].begin(),
+                                             answers[i].end(), true)) /
+                  num_queries;
+  }
+
+  computeAgreement(answers, &results);
+  return results;
+}
+
+std::vector<CollisionCheckerBenchmark::CheckerResult>
+CollisionCheckerBenchmark::runDistanceLookups(
+    const std::vector<std::pair<std::string, DistanceLookup> >& lookups)
+    const {
+  const double robot_radius = config_.constraints.robot_radius;
+  std::vector<CheckerResult> results(lookups.size());
+  std::vector<std::vector<char> > answers(lookups.size());
+  std::vector<double> distances;
+  std::vector<Eigen::Vector3d> gradients;
+  for (size_t i = 0; i < lookups.size(); ++i) {
+    CheckerResult& result = results[i];
+    result.name = lookups[i].first;
+    result.num_queries = points_.size();
+    result.time_sec = std::numeric_limits<double>::max();
+
+    for (int repetition = 0; repetition < std::max(config_.num_repetitions, 1);
+         ++repetition) {
+      const std::chrono::steady_clock::time_point start =
+          std::chrono::steady_clock::now();
+      lookups[i].second(&distances, &gradients);
+      result.time_sec = std::min(
+          result.time_sec, std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - start)
+                               .count());
+    }
+
+    answers[i].resize(points_.size());
+    for (size_t query = 0; query < points_.size(); ++query) {
+      answers[i][query] = distances[query] < robot_radius;
+    }
+    result.collision_rate =
+        points_.empty()
+            ? 0.0
+            : static_cast<double>(std::count(answers[i].begin(),
+                                             answers[i].end(), true)) /
+                  points_.size();
+  }
+  computeAgreement(answers, &results);
+  return results;
+}
+
+void CollisionCheckerBenchmark::runBenchmark() {
+  CHECK(esdf_map_) << "Load a map first.";
+  generateQueries();
+
+  std::vector<std::pair<std::string, IndexedChecker> > point_checkers;
+  for (const std::pair<std::string, PointChecker>& checker : point_checkers_) {
+    const PointChecker& check = checker.second;
+    point_checkers.emplace_back(checker.first, [this, &check](size_t i) {
+      return check(points_[i]);
+    });
+  }
+  point_results_ = runCheckers(point_checkers, points_.size());
+
+  std::vector<std::pair<std::string, IndexedChecker> > segment_checkers;
+  for (const std::pair<std::string, SegmentChecker>& checker :
+       segment_checkers_) {
+    const SegmentChecker& check = checker.second;
+    segment_checkers.emplace_back(checker.first, [this, &check](size_t i) {
+      return check(segments_[i].first, segments_[i].second);
+    });
+  }
+  segment_results_ = runCheckers(segment_checkers, segments_.size());
+
+  EsdfDistanceSource esdf_source(esdf_map_.get());
+  const FunctionDistanceSource function_source(
+      makeDistanceAndGradientFunction(&esdf_source));
+  std::vector<std::pair<std::string, DistanceLookup> > lookups;
+  lookups.emplace_back(
+      "function", [this, &function_source](
+                      std::vector<double>* distances,
+                      std::vector<Eigen::Vector3d>* gradients) {
+        lookUpDistances(function_source, points_, distances, gradients);
+      });
+  lookups.emplace_back(
+      "esdf_source", [this, &esdf_source](
+                         std::vector<double>* distances,
+                         std::vector<Eigen::Vector3d>* gradients) {
+        lookUpDistances(esdf_source, points_, distances, gradients);
+      });
+  lookups.emplace_back(
+      "esdf_source_batch", [this, &esdf_source](
+                               std::vector<double>* distances,
+                               std::vector<Eigen::Vector3d>* gradients) {
+        esdf_source.getDistancesAndGradients(points_, distances, gradients);
+      });
+  distance_results_ = runDistanceLookups(lookups);
+}
+
+bool CollisionCheckerBenchmark::outputResultsCsv(
+    const std::string& filename,
+    const std::vector<CheckerResult>& results) const {
+  FILE* fp = fopen(filename.c_str(), "w+");
+  if (fp == NULL) {
+    LOG(ERROR) << "Couldn't open results file: " << filename;
+    return false;
+  }
+  fprintf(fp, "#checker,num_queries,time_sec,queries_per_sec,collision_rate");
+  for (const CheckerResult& result : results) {
+    fprintf(fp, ",agree_%s", result.name.c_str());
+  }
+  fprintf(fp, "\n");
+
+  for (const CheckerResult& result : results) {
+    fprintf(fp, "%s,%zu,%f,%f,%f", result.name.c_str(), result.num_queries,
+            result.time_sec,
+            result.time_sec > 0.0 ? result.num_queries / result.time_sec : 0.0,
+            result.collision_rate);
+    for (double agreement : result.agreement) {
+      fprintf(fp, ",%f", agreement);
+    }
+    fprintf(fp, "\n");
+  }
+  fclose(fp);
+  LOG(INFO) << "Output results to: " << filename;
+  return true;
+}
+
+void CollisionCheckerBenchmark::printResults(FILE* fp) const {
+  const std::vector<CheckerResult>* all_results[3] = {
+      &point_results_, &segment_results_, &distance_results_};
+  const char* kTitles[3] = {"Points", "Segments", "Distances"};
+  for (int i = 0; i < 3; ++i) {
+    fprintf(fp, "%s:\n  %-26s %12s %9s  agreement\n", kTitles[i], "checker",
+            "queries/s", "collide");
+    for (const CheckerResult& result : *all_results[i]) {
+      fprintf(fp, "  %-26s %12.0f %9.4f ", result.name.c_str(),
+              result.time_sec > 0.0 ? result.num_queries / result.time_sec
+                                    : 0.0,
+              result.collision_rate);
+      for (double agreement : result.agreement) {
+        fprintf(fp, " %.4f", agreement);
+      }
+      fprintf(fp, "\n");
+    }
+  }
+}
+
+}  // namespace mav_planning
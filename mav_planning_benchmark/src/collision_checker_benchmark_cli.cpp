@@ -0,0 +1,60 @@
+#include <glog/logging.h>
+
+#include "mav_planning_benchmark/benchmark_utils.h"
+#include "mav_planning_benchmark/collision_checker_benchmark.h"
+#include "mav_planning_benchmark/config_file.h"
+
+// Compares the speed and answers of all collision checkers on one map.
+// Usage:
+//   collision_checker_benchmark config.yaml [key:=value ...]
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+  FLAGS_alsologtostderr = true;
+
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s config.yaml [key:=value ...]\n", argv[0]);
+    return 1;
+  }
+
+  mav_planning::ConfigFile config_file;
+  if (!config_file.load(argv[1])) {
+    return 1;
+  }
+  for (int i = 2; i < argc; ++i) {
+    const std::string arg(argv[i]);
+    const size_t separator = arg.find(":=");
+    if (separator == std::string::npos) {
+      LOG(ERROR) << "Expected key:=value, got: " << arg;
+      return 1;
+    }
+    config_file.set(arg.substr(0, separator), arg.substr(separator + 2));
+  }
+
+  mav_planning::CollisionCheckerBenchmarkConfig config;
+  config.setParameters(config_file);
+  for (const std::string& key : config_file.getUnusedKeys()) {
+    LOG(WARNING) << "Unknown config key: " << key;
+  }
+
+  mav_planning::CollisionCheckerBenchmark benchmark;
+  benchmark.setConfig(config);
+  if (!benchmark.loadMap()) {
+    return 1;
+  }
+  benchmark.runBenchmark();
+  benchmark.printResults(stdout);
+
+  if (config.results_name.empty()) {
+    return 0;
+  }
+  const std::string results_prefix = mav_planning::getResultsPathPrefix(
+      config.base_path + "/" + config.results_name);
+  bool success = benchmark.outputResultsCsv(results_prefix + "_points.csv",
+                                            benchmark.getPointResults());
+  success &= benchmark.outputResultsCsv(results_prefix + "_segments.csv",
+                                        benchmark.getSegmentResults());
+  success &= benchmark.outputResultsCsv(results_prefix + "_distances.csv",
+                                        benchmark.getDistanceResults());
+  return success ? 0 : 1;
+}
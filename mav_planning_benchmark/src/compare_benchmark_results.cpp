@@ -0,0 +1,59 @@
+#include <glog/logging.h>
+
+#include "mav_planning_benchmark/config_file.h"
+#include "mav_planning_benchmark/results_comparison.h"
+
+// Compares a benchmark results CSV against a baseline one. Usage:
+//   compare_benchmark_results baseline.csv new.csv [config.yaml]
+//       [key:=value ...]
+// Exits with 1 if anything regressed past the thresholds in the config, and
+// with 2 if the files couldn't be compared.
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+  FLAGS_alsologtostderr = true;
+
+  if (argc < 3) {
+    fprintf(stderr,
+            "Usage: %s baseline.csv new.csv [config.yaml] [key:=value ...]\n",
+            argv[0]);
+    return 2;
+  }
+
+  mav_planning::ConfigFile config_file;
+  int arg_index = 3;
+  if (argc > 3 && std::string(argv[3]).find(":=") == std::string::npos) {
+    if (!config_file.load(argv[3])) {
+      return 2;
+    }
+    arg_index++;
+  }
+  for (; arg_index < argc; ++arg_index) {
+    const std::string arg(argv[arg_index]);
+    const size_t separator = arg.find(":=");
+    if (separator == std::string::npos) {
+      LOG(ERROR) << "Expected key:=value, got: " << arg;
+      return 2;
+    }
+    config_file.set(arg.substr(0, separator), arg.substr(separator + 2));
+  }
+
+  mav_planning::ResultsComparisonConfig config;
+  config.setParameters(config_file);
+  for (const std::string& key : config_file.getUnusedKeys()) {
+    LOG(WARNING) << "Unknown config key: " << key;
+  }
+
+  mav_planning::ResultsTable baseline, current;
+  if (!baseline.load(argv[1]) || !current.load(argv[2])) {
+    return 2;
+  }
+
+  mav_planning::ResultsComparison comparison;
+  comparison.setConfig(config);
+  const int exit_code = comparison.compareAndReport(baseline, current, stdout);
+  if (exit_code == 1) {
+    LOG(ERROR) << "Performance regression against " << argv[1];
+  }
+  return exit_code;
+}
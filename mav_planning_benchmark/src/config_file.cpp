@@ -0,0 +1,187 @@
+#include <stdlib.h>
+#include <fstream>
+
+#include <glog/logging.h>
+
+#include "mav_planning_benchmark/config_file.h"
+
+namespace mav_planning {
+
+namespace {
+
+std::string trim(const std::string& str) {
+  const char* kWhitespace = " \t\r\n";
+  const size_t first = str.find_first_not_of(kWhitespace);
+  if (first == std::string::npos) {
+    return std::string();
+  }
+  const size_t last = str.find_last_not_of(kWhitespace);
+  return str.substr(first, last - first + 1);
+}
+
+std::string stripQuotes(const std::string& str) {
+  if (str.size() >= 2 && (str.front() == '"' || str.front() == '\'') &&
+      str.back() == str.front()) {
+    return str.substr(1, str.size() - 2);
+  }
+  return str;
+}
+
+}  // namespace
+
+bool ConfigFile::load(const std::string& filename) {
+  std::ifstream file(filename);
+  if (!file.is_open()) {
+    LOG(ERROR) << "Couldn't open config file: " << filename;
+    return false;
+  }
+
+  bool success = true;
+  std::string line;
+  int line_number = 0;
+  while (std::getline(file, line)) {
+    line_number++;
+    // Comments only start at the beginning of a line or after whitespace, so
+    // that values with '#' in them still work.
+    size_t comment = line.find('#');
+    while (comment != std::string::npos && comment > 0 &&
+           line[comment - 1] != ' ' && line[comment - 1] != '\t') {
+      comment = line.find('#', comment + 1);
+    }
+    if (comment != std::string::npos) {
+      line = line.substr(0, comment);
+    }
+    line = trim(line);
+    if (line.empty() || line == "---") {
+      continue;
+    }
+
+    const size_t colon = line.find(':');
+    if (colon == std::string::npos || colon == 0) {
+      LOG(ERROR) << filename << ":" << line_number
+                 << ": expected \"key: value\", got: " << line;
+      success = false;
+      continue;
+    }
+    set(trim(line.substr(0, colon)), trim(line.substr(colon + 1)));
+  }
+  return success;
+}
+
+void ConfigFile::set(const std::string& key, const std::string& value) {
+  values_[key] = value;
+}
+
+bool ConfigFile::hasParam(const std::string& key) const {
+  return values_.count(key) > 0;
+}
+
+bool ConfigFile::getString(const std::string& key, std::string* value) const {
+  std::map<std::string, std::string>::const_iterator it = values_.find(key);
+  if (it == values_.end()) {
+    return false;
+  }
+  used_keys_.insert(key);
+  *value = it->second;
+  return true;
+}
+
+void ConfigFile::param(const std::string& key, std::string& value,
+                       const std::string& default_value) const {
+  std::string str;
+  if (!getString(key, &str)) {
+    value = default_value;
+    return;
+  }
+  value = stripQuotes(str);
+}
+
+void ConfigFile::param(const std::string& key, double& value,
+                       double default_value) const {
+  value = default_value;
+  std::string str;
+  if (!getString(key, &str)) {
+    return;
+  }
+  char* end = nullptr;
+  const double parsed = strtod(str.c_str(), &end);
+  if (str.empty() || *end != '\0') {
+    LOG(WARNING) << "Config value for " << key << " is not a number: " << str
+                 << ", using default " << default_value;
+    return;
+  }
+  value = parsed;
+}
+
+void ConfigFile::param(const std::string& key, int& value,
+                       int default_value) const {
+  value = default_value;
+  std::string str;
+  if (!getString(key, &str)) {
+    return;
+  }
+  char* end = nullptr;
+  const long parsed = strtol(str.c_str(), &end, 10);
+  if (str.empty() || *end != '\0') {
+    LOG(WARNING) << "Config value for " << key << " is not an integer: " << str
+                 << ", using default " << default_value;
+    return;
+  }
+  value = static_cast<int>(parsed);
+}
+
+void ConfigFile::param(const std::string& key, bool& value,
+                       bool default_value) const {
+  value = default_value;
+  std::string str;
+  if (!getString(key, &str)) {
+    return;
+  }
+  if (str == "true" || str == "True" || str == "1" || str == "yes") {
+    value = true;
+  } else if (str == "false" || str == "False" || str == "0" || str == "no") {
+    value = false;
+  } else {
+    LOG(WARNING) << "Config value for " << key << " is not a bool: " << str
+                 << ", using default " << default_value;
+  }
+}
+
+void ConfigFile::param(const std::string& key, std::vector<std::string>& value,
+                       const std::vector<std::string>& default_value) const {
+  std::string str;
+  if (!getString(key, &str)) {
+    value = default_value;
+    return;
+  }
+  if (str.size() >= 2 && str.front() == '[' && str.back() == ']') {
+    str = str.substr(1, str.size() - 2);
+  }
+
+  value.clear();
+  size_t start = 0;
+  while (start <= str.size()) {
+    size_t comma = str.find(',', start);
+    if (comma == std::string::npos) {
+      comma = str.size();
+    }
+    const std::string item =
+        stripQuotes(trim(str.substr(start, comma - start)));
+    if (!item.empty()) {
+      value.push_back(item);
+    }
+    start = comma + 1;
+  }
+}
+
+std::vector<std::string> ConfigFile::getUnusedKeys() const {
+  std::vector<std::string> unused_keys;
+  for (const std::pair<const std::string, std::string>& kv : values_) {
+    if (used_keys_.count(kv.first) == 0) {
+      unused_keys.push_back(kv.first);
+    }
+  }
+  return unused_keys;
+}
+
+}  // namespace mav_planning
@@ -1,134 +1,233 @@
-#include <mav_planning_common/color_utils.h>
-#include <mav_planning_common/path_visualization.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+#include <mav_planning_common/map_query_scope.h>
+#include <mav_planning_common/planning_counters.h>
 #include <mav_planning_common/utils.h>
 #include <mav_trajectory_generation/timing.h>
-#include <mav_visualization/helpers.h>
+#include <voxblox/io/layer_io.h>
 #include <voxblox/utils/planning_utils.h>
 
+#include "mav_planning_benchmark/benchmark_utils.h"
 #include "mav_planning_benchmark/global_planning_benchmark.h"
+#include "mav_planning_benchmark/resource_usage.h"
 
 namespace mav_planning {
 
-GlobalPlanningBenchmark::GlobalPlanningBenchmark(
-    const ros::NodeHandle& nh, const ros::NodeHandle& nh_private)
-    : nh_(nh),
-      nh_private_(nh_private),
-      visualize_(true),
-      frame_id_("map"),
-      rrt_connect_planner_(nh, nh_private),
-      rrt_star_planner_(nh, nh_private),
-      bit_star_planner_(nh, nh_private),
-      prm_planner_(nh, nh_private),
-      skeleton_planner_(nh, nh_private) {
-  // Make sure we got the robot size, v_max, a_max, etc from constraints.
-  constraints_.setParametersFromRos(nh_private_);
-
-  nh_private_.param("visualize", visualize_, visualize_);
-  nh_private_.param("frame_id", frame_id_, frame_id_);
-
-  path_marker_pub_ =
-      nh_private_.advertise<visualization_msgs::MarkerArray>("path", 1, true);
-
-  global_planning_methods_.push_back(kStraightLine);
-  global_planning_methods_.push_back(kRrtConnect);
-  global_planning_methods_.push_back(kRrtStar);
-  global_planning_methods_.push_back(kSkeletonGraph);
-  global_planning_methods_.push_back(kPrm);
-
-  path_smoothing_methods_.push_back(kNone);
-  path_smoothing_methods_.push_back(kVelocityRamp);
-  path_smoothing_methods_.push_back(kPolynomial);
-  path_smoothing_methods_.push_back(kLoco);
-  //path_smoothing_methods_.push_back(kLoco2);
-  //path_smoothing_methods_.push_back(kLoco3);
+namespace {
+
+bool getOmplPlannerType(GlobalPlanningBenchmark::GlobalPlanningMethod method,
+                        VoxbloxOmplRrt::RrtPlannerType* planner_type) {
+  CHECK_NOTNULL(planner_type);
+  switch (method) {
+    case GlobalPlanningBenchmark::kRrtConnect:
+      *planner_type = VoxbloxOmplRrt::kRrtConnect;
+      return true;
+    case GlobalPlanningBenchmark::kRrtStar:
+      *planner_type = VoxbloxOmplRrt::kRrtStar;
+      return true;
+    case GlobalPlanningBenchmark::kInformedRrtStar:
+      *planner_type = VoxbloxOmplRrt::kInformedRrtStar;
+      return true;
+    case GlobalPlanningBenchmark::kBitStar:
+      *planner_type = VoxbloxOmplRrt::kBitStar;
+      return true;
+    case GlobalPlanningBenchmark::kPrm:
+      *planner_type = VoxbloxOmplRrt::kPrm;
+      return true;
+    default:
+      return false;
+  }
+}
+
+}  // namespace
+
+GlobalPlanningBenchmark::GlobalPlanningBenchmark()
+    : verbose_(false),
+      lower_bound_(Eigen::Vector3d::Zero()),
+      upper_bound_(Eigen::Vector3d::Zero()) {
+  setConfig(config_);
+}
+
+bool GlobalPlanningBenchmark::setConfig(const GlobalBenchmarkConfig& config) {
+  std::vector<GlobalPlanningMethod> global_planning_methods;
+  for (size_t i = 0; i < config.global_planners.size(); ++i) {
+    const GlobalPlannerConfig& planner = config.global_planners[i];
+    GlobalPlanningMethod method;
+    if (!globalPlanningMethodFromString(planner.type, &method)) {
+      LOG(ERROR) << "Unknown global planning method: " << planner.type
+                 << " (for planner " << planner.name << ")";
+      return false;
+    }
+    for (size_t j = 0; j < i; ++j) {
+      if (config.global_planners[j].name == planner.name) {
+        LOG(ERROR) << "Global planner " << planner.name << " is in the list "
+                   << "more than once.";
+        return false;
+      }
+    }
+    VoxbloxOmplRrt::RrtPlannerType ompl_type;
+    const bool is_ompl = getOmplPlannerType(method, &ompl_type);
+    if (planner.num_threads < 1 || (!is_ompl && planner.num_threads > 1)) {
+      LOG(ERROR) << "Global planner " << planner.name << " can't run on "
+                 << planner.num_threads << " threads, only the OMPL planners "
+                 << "can use more than one.";
+      return false;
+    }
+    global_planning_methods.push_back(method);
+  }
+  std::vector<PathSmoothingMethod> path_smoothing_methods;
+  for (const std::string& name : config.path_smoothing_methods) {
+    PathSmoothingMethod method;
+    if (!pathSmoothingMethodFromString(name, &method)) {
+      LOG(ERROR) << "Unknown path smoothing method: " << name;
+      return false;
+    }
+    path_smoothing_methods.push_back(method);
+  }
+
+  config_ = config;
+  constraints_ = config.constraints;
+  verbose_ = config.verbose;
+  global_planning_methods_.swap(global_planning_methods);
+  path_smoothing_methods_.swap(path_smoothing_methods);
+  return true;
 }
 
-void GlobalPlanningBenchmark::loadMap(const std::string& base_path,
+bool GlobalPlanningBenchmark::loadMap() {
+  return loadMap(config_.base_path, config_.esdf_name,
+                 config_.sparse_graph_name);
+}
+
+bool GlobalPlanningBenchmark::loadMap(const std::string& base_path,
                                       const std::string& esdf_name,
                                       const std::string& sparse_graph_name) {
   // We can add as many "/////"s as we want, let's play it safe.
   std::string esdf_path = base_path + "/" + esdf_name;
   std::string sparse_graph_path = base_path + "/" + sparse_graph_name;
 
-  // TODO(helenol): replace this with actually loading the stats from the map.
-  esdf_server_.reset(new voxblox::EsdfServer(nh_, nh_private_));
-
-  if (!esdf_server_->loadMap(esdf_path)) {
-    ROS_ERROR_STREAM("Couldn't load ESDF  from file: " << esdf_path);
-    return;
+  // Voxel size and voxels per side come from the file. Saved maps usually
+  // have the TSDF in there too, so skip over any other layers.
+  const bool kMultipleLayerSupport = true;
+  voxblox::Layer<voxblox::EsdfVoxel>::Ptr esdf_layer;
+  if (!voxblox::io::LoadLayer<voxblox::EsdfVoxel>(
+          esdf_path, kMultipleLayerSupport, &esdf_layer)) {
+    LOG(ERROR) << "Couldn't load ESDF from file: " << esdf_path;
+    return false;
+  }
+  esdf_map_.reset(new voxblox::EsdfMap(esdf_layer));
+  distance_source_.setEsdfMap(esdf_map_.get());
+
+  // Optimistic planners check against the TSDF, which is normally saved in
+  // the same file.
+  tsdf_layer_.reset();
+  for (const GlobalPlannerConfig& planner : config_.global_planners) {
+    if (!planner.optimistic || tsdf_layer_) {
+      continue;
+    }
+    if (!voxblox::io::LoadLayer<voxblox::TsdfVoxel>(
+            esdf_path, kMultipleLayerSupport, &tsdf_layer_)) {
+      LOG(ERROR) << "Optimistic planner " << planner.name
+                 << " needs a TSDF, couldn't load one from file: "
+                 << esdf_path;
+      return false;
+    }
   }
-  esdf_server_->setTraversabilityRadius(constraints_.robot_radius);
 
   skeleton_graph_.clear();
   if (!voxblox::io::loadSparseSkeletonGraphFromFile(sparse_graph_path,
                                                     &skeleton_graph_)) {
-    ROS_ERROR_STREAM(
-        "Couldn't load skeleton sparse graph from file: " << sparse_graph_path);
-    return;
+    LOG(ERROR) << "Couldn't load skeleton sparse graph from file: "
+               << sparse_graph_path;
+    return false;
   }
 
-  if (visualize_) {
-    esdf_server_->disableIncrementalUpdate();
-    esdf_server_->updateMesh();
-    esdf_server_->publishSlices();
-    esdf_server_->publishPointclouds();
-    esdf_server_->publishTraversable();
+  skeleton_attachment_layer_.reset();
+  if (config_.use_skeleton_attachment) {
+    skeleton_attachment_layer_.reset(
+        new voxblox::Layer<voxblox::SkeletonAttachmentVoxel>(
+            esdf_layer->voxel_size(), esdf_layer->voxels_per_side()));
+    voxblox::SkeletonAttachmentGenerator attachment_generator;
+    attachment_generator.setEsdfLayer(esdf_layer.get());
+    attachment_generator.setMinEsdfDistance(constraints_.robot_radius);
+    attachment_generator.generate(skeleton_graph_,
+                                  skeleton_attachment_layer_.get());
   }
 
   setupPlanners();
+  return true;
 }
 
 void GlobalPlanningBenchmark::setupPlanners() {
-  CHECK(esdf_server_);
+  CHECK(esdf_map_);
 
   // For all planners:
   // Figure out map bounds!
-  voxblox::utils::computeMapBoundsFromLayer(
-      *esdf_server_->getEsdfMapPtr()->getEsdfLayerPtr(), &lower_bound_,
-      &upper_bound_);
-  double voxel_size =
-      esdf_server_->getEsdfMapPtr()->getEsdfLayerPtr()->voxel_size();
-
-  // RRT Connect
-  rrt_connect_planner_.setPlanner(VoxbloxOmplRrt::kRrtConnect);
-  rrt_connect_planner_.setNumSecondsToPlan(1.0);
-  rrt_connect_planner_.setRobotRadius(constraints_.robot_radius);
-  rrt_connect_planner_.setOptimistic(false);
-  rrt_connect_planner_.setEsdfLayer(
-      esdf_server_->getEsdfMapPtr()->getEsdfLayerPtr());
-  rrt_connect_planner_.setBounds(lower_bound_, upper_bound_);
-  rrt_connect_planner_.setupProblem();
-
-  // RRT*
-  rrt_star_planner_.setPlanner(VoxbloxOmplRrt::kRrtStar);
-  rrt_star_planner_.setNumSecondsToPlan(2.0);
-  rrt_star_planner_.setRobotRadius(constraints_.robot_radius);
-  rrt_star_planner_.setOptimistic(false);
-  rrt_star_planner_.setEsdfLayer(
-      esdf_server_->getEsdfMapPtr()->getEsdfLayerPtr());
-  rrt_star_planner_.setBounds(lower_bound_, upper_bound_);
-  rrt_star_planner_.setupProblem();
-
-  // BIT*
-  bit_star_planner_.setPlanner(VoxbloxOmplRrt::kRrtConnect);
-  bit_star_planner_.setNumSecondsToPlan(1.0);
-  bit_star_planner_.setRobotRadius(constraints_.robot_radius);
-  bit_star_planner_.setOptimistic(false);
-  bit_star_planner_.setEsdfLayer(
-      esdf_server_->getEsdfMapPtr()->getEsdfLayerPtr());
-  bit_star_planner_.setBounds(lower_bound_, upper_bound_);
-  bit_star_planner_.setupProblem();
-
-  // PRM (note that this one is a bit different, since we actually
-  prm_planner_.setPlanner(VoxbloxOmplRrt::kPrm);
-  prm_planner_.setNumSecondsToPlan(0.01);
-  prm_planner_.setRobotRadius(constraints_.robot_radius);
-  prm_planner_.setOptimistic(false);
-  prm_planner_.setEsdfLayer(esdf_server_->getEsdfMapPtr()->getEsdfLayerPtr());
-  prm_planner_.setBounds(lower_bound_, upper_bound_);
-  prm_planner_.setupProblem();
-  // This is different from the other planners: grow the PRM tree for 2 seconds!
-  prm_planner_.constructPrmRoadmap(2.0);
+  voxblox::utils::computeMapBoundsFromLayer(*esdf_map_->getEsdfLayerPtr(),
+                                            &lower_bound_, &upper_bound_);
+
+  // Set up the workers in parallel, the PRM roadmaps take a while.
+  const int num_threads = getNumThreads();
+  workers_.clear();
+  std::vector<std::future<void>> setup_futures;
+  for (int i = 0; i < num_threads; ++i) {
+    workers_.emplace_back(new TrialWorker());
+    if (component_setup_) {
+      component_setup_(workers_.back().get());
+    }
+    setup_futures.push_back(std::async(std::launch::async,
+                                       &GlobalPlanningBenchmark::setupWorker,
+                                       this, workers_.back().get()));
+  }
+  for (std::future<void>& future : setup_futures) {
+    future.get();
+  }
+}
+
+void GlobalPlanningBenchmark::setupWorker(TrialWorker* worker) {
+  CHECK_NOTNULL(worker);
+  voxblox::Layer<voxblox::EsdfVoxel>* esdf_layer =
+      esdf_map_->getEsdfLayerPtr();
+  double voxel_size = esdf_layer->voxel_size();
+
+  // All the OMPL planners, as many as configured.
+  worker->ompl_planners.clear();
+  worker->ompl_planners.resize(config_.global_planners.size());
+  for (size_t i = 0; i < config_.global_planners.size(); ++i) {
+    const GlobalPlannerConfig& planner_config = config_.global_planners[i];
+    VoxbloxOmplRrt::RrtPlannerType planner_type;
+    if (!getOmplPlannerType(global_planning_methods_[i], &planner_type)) {
+      continue;
+    }
+    for (int j = 0; j < planner_config.num_threads; ++j) {
+      std::unique_ptr<VoxbloxOmplRrt> planner(new VoxbloxOmplRrt());
+      planner->setPlanner(planner_type);
+      planner->setNumSecondsToPlan(planner_config.plan_time_sec);
+      planner->setSimplifySolution(planner_config.simplify_solution);
+      planner->setRobotRadius(constraints_.robot_radius);
+      planner->setOptimistic(planner_config.optimistic);
+      planner->setVerbose(verbose_);
+      planner->setRecordCostTrace(config_.record_cost_traces);
+      if (planner_config.optimistic) {
+        planner->setTsdfLayer(CHECK_NOTNULL(tsdf_layer_.get()));
+      } else {
+        planner->setEsdfLayer(esdf_layer);
+      }
+      planner->setBounds(lower_bound_, upper_bound_);
+      planner->setupProblem();
+      if (planner_type == VoxbloxOmplRrt::kPrm) {
+        // This is different from the other planners: grow the PRM tree once
+        // for the whole map! Every worker and thread grows its own.
+        planner->constructPrmRoadmap(planner_config.roadmap_time_sec);
+      }
+      worker->ompl_planners[i].push_back(std::move(planner));
+    }
+  }
 
   //       .-.
   //      (o.o)
@@ -144,163 +243,539 @@ void GlobalPlanningBenchmark::setupPlanners() {
   //      || ||
   //      || ||
   // l42 ==' '==
-  skeleton_planner_.setEsdfLayer(
-      esdf_server_->getEsdfMapPtr()->getEsdfLayerPtr());
-  skeleton_planner_.setRobotRadius(constraints_.robot_radius);
-  skeleton_planner_.setSparseGraph(&skeleton_graph_);
+  worker->skeleton_planner.setEsdfLayer(esdf_layer);
+  worker->skeleton_planner.setRobotRadius(constraints_.robot_radius);
+  worker->skeleton_planner.setVerbose(verbose_);
+  worker->skeleton_planner.setSparseGraph(&skeleton_graph_);
+  worker->skeleton_planner.setAttachmentLayer(
+      skeleton_attachment_layer_.get());
 
   // Straight-line smoother.
-  ramp_smoother_.setParametersFromRos(nh_private_);
+  worker->ramp_smoother.setPhysicalConstraints(constraints_);
+  worker->ramp_smoother.setVerbose(verbose_);
 
   // Poly smoother.
-  poly_smoother_.setParametersFromRos(nh_private_);
-  poly_smoother_.setMinCollisionCheckResolution(voxel_size);
-  poly_smoother_.setMapDistanceCallback(std::bind(
+  worker->poly_smoother.setPhysicalConstraints(constraints_);
+  worker->poly_smoother.setVerbose(verbose_);
+  worker->poly_smoother.setMinCollisionCheckResolution(voxel_size);
+  worker->poly_smoother.setMapDistanceCallback(std::bind(
       &GlobalPlanningBenchmark::getMapDistance, this, std::placeholders::_1));
-  poly_smoother_.setOptimizeTime(true);
-  poly_smoother_.setSplitAtCollisions(true);
+  worker->poly_smoother.setOptimizeTime(true);
+  worker->poly_smoother.setSplitAtCollisions(true);
 
   // Loco smoother!
-  loco_smoother_.setParametersFromRos(nh_private_);
-  loco_smoother_.setMinCollisionCheckResolution(voxel_size);
-  loco_smoother_.setDistanceAndGradientFunction(
-      std::bind(&GlobalPlanningBenchmark::getMapDistanceAndGradient, this,
-                std::placeholders::_1, std::placeholders::_2));
-  loco_smoother_.setOptimizeTime(true);
-  loco_smoother_.setResampleTrajectory(true);
-  loco_smoother_.setResampleVisibility(true);
-  loco_smoother_.setNumSegments(5);
+  worker->loco_smoother.setPhysicalConstraints(constraints_);
+  worker->loco_smoother.setVerbose(verbose_);
+  worker->loco_smoother.setMinCollisionCheckResolution(voxel_size);
+  worker->loco_smoother.setDistanceSource(&distance_source_);
+  worker->loco_smoother.setOptimizeTime(true);
+  worker->loco_smoother.setResampleTrajectory(true);
+  worker->loco_smoother.setResampleVisibility(true);
+  worker->loco_smoother.setNumSegments(5);
 
   // Loco variants
-  loco2_smoother_.setParametersFromRos(nh_private_);
-  loco2_smoother_.setMinCollisionCheckResolution(voxel_size);
-  loco2_smoother_.setDistanceAndGradientFunction(
-      std::bind(&GlobalPlanningBenchmark::getMapDistanceAndGradient, this,
-                std::placeholders::_1, std::placeholders::_2));
-  loco2_smoother_.setOptimizeTime(true);
-  loco2_smoother_.setResampleTrajectory(false);
-  loco2_smoother_.setResampleVisibility(false);
-  loco2_smoother_.setNumSegments(5);
-
-  loco3_smoother_.setParametersFromRos(nh_private_);
-  loco3_smoother_.setMinCollisionCheckResolution(voxel_size);
-  loco3_smoother_.setDistanceAndGradientFunction(
-      std::bind(&GlobalPlanningBenchmark::getMapDistanceAndGradient, this,
-                std::placeholders::_1, std::placeholders::_2));
-  loco3_smoother_.setOptimizeTime(true);
-  loco3_smoother_.setResampleTrajectory(true);
-  loco3_smoother_.setResampleVisibility(false);
-  loco3_smoother_.setNumSegments(5);
+  worker->loco2_smoother.setPhysicalConstraints(constraints_);
+  worker->loco2_smoother.setVerbose(verbose_);
+  worker->loco2_smoother.setMinCollisionCheckResolution(voxel_size);
+  worker->loco2_smoother.setDistanceSource(&distance_source_);
+  worker->loco2_smoother.setOptimizeTime(true);
+  worker->loco2_smoother.setResampleTrajectory(false);
+  worker->loco2_smoother.setResampleVisibility(false);
+  worker->loco2_smoother.setNumSegments(5);
+
+  worker->loco3_smoother.setPhysicalConstraints(constraints_);
+  worker->loco3_smoother.setVerbose(verbose_);
+  worker->loco3_smoother.setMinCollisionCheckResolution(voxel_size);
+  worker->loco3_smoother.setDistanceSource(&distance_source_);
+  worker->loco3_smoother.setOptimizeTime(true);
+  worker->loco3_smoother.setResampleTrajectory(true);
+  worker->loco3_smoother.setResampleVisibility(false);
+  worker->loco3_smoother.setNumSegments(5);
 }
 
-void GlobalPlanningBenchmark::runBenchmark(int num_trials) {
-  CHECK(esdf_server_);
+int GlobalPlanningBenchmark::getNumThreads() const {
+  if (config_.num_threads > 0) {
+    return config_.num_threads;
+  }
+  return std::max(1u, std::thread::hardware_concurrency());
+}
 
-  const double kMinimumDistanceMeters = 2.0;
-  GlobalBenchmarkResult result_template;
-  result_template.robot_radius_m = constraints_.robot_radius;
-  result_template.v_max = constraints_.v_max;
-  result_template.a_max = constraints_.a_max;
+void GlobalPlanningBenchmark::runBenchmark() {
+  runBenchmark(config_.num_trials);
+}
 
+void GlobalPlanningBenchmark::runBenchmark(int num_trials) {
+  CHECK(esdf_map_);
+  CHECK(!workers_.empty());
+
+  const int num_threads =
+      std::min(static_cast<int>(workers_.size()), num_trials);
+  if (num_threads <= 1) {
+    runTrialsSerial(num_trials);
+  } else {
+    runTrialsParallel(num_trials, num_threads);
+  }
+}
+
+void GlobalPlanningBenchmark::runTrialsSerial(int num_trials) {
+  std::vector<GlobalBenchmarkResult> trial_results;
+  std::vector<mav_msgs::EigenTrajectoryPointVector> trial_paths;
   for (int trial = 0; trial < num_trials; trial++) {
-    srand(trial);
-    if (!ros::ok()) {
-      break;
+    trial_results.clear();
+    trial_paths.clear();
+    if (!runTrial(trial, workers_.front().get(), &trial_results,
+                  &trial_paths)) {
+      LOG(ERROR) << "Couldn't find a valid start and goal position at least "
+                 << config_.min_start_goal_distance_m
+                 << " meters apart! Aborting at trial " << trial << ".";
+      return;
     }
-
-    // Get the start and goal positions.
-    Eigen::Vector3d start, goal;
-    if (!selectRandomStartAndGoal(kMinimumDistanceMeters, &start, &goal)) {
-      ROS_ERROR(
-          "Couldn't find a valid start and goal position at least %f meters "
-          "apart! Aborting at trial %d.",
-          kMinimumDistanceMeters, trial);
+    if (!finishTrial(trial, trial_results, trial_paths)) {
       return;
     }
+  }
+}
 
-    result_template.trial_number = trial;
-    result_template.seed = trial;
-    result_template.straight_line_path_length_m = (goal - start).norm();
-
-    mav_msgs::EigenTrajectoryPoint start_point, goal_point;
-    start_point.position_W = start;
-    goal_point.position_W = goal;
-
-    visualization_msgs::MarkerArray marker_array;
-
-    // Go through a list of all the global planners to try...
-    for (GlobalPlanningMethod global_method : global_planning_methods_) {
-      srand(trial);
-
-      mav_msgs::EigenTrajectoryPointVector waypoints;
-      mav_trajectory_generation::timing::MiniTimer global_planner_timer;
-      bool global_success =
-          runGlobalPlanner(global_method, start_point, goal_point, &waypoints);
-      global_planner_timer.stop();
-
-      // Go through a list of all the path smoothers to try, per planner.
-      for (PathSmoothingMethod smoothing_method : path_smoothing_methods_) {
-        srand(trial);
-        mav_msgs::EigenTrajectoryPointVector path;
-
-        mav_trajectory_generation::timing::MiniTimer smoothing_timer;
-        bool local_success =
-            runPathSmoother(smoothing_method, waypoints, &path);
-        smoothing_timer.stop();
-
-        ROS_INFO(
-            "[Trial %d]: Finished running global method %d and local method %d",
-            trial, global_method, smoothing_method);
-
-        GlobalBenchmarkResult result = result_template;
-        result.global_planning_method = global_method;
-        result.path_smoothing_method = smoothing_method;
-
-        result.planning_success = global_success && local_success;
-        result.computation_time_sec =
-            global_planner_timer.getTime() + smoothing_timer.getTime();
-        fillInPathResults(path, &result);
-        results_.push_back(result);
-
-        if (visualize_) {
-          marker_array.markers.push_back(createMarkerForPath(
-              path, frame_id_, percentToRainbowColor(global_method / 4.0 +
-                                                     smoothing_method / 12.0),
-              std::to_string(global_method) + "_" +
-                  std::to_string(smoothing_method),
-              0.075));
+void GlobalPlanningBenchmark::runTrialsParallel(int num_trials,
+                                                int num_threads) {
+  // Workers take the next trial number whenever they're free. Finished trials
+  // wait here until all the ones before them are done, so that everything
+  // after is in the same order as in a serial run.
+  struct TrialOutput {
+    bool done = false;
+    bool valid = false;
+    std::vector<GlobalBenchmarkResult> results;
+    std::vector<mav_msgs::EigenTrajectoryPointVector> paths;
+  };
+  std::vector<TrialOutput> outputs(num_trials);
+  std::mutex outputs_mutex;
+  std::condition_variable trial_done;
+  std::atomic<int> next_trial(0);
+  std::atomic<bool> stop(false);
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    TrialWorker* worker = workers_[i].get();
+    threads.emplace_back([&, worker]() {
+      while (!stop) {
+        const int trial = next_trial++;
+        if (trial >= num_trials) {
+          break;
+        }
+        TrialOutput output;
+        output.valid = runTrial(trial, worker, &output.results, &output.paths);
+        {
+          std::lock_guard<std::mutex> lock(outputs_mutex);
+          outputs[trial].valid = output.valid;
+          outputs[trial].results.swap(output.results);
+          outputs[trial].paths.swap(output.paths);
+          outputs[trial].done = true;
         }
+        trial_done.notify_all();
       }
+    });
+  }
+
+  for (int trial = 0; trial < num_trials; ++trial) {
+    TrialOutput output;
+    {
+      std::unique_lock<std::mutex> lock(outputs_mutex);
+      trial_done.wait(lock, [&]() { return outputs[trial].done; });
+      output.valid = outputs[trial].valid;
+      output.results.swap(outputs[trial].results);
+      output.paths.swap(outputs[trial].paths);
     }
-    if (visualize_) {
-      path_marker_pub_.publish(marker_array);
+    if (!output.valid) {
+      LOG(ERROR) << "Couldn't find a valid start and goal position at least "
+                 << config_.min_start_goal_distance_m
+                 << " meters apart! Aborting at trial " << trial << ".";
+      stop = true;
+      break;
+    }
+    if (!finishTrial(trial, output.results, output.paths)) {
+      stop = true;
+      break;
+    }
+  }
+
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+bool GlobalPlanningBenchmark::finishTrial(
+    int trial, const std::vector<GlobalBenchmarkResult>& trial_results,
+    const std::vector<mav_msgs::EigenTrajectoryPointVector>& trial_paths) {
+  results_.insert(results_.end(), trial_results.begin(), trial_results.end());
+  if (trial_callback_ &&
+      !trial_callback_(trial, trial_results, trial_paths)) {
+    LOG(INFO) << "Benchmark stopped after trial " << trial << ".";
+    return false;
+  }
+  return true;
+}
+
+bool GlobalPlanningBenchmark::runTrial(
+    int trial, TrialWorker* worker,
+    std::vector<GlobalBenchmarkResult>* results,
+    std::vector<mav_msgs::EigenTrajectoryPointVector>* paths) const {
+  CHECK_NOTNULL(worker);
+  CHECK_NOTNULL(results);
+  CHECK_NOTNULL(paths);
+  // Everything random in here is seeded from the trial number, on this
+  // thread only.
+  seedRandom(trial);
+
+  // Get the start and goal positions.
+  Eigen::Vector3d start, goal;
+  if (!selectRandomStartAndGoal(config_.min_start_goal_distance_m, &start,
+                                &goal)) {
+    return false;
+  }
+
+  GlobalBenchmarkResult result_template;
+  result_template.robot_radius_m = constraints_.robot_radius;
+  result_template.v_max = constraints_.v_max;
+  result_template.a_max = constraints_.a_max;
+  result_template.trial_number = trial;
+  result_template.seed = trial;
+  result_template.straight_line_path_length_m = (goal - start).norm();
+
+  mav_msgs::EigenTrajectoryPoint start_point, goal_point;
+  start_point.position_W = start;
+  goal_point.position_W = goal;
+
+  // Go through a list of all the global planners to try...
+  for (size_t planner_index = 0;
+       planner_index < global_planning_methods_.size(); ++planner_index) {
+    const GlobalPlanningMethod global_method =
+        global_planning_methods_[planner_index];
+    seedRandom(trial);
+
+    const size_t peak_rss_before_kb = getPeakRssKb();
+    const PlanningCounters global_counters_before = getPlanningCounters();
+    const size_t global_allocations_before = getThreadAllocationCount();
+
+    mav_msgs::EigenTrajectoryPointVector waypoints;
+    VoxbloxOmplRrt::CostTrace cost_trace;
+    mav_trajectory_generation::timing::MiniTimer global_planner_timer;
+    bool global_success =
+        runGlobalPlanner(planner_index, start_point, goal_point, worker,
+                         &waypoints, &cost_trace);
+    global_planner_timer.stop();
+
+    const size_t global_allocations =
+        getThreadAllocationCount() - global_allocations_before;
+    const PlanningCounters global_counters =
+        getPlanningCounters() - global_counters_before;
+
+    // Go through a list of all the path smoothers to try, per planner.
+    for (PathSmoothingMethod smoothing_method : path_smoothing_methods_) {
+      seedRandom(trial);
+      mav_msgs::EigenTrajectoryPointVector path;
+
+      const PlanningCounters smoothing_counters_before = getPlanningCounters();
+      const size_t smoothing_allocations_before = getThreadAllocationCount();
+
+      mav_trajectory_generation::timing::MiniTimer smoothing_timer;
+      bool local_success =
+          runPathSmoother(smoothing_method, waypoints, worker, &path);
+      smoothing_timer.stop();
+
+      const size_t smoothing_allocations =
+          getThreadAllocationCount() - smoothing_allocations_before;
+      const PlanningCounters smoothing_counters =
+          getPlanningCounters() - smoothing_counters_before;
+
+      LOG(INFO) << "[Trial " << trial << "]: Finished running global planner "
+                << config_.global_planners[planner_index].name
+                << " and local method "
+                << pathSmoothingMethodToString(smoothing_method);
+
+      GlobalBenchmarkResult result = result_template;
+      result.global_planning_method = global_method;
+      result.global_planner = static_cast<int>(planner_index);
+      result.cost_trace = cost_trace;
+      result.path_smoothing_method = smoothing_method;
+
+      result.planning_success = global_success && local_success;
+      result.computation_time_sec =
+          global_planner_timer.getTime() + smoothing_timer.getTime();
+      result.global_plan_time_sec = global_planner_timer.getTime();
+      result.smoothing_time_sec = smoothing_timer.getTime();
+      result.shortening_time_sec = global_counters.shortening_time_sec +
+                                   smoothing_counters.shortening_time_sec;
+      result.num_distance_queries = global_counters.distance_queries +
+                                    smoothing_counters.distance_queries;
+      result.num_collision_checks = global_counters.collision_checks +
+                                    smoothing_counters.collision_checks;
+      result.num_allocations = global_allocations + smoothing_allocations;
+      result.peak_rss_delta_kb = getPeakRssKb() - peak_rss_before_kb;
+
+      mav_trajectory_generation::timing::MiniTimer collision_check_timer;
+      fillInPathResults(path, &result);
+      result.collision_check_time_sec = collision_check_timer.stop();
+
+      results->push_back(result);
+      paths->push_back(path);
     }
   }
+  return true;
 }
 
-void GlobalPlanningBenchmark::outputResults(const std::string& filename) {
+bool GlobalPlanningBenchmark::outputResultsCsv(
+    const std::string& filename) const {
   // Append? That's cool I guess.
   FILE* fp = fopen(filename.c_str(), "w+");
   if (fp == NULL) {
-    return;
+    LOG(ERROR) << "Couldn't open results file: " << filename;
+    return false;
   }
   fprintf(fp,
           "#trial,seed,robot_radius,v_max,a_max,global_method,smoothing_method,"
           "planning_success,is_collision_free,is_feasible,computation_time_sec,"
           "total_path_time_sec,total_path_length_m,straight_line_path_length_"
-          "m\n");
+          "m,global_plan_time_sec,shortening_time_sec,smoothing_time_sec,"
+          "collision_check_time_sec,num_distance_queries,num_collision_checks,"
+          "num_allocations,peak_rss_delta_kb,global_planner\n");
   for (const GlobalBenchmarkResult& result : results_) {
-    fprintf(fp, "%d,%d,%f,%f,%f,%d,%d,%d,%d,%d,%f,%f,%f,%f\n",
+    fprintf(fp,
+            "%d,%d,%f,%f,%f,%d,%d,%d,%d,%d,%f,%f,%f,%f,%f,%f,%f,%f,%zu,%zu,"
+            "%zu,%zu,%d\n",
             result.trial_number, result.seed, result.robot_radius_m,
             result.v_max, result.a_max, result.global_planning_method,
             result.path_smoothing_method, result.planning_success,
             result.is_collision_free, result.is_feasible,
             result.computation_time_sec, result.total_path_time_sec,
-            result.total_path_length_m, result.straight_line_path_length_m);
+            result.total_path_length_m, result.straight_line_path_length_m,
+            result.global_plan_time_sec, result.shortening_time_sec,
+            result.smoothing_time_sec, result.collision_check_time_sec,
+            result.num_distance_queries, result.num_collision_checks,
+            result.num_allocations, result.peak_rss_delta_kb,
+            result.global_planner);
   }
   fclose(fp);
-  ROS_INFO_STREAM(
-      "[Global Planning Benchmark] Output results to: " << filename);
+  LOG(INFO) << "[Global Planning Benchmark] Output results to: " << filename;
+  return true;
+}
+
+bool GlobalPlanningBenchmark::outputResultsJson(
+    const std::string& filename) const {
+  FILE* fp = fopen(filename.c_str(), "w+");
+  if (fp == NULL) {
+    LOG(ERROR) << "Couldn't open results file: " << filename;
+    return false;
+  }
+  // Same fields as the CSV, plus the method names so that nobody has to look
+  // up the enum values.
+  fprintf(fp, "{\n  \"map\": %s,\n  \"results\": [",
+          toJsonString(config_.base_path + "/" + config_.esdf_name).c_str());
+  for (size_t i = 0; i < results_.size(); ++i) {
+    const GlobalBenchmarkResult& result = results_[i];
+    fprintf(fp,
+            "%s\n    {\"trial\": %d, \"seed\": %d, \"robot_radius\": %f, "
+            "\"v_max\": %f, \"a_max\": %f, \"global_planner\": %d, "
+            "\"global_planner_name\": %s, \"global_method\": %d, "
+            "\"global_method_name\": %s, \"smoothing_method\": %d, "
+            "\"smoothing_method_name\": %s, \"planning_success\": %s, "
+            "\"is_collision_free\": %s, \"is_feasible\": %s, "
+            "\"computation_time_sec\": %f, \"total_path_time_sec\": %f, "
+            "\"total_path_length_m\": %f, "
+            "\"straight_line_path_length_m\": %f, "
+            "\"global_plan_time_sec\": %f, \"shortening_time_sec\": %f, "
+            "\"smoothing_time_sec\": %f, \"collision_check_time_sec\": %f, "
+            "\"num_distance_queries\": %zu, \"num_collision_checks\": %zu, "
+            "\"num_allocations\": %zu, \"peak_rss_delta_kb\": %zu}",
+            i == 0 ? "" : ",", result.trial_number, result.seed,
+            result.robot_radius_m, result.v_max, result.a_max,
+            result.global_planner,
+            toJsonString(config_.global_planners[result.global_planner].name)
+                .c_str(),
+            result.global_planning_method,
+            toJsonString(
+                globalPlanningMethodToString(result.global_planning_method))
+                .c_str(),
+            result.path_smoothing_method,
+            toJsonString(
+                pathSmoothingMethodToString(result.path_smoothing_method))
+                .c_str(),
+            result.planning_success ? "true" : "false",
+            result.is_collision_free ? "true" : "false",
+            result.is_feasible ? "true" : "false", result.computation_time_sec,
+            result.total_path_time_sec, result.total_path_length_m,
+            result.straight_line_path_length_m, result.global_plan_time_sec,
+            result.shortening_time_sec, result.smoothing_time_sec,
+            result.collision_check_time_sec, result.num_distance_queries,
+            result.num_collision_checks, result.num_allocations,
+            result.peak_rss_delta_kb);
+  }
+  fprintf(fp, "\n  ]\n}\n");
+  fclose(fp);
+  LOG(INFO) << "[Global Planning Benchmark] Output results to: " << filename;
+  return true;
+}
+
+bool GlobalPlanningBenchmark::outputSummaryCsv(
+    const std::string& filename) const {
+  FILE* fp = fopen(filename.c_str(), "w+");
+  if (fp == NULL) {
+    LOG(ERROR) << "Couldn't open summary file: " << filename;
+    return false;
+  }
+  fprintf(fp,
+          "#global_planner,global_method,smoothing_method,num_trials,"
+          "success_rate,"
+          "collision_free_rate,feasible_rate");
+  const std::vector<std::string> kMetrics = {
+      "computation_time_sec", "global_plan_time_sec", "shortening_time_sec",
+      "smoothing_time_sec",   "collision_check_time_sec",
+      "num_distance_queries", "num_collision_checks", "num_allocations"};
+  for (const std::string& metric : kMetrics) {
+    writePercentileHeader(fp, metric);
+  }
+  fprintf(fp, "\n");
+
+  for (size_t planner_index = 0;
+       planner_index < global_planning_methods_.size(); ++planner_index) {
+    for (PathSmoothingMethod smoothing_method : path_smoothing_methods_) {
+      std::vector<std::vector<double>> metrics(kMetrics.size());
+      int num_trials = 0, num_success = 0, num_collision_free = 0,
+          num_feasible = 0;
+      for (const GlobalBenchmarkResult& result : results_) {
+        if (result.global_planner != static_cast<int>(planner_index) ||
+            result.path_smoothing_method != smoothing_method) {
+          continue;
+        }
+        num_trials++;
+        num_success += result.planning_success;
+        num_collision_free += result.is_collision_free;
+        num_feasible += result.is_feasible;
+        // Same order as kMetrics.
+        metrics[0].push_back(result.computation_time_sec);
+        metrics[1].push_back(result.global_plan_time_sec);
+        metrics[2].push_back(result.shortening_time_sec);
+        metrics[3].push_back(result.smoothing_time_sec);
+        metrics[4].push_back(result.collision_check_time_sec);
+        metrics[5].push_back(result.num_distance_queries);
+        metrics[6].push_back(result.num_collision_checks);
+        metrics[7].push_back(result.num_allocations);
+      }
+      if (num_trials == 0) {
+        continue;
+      }
+      fprintf(fp, "%s,%s,%s,%d,%f,%f,%f",
+              config_.global_planners[planner_index].name.c_str(),
+              globalPlanningMethodToString(
+                  global_planning_methods_[planner_index])
+                  .c_str(),
+              pathSmoothingMethodToString(smoothing_method).c_str(),
+              num_trials, static_cast<double>(num_success) / num_trials,
+              static_cast<double>(num_collision_free) / num_trials,
+              static_cast<double>(num_feasible) / num_trials);
+      for (const std::vector<double>& values : metrics) {
+        writePercentiles(fp, values);
+      }
+      fprintf(fp, "\n");
+    }
+  }
+  fclose(fp);
+  LOG(INFO) << "[Global Planning Benchmark] Output summary to: " << filename;
+  return true;
+}
+
+bool GlobalPlanningBenchmark::outputCostTracesCsv(
+    const std::string& filename) const {
+  FILE* fp = fopen(filename.c_str(), "w+");
+  if (fp == NULL) {
+    LOG(ERROR) << "Couldn't open cost traces file: " << filename;
+    return false;
+  }
+  fprintf(fp,
+          "#trial,seed,global_planner,global_method,time_sec,cost,tree_size,"
+          "collision_checks\n");
+  for (const GlobalBenchmarkResult& result : results_) {
+    // Every smoother has a copy of the same trace.
+    if (path_smoothing_methods_.empty() ||
+        result.path_smoothing_method != path_smoothing_methods_.front()) {
+      continue;
+    }
+    for (const VoxbloxOmplRrt::CostTracePoint& point : result.cost_trace) {
+      fprintf(fp, "%d,%d,%d,%d,%f,%f,%zu,%zu\n", result.trial_number,
+              result.seed, result.global_planner,
+              result.global_planning_method, point.time_sec, point.cost,
+              point.tree_size, point.collision_checks);
+    }
+  }
+  fclose(fp);
+  LOG(INFO) << "[Global Planning Benchmark] Output cost traces to: "
+            << filename;
+  return true;
+}
+
+std::string GlobalPlanningBenchmark::globalPlanningMethodToString(
+    GlobalPlanningMethod method) {
+  switch (method) {
+    case kStraightLine:
+      return "straight_line";
+    case kRrtConnect:
+      return "rrt_connect";
+    case kRrtStar:
+      return "rrt_star";
+    case kSkeletonGraph:
+      return "skeleton_graph";
+    case kPrm:
+      return "prm";
+    case kBitStar:
+      return "bit_star";
+    case kInformedRrtStar:
+      return "informed_rrt_star";
+  }
+  return "unknown";
+}
+
+std::string GlobalPlanningBenchmark::pathSmoothingMethodToString(
+    PathSmoothingMethod method) {
+  switch (method) {
+    case kNone:
+      return "none";
+    case kVelocityRamp:
+      return "velocity_ramp";
+    case kPolynomial:
+      return "polynomial";
+    case kLoco:
+      return "loco";
+    case kLoco2:
+      return "loco2";
+    case kLoco3:
+      return "loco3";
+  }
+  return "unknown";
+}
+
+bool GlobalPlanningBenchmark::globalPlanningMethodFromString(
+    const std::string& name, GlobalPlanningMethod* method) {
+  CHECK_NOTNULL(method);
+  for (int i = kStraightLine; i <= kInformedRrtStar; ++i) {
+    if (name == globalPlanningMethodToString(
+                    static_cast<GlobalPlanningMethod>(i))) {
+      *method = static_cast<GlobalPlanningMethod>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool GlobalPlanningBenchmark::pathSmoothingMethodFromString(
+    const std::string& name, PathSmoothingMethod* method) {
+  CHECK_NOTNULL(method);
+  for (int i = kNone; i <= kLoco3; ++i) {
+    if (name ==
+        pathSmoothingMethodToString(static_cast<PathSmoothingMethod>(i))) {
+      *method = static_cast<PathSmoothingMethod>(i);
+      return true;
+    }
+  }
+  return false;
 }
 
 bool GlobalPlanningBenchmark::selectRandomStartAndGoal(
@@ -335,34 +810,16 @@ bool GlobalPlanningBenchmark::selectRandomStartAndGoal(
 
 double GlobalPlanningBenchmark::getMapDistance(
     const Eigen::Vector3d& position) const {
-  CHECK(esdf_server_);
-  double distance = 0.0;
-  const bool kInterpolate = false;
-  if (!esdf_server_->getEsdfMapPtr()->getDistanceAtPosition(
-          position, kInterpolate, &distance)) {
-    return 0.0;
-  }
-  return distance;
-}
-
-double GlobalPlanningBenchmark::getMapDistanceAndGradient(
-    const Eigen::Vector3d& position, Eigen::Vector3d* gradient) const {
-  CHECK(esdf_server_);
-  double distance = 0.0;
-  const bool kInterpolate = false;
-  if (!esdf_server_->getEsdfMapPtr()->getDistanceAndGradientAtPosition(
-          position, kInterpolate, &distance, gradient)) {
-    return 0.0;
-  }
-  return distance;
+  CHECK(esdf_map_);
+  return distance_source_.getDistance(position);
 }
 
 double GlobalPlanningBenchmark::getMapDistanceWithoutInterpolation(
     const Eigen::Vector3d& position) const {
-  CHECK(esdf_server_);
+  CHECK(esdf_map_);
   double distance = 0.0;
   const bool kInterpolate = false;
-  if (!esdf_server_->getEsdfMapPtr()->getDistanceAtPosition(
+  if (!esdf_map_->getDistanceAtPosition(
           position, kInterpolate, &distance)) {
     return 0.0;
   }
@@ -371,6 +828,7 @@ double GlobalPlanningBenchmark::getMapDistanceWithoutInterpolation(
 
 bool GlobalPlanningBenchmark::isPathCollisionFree(
     const mav_msgs::EigenTrajectoryPointVector& path) const {
+  MapQueryScope scope;
   for (const mav_msgs::EigenTrajectoryPoint& point : path) {
     if (getMapDistance(point.position_W) < constraints_.robot_radius) {
       return false;
@@ -408,93 +866,150 @@ void GlobalPlanningBenchmark::fillInPathResults(
 }
 
 bool GlobalPlanningBenchmark::runGlobalPlanner(
-    const GlobalPlanningMethod planning_method,
-    const mav_msgs::EigenTrajectoryPoint& start,
-    const mav_msgs::EigenTrajectoryPoint& goal,
-    mav_msgs::EigenTrajectoryPointVector* waypoints) {
+    size_t planner_index, const mav_msgs::EigenTrajectoryPoint& start,
+    const mav_msgs::EigenTrajectoryPoint& goal, TrialWorker* worker,
+    mav_msgs::EigenTrajectoryPointVector* waypoints,
+    VoxbloxOmplRrt::CostTrace* cost_trace) const {
+  CHECK_NOTNULL(worker);
   CHECK_NOTNULL(waypoints);
+  CHECK_NOTNULL(cost_trace);
+  cost_trace->clear();
+  CHECK_LT(planner_index, global_planning_methods_.size());
+  const GlobalPlanningMethod planning_method =
+      global_planning_methods_[planner_index];
   if (planning_method == kStraightLine) {
     waypoints->push_back(start);
     waypoints->push_back(goal);
     return true;
   }
-  if (planning_method == kRrtConnect) {
-    bool success =
-        rrt_connect_planner_.getPathBetweenWaypoints(start, goal, waypoints);
+  if (planning_method == kSkeletonGraph) {
+    bool success = worker->skeleton_planner.getPathBetweenWaypoints(
+        start, goal, waypoints);
     return success;
   }
-  if (planning_method == kRrtStar) {
-    bool success =
-        rrt_star_planner_.getPathBetweenWaypoints(start, goal, waypoints);
-    return success;
+
+  // Everything else is one of the OMPL planners.
+  const std::vector<std::unique_ptr<VoxbloxOmplRrt>>& ompl_planners =
+      worker->ompl_planners[planner_index];
+  if (ompl_planners.empty()) {
+    return false;
   }
-  if (planning_method == kSkeletonGraph) {
+  if (ompl_planners.size() == 1) {
     bool success =
-        skeleton_planner_.getPathBetweenWaypoints(start, goal, waypoints);
+        ompl_planners.front()->getPathBetweenWaypoints(start, goal, waypoints);
+    *cost_trace = ompl_planners.front()->getCostTrace();
     return success;
   }
-  if (planning_method == kPrm) {
-    bool success = prm_planner_.getPathBetweenWaypoints(start, goal, waypoints);
-    return success;
+  return runParallelOmplPlanners(ompl_planners, start, goal, waypoints,
+                                 cost_trace);
+}
+
+bool GlobalPlanningBenchmark::runParallelOmplPlanners(
+    const std::vector<std::unique_ptr<VoxbloxOmplRrt>>& planners,
+    const mav_msgs::EigenTrajectoryPoint& start,
+    const mav_msgs::EigenTrajectoryPoint& goal,
+    mav_msgs::EigenTrajectoryPointVector* waypoints,
+    VoxbloxOmplRrt::CostTrace* cost_trace) const {
+  CHECK_NOTNULL(waypoints);
+  CHECK_NOTNULL(cost_trace);
+  std::vector<mav_msgs::EigenTrajectoryPointVector> solutions(planners.size());
+  std::vector<PlanningCounters> counters(planners.size());
+  std::vector<std::future<bool>> futures;
+  for (size_t i = 0; i < planners.size(); ++i) {
+    futures.push_back(std::async(std::launch::async, [&, i]() {
+      const PlanningCounters counters_before = getPlanningCounters();
+      const bool success =
+          planners[i]->getPathBetweenWaypoints(start, goal, &solutions[i]);
+      counters[i] = getPlanningCounters() - counters_before;
+      return success;
+    }));
   }
 
-  return false;
+  bool success = false;
+  double best_length = std::numeric_limits<double>::max();
+  for (size_t i = 0; i < futures.size(); ++i) {
+    const bool planner_success = futures[i].get();
+    getPlanningCounters() += counters[i];
+    if (!planner_success) {
+      continue;
+    }
+    const double length = computePathLength(solutions[i]);
+    if (length < best_length) {
+      best_length = length;
+      waypoints->swap(solutions[i]);
+      *cost_trace = planners[i]->getCostTrace();
+      success = true;
+    }
+  }
+  return success;
 }
 
 bool GlobalPlanningBenchmark::runPathSmoother(
     const PathSmoothingMethod smoothing_method,
-    const mav_msgs::EigenTrajectoryPointVector& waypoints,
-    mav_msgs::EigenTrajectoryPointVector* path) {
+    const mav_msgs::EigenTrajectoryPointVector& waypoints, TrialWorker* worker,
+    mav_msgs::EigenTrajectoryPointVector* path) const {
+  CHECK_NOTNULL(worker);
   CHECK_NOTNULL(path);
   if (smoothing_method == kNone) {
     *path = waypoints;
     return true;
   }
   if (smoothing_method == kVelocityRamp) {
-    bool success = ramp_smoother_.getPathBetweenWaypoints(waypoints, path);
+    bool success =
+        worker->ramp_smoother.getPathBetweenWaypoints(waypoints, path);
     return success;
   }
 
   if (smoothing_method == kPolynomial) {
-    bool success = poly_smoother_.getPathBetweenWaypoints(waypoints, path);
+    bool success =
+        worker->poly_smoother.getPathBetweenWaypoints(waypoints, path);
     return success;
   }
 
   if (smoothing_method == kLoco) {
-    ROS_INFO("Starting method: loco");
+    if (verbose_) {
+      LOG(INFO) << "Starting method: loco";
+    }
     bool success = false;
     if (waypoints.size() == 2) {
-      success = loco_smoother_.getPathBetweenTwoPoints(waypoints[0],
-                                                       waypoints[1], path);
+      success = worker->loco_smoother.getPathBetweenTwoPoints(
+          waypoints[0], waypoints[1], path);
     } else {
-      success = loco_smoother_.getPathBetweenWaypoints(waypoints, path);
+      success = worker->loco_smoother.getPathBetweenWaypoints(waypoints, path);
     }
     return success;
   }
 
   if (smoothing_method == kLoco2) {
-    ROS_INFO("Starting method: loco2");
+    if (verbose_) {
+      LOG(INFO) << "Starting method: loco2";
+    }
     bool success = false;
     if (waypoints.size() == 2) {
-      success = loco2_smoother_.getPathBetweenTwoPoints(waypoints[0],
-                                                        waypoints[1], path);
+      success = worker->loco2_smoother.getPathBetweenTwoPoints(
+          waypoints[0], waypoints[1], path);
     } else {
-      success = loco2_smoother_.getPathBetweenWaypoints(waypoints, path);
+      success =
+          worker->loco2_smoother.getPathBetweenWaypoints(waypoints, path);
     }
     return success;
   }
 
   if (smoothing_method == kLoco3) {
-    ROS_INFO("Starting method: loco3");
+    if (verbose_) {
+      LOG(INFO) << "Starting method: loco3";
+    }
     bool success = false;
     if (waypoints.size() == 2) {
-      success = loco3_smoother_.getPathBetweenTwoPoints(waypoints[0],
-                                                        waypoints[1], path);
+      success = worker->loco3_smoother.getPathBetweenTwoPoints(
+          waypoints[0], waypoints[1], path);
     } else {
-      success = loco3_smoother_.getPathBetweenWaypoints(waypoints, path);
+      success =
+          worker->loco3_smoother.getPathBetweenWaypoints(waypoints, path);
     }
     return success;
   }
+  return false;
 }
 
 }  // namespace mav_planning
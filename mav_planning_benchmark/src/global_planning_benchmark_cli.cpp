@@ -0,0 +1,69 @@
+#include <glog/logging.h>
+#include <mav_trajectory_generation/timing.h>
+
+#include "mav_planning_benchmark/benchmark_utils.h"
+#include "mav_planning_benchmark/config_file.h"
+#include "mav_planning_benchmark/global_planning_benchmark.h"
+
+// Runs the global planning benchmark without ROS. Usage:
+//   global_planning_benchmark_cli config.yaml [key:=value ...]
+// Anything after the config file overrides a value in it.
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  google::InstallFailureSignalHandler();
+  FLAGS_alsologtostderr = true;
+
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s config.yaml [key:=value ...]\n", argv[0]);
+    return 1;
+  }
+
+  mav_planning::ConfigFile config_file;
+  if (!config_file.load(argv[1])) {
+    return 1;
+  }
+  for (int i = 2; i < argc; ++i) {
+    const std::string arg(argv[i]);
+    const size_t separator = arg.find(":=");
+    if (separator == std::string::npos) {
+      LOG(ERROR) << "Expected key:=value, got: " << arg;
+      return 1;
+    }
+    config_file.set(arg.substr(0, separator), arg.substr(separator + 2));
+  }
+
+  mav_planning::GlobalBenchmarkConfig config;
+  config.setParameters(config_file);
+
+  mav_planning::GlobalPlanningBenchmark benchmark;
+  if (!benchmark.setConfig(config)) {
+    return 1;
+  }
+  // Same settings for the skeleton planner and the smoothers as the ROS node
+  // reads from its params.
+  benchmark.setComponentParameters(&config_file);
+  if (!benchmark.loadMap()) {
+    return 1;
+  }
+  // Only now that the planners and smoothers read theirs too.
+  for (const std::string& key : config_file.getUnusedKeys()) {
+    LOG(WARNING) << "Unknown config key: " << key;
+  }
+  benchmark.runBenchmark();
+
+  // Results name is the CSV, the JSON, summary and cost traces go next to it.
+  const std::string results_path = config.base_path + "/" + config.results_name;
+  const std::string results_prefix =
+      mav_planning::getResultsPathPrefix(results_path);
+  bool success = benchmark.outputResultsCsv(results_path);
+  success &= benchmark.outputResultsJson(results_prefix + ".json");
+  success &= benchmark.outputSummaryCsv(results_prefix + "_summary.csv");
+  if (config.record_cost_traces) {
+    success &=
+        benchmark.outputCostTracesCsv(results_prefix + "_cost_traces.csv");
+  }
+
+  LOG(INFO) << "All timings: " << std::endl
+            << mav_trajectory_generation::timing::Timing::Print();
+  return success ? 0 : 1;
+}
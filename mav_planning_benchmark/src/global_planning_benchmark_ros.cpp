@@ -0,0 +1,101 @@
+#include <algorithm>
+
+#include <mav_planning_common/color_utils.h>
+#include <mav_planning_common/path_visualization.h>
+
+#include "mav_planning_benchmark/benchmark_utils.h"
+#include "mav_planning_benchmark/global_planning_benchmark_ros.h"
+
+namespace mav_planning {
+
+GlobalPlanningBenchmarkRos::GlobalPlanningBenchmarkRos(
+    const ros::NodeHandle& nh, const ros::NodeHandle& nh_private)
+    : nh_(nh), nh_private_(nh_private), visualize_(true), frame_id_("map") {
+  nh_private_.param("visualize", visualize_, visualize_);
+  nh_private_.param("frame_id", frame_id_, frame_id_);
+
+  GlobalBenchmarkConfig config;
+  config.verbose = true;
+  config.setParameters(nh_private_);
+  if (!benchmark_.setConfig(config)) {
+    ROS_FATAL("[Global Planning Benchmark] Invalid config, shutting down.");
+    ros::shutdown();
+    return;
+  }
+
+  // The skeleton planner and the smoothers have more settings than the
+  // config, read from the same params as in their own nodes.
+  benchmark_.setComponentParameters(&nh_private_);
+
+  path_marker_pub_ =
+      nh_private_.advertise<visualization_msgs::MarkerArray>("path", 1, true);
+
+  benchmark_.setTrialCallback(
+      std::bind(&GlobalPlanningBenchmarkRos::publishTrial, this,
+                std::placeholders::_1, std::placeholders::_2,
+                std::placeholders::_3));
+}
+
+bool GlobalPlanningBenchmarkRos::loadMap() {
+  if (!benchmark_.loadMap()) {
+    return false;
+  }
+
+  if (visualize_) {
+    const GlobalBenchmarkConfig& config = benchmark_.getConfig();
+    esdf_server_.reset(new voxblox::EsdfServer(nh_, nh_private_));
+    if (!esdf_server_->loadMap(config.base_path + "/" + config.esdf_name)) {
+      ROS_WARN("[Global Planning Benchmark] Couldn't load map to visualize.");
+      return true;
+    }
+    esdf_server_->setTraversabilityRadius(config.constraints.robot_radius);
+    esdf_server_->disableIncrementalUpdate();
+    esdf_server_->updateMesh();
+    esdf_server_->publishSlices();
+    esdf_server_->publishPointclouds();
+    esdf_server_->publishTraversable();
+  }
+  return true;
+}
+
+void GlobalPlanningBenchmarkRos::runBenchmark() { benchmark_.runBenchmark(); }
+
+void GlobalPlanningBenchmarkRos::outputResults() {
+  const GlobalBenchmarkConfig& config = benchmark_.getConfig();
+  const std::string results_path = config.base_path + "/" + config.results_name;
+  const std::string results_prefix = getResultsPathPrefix(results_path);
+  benchmark_.outputResultsCsv(results_path);
+  benchmark_.outputResultsJson(results_prefix + ".json");
+  benchmark_.outputSummaryCsv(results_prefix + "_summary.csv");
+  if (config.record_cost_traces) {
+    benchmark_.outputCostTracesCsv(results_prefix + "_cost_traces.csv");
+  }
+}
+
+bool GlobalPlanningBenchmarkRos::publishTrial(
+    int trial,
+    const std::vector<GlobalPlanningBenchmark::GlobalBenchmarkResult>& results,
+    const std::vector<mav_msgs::EigenTrajectoryPointVector>& paths) {
+  if (visualize_) {
+    visualization_msgs::MarkerArray marker_array;
+    const double num_planners =
+        std::max<size_t>(benchmark_.getConfig().global_planners.size(), 1);
+    for (size_t i = 0; i < results.size(); ++i) {
+      // By planner, not method, since there can be several of each method.
+      const int global_planner = results[i].global_planner;
+      const int smoothing_method = results[i].path_smoothing_method;
+      mav_msgs::EigenTrajectoryPointVector path = paths[i];
+      marker_array.markers.push_back(createMarkerForPath(
+          path, frame_id_,
+          percentToRainbowColor(global_planner / num_planners +
+                                smoothing_method / (3.0 * num_planners)),
+          std::to_string(global_planner) + "_" +
+              std::to_string(smoothing_method),
+          0.075));
+    }
+    path_marker_pub_.publish(marker_array);
+  }
+  return ros::ok();
+}
+
+}  // namespace mav_planning
@@ -1,21 +1,28 @@
 #include <mav_planning_common/color_utils.h>
 #include <mav_planning_common/path_visualization.h>
+#include <mav_planning_common/planning_counters.h>
 #include <mav_planning_common/utils.h>
 #include <mav_trajectory_generation/timing.h>
 #include <mav_trajectory_generation/trajectory_sampling.h>
 #include <mav_visualization/helpers.h>
 #include <voxblox/core/common.h>
 #include <voxblox/utils/planning_utils.h>
+#include <voxblox_ros/ros_params.h>
+#include <voxblox_planning_common/synthetic_world.h>
 
+#include "mav_planning_benchmark/benchmark_utils.h"
 #include "mav_planning_benchmark/local_planning_benchmark.h"
+#include "mav_planning_benchmark/resource_usage.h"
 
 namespace mav_planning {
 
 LocalPlanningBenchmark::LocalPlanningBenchmark(
-    const ros::NodeHandle& nh, const ros::NodeHandle& nh_private)
+    const ros::NodeHandle& nh, const ros::NodeHandle& nh_private,
+    bool headless)
     : nh_(nh),
       nh_private_(nh_private),
       visualize_(true),
+      headless_(headless || nh_private.param("headless", false)),
       frame_id_("map"),
       replan_dt_(1.0),
       max_replans_(60),
@@ -26,46 +33,110 @@ LocalPlanningBenchmark::LocalPlanningBenchmark(
       camera_min_dist_(0.5),
       camera_max_dist_(10.0),
       camera_model_dist_(5.0),
-      loco_planner_(nh_, nh_private_),
-      esdf_server_(nh_, nh_private_) {
+      loco_planner_(nh_, nh_private_, headless_) {
   constraints_.setParametersFromRos(nh_private_);
   goal_selector_.setParametersFromRos(nh_private_);
 
   nh_private_.param("visualize", visualize_, visualize_);
   nh_private_.param("frame_id", frame_id_, frame_id_);
+  if (headless_) {
+    visualize_ = false;
+  }
 
   nh_private_.param("camera_max_dist", camera_max_dist_, camera_max_dist_);
   nh_private_.param("camera_model_dist", camera_model_dist_,
                     camera_model_dist_);
 
-  path_marker_pub_ =
-      nh_private_.advertise<visualization_msgs::MarkerArray>("path", 1, true);
-  view_ptcloud_pub_ = nh_private_.advertise<pcl::PointCloud<pcl::PointXYZRGB> >(
-      "view_ptcloud_pub", 1, true);
-  additional_marker_pub_ =
-      nh_private_.advertise<visualization_msgs::MarkerArray>("path_additions",
-                                                             1, true);
+  if (!headless_) {
+    path_marker_pub_ = nh_private_.advertise<visualization_msgs::MarkerArray>(
+        "path", 1, true);
+    view_ptcloud_pub_ =
+        nh_private_.advertise<pcl::PointCloud<pcl::PointXYZRGB> >(
+            "view_ptcloud_pub", 1, true);
+    additional_marker_pub_ =
+        nh_private_.advertise<visualization_msgs::MarkerArray>(
+            "path_additions", 1, true);
+  }
+
+  setupMap();
+
+  loco_planner_.setEsdfMap(esdf_map_);
+  goal_selector_.setTsdfMap(tsdf_map_);
+}
+
+void LocalPlanningBenchmark::setupMap() {
+  if (!headless_) {
+    esdf_server_.reset(new voxblox::EsdfServer(nh_, nh_private_));
+    esdf_server_->setClearSphere(true);
+    tsdf_map_ = esdf_server_->getTsdfMapPtr();
+    esdf_map_ = esdf_server_->getEsdfMapPtr();
+    return;
+  }
 
-  esdf_server_.setClearSphere(true);
+  // Same settings as the server would read.
+  std::string method = "merged";
+  nh_private_.param("method", method, method);
+  tsdf_map_.reset(
+      new voxblox::TsdfMap(voxblox::getTsdfMapConfigFromRosParam(nh_private_)));
+  esdf_map_.reset(
+      new voxblox::EsdfMap(voxblox::getEsdfMapConfigFromRosParam(nh_private_)));
+  tsdf_integrator_ = voxblox::TsdfIntegratorFactory::create(
+      method, voxblox::getTsdfIntegratorConfigFromRosParam(nh_private_),
+      tsdf_map_->getTsdfLayerPtr());
+  esdf_integrator_.reset(new voxblox::EsdfIntegrator(
+      voxblox::getEsdfIntegratorConfigFromRosParam(nh_private_),
+      tsdf_map_->getTsdfLayerPtr(), esdf_map_->getEsdfLayerPtr()));
+}
 
-  loco_planner_.setEsdfMap(esdf_server_.getEsdfMapPtr());
-  goal_selector_.setTsdfMap(esdf_server_.getTsdfMapPtr());
+void LocalPlanningBenchmark::clearMap() {
+  if (esdf_server_) {
+    esdf_server_->clear();
+    return;
+  }
+  tsdf_map_->getTsdfLayerPtr()->removeAllBlocks();
+  esdf_map_->getEsdfLayerPtr()->removeAllBlocks();
+  esdf_integrator_->clear();
+}
+
+void LocalPlanningBenchmark::integrateIntoMap(
+    const voxblox::Transformation& T_G_C, const voxblox::Pointcloud& ptcloud_C,
+    const voxblox::Colors& colors) {
+  // NewPoseCallback will mark unknown as occupied and clear space otherwise.
+  if (esdf_server_) {
+    esdf_server_->integratePointcloud(T_G_C, ptcloud_C, colors);
+    esdf_server_->newPoseCallback(T_G_C);
+    if (visualize_) {
+      // Updates the ESDF too.
+      esdf_server_->updateMesh();
+    } else {
+      esdf_server_->updateEsdf();
+    }
+    return;
+  }
+  // Same as the server does, with the clear sphere on.
+  tsdf_integrator_->integratePointCloud(T_G_C, ptcloud_C, colors);
+  esdf_integrator_->addNewRobotPosition(T_G_C.getPosition());
+  if (tsdf_map_->getTsdfLayer().getNumberOfAllocatedBlocks() > 0) {
+    const bool kClearUpdatedFlag = true;
+    esdf_integrator_->updateFromTsdfLayer(kClearUpdatedFlag);
+  }
 }
 
-void LocalPlanningBenchmark::generateWorld(double density) {
-  // There's a 2 meter padding on each side of the map that's free.
+void LocalPlanningBenchmark::generateWorld(double density, int seed) {
+  // There's a 4 meter padding on each side of the map that's free.
   const double kWorldXY = 15.0;
   const double kWorldZ = 5.0;
 
-  generateCustomWorld(Eigen::Vector3d(kWorldXY, kWorldXY, kWorldZ), density);
+  generateCustomWorld(Eigen::Vector3d(kWorldXY, kWorldXY, kWorldZ), density,
+                      seed);
 }
 
 void LocalPlanningBenchmark::runBenchmark(int trial_number) {
   constexpr double kPlanningHeight = 1.5;
   constexpr double kMinDistanceToGoal = 0.2;
 
-  srand(trial_number);
-  esdf_server_.clear();
+  seedRandom(trial_number);
+  clearMap();
   LocalBenchmarkResult result_template;
 
   result_template.trial_number = trial_number;
@@ -118,6 +189,11 @@ void LocalPlanningBenchmark::runBenchmark(int trial_number) {
   double start_time = 0.0;
   double plan_elapsed_time = 0.0;
   double total_path_distance = 0.0;
+
+  const size_t peak_rss_before_kb = getPeakRssKb();
+  PlanningCounters planning_counters;
+  size_t num_allocations = 0;
+
   int i = 0;
   for (i = 0; i < max_replans_; ++i) {
     if (i > 0 && !trajectory.empty()) {
@@ -130,7 +206,9 @@ void LocalPlanningBenchmark::runBenchmark(int trial_number) {
     } else {
       viewpoint = executed_path.back();
     }
+    mav_trajectory_generation::timing::MiniTimer map_update_timer;
     addViewpointToMap(viewpoint);
+    result_template.map_update_time_sec += map_update_timer.stop();
     if (visualize_) {
       appendViewpointMarker(viewpoint, &additional_markers);
     }
@@ -139,6 +217,8 @@ void LocalPlanningBenchmark::runBenchmark(int trial_number) {
     last_trajectory = trajectory;
 
     // Actually plan the path.
+    const PlanningCounters counters_before = getPlanningCounters();
+    const size_t allocations_before = getThreadAllocationCount();
     mav_trajectory_generation::timing::MiniTimer timer;
     bool success = false;
 
@@ -149,16 +229,27 @@ void LocalPlanningBenchmark::runBenchmark(int trial_number) {
       success = loco_planner_.getTrajectoryTowardGoalFromInitialTrajectory(
           start_time, last_trajectory, current_goal, &trajectory);
     }
-    plan_elapsed_time += timer.stop();
+    const double replan_time = timer.stop();
+    plan_elapsed_time += replan_time;
+    result_template.replan_times_sec.push_back(replan_time);
+    result_template.max_replan_time_sec =
+        std::max(result_template.max_replan_time_sec, replan_time);
 
     if (!success || trajectory.empty()) {
-      if (!goal_selector_.selectNextGoal(goal, current_goal, viewpoint,
-                                         &current_goal)) {
+      mav_trajectory_generation::timing::MiniTimer goal_selection_timer;
+      const bool new_goal = goal_selector_.selectNextGoal(
+          goal, current_goal, viewpoint, &current_goal);
+      result_template.goal_selection_time_sec += goal_selection_timer.stop();
+      planning_counters += getPlanningCounters() - counters_before;
+      num_allocations += getThreadAllocationCount() - allocations_before;
+      if (!new_goal) {
         // In case we're not tracking a new goal...
         break;
       }
       continue;
     }
+    planning_counters += getPlanningCounters() - counters_before;
+    num_allocations += getThreadAllocationCount() - allocations_before;
 
     // Sample the trajectory, set the yaw, and append to the executed path.
     mav_msgs::EigenTrajectoryPointVector path;
@@ -216,8 +307,16 @@ void LocalPlanningBenchmark::runBenchmark(int trial_number) {
   // Rough estimate. ;)
   result_template.total_path_time_sec =
       constraints_.sampling_dt * executed_path.size();
+  result_template.shortening_time_sec = planning_counters.shortening_time_sec;
+  result_template.num_distance_queries = planning_counters.distance_queries;
+  result_template.num_collision_checks = planning_counters.collision_checks;
+  result_template.num_allocations = num_allocations;
+  result_template.peak_rss_delta_kb = getPeakRssKb() - peak_rss_before_kb;
+
+  mav_trajectory_generation::timing::MiniTimer collision_check_timer;
   result_template.is_collision_free = isPathCollisionFree(executed_path);
   result_template.is_feasible = isPathFeasible(executed_path);
+  result_template.collision_check_time_sec = collision_check_timer.stop();
   result_template.local_planning_method = kLoco;
 
   results_.push_back(result_template);
@@ -237,72 +336,116 @@ void LocalPlanningBenchmark::outputResults(const std::string& filename) {
           "#trial,seed,density,robot_radius,v_max,a_max,local_method,planning_"
           "success,is_collision_free,is_feasible,num_replans,distance_from_"
           "goal,computation_time_sec,total_path_time_sec,total_path_length_m,"
-          "straight_line_path_length_m\n");
+          "straight_line_path_length_m,map_update_time_sec,shortening_time_"
+          "sec,goal_selection_time_sec,collision_check_time_sec,max_replan_"
+          "time_sec,num_distance_queries,num_collision_checks,num_"
+          "allocations,peak_rss_delta_kb\n");
   for (const LocalBenchmarkResult& result : results_) {
-    fprintf(fp, "%d,%d,%f,%f,%f,%f,%d,%d,%d,%d,%d,%f,%f,%f,%f,%f\n",
+    fprintf(fp,
+            "%d,%d,%f,%f,%f,%f,%d,%d,%d,%d,%d,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f,"
+            "%zu,%zu,%zu,%zu\n",
             result.trial_number, result.seed, result.density,
             result.robot_radius_m, result.v_max, result.a_max,
             result.local_planning_method, result.planning_success,
             result.is_collision_free, result.is_feasible, result.num_replans,
             result.distance_from_goal, result.computation_time_sec,
             result.total_path_time_sec, result.total_path_length_m,
-            result.straight_line_path_length_m);
+            result.straight_line_path_length_m, result.map_update_time_sec,
+            result.shortening_time_sec, result.goal_selection_time_sec,
+            result.collision_check_time_sec, result.max_replan_time_sec,
+            result.num_distance_queries, result.num_collision_checks,
+            result.num_allocations, result.peak_rss_delta_kb);
   }
   fclose(fp);
   ROS_INFO_STREAM("[Local Planning Benchmark] Output results to: " << filename);
 }
 
+void LocalPlanningBenchmark::outputSummary(const std::string& filename) {
+  FILE* fp = fopen(filename.c_str(), "w+");
+  if (fp == NULL) {
+    return;
+  }
+  fprintf(fp, "#local_method,density,num_trials,success_rate");
+  writePercentileHeader(fp, "replan_time_sec");
+  writePercentileHeader(fp, "computation_time_sec");
+  writePercentileHeader(fp, "map_update_time_sec");
+  writePercentileHeader(fp, "num_distance_queries");
+  writePercentileHeader(fp, "num_collision_checks");
+  writePercentileHeader(fp, "num_allocations");
+  fprintf(fp, "\n");
+
+  // Results come in order of density, so group consecutive ones.
+  size_t first = 0;
+  while (first < results_.size()) {
+    size_t last = first;
+    while (last < results_.size() &&
+           results_[last].local_planning_method ==
+               results_[first].local_planning_method &&
+           results_[last].density == results_[first].density) {
+      last++;
+    }
+
+    int num_success = 0;
+    std::vector<double> replan_times, computation_times, map_update_times,
+        distance_queries, collision_checks, allocations;
+    for (size_t i = first; i < last; ++i) {
+      const LocalBenchmarkResult& result = results_[i];
+      num_success += result.planning_success;
+      replan_times.insert(replan_times.end(), result.replan_times_sec.begin(),
+                          result.replan_times_sec.end());
+      computation_times.push_back(result.computation_time_sec);
+      map_update_times.push_back(result.map_update_time_sec);
+      distance_queries.push_back(result.num_distance_queries);
+      collision_checks.push_back(result.num_collision_checks);
+      allocations.push_back(result.num_allocations);
+    }
+    const int num_trials = static_cast<int>(last - first);
+    fprintf(fp, "%d,%f,%d,%f", results_[first].local_planning_method,
+            results_[first].density, num_trials,
+            static_cast<double>(num_success) / num_trials);
+    writePercentiles(fp, replan_times);
+    writePercentiles(fp, computation_times);
+    writePercentiles(fp, map_update_times);
+    writePercentiles(fp, distance_queries);
+    writePercentiles(fp, collision_checks);
+    writePercentiles(fp, allocations);
+    fprintf(fp, "\n");
+    first = last;
+  }
+  fclose(fp);
+  ROS_INFO_STREAM("[Local Planning Benchmark] Output summary to: " << filename);
+}
+
 void LocalPlanningBenchmark::generateCustomWorld(const Eigen::Vector3d& size,
-                                                 double density) {
-  esdf_server_.clear();
+                                                 double density, int seed) {
+  clearMap();
 
   lower_bound_ = Eigen::Vector3d::Zero();
   upper_bound_ = size;
 
   density_ = density;  // Cache this for result output.
+
+  // A forest of cylinders, with free space around the edges (so we know we
+  // don't start in collision). All objects gotta be on the floor. Just
+  // because.
+  SyntheticWorldSpec spec;
+  spec.type = SyntheticWorldSpec::kForest;
+  spec.seed = seed;
+  spec.size = size;
+  spec.density = density;
+  spec.free_border_m = 4.0;
+  spec.min_radius_m = 0.25;
+  spec.max_radius_m = 1.0;
+  spec.min_height_m = 2.0;
   world_.clear();
-  world_.addPlaneBoundaries(0.0, size.x(), 0.0, size.y());
-
-  world_.addObject(std::unique_ptr<voxblox::Object>(new voxblox::PlaneObject(
-      voxblox::Point(0.0, 0.0, 0.0), voxblox::Point(0.0, 0.0, 1.0),
-      voxblox::Color::Green())));
-
-  // Sets the display bounds.
-  world_.setBounds(
-      Eigen::Vector3f(-1.0, -1.0, -1.0),
-      size.cast<voxblox::FloatingPoint>() + Eigen::Vector3f(1.0, 1.0, 1.0));
-
-  // Free space around the edges (so we know we don't start in collision).
-  Eigen::Vector3d free_space_bounds(4.0, 4.0, 4.0);
-
-  // Some mins and maxes... All objects gotta be on the floor. Just because.
-  const double kMinHeight = 2.0;
-  const double kMaxHeight = 5.0;
-  const double kMinRadius = 0.25;
-  const double kMaxRadius = 1.0;
-
-  double usable_area = (size.x() - 2 * free_space_bounds.x()) *
-                       (size.y() - 2 * free_space_bounds.y());
-  int num_objects = static_cast<int>(std::floor(density * usable_area));
-
-  for (int i = 0; i < num_objects; ++i) {
-    // First select size; pose depends on size in z.
-    double height = randMToN(kMinHeight, kMaxHeight);
-    double radius = randMToN(kMinRadius, kMaxRadius);
-    // First select its pose.
-    Eigen::Vector3d position(
-        randMToN(free_space_bounds.x(), size.x() - free_space_bounds.x()),
-        randMToN(free_space_bounds.y(), size.y() - free_space_bounds.y()),
-        height / 2.0);
-
-    world_.addObject(std::unique_ptr<voxblox::Object>(new voxblox::Cylinder(
-        position.cast<float>(), radius, height, voxblox::Color(165, 42, 42))));
-  }
+  addSyntheticWorldObjects(spec, &world_);
 
-  esdf_server_.setSliceLevel(1.5);
+  if (esdf_server_) {
+    esdf_server_->setSliceLevel(1.5);
+  }
 
   // Cache the TSDF voxel size.
-  voxel_size_ = esdf_server_.getTsdfMapPtr()->getTsdfLayerPtr()->voxel_size();
+  voxel_size_ = tsdf_map_->getTsdfLayerPtr()->voxel_size();
 }
 
 // Generates a synthetic viewpoint, and adds it to the voxblox map.
@@ -330,20 +473,13 @@ void LocalPlanningBenchmark::addViewpointToMap(
   // Step 3: integrate into the map.
   // Transform back into camera frame.
   voxblox::transformPointcloud(T_G_C.inverse(), ptcloud, &ptcloud_C);
-  esdf_server_.integratePointcloud(T_G_C, ptcloud_C, colors);
 
-  // Step 4: update mesh and ESDF. NewPoseCallback will mark unknown as
-  // occupied and clear space otherwise.
-  esdf_server_.newPoseCallback(T_G_C);
-  if (visualize_) {
-    esdf_server_.updateMesh();
-  } else {
-    esdf_server_.updateEsdf();
-  }
+  // Step 4: update mesh and ESDF.
+  integrateIntoMap(T_G_C, ptcloud_C, colors);
 
   if (visualize_) {
-    esdf_server_.publishAllUpdatedTsdfVoxels();
-    esdf_server_.publishSlices();
+    esdf_server_->publishAllUpdatedTsdfVoxels();
+    esdf_server_->publishSlices();
 
     pcl::PointCloud<pcl::PointXYZRGB> ptcloud_pcl;
     ptcloud_pcl.header.frame_id = frame_id_;
@@ -366,7 +502,7 @@ double LocalPlanningBenchmark::getMapDistance(
     const Eigen::Vector3d& position) const {
   double distance = 0.0;
   const bool kInterpolate = true;
-  if (!esdf_server_.getEsdfMapPtr()->getDistanceAtPosition(
+  if (!esdf_map_->getDistanceAtPosition(
           position, kInterpolate, &distance)) {
     return 0.0;
   }
@@ -377,7 +513,7 @@ double LocalPlanningBenchmark::getMapDistanceAndGradient(
     const Eigen::Vector3d& position, Eigen::Vector3d* gradient) const {
   double distance = 0.0;
   const bool kInterpolate = true;
-  if (!esdf_server_.getEsdfMapPtr()->getDistanceAndGradientAtPosition(
+  if (!esdf_map_->getDistanceAndGradientAtPosition(
           position, kInterpolate, &distance, gradient)) {
     return 0.0;
   }
@@ -1,5 +1,32 @@
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include <mav_planning_common/utils.h>
+
+#include "mav_planning_benchmark/benchmark_utils.h"
 #include "mav_planning_benchmark/local_planning_benchmark.h"
 
+// Runs all trials of one density on one benchmark instance, and returns their
+// results.
+std::vector<mav_planning::LocalPlanningBenchmark::LocalBenchmarkResult>
+runDensity(double density, int first_trial_number, int num_trials,
+           mav_planning::LocalPlanningBenchmark* benchmark) {
+  CHECK_NOTNULL(benchmark);
+  benchmark->clearResults();
+  for (int j = 0; j < num_trials; ++j) {
+    if (!ros::ok()) {
+      break;
+    }
+    const int trial_number = first_trial_number + j;
+    benchmark->generateWorld(density, trial_number);
+    mav_planning::seedRandom(trial_number);
+    benchmark->runBenchmark(trial_number);
+  }
+  return benchmark->getResults();
+}
+
 int main(int argc, char** argv) {
   ros::init(argc, argv, "local_planning_benchmark");
   google::InitGoogleLogging(argv[0]);
@@ -16,9 +43,15 @@ int main(int argc, char** argv) {
   int num_trials = 100;
   std::string results_path;
   bool exit_at_end = false;
+  // Densities are spread over this many threads, each with its own map and
+  // planner. 0 uses one per core.
+  int num_threads = 1;
   nh_private.param("results_path", results_path, results_path);
   nh_private.param("num_trials", num_trials, num_trials);
   nh_private.param("exit_at_end", exit_at_end, exit_at_end);
+  nh_private.param("num_threads", num_threads, num_threads);
+  // Nothing to look at afterwards either.
+  exit_at_end |= node.headless();
 
   const double min_density = 0.05;
   const double max_density = 0.50;
@@ -32,27 +65,64 @@ int main(int argc, char** argv) {
   int trials_per_density = num_trials / num_densities;
   ROS_INFO_STREAM("[Local Planning Benchmark]: Trials per density: "
                   << trials_per_density << " num densities: " << num_densities);
-  int trial_number = 0;
 
-  for (int i = 0; i < num_densities; ++i) {
-    if (!ros::ok()) {
-      break;
-    }
-    double density = min_density + i * density_increment;
-    for (int j = 0; j < trials_per_density; ++j) {
-      if (!ros::ok()) {
+  if (num_threads <= 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  num_threads = std::min(num_threads, num_densities);
+  if (node.visualize() && num_threads > 1) {
+    ROS_WARN("[Local Planning Benchmark]: Can't visualize from several "
+             "threads, running on one.");
+    num_threads = 1;
+  }
+
+  // Every thread gets its own benchmark instance, the first one is the node
+  // itself. The others are headless, so only the node is on ROS. Trial
+  // numbers (and so seeds) only depend on the density and the trial within
+  // it, so the results are the same for any number of threads.
+  std::vector<std::unique_ptr<mav_planning::LocalPlanningBenchmark> >
+      extra_benchmarks;
+  const bool kHeadless = true;
+  for (int i = 1; i < num_threads; ++i) {
+    extra_benchmarks.emplace_back(
+        new mav_planning::LocalPlanningBenchmark(nh, nh_private, kHeadless));
+  }
+
+  std::vector<std::vector<
+      mav_planning::LocalPlanningBenchmark::LocalBenchmarkResult> >
+      density_results(num_densities);
+  std::atomic<int> next_density(0);
+  auto run_worker = [&](mav_planning::LocalPlanningBenchmark* benchmark) {
+    while (ros::ok()) {
+      const int i = next_density++;
+      if (i >= num_densities) {
         break;
       }
-      srand(trial_number);
-      node.generateWorld(density);
-      srand(trial_number);
-      node.runBenchmark(trial_number);
-      trial_number++;
+      const double density = min_density + i * density_increment;
+      density_results[i] = runDensity(density, i * trials_per_density,
+                                      trials_per_density, benchmark);
     }
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < extra_benchmarks.size(); ++i) {
+    threads.emplace_back(run_worker, extra_benchmarks[i].get());
+  }
+  run_worker(&node);
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  // Output in order of density, no matter which thread finished first.
+  node.clearResults();
+  for (const auto& results : density_results) {
+    node.appendResults(results);
   }
 
   if (!results_path.empty()) {
     node.outputResults(results_path);
+    node.outputSummary(mav_planning::getResultsPathPrefix(results_path) +
+                       "_summary.csv");
   }
 
   ROS_INFO_STREAM("All timings: "
@@ -0,0 +1,27 @@
+#include <sys/resource.h>
+
+#include "mav_planning_benchmark/resource_usage.h"
+
+namespace mav_planning {
+namespace {
+
+// Plain thread_local size_t, so there's no dynamic initialization that could
+// itself allocate.
+thread_local size_t thread_allocation_count = 0;
+
+}  // namespace
+
+size_t getThreadAllocationCount() { return thread_allocation_count; }
+
+void countThreadAllocation() { ++thread_allocation_count; }
+
+size_t getPeakRssKb() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+  // Kilobytes on Linux.
+  return static_cast<size_t>(usage.ru_maxrss);
+}
+
+}  // namespace mav_planning
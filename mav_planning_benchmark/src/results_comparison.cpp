@@ -0,0 +1,341 @@
+#include <stdlib.h>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+#include <glog/logging.h>
+
+#include "mav_planning_benchmark/benchmark_utils.h"
+#include "mav_planning_benchmark/results_comparison.h"
+
+namespace mav_planning {
+
+namespace {
+
+std::vector<std::string> splitLine(const std::string& line) {
+  std::vector<std::string> fields;
+  std::stringstream stream(line);
+  std::string field;
+  while (std::getline(stream, field, ',')) {
+    fields.push_back(field);
+  }
+  return fields;
+}
+
+bool endsWith(const std::string& str, const std::string& ending) {
+  return str.size() >= ending.size() &&
+         str.compare(str.size() - ending.size(), ending.size(), ending) == 0;
+}
+
+}  // namespace
+
+ResultsTable::ResultsTable(const std::vector<std::string>& columns,
+                           const std::vector<std::vector<double> >& rows)
+    : columns_(columns), rows_(rows) {
+  for (const std::vector<double>& row : rows_) {
+    CHECK_EQ(columns_.size(), row.size());
+  }
+}
+
+bool ResultsTable::load(const std::string& filename) {
+  std::ifstream file(filename);
+  if (!file.is_open()) {
+    LOG(ERROR) << "Couldn't open results file: " << filename;
+    return false;
+  }
+
+  columns_.clear();
+  rows_.clear();
+  std::string line;
+  int line_number = 0;
+  while (std::getline(file, line)) {
+    line_number++;
+    if (line.empty()) {
+      continue;
+    }
+    if (columns_.empty()) {
+      if (line[0] != '#') {
+        LOG(ERROR) << filename << ": expected a '#' header line first.";
+        return false;
+      }
+      columns_ = splitLine(line.substr(1));
+      continue;
+    }
+
+    const std::vector<std::string> fields = splitLine(line);
+    if (fields.size() != columns_.size()) {
+      LOG(ERROR) << filename << ":" << line_number << ": expected "
+                 << columns_.size() << " columns, got " << fields.size();
+      return false;
+    }
+    std::vector<double> row(fields.size());
+    for (size_t i = 0; i < fields.size(); ++i) {
+      char* end = nullptr;
+      row[i] = strtod(fields[i].c_str(), &end);
+      if (fields[i].empty() || *end != '\0') {
+        LOG(ERROR) << filename << ":" << line_number << ": column "
+                   << columns_[i] << " is not a number: " << fields[i];
+        return false;
+      }
+    }
+    rows_.push_back(row);
+  }
+  return !columns_.empty();
+}
+
+int ResultsTable::getColumnIndex(const std::string& name) const {
+  for (size_t i = 0; i < columns_.size(); ++i) {
+    if (columns_[i] == name) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+double ResultsComparisonConfig::getMaxRatio(const std::string& metric) const {
+  std::map<std::string, double>::const_iterator it =
+      max_ratio_per_metric.find(metric);
+  if (it == max_ratio_per_metric.end()) {
+    return max_ratio;
+  }
+  return it->second;
+}
+
+bool ResultsComparison::compare(const ResultsTable& baseline,
+                                const ResultsTable& current) {
+  groups_.clear();
+  group_columns_.clear();
+
+  const int baseline_seed_index = baseline.getColumnIndex("seed");
+  const int current_seed_index = current.getColumnIndex("seed");
+  if (baseline_seed_index < 0 || current_seed_index < 0) {
+    LOG(ERROR) << "Both results need a seed column to match trials.";
+    return false;
+  }
+
+  // Everything that, together with the seed, identifies a trial.
+  for (const std::string& column : baseline.getColumns()) {
+    if (endsWith(column, "_method") || column == "global_planner" ||
+        column == "density") {
+      group_columns_.push_back(column);
+    }
+  }
+  std::vector<int> baseline_group_indices, current_group_indices;
+  for (const std::string& column : group_columns_) {
+    if (!current.hasColumn(column)) {
+      LOG(ERROR) << "New results don't have the baseline's key column "
+                 << column << ", are they from the same benchmark?";
+      return false;
+    }
+    baseline_group_indices.push_back(baseline.getColumnIndex(column));
+    current_group_indices.push_back(current.getColumnIndex(column));
+  }
+
+  std::vector<std::string> metrics;
+  for (const std::string& metric : config_.metrics) {
+    if (baseline.hasColumn(metric) && current.hasColumn(metric)) {
+      metrics.push_back(metric);
+    } else {
+      LOG(WARNING) << "Metric " << metric << " isn't in both results.";
+    }
+  }
+  if (metrics.empty()) {
+    LOG(ERROR) << "No metrics to compare.";
+    return false;
+  }
+
+  // Older results files don't have a success column, then all trials count.
+  const int baseline_success_index =
+      baseline.getColumnIndex("planning_success");
+  const int current_success_index = current.getColumnIndex("planning_success");
+
+  // Key is the group columns followed by the seed.
+  typedef std::map<std::vector<double>, size_t> TrialMap;
+  TrialMap current_trials;
+  const std::vector<std::vector<double> >& current_rows = current.getRows();
+  for (size_t i = 0; i < current_rows.size(); ++i) {
+    std::vector<double> key;
+    for (int index : current_group_indices) {
+      key.push_back(current_rows[i][index]);
+    }
+    key.push_back(current_rows[i][current_seed_index]);
+    if (!current_trials.insert(std::make_pair(key, i)).second) {
+      LOG(WARNING) << "Duplicate trial in new results, using the first one.";
+    }
+  }
+
+  // Matched (baseline row, current row) pairs per group.
+  typedef std::vector<std::pair<size_t, size_t> > TrialPairs;
+  typedef std::map<std::vector<double>, TrialPairs> GroupMap;
+  GroupMap matched_groups;
+  size_t num_unmatched = 0;
+  const std::vector<std::vector<double> >& baseline_rows = baseline.getRows();
+  for (size_t i = 0; i < baseline_rows.size(); ++i) {
+    std::vector<double> key;
+    for (int index : baseline_group_indices) {
+      key.push_back(baseline_rows[i][index]);
+    }
+    const std::vector<double> group_key = key;
+    key.push_back(baseline_rows[i][baseline_seed_index]);
+
+    TrialMap::const_iterator it = current_trials.find(key);
+    if (it == current_trials.end()) {
+      num_unmatched++;
+      continue;
+    }
+    matched_groups[group_key].push_back(std::make_pair(i, it->second));
+  }
+  if (num_unmatched > 0) {
+    LOG(WARNING) << num_unmatched
+                 << " baseline trials have no match in the new results.";
+  }
+
+  for (const GroupMap::value_type& group : matched_groups) {
+    const TrialPairs& pairs = group.second;
+    GroupComparison comparison;
+    comparison.key = group.first;
+    comparison.num_matched_trials = pairs.size();
+    const bool enough_trials =
+        static_cast<int>(pairs.size()) >= config_.min_matched_trials;
+
+    std::vector<bool> both_successful(pairs.size(), true);
+    size_t num_baseline_success = 0, num_current_success = 0;
+    for (size_t i = 0; i < pairs.size(); ++i) {
+      const bool baseline_success =
+          baseline_success_index < 0 ||
+          baseline_rows[pairs[i].first][baseline_success_index] > 0.0;
+      const bool current_success =
+          current_success_index < 0 ||
+          current_rows[pairs[i].second][current_success_index] > 0.0;
+      num_baseline_success += baseline_success;
+      num_current_success += current_success;
+      both_successful[i] = baseline_success && current_success;
+    }
+    comparison.baseline_success_rate =
+        static_cast<double>(num_baseline_success) / pairs.size();
+    comparison.new_success_rate =
+        static_cast<double>(num_current_success) / pairs.size();
+    if (enough_trials &&
+        comparison.baseline_success_rate - comparison.new_success_rate >
+            config_.max_success_rate_drop) {
+      comparison.is_regression = true;
+    }
+
+    for (const std::string& metric : metrics) {
+      const int baseline_index = baseline.getColumnIndex(metric);
+      const int current_index = current.getColumnIndex(metric);
+
+      std::vector<double> ratios;
+      for (size_t i = 0; i < pairs.size(); ++i) {
+        if (config_.only_successful && !both_successful[i]) {
+          continue;
+        }
+        const double baseline_value =
+            baseline_rows[pairs[i].first][baseline_index];
+        const double current_value =
+            current_rows[pairs[i].second][current_index];
+        if (baseline_value > 0.0) {
+          ratios.push_back(current_value / baseline_value);
+        } else if (baseline_value == 0.0 && current_value == 0.0) {
+          // I.e. the straight line planner taking no measurable time.
+          ratios.push_back(1.0);
+        }
+        // Otherwise there's no meaningful ratio, leave the trial out.
+      }
+
+      MetricComparison metric_comparison;
+      metric_comparison.metric = metric;
+      computeRatioStatistics(ratios, &metric_comparison);
+      metric_comparison.is_regression =
+          static_cast<int>(ratios.size()) >= config_.min_matched_trials &&
+          metric_comparison.median_ratio > config_.getMaxRatio(metric) &&
+          metric_comparison.ratio_lower > 1.0;
+      comparison.is_regression |= metric_comparison.is_regression;
+      comparison.metrics.push_back(metric_comparison);
+    }
+    groups_.push_back(comparison);
+  }
+
+  if (groups_.empty()) {
+    LOG(ERROR) << "No trials could be matched between the two results.";
+    return false;
+  }
+  return true;
+}
+
+void ResultsComparison::computeRatioStatistics(
+    const std::vector<double>& ratios, MetricComparison* comparison) const {
+  CHECK_NOTNULL(comparison);
+  comparison->num_pairs = ratios.size();
+  if (ratios.empty()) {
+    return;
+  }
+
+  std::vector<double> sorted_ratios = ratios;
+  std::sort(sorted_ratios.begin(), sorted_ratios.end());
+  comparison->median_ratio = computeSortedPercentile(sorted_ratios, 50.0);
+
+  // Percentile bootstrap: resample the pairs with replacement and take the
+  // spread of the resampled medians. Fixed seed so that the same two files
+  // always give the same verdict.
+  std::mt19937 engine(config_.bootstrap_seed);
+  std::uniform_int_distribution<size_t> pick(0, ratios.size() - 1);
+  std::vector<double> medians(std::max(config_.num_bootstrap_samples, 1));
+  std::vector<double> resample(ratios.size());
+  for (double& median : medians) {
+    for (double& value : resample) {
+      value = ratios[pick(engine)];
+    }
+    std::sort(resample.begin(), resample.end());
+    median = computeSortedPercentile(resample, 50.0);
+  }
+  std::sort(medians.begin(), medians.end());
+  const double tail_percent = 50.0 * (1.0 - config_.confidence);
+  comparison->ratio_lower = computeSortedPercentile(medians, tail_percent);
+  comparison->ratio_upper =
+      computeSortedPercentile(medians, 100.0 - tail_percent);
+}
+
+bool ResultsComparison::hasRegression() const {
+  for (const GroupComparison& group : groups_) {
+    if (group.is_regression) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int ResultsComparison::compareAndReport(const ResultsTable& baseline,
+                                        const ResultsTable& current,
+                                        FILE* fp) {
+  if (!compare(baseline, current)) {
+    return 2;
+  }
+  if (fp != nullptr) {
+    printReport(fp);
+  }
+  return hasRegression() ? 1 : 0;
+}
+
+void ResultsComparison::printReport(FILE* fp) const {
+  for (const GroupComparison& group : groups_) {
+    for (size_t i = 0; i < group_columns_.size(); ++i) {
+      fprintf(fp, "%s%s: %g", i == 0 ? "" : ", ", group_columns_[i].c_str(),
+              group.key[i]);
+    }
+    fprintf(fp, " (%zu trials)%s\n", group.num_matched_trials,
+            group.is_regression ? " REGRESSION" : "");
+    fprintf(fp, "  %-28s %.3f -> %.3f\n", "success_rate",
+            group.baseline_success_rate, group.new_success_rate);
+    for (const MetricComparison& metric : group.metrics) {
+      fprintf(fp, "  %-28s x%.3f [%.3f, %.3f] over %zu trials%s\n",
+              metric.metric.c_str(), metric.median_ratio, metric.ratio_lower,
+              metric.ratio_upper, metric.num_pairs,
+              metric.is_regression ? " REGRESSION" : "");
+    }
+  }
+}
+
+}  // namespace mav_planning
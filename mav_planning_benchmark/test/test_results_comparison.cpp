@@ -0,0 +1,329 @@
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "mav_planning_benchmark/results_comparison.h"
+
+namespace mav_planning {
+
+class ResultsComparisonTest : public ::testing::Test {
+ protected:
+  static constexpr int kNumSeeds = 20;
+  static constexpr int kNumPlanners = 3;
+
+  virtual void SetUp() {
+    config_.metrics = {"computation_time_sec", "total_path_length_m"};
+    comparison_.setConfig(config_);
+  }
+
+  struct Trial {
+    double seed;
+    double global_planner;
+    bool success;
+    double computation_time_sec;
+    double total_path_length_m;
+  };
+
+  static ResultsTable makeTable(const std::vector<Trial>& trials) {
+    std::vector<std::vector<double> > rows;
+    for (const Trial& trial : trials) {
+      rows.push_back({trial.seed, trial.global_planner,
+                      trial.success ? 1.0 : 0.0, trial.computation_time_sec,
+                      trial.total_path_length_m});
+    }
+    return ResultsTable({"seed", "global_planner", "planning_success",
+                         "computation_time_sec", "total_path_length_m"},
+                        rows);
+  }
+
+  // Every planner on every seed, with times and lengths that vary a lot
+  // between trials, like they do between worlds.
+  std::vector<Trial> makeBaselineTrials() {
+    std::uniform_real_distribution<double> time(0.1, 2.0);
+    std::uniform_real_distribution<double> length(5.0, 30.0);
+    std::vector<Trial> trials;
+    for (int planner = 0; planner < kNumPlanners; ++planner) {
+      for (int seed = 0; seed < kNumSeeds; ++seed) {
+        trials.push_back(
+            {static_cast<double>(seed), static_cast<double>(planner), true,
+             time(engine_), length(engine_)});
+      }
+    }
+    return trials;
+  }
+
+  // Scales every computation time by a random factor around 1, like running
+  // the same trials again on a busy machine. The paths stay the same.
+  std::vector<Trial> addNoise(std::vector<Trial> trials, double sigma) {
+    std::lognormal_distribution<double> noise(0.0, sigma);
+    for (Trial& trial : trials) {
+      trial.computation_time_sec *= noise(engine_);
+    }
+    return trials;
+  }
+
+  const ResultsComparison::GroupComparison* getGroup(double planner) const {
+    for (const ResultsComparison::GroupComparison& group :
+         comparison_.getGroups()) {
+      if (group.key == std::vector<double>({planner})) {
+        return &group;
+      }
+    }
+    return nullptr;
+  }
+
+  std::mt19937 engine_;
+  ResultsComparisonConfig config_;
+  ResultsComparison comparison_;
+};
+
+TEST_F(ResultsComparisonTest, MatchesTrialsByKeyColumns) {
+  const std::vector<Trial> baseline_trials = makeBaselineTrials();
+  std::vector<Trial> current_trials = baseline_trials;
+  // Planner 1 got twice as slow. Trials come in a different order, one is
+  // missing and one is new, and seeds are only unique per planner.
+  for (Trial& trial : current_trials) {
+    if (trial.global_planner == 1.0) {
+      trial.computation_time_sec *= 2.0;
+    }
+  }
+  std::reverse(current_trials.begin(), current_trials.end());
+  current_trials.pop_back();
+  current_trials.push_back({100.0, 0.0, true, 1.0, 1.0});
+
+  ASSERT_TRUE(comparison_.compare(makeTable(baseline_trials),
+                                  makeTable(current_trials)));
+  EXPECT_EQ(std::vector<std::string>({"global_planner"}),
+            comparison_.getGroupColumns());
+  ASSERT_EQ(static_cast<size_t>(kNumPlanners), comparison_.getGroups().size());
+  for (int planner = 0; planner < kNumPlanners; ++planner) {
+    const ResultsComparison::GroupComparison* group = getGroup(planner);
+    ASSERT_TRUE(group != nullptr);
+    // The reversed table lost planner 0, seed 0.
+    EXPECT_EQ(planner == 0 ? kNumSeeds - 1u : kNumSeeds + 0u,
+              group->num_matched_trials);
+    ASSERT_EQ(2u, group->metrics.size());
+    const double expected_time_ratio = planner == 1 ? 2.0 : 1.0;
+    EXPECT_DOUBLE_EQ(expected_time_ratio, group->metrics[0].median_ratio);
+    EXPECT_DOUBLE_EQ(1.0, group->metrics[1].median_ratio);
+    EXPECT_EQ(planner == 1, group->is_regression);
+  }
+
+  // Results from another benchmark, without the key column.
+  std::vector<std::vector<double> > rows = {{0.0, 1.0, 1.0}};
+  const ResultsTable other({"seed", "computation_time_sec", "smoother_time"},
+                           rows);
+  EXPECT_FALSE(comparison_.compare(makeTable(baseline_trials), other));
+  // And without any seeds.
+  const ResultsTable no_seeds({"global_planner", "computation_time_sec"},
+                              {{0.0, 1.0}});
+  EXPECT_FALSE(comparison_.compare(no_seeds, no_seeds));
+}
+
+TEST_F(ResultsComparisonTest, OnlySuccessfulTrialsCount) {
+  const std::vector<Trial> baseline_trials = makeBaselineTrials();
+  // Most trials fail now, and failed trials run into the time limit, so
+  // they're much slower.
+  std::vector<Trial> current_trials = baseline_trials;
+  for (size_t i = 0u; i < current_trials.size(); ++i) {
+    if (i % 5 != 0) {
+      current_trials[i].success = false;
+      current_trials[i].computation_time_sec *= 10.0;
+    }
+  }
+  // Only look at the metrics here, and on the few successful trials too.
+  config_.max_success_rate_drop = 1.0;
+  config_.min_matched_trials = 3;
+
+  config_.only_successful = true;
+  comparison_.setConfig(config_);
+  ASSERT_TRUE(comparison_.compare(makeTable(baseline_trials),
+                                  makeTable(current_trials)));
+  EXPECT_FALSE(comparison_.hasRegression());
+  for (const ResultsComparison::GroupComparison& group :
+       comparison_.getGroups()) {
+    EXPECT_EQ(static_cast<size_t>(kNumSeeds), group.num_matched_trials);
+    EXPECT_DOUBLE_EQ(0.2, group.new_success_rate);
+    EXPECT_GT(group.metrics[0].num_pairs, 0u);
+    EXPECT_EQ(group.num_matched_trials / 5u, group.metrics[0].num_pairs);
+    EXPECT_DOUBLE_EQ(1.0, group.metrics[0].median_ratio);
+  }
+
+  config_.only_successful = false;
+  comparison_.setConfig(config_);
+  ASSERT_TRUE(comparison_.compare(makeTable(baseline_trials),
+                                  makeTable(current_trials)));
+  EXPECT_TRUE(comparison_.hasRegression());
+  for (const ResultsComparison::GroupComparison& group :
+       comparison_.getGroups()) {
+    EXPECT_EQ(group.num_matched_trials, group.metrics[0].num_pairs);
+    EXPECT_DOUBLE_EQ(10.0, group.metrics[0].median_ratio);
+    EXPECT_TRUE(group.metrics[0].is_regression);
+  }
+}
+
+TEST_F(ResultsComparisonTest, ZeroBaselines) {
+  // Planner 0 takes no measurable time in either, planner 1 started taking
+  // some, and planner 2 has a broken (negative) baseline.
+  std::vector<Trial> baseline_trials, current_trials;
+  for (int seed = 0; seed < kNumSeeds; ++seed) {
+    for (int planner = 0; planner < 3; ++planner) {
+      const double baseline_time = planner == 2 ? -1.0 : 0.0;
+      const double current_time = planner == 1 ? 0.5 : 0.0;
+      baseline_trials.push_back({static_cast<double>(seed),
+                                 static_cast<double>(planner), true,
+                                 baseline_time, 10.0});
+      current_trials.push_back({static_cast<double>(seed),
+                                static_cast<double>(planner), true,
+                                current_time, 10.0});
+    }
+  }
+  ASSERT_TRUE(comparison_.compare(makeTable(baseline_trials),
+                                  makeTable(current_trials)));
+  EXPECT_FALSE(comparison_.hasRegression());
+
+  // 0 -> 0 is no change.
+  const ResultsComparison::GroupComparison* group = getGroup(0.0);
+  ASSERT_TRUE(group != nullptr);
+  EXPECT_EQ(static_cast<size_t>(kNumSeeds), group->metrics[0].num_pairs);
+  EXPECT_DOUBLE_EQ(1.0, group->metrics[0].median_ratio);
+
+  // Anything else has no ratio, so those trials are left out and can't fail
+  // (or pass) anything. The other metric still has all of them.
+  for (double planner : {1.0, 2.0}) {
+    group = getGroup(planner);
+    ASSERT_TRUE(group != nullptr);
+    EXPECT_EQ(0u, group->metrics[0].num_pairs);
+    EXPECT_FALSE(group->metrics[0].is_regression);
+    EXPECT_EQ(static_cast<size_t>(kNumSeeds), group->metrics[1].num_pairs);
+  }
+}
+
+TEST_F(ResultsComparisonTest, BootstrapIntervalBounds) {
+  const std::vector<Trial> baseline_trials = makeBaselineTrials();
+  const std::vector<Trial> current_trials = addNoise(baseline_trials, 0.2);
+  ASSERT_TRUE(comparison_.compare(makeTable(baseline_trials),
+                                  makeTable(current_trials)));
+
+  for (const ResultsComparison::GroupComparison& group :
+       comparison_.getGroups()) {
+    const ResultsComparison::MetricComparison& metric = group.metrics[0];
+    // The interval holds the median, is within the range of the ratios, and
+    // isn't degenerate for noisy ratios.
+    double min_ratio = 1e9, max_ratio = 0.0;
+    for (size_t i = 0u; i < baseline_trials.size(); ++i) {
+      if (baseline_trials[i].global_planner != group.key[0]) {
+        continue;
+      }
+      const double ratio = current_trials[i].computation_time_sec /
+                           baseline_trials[i].computation_time_sec;
+      min_ratio = std::min(min_ratio, ratio);
+      max_ratio = std::max(max_ratio, ratio);
+    }
+    EXPECT_LE(min_ratio, metric.ratio_lower);
+    EXPECT_LT(metric.ratio_lower, metric.median_ratio);
+    EXPECT_LT(metric.median_ratio, metric.ratio_upper);
+    EXPECT_LE(metric.ratio_upper, max_ratio);
+
+    // No spread at all in the path lengths' ratios.
+    EXPECT_DOUBLE_EQ(group.metrics[1].median_ratio,
+                     group.metrics[1].ratio_lower);
+    EXPECT_DOUBLE_EQ(group.metrics[1].median_ratio,
+                     group.metrics[1].ratio_upper);
+  }
+
+  // The same files always give the same interval, and a lower confidence a
+  // narrower one.
+  const ResultsComparison::MetricComparison first =
+      comparison_.getGroups()[0].metrics[0];
+  ASSERT_TRUE(comparison_.compare(makeTable(baseline_trials),
+                                  makeTable(current_trials)));
+  const ResultsComparison::MetricComparison& again =
+      comparison_.getGroups()[0].metrics[0];
+  EXPECT_EQ(first.ratio_lower, again.ratio_lower);
+  EXPECT_EQ(first.ratio_upper, again.ratio_upper);
+
+  config_.confidence = 0.5;
+  comparison_.setConfig(config_);
+  ASSERT_TRUE(comparison_.compare(makeTable(baseline_trials),
+                                  makeTable(current_trials)));
+  const ResultsComparison::MetricComparison& narrow =
+      comparison_.getGroups()[0].metrics[0];
+  EXPECT_GE(narrow.ratio_lower, first.ratio_lower);
+  EXPECT_LE(narrow.ratio_upper, first.ratio_upper);
+  EXPECT_LT(narrow.ratio_upper - narrow.ratio_lower,
+            first.ratio_upper - first.ratio_lower);
+}
+
+TEST_F(ResultsComparisonTest, ExitCodes) {
+  const std::vector<Trial> baseline_trials = makeBaselineTrials();
+  const ResultsTable baseline = makeTable(baseline_trials);
+  const double kNoise = 0.05;
+
+  EXPECT_EQ(0, comparison_.compareAndReport(baseline, baseline, nullptr));
+
+  // Rerunning the same code only adds noise, and that must not fail.
+  for (int run = 0; run < 10; ++run) {
+    EXPECT_EQ(0, comparison_.compareAndReport(
+                     makeTable(addNoise(baseline_trials, kNoise)),
+                     makeTable(addNoise(baseline_trials, kNoise)), nullptr))
+        << "run " << run;
+  }
+
+  // A clear regression in one planner, under the same noise.
+  std::vector<Trial> slower_trials = addNoise(baseline_trials, kNoise);
+  for (Trial& trial : slower_trials) {
+    if (trial.global_planner == 2.0) {
+      trial.computation_time_sec *= 1.5;
+    }
+  }
+  EXPECT_EQ(1, comparison_.compareAndReport(baseline, makeTable(slower_trials),
+                                            nullptr));
+  EXPECT_TRUE(getGroup(2.0)->metrics[0].is_regression);
+  EXPECT_FALSE(getGroup(0.0)->is_regression);
+  // Unless it's under the threshold for that metric.
+  config_.max_ratio_per_metric["computation_time_sec"] = 2.0;
+  comparison_.setConfig(config_);
+  EXPECT_EQ(0, comparison_.compareAndReport(baseline, makeTable(slower_trials),
+                                            nullptr));
+  config_.max_ratio_per_metric.clear();
+
+  // Same paths, but fewer of them.
+  config_.max_success_rate_drop = 0.1;
+  comparison_.setConfig(config_);
+  std::vector<Trial> failing_trials = baseline_trials;
+  for (int i = 0; i < 3; ++i) {
+    failing_trials[i].success = false;
+  }
+  EXPECT_EQ(1, comparison_.compareAndReport(
+                   baseline, makeTable(failing_trials), nullptr));
+  EXPECT_TRUE(getGroup(0.0)->is_regression);
+  EXPECT_DOUBLE_EQ(1.0 - 3.0 / kNumSeeds, getGroup(0.0)->new_success_rate);
+  // One failure in 20 is within the allowed drop.
+  failing_trials[1].success = failing_trials[2].success = true;
+  EXPECT_EQ(0, comparison_.compareAndReport(
+                   baseline, makeTable(failing_trials), nullptr));
+  // And with too few trials, nothing can fail.
+  config_.min_matched_trials = kNumSeeds + 1;
+  comparison_.setConfig(config_);
+  EXPECT_EQ(0, comparison_.compareAndReport(baseline, makeTable(slower_trials),
+                                            nullptr));
+
+  // Nothing to compare.
+  config_.metrics = {"total_path_time_sec"};
+  comparison_.setConfig(config_);
+  EXPECT_EQ(2, comparison_.compareAndReport(baseline, baseline, nullptr));
+}
+
+}  // namespace mav_planning
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  google::InitGoogleLogging(argv[0]);
+
+  return RUN_ALL_TESTS();
+}
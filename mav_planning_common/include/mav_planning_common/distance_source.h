@@ -0,0 +1,102 @@
+#ifndef MAV_PLANNING_COMMON_DISTANCE_SOURCE_H_
+#define MAV_PLANNING_COMMON_DISTANCE_SOURCE_H_
+
+#include <functional>
+#include <vector>
+
+#include <glog/logging.h>
+#include <Eigen/Core>
+
+namespace mav_planning {
+
+// Map distance lookups as a compile-time policy. Code templated on (or taking
+// a pointer to) a DistanceSource gets the lookups inlined into its loops,
+// instead of a std::function call per lookup. A DistanceSource is any class
+// with these const methods:
+//
+//   double getDistance(const Eigen::Vector3d& position) const;
+//   double getDistanceAndGradient(const Eigen::Vector3d& position,
+//                                 Eigen::Vector3d* gradient) const;
+//   void getDistances(const std::vector<Eigen::Vector3d>& positions,
+//                     std::vector<double>* distances) const;
+//   void getDistancesAndGradients(
+//       const std::vector<Eigen::Vector3d>& positions,
+//       std::vector<double>* distances,
+//       std::vector<Eigen::Vector3d>* gradients) const;
+//
+// Unknown space has distance 0. Gradients are only computed if not nullptr.
+// The batch versions resize the outputs to the number of positions.
+//
+// See EsdfDistanceSource in voxblox_planning_common for the ESDF one.
+
+// Any std::function callback as a DistanceSource, for code that only has
+// those. Every lookup is still a std::function call.
+class FunctionDistanceSource {
+ public:
+  typedef std::function<double(const Eigen::Vector3d& position,
+                               Eigen::Vector3d* gradient)>
+      DistanceAndGradientFunctionType;
+
+  FunctionDistanceSource() {}
+  explicit FunctionDistanceSource(
+      const DistanceAndGradientFunctionType& function)
+      : function_(function) {}
+
+  void setDistanceAndGradientFunction(
+      const DistanceAndGradientFunctionType& function) {
+    function_ = function;
+  }
+
+  double getDistance(const Eigen::Vector3d& position) const {
+    return function_(position, nullptr);
+  }
+  double getDistanceAndGradient(const Eigen::Vector3d& position,
+                                Eigen::Vector3d* gradient) const {
+    return function_(position, gradient);
+  }
+
+  void getDistances(const std::vector<Eigen::Vector3d>& positions,
+                    std::vector<double>* distances) const {
+    getDistancesAndGradients(positions, distances, nullptr);
+  }
+  void getDistancesAndGradients(const std::vector<Eigen::Vector3d>& positions,
+                                std::vector<double>* distances,
+                                std::vector<Eigen::Vector3d>* gradients) const {
+    CHECK_NOTNULL(distances);
+    distances->resize(positions.size());
+    if (gradients != nullptr) {
+      gradients->resize(positions.size());
+    }
+    for (size_t i = 0; i < positions.size(); ++i) {
+      (*distances)[i] = function_(
+          positions[i], gradients == nullptr ? nullptr : &(*gradients)[i]);
+    }
+  }
+
+ private:
+  DistanceAndGradientFunctionType function_;
+};
+
+// And the other way around: a DistanceSource as a callback, for the
+// std::function interfaces. The source has to outlive the callback.
+template <typename DistanceSource>
+FunctionDistanceSource::DistanceAndGradientFunctionType
+makeDistanceAndGradientFunction(const DistanceSource* source) {
+  CHECK_NOTNULL(source);
+  return [source](const Eigen::Vector3d& position, Eigen::Vector3d* gradient) {
+    return source->getDistanceAndGradient(position, gradient);
+  };
+}
+
+template <typename DistanceSource>
+std::function<double(const Eigen::Vector3d& position)> makeDistanceFunction(
+    const DistanceSource* source) {
+  CHECK_NOTNULL(source);
+  return [source](const Eigen::Vector3d& position) {
+    return source->getDistance(position);
+  };
+}
+
+}  // namespace mav_planning
+
+#endif  // MAV_PLANNING_COMMON_DISTANCE_SOURCE_H_
@@ -0,0 +1,48 @@
+#ifndef MAV_PLANNING_COMMON_MAP_QUERY_SCOPE_H_
+#define MAV_PLANNING_COMMON_MAP_QUERY_SCOPE_H_
+
+#include <stddef.h>
+
+namespace mav_planning {
+
+// Marks a run of map lookups on this thread, like one path collision check,
+// during which the lookups may reuse what the ones before them found (see
+// EsdfDistanceSource). The map shouldn't change in between. Scopes nest, and
+// lookups outside of any scope don't reuse anything. Use like:
+//   {
+//     MapQueryScope scope;
+//     for (...) { ... getMapDistance(...) ... }
+//   }
+class MapQueryScope {
+ public:
+  MapQueryScope() { ++getState().depth; }
+  ~MapQueryScope() {
+    State& state = getState();
+    if (--state.depth == 0) {
+      ++state.generation;
+    }
+  }
+
+  MapQueryScope(const MapQueryScope&) = delete;
+  MapQueryScope& operator=(const MapQueryScope&) = delete;
+
+  static bool isActive() { return getState().depth > 0; }
+  // Changes whenever the outermost scope ends, so anything cached under an
+  // older generation is stale.
+  static size_t getGeneration() { return getState().generation; }
+
+ private:
+  struct State {
+    int depth = 0;
+    size_t generation = 0;
+  };
+
+  static State& getState() {
+    static thread_local State state;
+    return state;
+  }
+};
+
+}  // namespace mav_planning
+
+#endif  // MAV_PLANNING_COMMON_MAP_QUERY_SCOPE_H_
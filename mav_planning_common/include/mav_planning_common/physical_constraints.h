@@ -16,12 +16,16 @@ struct PhysicalConstraints {
         robot_radius(1.0),
         sampling_dt(0.01) {}
 
-  void setParametersFromRos(const ros::NodeHandle& nh) {
-    nh.param("v_max", v_max, v_max);
-    nh.param("a_max", a_max, a_max);
-    nh.param("yaw_rate_max", yaw_rate_max, yaw_rate_max);
-    nh.param("robot_radius", robot_radius, robot_radius);
-    nh.param("sampling_dt", sampling_dt, sampling_dt);
+  void setParametersFromRos(const ros::NodeHandle& nh) { setParameters(nh); }
+  // Same, from anything with a ros::NodeHandle-style param(key, value,
+  // default).
+  template <typename ParamSource>
+  void setParameters(const ParamSource& params) {
+    params.param("v_max", v_max, v_max);
+    params.param("a_max", a_max, a_max);
+    params.param("yaw_rate_max", yaw_rate_max, yaw_rate_max);
+    params.param("robot_radius", robot_radius, robot_radius);
+    params.param("sampling_dt", sampling_dt, sampling_dt);
   }
 
   double v_max;  // Meters/second
@@ -0,0 +1,42 @@
+#ifndef MAV_PLANNING_COMMON_PLANNING_COUNTERS_H_
+#define MAV_PLANNING_COMMON_PLANNING_COUNTERS_H_
+
+#include <stddef.h>
+
+namespace mav_planning {
+
+// Counts how much work the planners do: map distance lookups, collision
+// checks (a whole line/state/trajectory check counts once), and time spent
+// shortening paths. Every thread has its own counters, so to get the cost of
+// a call, take the difference of getPlanningCounters() before and after it.
+// Anything that hands work to other threads has to add their counts back.
+struct PlanningCounters {
+  size_t distance_queries = 0;
+  size_t collision_checks = 0;
+  double shortening_time_sec = 0.0;
+
+  PlanningCounters& operator+=(const PlanningCounters& other) {
+    distance_queries += other.distance_queries;
+    collision_checks += other.collision_checks;
+    shortening_time_sec += other.shortening_time_sec;
+    return *this;
+  }
+
+  PlanningCounters operator-(const PlanningCounters& other) const {
+    PlanningCounters difference;
+    difference.distance_queries = distance_queries - other.distance_queries;
+    difference.collision_checks = collision_checks - other.collision_checks;
+    difference.shortening_time_sec =
+        shortening_time_sec - other.shortening_time_sec;
+    return difference;
+  }
+};
+
+inline PlanningCounters& getPlanningCounters() {
+  static thread_local PlanningCounters counters;
+  return counters;
+}
+
+}  // namespace mav_planning
+
+#endif  // MAV_PLANNING_COMMON_PLANNING_COUNTERS_H_
@@ -0,0 +1,91 @@
+#ifndef MAV_PLANNING_COMMON_SCOPED_TRACE_H_
+#define MAV_PLANNING_COMMON_SCOPED_TRACE_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <string>
+
+namespace mav_planning {
+
+// Timeline tracing, to see what the timing::Timer averages hide: single slow
+// calls, and which threads did what at the same time. Every ScopedTrace
+// records when it started and ended, on which thread, into a fixed-size ring
+// buffer of that thread (the oldest events are overwritten). The result is
+// written in the Chrome trace event format, which chrome://tracing and
+// Perfetto (ui.perfetto.dev) load.
+//
+// Off by default. While off, a ScopedTrace costs one predictable branch at
+// either end and records nothing.
+//
+// Names and categories are NOT copied, so they have to outlive the trace:
+// use string literals, like the timer names.
+//   {
+//     ScopedTrace trace("plan/rrt_star", "rrt");
+//     ...
+//   }
+
+inline std::atomic<bool>& getTracingEnabledFlag() {
+  // Constant-initialized, so there's no guard on it.
+  static std::atomic<bool> enabled(false);
+  return enabled;
+}
+
+inline bool isTracingEnabled() {
+  return getTracingEnabledFlag().load(std::memory_order_relaxed);
+}
+void setTracingEnabled(bool enabled);
+
+// Events kept per thread. Changing it clears the trace.
+void setTraceBufferSize(size_t num_events);
+size_t getTraceBufferSize();
+
+// Drops all events recorded so far.
+void clearTrace();
+
+// Writes everything recorded so far as Chrome trace JSON. Events that are
+// being recorded while writing may or may not be in it.
+void writeChromeTrace(std::ostream* out);
+bool writeChromeTrace(const std::string& filename);
+
+// Timestamps, in nanoseconds on the steady clock.
+inline int64_t getTraceTimeNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// For events that don't fit a scope. Records even if tracing is off.
+void recordTraceEvent(const char* name, const char* category,
+                      int64_t start_time_ns, int64_t end_time_ns);
+
+class ScopedTrace {
+ public:
+  explicit ScopedTrace(const char* name, const char* category = "planning")
+      : name_(nullptr), category_(category), start_time_ns_(0) {
+    if (isTracingEnabled()) {
+      name_ = name;
+      start_time_ns_ = getTraceTimeNs();
+    }
+  }
+
+  ~ScopedTrace() {
+    if (name_ != nullptr) {
+      recordTraceEvent(name_, category_, start_time_ns_, getTraceTimeNs());
+    }
+  }
+
+  ScopedTrace(const ScopedTrace&) = delete;
+  ScopedTrace& operator=(const ScopedTrace&) = delete;
+
+ private:
+  // Only set if tracing was on at the start.
+  const char* name_;
+  const char* category_;
+  int64_t start_time_ns_;
+};
+
+}  // namespace mav_planning
+
+#endif  // MAV_PLANNING_COMMON_SCOPED_TRACE_H_
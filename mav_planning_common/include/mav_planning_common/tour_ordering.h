@@ -0,0 +1,23 @@
+#ifndef MAV_PLANNING_COMMON_TOUR_ORDERING_H_
+#define MAV_PLANNING_COMMON_TOUR_ORDERING_H_
+
+#include <Eigen/Core>
+#include <vector>
+
+namespace mav_planning {
+
+// Orders goals into a short tour through all of them, given the travel costs
+// between them (symmetric). Starts from the nearest neighbor tour, then applies
+// 2-opt and Or-opt moves until neither improves it any more. Not optimal, but
+// fast enough for hundreds of goals.
+//
+// The tour starts at goal 0, and returns there at the end if return_to_start;
+// otherwise it ends wherever is cheapest. Unreachable pairs should be infinite,
+// and are only used if there's no tour without them. order is the goal
+// indices in the order to visit them. Returns the cost of the tour.
+double orderTour(const Eigen::MatrixXd& costs, bool return_to_start,
+                 std::vector<size_t>* order);
+
+}  // namespace mav_planning
+
+#endif  // MAV_PLANNING_COMMON_TOUR_ORDERING_H_
@@ -0,0 +1,66 @@
+#ifndef MAV_PLANNING_COMMON_TRAJECTORY_SAMPLER_H_
+#define MAV_PLANNING_COMMON_TRAJECTORY_SAMPLER_H_
+
+#include <functional>
+
+#include <mav_msgs/eigen_mav_msgs.h>
+#include <mav_trajectory_generation/trajectory.h>
+
+#include "mav_planning_common/physical_constraints.h"
+
+namespace mav_planning {
+
+// Walks a trajectory every dt seconds and evaluates one point at a time,
+// instead of sampling the whole thing into a vector up front, so checks need
+// constant memory and can stop early. Use like:
+//   TrajectorySampler sampler(trajectory, dt);
+//   mav_msgs::EigenTrajectoryPoint point;
+//   while (sampler.next(&point)) { ... }
+// The trajectory has to outlive the sampler.
+class TrajectorySampler {
+ public:
+  TrajectorySampler(const mav_trajectory_generation::Trajectory& trajectory,
+                    double dt);
+  // Only sample between start_time and end_time.
+  TrajectorySampler(const mav_trajectory_generation::Trajectory& trajectory,
+                    double dt, double start_time, double end_time);
+
+  // Fills in position, velocity, acceleration and time of the next sample.
+  // Returns false once past the end.
+  bool next(mav_msgs::EigenTrajectoryPoint* point);
+
+  bool done() const;
+  void reset();
+
+ private:
+  double getSampleTime() const;
+
+  const mav_trajectory_generation::Trajectory& trajectory_;
+  double dt_;
+  double start_time_;
+  double end_time_;
+
+  size_t sample_index_;
+  // Segment the last sample was in and its start time, so that we don't
+  // have to search through all the segments for every sample.
+  size_t segment_index_;
+  double segment_start_time_;
+};
+
+// Streaming checks over a trajectory. Both stop at the first failing sample.
+// Velocity and acceleration may go over the constraints by margin.
+bool isTrajectoryFeasible(
+    const mav_trajectory_generation::Trajectory& trajectory, double dt,
+    const PhysicalConstraints& constraints, double margin);
+
+// Distance function returns the map distance at a position, which has to be at
+// least min_distance everywhere.
+bool isTrajectoryCollisionFree(
+    const mav_trajectory_generation::Trajectory& trajectory, double dt,
+    const std::function<double(const Eigen::Vector3d& position)>&
+        distance_function,
+    double min_distance);
+
+}  // namespace mav_planning
+
+#endif  // MAV_PLANNING_COMMON_TRAJECTORY_SAMPLER_H_
@@ -2,6 +2,7 @@
 #define MAV_PLANNING_COMMON_UTILS_H_
 
 #include <mav_msgs/eigen_mav_msgs.h>
+#include <atomic>
 #include <random>
 
 namespace mav_planning {
@@ -23,10 +24,33 @@ inline double computePathLength(
   return distance;
 }
 
-// Generates a double between m and n. Use srand(x) to set the seed used for
-// this.
+// Engine for a thread that just started drawing numbers. Each one is seeded
+// differently, so threads that never call seedRandom() don't all draw the
+// same numbers. Which thread gets which seed depends on the order they start
+// in, so only seedRandom() makes a thread's numbers reproducible.
+inline std::mt19937 makeThreadRandomEngine() {
+  static std::atomic<unsigned int> num_engines(0u);
+  std::seed_seq seed_sequence = {
+      static_cast<unsigned int>(std::mt19937::default_seed), num_engines++};
+  return std::mt19937(seed_sequence);
+}
+
+// Random engine behind randMToN. Every thread has its own, so threads don't
+// race on (or reseed each other's) random state, and a thread seeded with
+// seedRandom(x) always gets the same numbers no matter what the others do.
+inline std::mt19937& getRandomEngine() {
+  static thread_local std::mt19937 engine = makeThreadRandomEngine();
+  return engine;
+}
+
+// Only seeds the calling thread.
+inline void seedRandom(unsigned int seed) { getRandomEngine().seed(seed); }
+
+// Generates a double between m and n. Use seedRandom(x) to set the seed used
+// for this.
 inline double randMToN(double m, double n) {
-  return m + (rand() / (RAND_MAX / (n - m)));
+  return m + (n - m) * (static_cast<double>(getRandomEngine()()) /
+                        std::mt19937::max());
 }
 
 }  // namespace mav_planning
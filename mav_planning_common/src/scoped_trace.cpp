@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "mav_planning_common/scoped_trace.h"
+
+namespace mav_planning {
+
+namespace {
+
+struct TraceEvent {
+  const char* name;
+  const char* category;
+  int64_t start_time_ns;
+  int64_t end_time_ns;
+  int thread_id;
+};
+
+// Ring buffer of one thread. Once the thread exits, it goes to the next new
+// thread, with its events, so that short-lived threads don't pile up buffers.
+struct TraceBuffer {
+  // Only ever contended while writing out, clearing or resizing.
+  std::mutex mutex;
+  size_t capacity = 0;
+  // All events recorded since the last clear. The next one goes to
+  // num_recorded % capacity once the buffer is full.
+  size_t num_recorded = 0;
+  std::vector<TraceEvent> events;
+
+  void clear() {
+    num_recorded = 0;
+    events.clear();
+  }
+};
+
+class TraceRecorder {
+ public:
+  static TraceRecorder& getInstance() {
+    static TraceRecorder recorder;
+    return recorder;
+  }
+
+  TraceBuffer* acquireBuffer() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!free_buffers_.empty()) {
+      TraceBuffer* buffer = free_buffers_.back();
+      free_buffers_.pop_back();
+      return buffer;
+    }
+    buffers_.emplace_back(new TraceBuffer());
+    buffers_.back()->capacity = buffer_size_;
+    return buffers_.back().get();
+  }
+
+  void releaseBuffer(TraceBuffer* buffer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_buffers_.push_back(buffer);
+  }
+
+  int getNewThreadId() { return next_thread_id_++; }
+
+  size_t getBufferSize() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return buffer_size_;
+  }
+
+  void setBufferSize(size_t num_events) {
+    CHECK_GT(num_events, 0u);
+    std::lock_guard<std::mutex> lock(mutex_);
+    buffer_size_ = num_events;
+    for (const std::unique_ptr<TraceBuffer>& buffer : buffers_) {
+      std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+      buffer->capacity = buffer_size_;
+      buffer->clear();
+    }
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const std::unique_ptr<TraceBuffer>& buffer : buffers_) {
+      std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+      buffer->clear();
+    }
+  }
+
+  void getEvents(std::vector<TraceEvent>* events) {
+    CHECK_NOTNULL(events);
+    events->clear();
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const std::unique_ptr<TraceBuffer>& buffer : buffers_) {
+      std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+      events->insert(events->end(), buffer->events.begin(),
+                     buffer->events.end());
+    }
+  }
+
+ private:
+  TraceRecorder() : buffer_size_(16384u), next_thread_id_(0) {}
+
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<TraceBuffer>> buffers_;
+  std::vector<TraceBuffer*> free_buffers_;
+  size_t buffer_size_;
+  std::atomic<int> next_thread_id_;
+};
+
+// The buffer of the current thread, handed back when the thread exits.
+class ThreadTraceBuffer {
+ public:
+  ThreadTraceBuffer()
+      : buffer_(TraceRecorder::getInstance().acquireBuffer()),
+        thread_id_(TraceRecorder::getInstance().getNewThreadId()) {}
+  ~ThreadTraceBuffer() { TraceRecorder::getInstance().releaseBuffer(buffer_); }
+
+  void record(const char* name, const char* category, int64_t start_time_ns,
+              int64_t end_time_ns) {
+    const TraceEvent event = {name, category, start_time_ns, end_time_ns,
+                              thread_id_};
+    std::lock_guard<std::mutex> lock(buffer_->mutex);
+    if (buffer_->events.size() < buffer_->capacity) {
+      buffer_->events.push_back(event);
+    } else {
+      buffer_->events[buffer_->num_recorded % buffer_->capacity] = event;
+    }
+    ++buffer_->num_recorded;
+  }
+
+ private:
+  TraceBuffer* buffer_;
+  int thread_id_;
+};
+
+// Names are meant to be literals, but quotes or backslashes would still
+// break the JSON.
+void writeJsonString(const char* string, std::ostream* out) {
+  *out << '"';
+  for (const char* c = string; *c != '\0'; ++c) {
+    if (*c == '"' || *c == '\\') {
+      *out << '\\';
+    }
+    *out << *c;
+  }
+  *out << '"';
+}
+
+}  // namespace
+
+void setTracingEnabled(bool enabled) {
+  getTracingEnabledFlag().store(enabled, std::memory_order_relaxed);
+}
+
+void setTraceBufferSize(size_t num_events) {
+  TraceRecorder::getInstance().setBufferSize(num_events);
+}
+
+size_t getTraceBufferSize() {
+  return TraceRecorder::getInstance().getBufferSize();
+}
+
+void clearTrace() { TraceRecorder::getInstance().clear(); }
+
+void recordTraceEvent(const char* name, const char* category,
+                      int64_t start_time_ns, int64_t end_time_ns) {
+  static thread_local ThreadTraceBuffer buffer;
+  buffer.record(name, category, start_time_ns, end_time_ns);
+}
+
+void writeChromeTrace(std::ostream* out) {
+  CHECK_NOTNULL(out);
+  std::vector<TraceEvent> events;
+  TraceRecorder::getInstance().getEvents(&events);
+  std::sort(events.begin(), events.end(),
+            [](const TraceEvent& a, const TraceEvent& b) {
+              return a.start_time_ns < b.start_time_ns;
+            });
+
+  // Timestamps are in microseconds, from the first event on.
+  const int64_t first_time_ns = events.empty() ? 0 : events[0].start_time_ns;
+  const std::ios::fmtflags flags = out->flags();
+  const std::streamsize precision = out->precision();
+  out->setf(std::ios::fixed, std::ios::floatfield);
+  out->precision(3);
+  *out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  for (size_t i = 0; i < events.size(); ++i) {
+    const TraceEvent& event = events[i];
+    *out << (i == 0 ? "\n" : ",\n") << "{\"name\":";
+    writeJsonString(event.name, out);
+    *out << ",\"cat\":";
+    writeJsonString(event.category, out);
+    *out << ",\"ph\":\"X\",\"ts\":"
+         << (event.start_time_ns - first_time_ns) / 1000.0
+         << ",\"dur\":" << (event.end_time_ns - event.start_time_ns) / 1000.0
+         << ",\"pid\":0,\"tid\":" << event.thread_id << "}";
+  }
+  *out << "\n]}\n";
+  out->flags(flags);
+  out->precision(precision);
+}
+
+bool writeChromeTrace(const std::string& filename) {
+  // Planners serving requests in parallel all write to the same file.
+  static std::mutex file_mutex;
+  std::lock_guard<std::mutex> lock(file_mutex);
+  std::ofstream out(filename);
+  if (!out) {
+    LOG(ERROR) << "Couldn't open trace file " << filename;
+    return false;
+  }
+  writeChromeTrace(&out);
+  return static_cast<bool>(out);
+}
+
+}  // namespace mav_planning
@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <glog/logging.h>
+
+#include "mav_planning_common/tour_ordering.h"
+
+namespace mav_planning {
+
+namespace {
+
+// Smallest improvement worth making a move for, so rounding can't make moves
+// go in circles.
+constexpr double kMinImprovement = 1e-9;
+// Just a safety net, improvement runs out way before.
+constexpr int kMaxPasses = 1000;
+
+// The tour as a sequence with both ends fixed: goal 0 first, and a marker for
+// the end of the tour last, which is either goal 0 again or free to get to.
+class Tour {
+ public:
+  Tour(const Eigen::MatrixXd& costs, bool return_to_start)
+      : costs_(costs),
+        return_to_start_(return_to_start),
+        end_marker_(costs.rows()) {}
+
+  double cost(size_t from, size_t to) const {
+    if (to == end_marker_) {
+      return return_to_start_ ? costs_(from, 0) : 0.0;
+    }
+    return costs_(from, to);
+  }
+
+  void setupNearestNeighbor() {
+    const size_t num_goals = end_marker_;
+    std::vector<bool> visited(num_goals, false);
+    sequence_.clear();
+    sequence_.reserve(num_goals + 1);
+    sequence_.push_back(0);
+    visited[0] = true;
+    for (size_t i = 1; i < num_goals; ++i) {
+      const size_t last = sequence_.back();
+      size_t nearest = num_goals;
+      for (size_t goal = 1; goal < num_goals; ++goal) {
+        if (visited[goal]) {
+          continue;
+        }
+        if (nearest == num_goals ||
+            costs_(last, goal) < costs_(last, nearest)) {
+          nearest = goal;
+        }
+      }
+      sequence_.push_back(nearest);
+      visited[nearest] = true;
+    }
+    sequence_.push_back(end_marker_);
+  }
+
+  // Reverses a stretch of the tour wherever that's cheaper. Returns whether
+  // anything changed.
+  bool improveTwoOpt() {
+    bool improved = false;
+    const size_t last_inner = sequence_.size() - 2;
+    for (size_t i = 1; i < last_inner; ++i) {
+      for (size_t j = i + 1; j <= last_inner; ++j) {
+        const double delta = cost(sequence_[i - 1], sequence_[j]) +
+                             cost(sequence_[i], sequence_[j + 1]) -
+                             cost(sequence_[i - 1], sequence_[i]) -
+                             cost(sequence_[j], sequence_[j + 1]);
+        if (delta < -kMinImprovement) {
+          std::reverse(sequence_.begin() + i, sequence_.begin() + j + 1);
+          improved = true;
+        }
+      }
+    }
+    return improved;
+  }
+
+  // Moves stretches of up to three goals elsewhere in the tour, either way
+  // around, wherever that's cheaper. Returns whether anything changed.
+  bool improveOrOpt() {
+    constexpr size_t kMaxSegmentLength = 3;
+    bool improved = false;
+    for (size_t length = 1; length <= kMaxSegmentLength; ++length) {
+      for (size_t i = 1; i + length < sequence_.size(); ++i) {
+        const size_t end = i + length - 1;
+        const size_t first = sequence_[i];
+        const size_t last = sequence_[end];
+        const double removal_gain = cost(sequence_[i - 1], first) +
+                                    cost(last, sequence_[end + 1]) -
+                                    cost(sequence_[i - 1], sequence_[end + 1]);
+        // Insert between k and k + 1.
+        for (size_t k = 0; k + 1 < sequence_.size(); ++k) {
+          if (k + 1 >= i && k <= end) {
+            continue;
+          }
+          const size_t before = sequence_[k];
+          const size_t after = sequence_[k + 1];
+          const double gap_cost = cost(before, after);
+          const double forward_cost =
+              cost(before, first) + cost(last, after) - gap_cost;
+          const double reversed_cost =
+              cost(before, last) + cost(first, after) - gap_cost;
+          const bool reverse = reversed_cost < forward_cost;
+          if (std::min(forward_cost, reversed_cost) - removal_gain <
+              -kMinImprovement) {
+            moveSegment(i, end, k, reverse);
+            improved = true;
+            break;
+          }
+        }
+      }
+    }
+    return improved;
+  }
+
+  const std::vector<size_t>& getSequence() const { return sequence_; }
+
+ private:
+  // Moves [begin, end] of the sequence to right after position k, which is
+  // outside of it.
+  void moveSegment(size_t begin, size_t end, size_t k, bool reverse) {
+    if (reverse) {
+      std::reverse(sequence_.begin() + begin, sequence_.begin() + end + 1);
+    }
+    if (k < begin) {
+      std::rotate(sequence_.begin() + k + 1, sequence_.begin() + begin,
+                  sequence_.begin() + end + 1);
+    } else {
+      std::rotate(sequence_.begin() + begin, sequence_.begin() + end + 1,
+                  sequence_.begin() + k + 1);
+    }
+  }
+
+  const Eigen::MatrixXd& costs_;
+  const bool return_to_start_;
+  const size_t end_marker_;
+  std::vector<size_t> sequence_;
+};
+
+}  // namespace
+
+double orderTour(const Eigen::MatrixXd& costs, bool return_to_start,
+                 std::vector<size_t>* order) {
+  CHECK_NOTNULL(order);
+  CHECK_EQ(costs.rows(), costs.cols());
+  order->clear();
+  const size_t num_goals = costs.rows();
+  if (num_goals == 0) {
+    return 0.0;
+  }
+
+  // Unreachable legs cost more than any whole tour without them, so that they
+  // still compare properly.
+  double max_cost = 0.0;
+  for (size_t i = 0; i < num_goals; ++i) {
+    for (size_t j = 0; j < num_goals; ++j) {
+      if (std::isfinite(costs(i, j))) {
+        max_cost = std::max(max_cost, costs(i, j));
+      }
+    }
+  }
+  const double unreachable_cost = 1.0 + num_goals * max_cost;
+  Eigen::MatrixXd leg_costs = costs;
+  for (size_t i = 0; i < num_goals; ++i) {
+    for (size_t j = 0; j < num_goals; ++j) {
+      if (!std::isfinite(leg_costs(i, j))) {
+        leg_costs(i, j) = unreachable_cost;
+      }
+    }
+  }
+
+  Tour tour(leg_costs, return_to_start);
+  tour.setupNearestNeighbor();
+  for (int pass = 0; pass < kMaxPasses; ++pass) {
+    const bool two_opt_improved = tour.improveTwoOpt();
+    const bool or_opt_improved = tour.improveOrOpt();
+    if (!two_opt_improved && !or_opt_improved) {
+      break;
+    }
+  }
+
+  // Drop the end marker, and add up the actual costs.
+  const std::vector<size_t>& sequence = tour.getSequence();
+  order->assign(sequence.begin(), sequence.end() - 1);
+  double total_cost = 0.0;
+  for (size_t i = 1; i < order->size(); ++i) {
+    total_cost += costs((*order)[i - 1], (*order)[i]);
+  }
+  if (return_to_start) {
+    total_cost += costs(order->back(), 0);
+  }
+  return total_cost;
+}
+
+}  // namespace mav_planning
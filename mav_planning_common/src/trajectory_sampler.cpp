@@ -0,0 +1,107 @@
+#include <algorithm>
+
+#include "mav_planning_common/map_query_scope.h"
+#include "mav_planning_common/planning_counters.h"
+#include "mav_planning_common/trajectory_sampler.h"
+
+namespace mav_planning {
+
+TrajectorySampler::TrajectorySampler(
+    const mav_trajectory_generation::Trajectory& trajectory, double dt)
+    : TrajectorySampler(trajectory, dt, trajectory.getMinTime(),
+                        trajectory.getMaxTime()) {}
+
+TrajectorySampler::TrajectorySampler(
+    const mav_trajectory_generation::Trajectory& trajectory, double dt,
+    double start_time, double end_time)
+    : trajectory_(trajectory),
+      dt_(dt),
+      start_time_(start_time),
+      end_time_(end_time) {
+  CHECK_GT(dt_, 0.0);
+  reset();
+}
+
+void TrajectorySampler::reset() {
+  sample_index_ = 0;
+  segment_index_ = 0;
+  segment_start_time_ = trajectory_.getMinTime();
+}
+
+double TrajectorySampler::getSampleTime() const {
+  // Multiply rather than accumulate so long trajectories don't drift.
+  return start_time_ + sample_index_ * dt_;
+}
+
+bool TrajectorySampler::done() const {
+  return trajectory_.empty() || getSampleTime() > end_time_;
+}
+
+bool TrajectorySampler::next(mav_msgs::EigenTrajectoryPoint* point) {
+  CHECK_NOTNULL(point);
+  if (done()) {
+    return false;
+  }
+  const double t = getSampleTime();
+  sample_index_++;
+
+  // Samples only go forward, so just move along the segments as needed.
+  const mav_trajectory_generation::Segment::Vector& segments =
+      trajectory_.segments();
+  while (segment_index_ + 1 < segments.size() &&
+         t > segment_start_time_ + segments[segment_index_].getTime()) {
+    segment_start_time_ += segments[segment_index_].getTime();
+    segment_index_++;
+  }
+
+  const mav_trajectory_generation::Segment& segment = segments[segment_index_];
+  const double segment_time = std::min(
+      std::max(t - segment_start_time_, 0.0), segment.getTime());
+
+  const int kPosition = mav_trajectory_generation::derivative_order::POSITION;
+  const int kVelocity = mav_trajectory_generation::derivative_order::VELOCITY;
+  const int kAcceleration =
+      mav_trajectory_generation::derivative_order::ACCELERATION;
+  point->position_W = segment.evaluate(segment_time, kPosition).head<3>();
+  point->velocity_W = segment.evaluate(segment_time, kVelocity).head<3>();
+  point->acceleration_W =
+      segment.evaluate(segment_time, kAcceleration).head<3>();
+  point->time_from_start_ns = mav_msgs::secondsToNanoseconds(t);
+  return true;
+}
+
+bool isTrajectoryFeasible(
+    const mav_trajectory_generation::Trajectory& trajectory, double dt,
+    const PhysicalConstraints& constraints, double margin) {
+  TrajectorySampler sampler(trajectory, dt);
+  mav_msgs::EigenTrajectoryPoint point;
+  while (sampler.next(&point)) {
+    if (point.acceleration_W.norm() > constraints.a_max + margin) {
+      return false;
+    }
+    if (point.velocity_W.norm() > constraints.v_max + margin) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool isTrajectoryCollisionFree(
+    const mav_trajectory_generation::Trajectory& trajectory, double dt,
+    const std::function<double(const Eigen::Vector3d& position)>&
+        distance_function,
+    double min_distance) {
+  CHECK(distance_function);
+  ++getPlanningCounters().collision_checks;
+  MapQueryScope scope;
+  TrajectorySampler sampler(trajectory, dt);
+  mav_msgs::EigenTrajectoryPoint point;
+  while (sampler.next(&point)) {
+    if (distance_function(point.position_W) < min_distance) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace mav_planning
@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include "mav_planning_common/tour_ordering.h"
+
+namespace mav_planning {
+
+class TourOrderingTest : public ::testing::Test {
+ protected:
+  // Distances between random points in a square.
+  Eigen::MatrixXd getRandomCosts(size_t num_goals, unsigned int seed) const {
+    std::mt19937 random_engine(seed);
+    std::uniform_real_distribution<double> coordinate(0.0, 10.0);
+    std::vector<Eigen::Vector2d> points(num_goals);
+    for (Eigen::Vector2d& point : points) {
+      point = Eigen::Vector2d(coordinate(random_engine),
+                              coordinate(random_engine));
+    }
+    Eigen::MatrixXd costs(num_goals, num_goals);
+    for (size_t i = 0; i < num_goals; ++i) {
+      for (size_t j = 0; j < num_goals; ++j) {
+        costs(i, j) = (points[i] - points[j]).norm();
+      }
+    }
+    return costs;
+  }
+
+  double getTourCost(const Eigen::MatrixXd& costs, bool return_to_start,
+                     const std::vector<size_t>& order) const {
+    double cost = 0.0;
+    for (size_t i = 0; i + 1 < order.size(); ++i) {
+      cost += costs(order[i], order[i + 1]);
+    }
+    if (return_to_start && !order.empty()) {
+      cost += costs(order.back(), 0);
+    }
+    return cost;
+  }
+
+  // Tries every order that starts at goal 0.
+  double getBruteForceCost(const Eigen::MatrixXd& costs,
+                           bool return_to_start) const {
+    std::vector<size_t> order(costs.rows());
+    for (size_t i = 0; i < order.size(); ++i) {
+      order[i] = i;
+    }
+    double best_cost = std::numeric_limits<double>::infinity();
+    do {
+      best_cost = std::min(best_cost,
+                           getTourCost(costs, return_to_start, order));
+    } while (std::next_permutation(order.begin() + 1, order.end()));
+    return best_cost;
+  }
+
+  void expectValidOrder(size_t num_goals,
+                        const std::vector<size_t>& order) const {
+    ASSERT_EQ(num_goals, order.size());
+    EXPECT_EQ(0u, order.front());
+    std::vector<size_t> sorted_order = order;
+    std::sort(sorted_order.begin(), sorted_order.end());
+    for (size_t i = 0; i < num_goals; ++i) {
+      EXPECT_EQ(i, sorted_order[i]);
+    }
+  }
+};
+
+TEST_F(TourOrderingTest, OrderIsPermutationWithMatchingCost) {
+  const size_t kNumGoals = 50u;
+  const Eigen::MatrixXd costs = getRandomCosts(kNumGoals, 1u);
+  for (const bool return_to_start : {false, true}) {
+    std::vector<size_t> order;
+    const double cost = orderTour(costs, return_to_start, &order);
+    expectValidOrder(kNumGoals, order);
+    EXPECT_NEAR(getTourCost(costs, return_to_start, order), cost, 1e-9);
+  }
+}
+
+TEST_F(TourOrderingTest, CloseToBruteForce) {
+  const size_t kNumGoals = 8u;
+  const int kNumInstances = 20;
+  // 2-opt and Or-opt mostly find the best tour at this size, and never miss
+  // it by much.
+  const double kMaxRatio = 1.1;
+  int num_optimal = 0;
+  for (int instance = 0; instance < kNumInstances; ++instance) {
+    const Eigen::MatrixXd costs = getRandomCosts(kNumGoals, instance);
+    for (const bool return_to_start : {false, true}) {
+      std::vector<size_t> order;
+      const double cost = orderTour(costs, return_to_start, &order);
+      expectValidOrder(kNumGoals, order);
+      const double best_cost = getBruteForceCost(costs, return_to_start);
+      EXPECT_GE(cost, best_cost - 1e-9);
+      EXPECT_LE(cost, kMaxRatio * best_cost)
+          << "Instance " << instance << " return to start "
+          << return_to_start;
+      if (cost <= best_cost + 1e-9) {
+        ++num_optimal;
+      }
+    }
+  }
+  EXPECT_GE(num_optimal, 3 * 2 * kNumInstances / 4);
+}
+
+TEST_F(TourOrderingTest, AvoidsUnreachableLegs) {
+  // On a line, but the nearest neighbor of every goal is unreachable, so
+  // only the tour that skips back and forth is finite.
+  const size_t kNumGoals = 6u;
+  const double kInfinity = std::numeric_limits<double>::infinity();
+  Eigen::MatrixXd costs(kNumGoals, kNumGoals);
+  for (size_t i = 0; i < kNumGoals; ++i) {
+    for (size_t j = 0; j < kNumGoals; ++j) {
+      const size_t gap = i > j ? i - j : j - i;
+      costs(i, j) = gap == 1 ? kInfinity : static_cast<double>(gap);
+    }
+  }
+
+  for (const bool return_to_start : {false, true}) {
+    std::vector<size_t> order;
+    const double cost = orderTour(costs, return_to_start, &order);
+    expectValidOrder(kNumGoals, order);
+    EXPECT_TRUE(std::isfinite(cost));
+    EXPECT_NEAR(getTourCost(costs, return_to_start, order), cost, 1e-9);
+    EXPECT_NEAR(getBruteForceCost(costs, return_to_start), cost, 1e-9);
+  }
+}
+
+TEST_F(TourOrderingTest, SmallTours) {
+  std::vector<size_t> order;
+  EXPECT_EQ(0.0, orderTour(Eigen::MatrixXd::Zero(1, 1), true, &order));
+  ASSERT_EQ(1u, order.size());
+  EXPECT_EQ(0u, order[0]);
+
+  Eigen::MatrixXd costs(2, 2);
+  costs << 0.0, 3.0, 3.0, 0.0;
+  EXPECT_EQ(3.0, orderTour(costs, false, &order));
+  EXPECT_EQ(6.0, orderTour(costs, true, &order));
+  expectValidOrder(2u, order);
+}
+
+}  // namespace mav_planning
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  google::InitGoogleLogging(argv[0]);
+
+  return RUN_ALL_TESTS();
+}
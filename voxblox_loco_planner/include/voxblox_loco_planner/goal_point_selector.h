@@ -5,6 +5,7 @@
 #include <mav_planning_common/utils.h>
 #include <voxblox/core/common.h>
 #include <voxblox/core/tsdf_map.h>
+#include <voxblox_planning_common/free_space_index.h>
 #include <voxblox_planning_common/gain_evaluator.h>
 #include <ros/node_handle.h>
 
@@ -20,6 +21,9 @@ struct GoalPointSelectorParameters {
 
   // For random sampling in general.
   int max_random_tries = 100;
+  // Sample from an index of observed-free voxels instead of rejection
+  // sampling. Falls back to rejection sampling if there's nothing free nearby.
+  bool use_free_space_index = true;
 
   // For the exploration planner.
   int num_exploration_samples = 15;
@@ -39,6 +43,12 @@ class GoalPointSelector {
 
   void setTsdfMap(const std::shared_ptr<voxblox::TsdfMap>& tsdf_map);
 
+  // Re-index the blocks of the map whose free space changed since the last
+  // call. Called automatically before selecting an exploration goal. Whoever
+  // integrates into the map can also pass the changed blocks directly.
+  void updateFreeSpaceIndex();
+  void updateFreeSpaceIndex(const voxblox::BlockIndexList& updated_blocks);
+
   bool selectNextGoal(const mav_msgs::EigenTrajectoryPoint& global_goal,
                       const mav_msgs::EigenTrajectoryPoint& current_goal,
                       const mav_msgs::EigenTrajectoryPoint& current_pose,
@@ -51,7 +61,11 @@ class GoalPointSelector {
 
   bool selectRandomFreePose(const mav_msgs::EigenTrajectoryPoint& input_pose,
                             double range_meters,
-                            mav_msgs::EigenTrajectoryPoint* sampled_pose) const;
+                            mav_msgs::EigenTrajectoryPoint* sampled_pose);
+
+  bool selectIndexedFreePose(const mav_msgs::EigenTrajectoryPoint& input_pose,
+                             double range_meters,
+                             mav_msgs::EigenTrajectoryPoint* sampled_pose);
 
   bool selectLocalExplorationGoal(
       const mav_msgs::EigenTrajectoryPoint& global_goal,
@@ -67,6 +81,9 @@ class GoalPointSelector {
   // Gain evaluator!
   GainEvaluator gain_evaluator_;
 
+  // Observed-free voxels, for sampling free poses directly.
+  FreeSpaceIndex free_space_index_;
+
   // Map.
   std::shared_ptr<voxblox::TsdfMap> tsdf_map_;
 };
@@ -11,6 +11,7 @@
 #include <voxblox/core/common.h>
 #include <voxblox/core/esdf_map.h>
 #include <voxblox/utils/planning_utils.h>
+#include <voxblox_planning_common/esdf_distance_source.h>
 #include <voxblox_planning_common/path_shortening.h>
 
 #include "voxblox_loco_planner/shotgun_planner.h"
@@ -22,8 +23,10 @@ class VoxbloxLocoPlanner {
   static constexpr int kN = 10;
   static constexpr int kD = 3;
 
+  // If headless, nothing is advertised or published, whatever the visualize
+  // param says.
   VoxbloxLocoPlanner(const ros::NodeHandle& nh,
-                     const ros::NodeHandle& nh_private);
+                     const ros::NodeHandle& nh_private, bool headless = false);
 
   // MUST be called to associate the map with the planner.
   void setEsdfMap(const std::shared_ptr<voxblox::EsdfMap>& esdf_map);
@@ -46,17 +49,19 @@ class VoxbloxLocoPlanner {
       mav_trajectory_generation::Trajectory* trajectory);
 
  private:
-  // Callbacks to bind to loco.
+  // Map access, through the same distance source as loco.
   double getMapDistance(const Eigen::Vector3d& position) const;
   double getMapDistanceAndGradient(const Eigen::Vector3d& position,
                                    Eigen::Vector3d* gradient) const;
-  double getMapDistanceAndGradientVector(const Eigen::VectorXd& position,
-                                         Eigen::VectorXd* gradient) const;
 
   // Evaluate what we've got here.
   bool isPathCollisionFree(
       const mav_msgs::EigenTrajectoryPointVector& path) const;
   bool isPathFeasible(const mav_msgs::EigenTrajectoryPointVector& path) const;
+  // Same collision check, but samples the trajectory lazily every dt and
+  // stops at the first bad point.
+  bool isTrajectoryCollisionFree(
+      const mav_trajectory_generation::Trajectory& trajectory, double dt) const;
 
   // Intermediate goal-finding.
   bool findIntermediateGoal(const mav_msgs::EigenTrajectoryPoint& start,
@@ -110,6 +115,7 @@ class VoxbloxLocoPlanner {
 
   // Map.
   std::shared_ptr<voxblox::EsdfMap> esdf_map_;
+  EsdfDistanceSource distance_source_;
 };
 
 }  // namespace mav_planning
@@ -1,3 +1,5 @@
+#include <mav_trajectory_generation/timing.h>
+
 #include "voxblox_loco_planner/goal_point_selector.h"
 
 namespace mav_planning {
@@ -29,6 +31,8 @@ void GoalPointSelector::setParametersFromRos(const ros::NodeHandle& nh) {
 
   nh.param("goal_selector_range", params_.random_sample_range,
            params_.random_sample_range);
+  nh.param("goal_selector_use_free_space_index", params_.use_free_space_index,
+           params_.use_free_space_index);
 }
 
 void GoalPointSelector::setTsdfMap(
@@ -36,7 +40,28 @@ void GoalPointSelector::setTsdfMap(
   tsdf_map_ = tsdf_map;
   if (tsdf_map) {
     gain_evaluator_.setTsdfLayer(tsdf_map->getTsdfLayerPtr());
+    free_space_index_.setTsdfLayer(tsdf_map->getTsdfLayerPtr());
+  } else {
+    free_space_index_.setTsdfLayer(nullptr);
+  }
+}
+
+void GoalPointSelector::updateFreeSpaceIndex() {
+  if (!tsdf_map_ || !params_.use_free_space_index) {
+    return;
   }
+  mav_trajectory_generation::timing::Timer timer_index(
+      "goal_selector/update_free_space_index");
+  free_space_index_.updateChangedBlocks();
+  timer_index.Stop();
+}
+
+void GoalPointSelector::updateFreeSpaceIndex(
+    const voxblox::BlockIndexList& updated_blocks) {
+  if (!tsdf_map_ || !params_.use_free_space_index) {
+    return;
+  }
+  free_space_index_.updateBlocks(updated_blocks);
 }
 
 bool GoalPointSelector::selectNextGoal(
@@ -69,9 +94,13 @@ bool GoalPointSelector::selectNextGoal(
     if (!tsdf_map_) {
       return false;
     }
+    // The map has most likely changed since the last goal, so refresh the
+    // free space before sampling from it.
+    updateFreeSpaceIndex();
     return selectLocalExplorationGoal(global_goal, current_goal, current_pose,
                                       next_goal);
   }
+  return false;
 }
 
 void GoalPointSelector::selectRandomPose(
@@ -96,10 +125,14 @@ void GoalPointSelector::selectRandomPose(
 
 bool GoalPointSelector::selectRandomFreePose(
     const mav_msgs::EigenTrajectoryPoint& input_pose, double range_meters,
-    mav_msgs::EigenTrajectoryPoint* sampled_pose) const {
+    mav_msgs::EigenTrajectoryPoint* sampled_pose) {
   if (!tsdf_map_) {
     return false;
   }
+  if (params_.use_free_space_index &&
+      selectIndexedFreePose(input_pose, range_meters, sampled_pose)) {
+    return true;
+  }
   // Get a pointer to the layer to use later.
   voxblox::Layer<voxblox::TsdfVoxel>* tsdf_layer = tsdf_map_->getTsdfLayerPtr();
   CHECK_NOTNULL(tsdf_layer);
@@ -126,6 +159,28 @@ bool GoalPointSelector::selectRandomFreePose(
   return false;
 }
 
+bool GoalPointSelector::selectIndexedFreePose(
+    const mav_msgs::EigenTrajectoryPoint& input_pose, double range_meters,
+    mav_msgs::EigenTrajectoryPoint* sampled_pose) {
+  const voxblox::Point center = input_pose.position_W.cast<float>();
+  const voxblox::FloatingPoint radius = range_meters;
+
+  // Only rebuild the alias table if the query changed, so repeated samples
+  // around the same pose are O(1).
+  if (!free_space_index_.isQuerySphere(center, radius) &&
+      !free_space_index_.setQuerySphere(center, radius)) {
+    return false;
+  }
+
+  voxblox::Point sampled_position;
+  if (!free_space_index_.sampleFreePoint(&sampled_position)) {
+    return false;
+  }
+  sampled_pose->position_W = sampled_position.cast<double>();
+  sampled_pose->setFromYaw(randMToN(-M_PI, M_PI));
+  return true;
+}
+
 bool GoalPointSelector::selectLocalExplorationGoal(
     const mav_msgs::EigenTrajectoryPoint& global_goal,
     const mav_msgs::EigenTrajectoryPoint& current_goal,
@@ -23,7 +23,7 @@ void ShotgunPlanner::setEsdfMap(
   esdf_map_ = esdf_map;
 }
 
-void ShotgunPlanner::setSeed(int seed) { srand(seed); }
+void ShotgunPlanner::setSeed(int seed) { seedRandom(seed); }
 
 // Main function to call. Returns whether the particles were able to get
 // anywhere at all.
@@ -1,3 +1,6 @@
+#include <mav_planning_common/map_query_scope.h>
+#include <mav_planning_common/planning_counters.h>
+#include <mav_planning_common/trajectory_sampler.h>
 #include <mav_trajectory_generation/timing.h>
 #include <mav_trajectory_generation/trajectory_sampling.h>
 #include <mav_trajectory_generation/vertex.h>
@@ -8,7 +11,8 @@
 namespace mav_planning {
 
 VoxbloxLocoPlanner::VoxbloxLocoPlanner(const ros::NodeHandle& nh,
-                                       const ros::NodeHandle& nh_private)
+                                       const ros::NodeHandle& nh_private,
+                                       bool headless)
     : nh_(nh),
       nh_private_(nh_private),
       verbose_(false),
@@ -26,6 +30,9 @@ VoxbloxLocoPlanner::VoxbloxLocoPlanner(const ros::NodeHandle& nh,
 
   nh_private_.param("verbose", verbose_, verbose_);
   nh_private_.param("visualize", visualize_, visualize_);
+  if (headless) {
+    visualize_ = false;
+  }
   nh_private_.param("frame_id", frame_id_, frame_id_);
   nh_private_.param("planning_horizon_m", planning_horizon_m_,
                     planning_horizon_m_);
@@ -44,18 +51,20 @@ VoxbloxLocoPlanner::VoxbloxLocoPlanner(const ros::NodeHandle& nh,
   path_shortener_.setConstraints(constraints_);
 
   // ROS debug visualization.
-  planning_marker_pub_ = nh_private_.advertise<visualization_msgs::MarkerArray>(
-      "planning_markers", 1, true);
+  if (!headless) {
+    planning_marker_pub_ =
+        nh_private_.advertise<visualization_msgs::MarkerArray>(
+            "planning_markers", 1, true);
+  }
 }
 
 void VoxbloxLocoPlanner::setEsdfMap(
     const std::shared_ptr<voxblox::EsdfMap>& esdf_map) {
   CHECK(esdf_map);
   esdf_map_ = esdf_map;
+  distance_source_.setEsdfMap(esdf_map.get());
 
-  loco_.setDistanceAndGradientFunction(
-      std::bind(&VoxbloxLocoPlanner::getMapDistanceAndGradientVector, this,
-                std::placeholders::_1, std::placeholders::_2));
+  loco_.setDistanceSource(&distance_source_);
   loco_.setMapResolution(esdf_map->voxel_size());
 
   shotgun_.setEsdfMap(esdf_map);
@@ -64,40 +73,19 @@ void VoxbloxLocoPlanner::setEsdfMap(
 
 double VoxbloxLocoPlanner::getMapDistance(
     const Eigen::Vector3d& position) const {
-  double distance = 0.0;
-  const bool kInterpolate = false;
-  if (!esdf_map_->getDistanceAtPosition(position, kInterpolate, &distance)) {
-    return 0.0;
-  }
-  return distance;
-}
-
-double VoxbloxLocoPlanner::getMapDistanceAndGradientVector(
-    const Eigen::VectorXd& position, Eigen::VectorXd* gradient) const {
-  CHECK_EQ(position.size(), 3);
-  if (gradient == nullptr) {
-    return getMapDistanceAndGradient(position, nullptr);
-  }
-  Eigen::Vector3d gradient_3d;
-  double distance = getMapDistanceAndGradient(position, &gradient_3d);
-  *gradient = gradient_3d;
-  return distance;
+  return distance_source_.getDistance(position);
 }
 
 double VoxbloxLocoPlanner::getMapDistanceAndGradient(
     const Eigen::Vector3d& position, Eigen::Vector3d* gradient) const {
-  double distance = 0.0;
-  const bool kInterpolate = false;
-  if (!esdf_map_->getDistanceAndGradientAtPosition(position, kInterpolate,
-                                                   &distance, gradient)) {
-    return 0.0;
-  }
-  return distance;
+  return distance_source_.getDistanceAndGradient(position, gradient);
 }
 
 // Evaluate what we've got here.
 bool VoxbloxLocoPlanner::isPathCollisionFree(
     const mav_msgs::EigenTrajectoryPointVector& path) const {
+  ++getPlanningCounters().collision_checks;
+  MapQueryScope scope;
   for (const mav_msgs::EigenTrajectoryPoint& point : path) {
     if (getMapDistance(point.position_W) < constraints_.robot_radius) {
       return false;
@@ -122,6 +110,13 @@ bool VoxbloxLocoPlanner::isPathFeasible(
   return true;
 }
 
+bool VoxbloxLocoPlanner::isTrajectoryCollisionFree(
+    const mav_trajectory_generation::Trajectory& trajectory, double dt) const {
+  return mav_planning::isTrajectoryCollisionFree(
+      trajectory, dt, makeDistanceFunction(&distance_source_),
+      constraints_.robot_radius);
+}
+
 bool VoxbloxLocoPlanner::getTrajectoryBetweenWaypoints(
     const mav_msgs::EigenTrajectoryPoint& start,
     const mav_msgs::EigenTrajectoryPoint& goal,
@@ -162,14 +157,11 @@ bool VoxbloxLocoPlanner::getTrajectoryBetweenWaypoints(
 
   // Check if this path is collision-free.
   constexpr double kCollisionSamplingDt = 0.1;
-  mav_msgs::EigenTrajectoryPoint::Vector path;
   bool success = false;
   int i = 0;
   for (i = 0; i < num_random_restarts_; i++) {
     loco_.getTrajectory(trajectory);
-    mav_trajectory_generation::sampleWholeTrajectory(
-        *trajectory, kCollisionSamplingDt, &path);
-    success = isPathCollisionFree(path);
+    success = isTrajectoryCollisionFree(*trajectory, kCollisionSamplingDt);
     if (success) {
       // Awesome, collision-free path.
       break;
@@ -0,0 +1,107 @@
+#ifndef VOXBLOX_PLANNING_COMMON_ESDF_DISTANCE_PYRAMID_H_
+#define VOXBLOX_PLANNING_COMMON_ESDF_DISTANCE_PYRAMID_H_
+
+#include <vector>
+
+#include <Eigen/Geometry>
+#include <voxblox/core/common.h>
+#include <voxblox/core/layer.h>
+#include <voxblox/core/voxel.h>
+
+namespace mav_planning {
+
+// Minimum ESDF distance per block, and per 2x2x2 and 4x4x4 group of blocks
+// (the levels), so that collision checks can accept whole regions of open
+// space at once and only sample finely near obstacles. Unobserved voxels count
+// as distance 0, and unallocated blocks as not free at all, so the minimum is
+// never more optimistic than the ESDF itself.
+//
+// Updates are per block: updating a block re-scans it and recomputes only the
+// groups above it. Not thread safe against updates, same as the layer.
+class EsdfDistancePyramid {
+ public:
+  static constexpr int kNumLevels = 3;
+
+  EsdfDistancePyramid();
+
+  // Bind the ESDF layer to one OWNED BY ANOTHER OBJECT. It is up to the user
+  // to ensure the layer exists and does not go out of scope. Clears the
+  // pyramid.
+  void setEsdfLayer(const voxblox::Layer<voxblox::EsdfVoxel>* esdf_layer);
+  const voxblox::Layer<voxblox::EsdfVoxel>* getEsdfLayer() const {
+    return esdf_layer_;
+  }
+
+  // Re-scan the given blocks. Blocks that are no longer allocated are dropped.
+  void updateBlock(const voxblox::BlockIndex& block_index);
+  void updateBlocks(const voxblox::BlockIndexList& block_indices);
+  // Re-scan every allocated block in the layer.
+  void updateAllBlocks();
+  // Re-scan every allocated block, but only recompute the groups above the
+  // blocks whose minimum distance changed, and drop blocks that are no longer
+  // allocated. Doesn't rely on (or touch) the layer's update flags, which
+  // other consumers of the layer may clear at any time.
+  void updateChangedBlocks();
+  void clear();
+
+  size_t getNumBlocks() const { return levels_[0].size(); }
+
+  // Whether every voxel of the block is known and further than min_distance
+  // from obstacles. If so, region is set to the largest block or group of
+  // blocks around it that is too, as an inclusive block index range.
+  bool getFreeBlockRegion(const voxblox::BlockIndex& block_index,
+                          voxblox::FloatingPoint min_distance,
+                          voxblox::BlockIndex* region_min,
+                          voxblox::BlockIndex* region_max) const;
+  // Same around a voxel, as an inclusive global voxel index range. If not
+  // free, the range is set to the voxel's block, where asking again for any
+  // other voxel gives the same answer.
+  bool getFreeVoxelRegion(const voxblox::GlobalIndex& voxel_index,
+                          voxblox::FloatingPoint min_distance,
+                          voxblox::GlobalIndex* region_min,
+                          voxblox::GlobalIndex* region_max) const;
+  // Same around a position, as a box in meters. If not free, the box is set
+  // to the position's block.
+  bool getFreeRegion(const Eigen::Vector3d& position, double min_distance,
+                     Eigen::AlignedBox3d* region) const;
+
+  // How far from start along the (normalized) direction, up to max_length,
+  // the line stays inside free regions.
+  double getFreeLengthAlongRay(const Eigen::Vector3d& start,
+                               const Eigen::Vector3d& direction,
+                               double max_length, double min_distance) const;
+
+ private:
+  typedef voxblox::AnyIndexHashMapType<voxblox::FloatingPoint>::type
+      LevelMap;
+
+  // Group index one level up, rounding down for negative indices too.
+  static voxblox::BlockIndex getParentIndex(
+      const voxblox::BlockIndex& block_index);
+
+  // Returns whether the block's minimum distance changed.
+  bool updateLevelZero(const voxblox::BlockIndex& block_index);
+  void updateGroupsAbove(const voxblox::BlockIndex& block_index);
+  void updateGroup(int level, const voxblox::BlockIndex& group_index);
+
+  // Not in the map means not free at all.
+  voxblox::FloatingPoint getMinDistance(
+      int level, const voxblox::BlockIndex& index) const;
+
+  // NON-OWNED pointer to the esdf layer.
+  const voxblox::Layer<voxblox::EsdfVoxel>* esdf_layer_;
+
+  // Cached parameters of the layer.
+  voxblox::FloatingPoint voxel_size_;
+  voxblox::FloatingPoint block_size_;
+  voxblox::FloatingPoint block_size_inv_;
+  int voxels_per_side_;
+
+  // Minimum distance per block, per group of 2x2x2 blocks and per group of
+  // 4x4x4 blocks.
+  std::vector<LevelMap> levels_;
+};
+
+}  // namespace mav_planning
+
+#endif  // VOXBLOX_PLANNING_COMMON_ESDF_DISTANCE_PYRAMID_H_
@@ -0,0 +1,200 @@
+#ifndef VOXBLOX_PLANNING_COMMON_ESDF_DISTANCE_SOURCE_H_
+#define VOXBLOX_PLANNING_COMMON_ESDF_DISTANCE_SOURCE_H_
+
+#include <vector>
+
+#include <mav_planning_common/distance_source.h>
+#include <mav_planning_common/map_query_scope.h>
+#include <mav_planning_common/planning_counters.h>
+#include <voxblox/core/esdf_map.h>
+
+#include "voxblox_planning_common/layer_query_cache.h"
+
+namespace mav_planning {
+
+// DistanceSource (see mav_planning_common/distance_source.h) on an ESDF map.
+// Same lookups the planners' getMapDistance() callbacks always did: 0 in
+// unknown space, and every position counts as one distance query. Gradients
+// are zero wherever the lookup fails. Everything
+// is inline, so it's only as fast as it should be when used directly, not
+// through a std::function.
+//
+// Lookups without interpolation go through a LayerQueryCache instead of the
+// layer's block hash map: one per batch, and one per thread for single
+// lookups inside a MapQueryScope. Their gradients are central differences
+// over the neighboring voxels, like the map's own. Interpolated lookups go
+// through the map as before.
+class EsdfDistanceSource {
+ public:
+  EsdfDistanceSource() : esdf_map_(nullptr), interpolate_(false) {}
+  explicit EsdfDistanceSource(const voxblox::EsdfMap* esdf_map)
+      : esdf_map_(CHECK_NOTNULL(esdf_map)), interpolate_(false) {}
+
+  // Owned by someone else.
+  void setEsdfMap(const voxblox::EsdfMap* esdf_map) {
+    esdf_map_ = CHECK_NOTNULL(esdf_map);
+  }
+  const voxblox::EsdfMap* getEsdfMap() const { return esdf_map_; }
+
+  // Off by default, like in the local planners.
+  bool getInterpolate() const { return interpolate_; }
+  void setInterpolate(bool interpolate) { interpolate_ = interpolate; }
+
+  double getDistance(const Eigen::Vector3d& position) const {
+    ++getPlanningCounters().distance_queries;
+    if (!interpolate_ && MapQueryScope::isActive()) {
+      return lookUpNearestDistance(position, getThreadCache());
+    }
+    return lookUpDistance(position);
+  }
+
+  double getDistanceAndGradient(const Eigen::Vector3d& position,
+                                Eigen::Vector3d* gradient) const {
+    ++getPlanningCounters().distance_queries;
+    if (!interpolate_ && MapQueryScope::isActive()) {
+      return lookUpNearestDistanceAndGradient(position, gradient,
+                                              getThreadCache());
+    }
+    return lookUpDistanceAndGradient(position, gradient);
+  }
+
+  void getDistances(const std::vector<Eigen::Vector3d>& positions,
+                    std::vector<double>* distances) const {
+    CHECK_NOTNULL(distances);
+    getPlanningCounters().distance_queries += positions.size();
+    distances->resize(positions.size());
+    if (interpolate_) {
+      for (size_t i = 0; i < positions.size(); ++i) {
+        (*distances)[i] = lookUpDistance(positions[i]);
+      }
+      return;
+    }
+    LayerQueryCache<voxblox::EsdfVoxel> cache(&esdf_map_->getEsdfLayer());
+    for (size_t i = 0; i < positions.size(); ++i) {
+      (*distances)[i] = lookUpNearestDistance(positions[i], &cache);
+    }
+  }
+
+  void getDistancesAndGradients(const std::vector<Eigen::Vector3d>& positions,
+                                std::vector<double>* distances,
+                                std::vector<Eigen::Vector3d>* gradients) const {
+    if (gradients == nullptr) {
+      getDistances(positions, distances);
+      return;
+    }
+    CHECK_NOTNULL(distances);
+    getPlanningCounters().distance_queries += positions.size();
+    distances->resize(positions.size());
+    gradients->resize(positions.size());
+    if (interpolate_) {
+      for (size_t i = 0; i < positions.size(); ++i) {
+        (*distances)[i] =
+            lookUpDistanceAndGradient(positions[i], &(*gradients)[i]);
+      }
+      return;
+    }
+    LayerQueryCache<voxblox::EsdfVoxel> cache(&esdf_map_->getEsdfLayer());
+    for (size_t i = 0; i < positions.size(); ++i) {
+      (*distances)[i] = lookUpNearestDistanceAndGradient(
+          positions[i], &(*gradients)[i], &cache);
+    }
+  }
+
+ private:
+  double lookUpDistance(const Eigen::Vector3d& position) const {
+    double distance = 0.0;
+    if (!esdf_map_->getDistanceAtPosition(position, interpolate_,
+                                          &distance)) {
+      return 0.0;
+    }
+    return distance;
+  }
+
+  double lookUpDistanceAndGradient(const Eigen::Vector3d& position,
+                                   Eigen::Vector3d* gradient) const {
+    if (gradient == nullptr) {
+      return lookUpDistance(position);
+    }
+    double distance = 0.0;
+    if (!esdf_map_->getDistanceAndGradientAtPosition(position, interpolate_,
+                                                     &distance, gradient)) {
+      gradient->setZero();
+      return 0.0;
+    }
+    return distance;
+  }
+
+  // Same as EsdfMap::getDistanceAtPosition() without interpolation.
+  double lookUpNearestDistance(
+      const Eigen::Vector3d& position,
+      LayerQueryCache<voxblox::EsdfVoxel>* cache) const {
+    voxblox::FloatingPoint distance = 0.0;
+    if (!getObservedDistance(position.cast<voxblox::FloatingPoint>(), cache,
+                             &distance)) {
+      return 0.0;
+    }
+    return static_cast<double>(distance);
+  }
+
+  // Same as EsdfMap::getDistanceAndGradientAtPosition() without
+  // interpolation.
+  double lookUpNearestDistanceAndGradient(
+      const Eigen::Vector3d& position, Eigen::Vector3d* gradient,
+      LayerQueryCache<voxblox::EsdfVoxel>* cache) const {
+    if (gradient == nullptr) {
+      return lookUpNearestDistance(position, cache);
+    }
+    const voxblox::Point point = position.cast<voxblox::FloatingPoint>();
+    const voxblox::FloatingPoint voxel_size = esdf_map_->voxel_size();
+    voxblox::FloatingPoint distance = 0.0;
+    voxblox::Point gradient_fp = voxblox::Point::Zero();
+    bool success = getObservedDistance(point, cache, &distance);
+    for (int i = 0; i < 3 && success; ++i) {
+      voxblox::Point offset = voxblox::Point::Zero();
+      offset(i) = voxel_size;
+      voxblox::FloatingPoint before = 0.0;
+      voxblox::FloatingPoint after = 0.0;
+      success = getObservedDistance(point - offset, cache, &before) &&
+                getObservedDistance(point + offset, cache, &after);
+      gradient_fp(i) = (after - before) / (2 * voxel_size);
+    }
+    if (!success) {
+      gradient->setZero();
+      return 0.0;
+    }
+    *gradient = gradient_fp.cast<double>();
+    return static_cast<double>(distance);
+  }
+
+  bool getObservedDistance(const voxblox::Point& point,
+                           LayerQueryCache<voxblox::EsdfVoxel>* cache,
+                           voxblox::FloatingPoint* distance) const {
+    const voxblox::EsdfVoxel* voxel = cache->getVoxelPtrByCoordinates(point);
+    if (voxel == nullptr || !voxel->observed) {
+      return false;
+    }
+    *distance = voxel->distance;
+    return true;
+  }
+
+  // Starts over whenever the layer or the outermost scope changes.
+  LayerQueryCache<voxblox::EsdfVoxel>* getThreadCache() const {
+    static thread_local LayerQueryCache<voxblox::EsdfVoxel> cache;
+    static thread_local size_t generation = 0;
+    const voxblox::Layer<voxblox::EsdfVoxel>* layer =
+        &esdf_map_->getEsdfLayer();
+    if (cache.getLayer() != layer ||
+        generation != MapQueryScope::getGeneration()) {
+      cache.setLayer(layer);
+      generation = MapQueryScope::getGeneration();
+    }
+    return &cache;
+  }
+
+  const voxblox::EsdfMap* esdf_map_;
+  bool interpolate_;
+};
+
+}  // namespace mav_planning
+
+#endif  // VOXBLOX_PLANNING_COMMON_ESDF_DISTANCE_SOURCE_H_
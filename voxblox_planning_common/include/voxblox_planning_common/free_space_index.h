@@ -0,0 +1,104 @@
+#ifndef VOXBLOX_PLANNING_COMMON_FREE_SPACE_INDEX_H_
+#define VOXBLOX_PLANNING_COMMON_FREE_SPACE_INDEX_H_
+
+#include <vector>
+
+#include <mav_planning_common/utils.h>
+#include <voxblox/core/common.h>
+#include <voxblox/core/layer.h>
+#include <voxblox/core/voxel.h>
+
+namespace mav_planning {
+
+// Keeps a list of observed-free voxel centers per TSDF block, so that a
+// guaranteed-free point can be drawn uniformly from the observed free space
+// within a sphere. Blocks in the sphere are put into an alias table weighted
+// by their free voxel count, so after setQuerySphere() every sample is O(1).
+class FreeSpaceIndex {
+ public:
+  FreeSpaceIndex();
+
+  // Bind the TSDF layer to one OWNED BY ANOTHER OBJECT. It is up to the user
+  // to ensure the layer exists and does not go out of scope. Clears the index.
+  void setTsdfLayer(const voxblox::Layer<voxblox::TsdfVoxel>* tsdf_layer);
+
+  // Re-scan the given blocks. Blocks that are no longer allocated or have no
+  // free voxels are dropped from the index.
+  void updateBlock(const voxblox::BlockIndex& block_index);
+  void updateBlocks(const voxblox::BlockIndexList& block_indices);
+  // Re-scan every allocated block in the layer.
+  void updateAllBlocks();
+  // Re-scan every allocated block, but only re-index the blocks whose set of
+  // free voxels changed, and drop blocks that are no longer allocated. A
+  // query stays valid if nothing changed. Doesn't rely on (or touch) the
+  // layer's update flags, which other consumers of the layer may clear at
+  // any time.
+  void updateChangedBlocks();
+  void clear();
+
+  // Total number of free voxels currently indexed.
+  size_t getNumFreeVoxels() const { return num_free_voxels_; }
+
+  // Builds the alias table over all indexed free voxels within radius of the
+  // center. Returns false if there are none. Any update to the index
+  // invalidates the query, and it has to be set again.
+  bool setQuerySphere(const voxblox::Point& center,
+                      voxblox::FloatingPoint radius);
+  bool hasQuery() const { return query_valid_; }
+  bool isQuerySphere(const voxblox::Point& center,
+                     voxblox::FloatingPoint radius) const;
+
+  // Draws a point uniformly from the free voxels in the query sphere (jittered
+  // within the voxel, but never out of the sphere). Uses randMToN, so seed
+  // with seedRandom().
+  bool sampleFreePoint(voxblox::Point* sample) const;
+
+ private:
+  // One bit per voxel of a block, set for the free ones.
+  typedef std::vector<uint64_t> FreeMask;
+  typedef voxblox::AnyIndexHashMapType<voxblox::Pointcloud>::type
+      BlockToFreePointsMap;
+  typedef voxblox::AnyIndexHashMapType<FreeMask>::type BlockToFreeMaskMap;
+
+  bool isVoxelFree(const voxblox::TsdfVoxel& voxel) const;
+  void getFreeMask(const voxblox::Block<voxblox::TsdfVoxel>& block,
+                   FreeMask* free_mask) const;
+  void addIndexedBlock(const voxblox::BlockIndex& block_index,
+                       const voxblox::Block<voxblox::TsdfVoxel>& block,
+                       const FreeMask& free_mask);
+  void removeIndexedBlock(const voxblox::BlockIndex& block_index);
+  void buildAliasTable(const std::vector<double>& weights);
+  size_t sampleAliasTable() const;
+
+  // NON-OWNED pointer to the tsdf layer.
+  const voxblox::Layer<voxblox::TsdfVoxel>* tsdf_layer_;
+
+  // Cached parameters of the layer.
+  voxblox::FloatingPoint voxel_size_;
+  voxblox::FloatingPoint block_size_;
+  voxblox::FloatingPoint block_size_inv_;
+
+  // Free voxel centers per block, and which voxels they came from, for
+  // telling whether a block changed. Only blocks with free voxels are in
+  // either.
+  BlockToFreePointsMap free_points_;
+  BlockToFreeMaskMap free_masks_;
+  size_t num_free_voxels_;
+
+  // Current query. Bins point either into free_points_ (blocks fully inside
+  // the sphere) or into boundary_points_ (filtered copies of blocks on the
+  // sphere boundary).
+  bool query_valid_;
+  voxblox::Point query_center_;
+  voxblox::FloatingPoint query_radius_;
+  std::vector<const voxblox::Pointcloud*> query_bins_;
+  std::vector<voxblox::Pointcloud> boundary_points_;
+
+  // Alias table (Vose) over the query bins.
+  std::vector<double> alias_prob_;
+  std::vector<size_t> alias_index_;
+};
+
+}  // namespace mav_planning
+
+#endif  // VOXBLOX_PLANNING_COMMON_FREE_SPACE_INDEX_H_
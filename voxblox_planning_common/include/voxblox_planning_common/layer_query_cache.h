@@ -0,0 +1,96 @@
+#ifndef VOXBLOX_PLANNING_COMMON_LAYER_QUERY_CACHE_H_
+#define VOXBLOX_PLANNING_COMMON_LAYER_QUERY_CACHE_H_
+
+#include <voxblox/core/block.h>
+#include <voxblox/core/common.h>
+#include <voxblox/core/layer.h>
+
+namespace mav_planning {
+
+// Looks up blocks and voxels of a layer like the layer does, but remembers
+// the last blocks it found, so that spatially coherent queries (along a line
+// or a trajectory) mostly skip the layer's block hash map. Direct-mapped on
+// the block index, so any 2x2x2 group of blocks fits at once. Unallocated
+// blocks are remembered too.
+//
+// Not thread safe, meant to live on the stack of a query loop or in a
+// thread_local. Holds on to the blocks it remembers, so a block removed from
+// the layer stays readable (with its old contents) until clear().
+template <typename VoxelType>
+class LayerQueryCache {
+ public:
+  typedef voxblox::Block<VoxelType> BlockType;
+  static constexpr size_t kNumBlocks = 8u;
+
+  LayerQueryCache() : layer_(nullptr), num_hits_(0u), num_misses_(0u) {}
+  explicit LayerQueryCache(const voxblox::Layer<VoxelType>* layer)
+      : LayerQueryCache() {
+    setLayer(layer);
+  }
+
+  // Owned by someone else. Also forgets all blocks.
+  void setLayer(const voxblox::Layer<VoxelType>* layer) {
+    layer_ = CHECK_NOTNULL(layer);
+    clear();
+  }
+  const voxblox::Layer<VoxelType>* getLayer() const { return layer_; }
+
+  void clear() {
+    for (Entry& entry : entries_) {
+      entry.valid = false;
+      entry.block.reset();
+    }
+  }
+
+  const BlockType* getBlockPtrByIndex(const voxblox::BlockIndex& block_index) {
+    Entry& entry = entries_[getSlot(block_index)];
+    if (entry.valid && entry.block_index == block_index) {
+      ++num_hits_;
+      return entry.block.get();
+    }
+    ++num_misses_;
+    entry.valid = true;
+    entry.block_index = block_index;
+    entry.block = layer_->getBlockPtrByIndex(block_index);
+    return entry.block.get();
+  }
+
+  const BlockType* getBlockPtrByCoordinates(const voxblox::Point& coords) {
+    return getBlockPtrByIndex(layer_->computeBlockIndexFromCoordinates(coords));
+  }
+
+  const VoxelType* getVoxelPtrByCoordinates(const voxblox::Point& coords) {
+    const BlockType* block = getBlockPtrByCoordinates(coords);
+    if (block == nullptr) {
+      return nullptr;
+    }
+    return &block->getVoxelByCoordinates(coords);
+  }
+
+  // Every lookup is either; misses are the ones that went to the layer.
+  size_t getNumHits() const { return num_hits_; }
+  size_t getNumMisses() const { return num_misses_; }
+
+ private:
+  struct Entry {
+    bool valid = false;
+    voxblox::BlockIndex block_index;
+    typename BlockType::ConstPtr block;
+  };
+
+  static size_t getSlot(const voxblox::BlockIndex& block_index) {
+    return static_cast<size_t>(block_index.x() + 2 * block_index.y() +
+                               4 * block_index.z()) &
+           (kNumBlocks - 1u);
+  }
+
+  const voxblox::Layer<VoxelType>* layer_;
+  Entry entries_[kNumBlocks];
+
+  size_t num_hits_;
+  size_t num_misses_;
+};
+
+}  // namespace mav_planning
+
+#endif  // VOXBLOX_PLANNING_COMMON_LAYER_QUERY_CACHE_H_
@@ -1,25 +1,48 @@
 #ifndef VOXBLOX_PLANNING_COMMON_PATH_SHORTENING_H_
 #define VOXBLOX_PLANNING_COMMON_PATH_SHORTENING_H_
 
-#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <mav_msgs/eigen_mav_msgs.h>
 #include <mav_planning_common/physical_constraints.h>
+#include <ros/node_handle.h>
 #include <voxblox/core/layer.h>
 #include <voxblox/core/voxel.h>
 
+#include "voxblox_planning_common/esdf_distance_pyramid.h"
+
 namespace mav_planning {
 
 class EsdfPathShortener {
  public:
-  typedef std::list<mav_msgs::EigenTrajectoryPoint,
-                    Eigen::aligned_allocator<mav_msgs::EigenTrajectoryPoint>>
-      EigenTrajectoryPointList;
+  enum ShorteningMethod {
+    // Recursively bisect the path, shortcutting any sub-range whose start
+    // and end see each other. Repeated until nothing changes.
+    kBisection = 0,
+    // Single pass: from each kept waypoint, jump to the farthest later
+    // waypoint that's visible, found by exponential + binary search.
+    kGreedy
+  };
 
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
   EsdfPathShortener();
 
+  void setParametersFromRos(const ros::NodeHandle& nh) { setParameters(nh); }
+  // Same, from anything with a ros::NodeHandle-style param(key, value,
+  // default).
+  template <typename ParamSource>
+  void setParameters(const ParamSource& params) {
+    std::string method = shorteningMethodToString(method_);
+    params.param("shortening_method", method, method);
+    if (!shorteningMethodFromString(method, &method_)) {
+      LOG(ERROR) << "[Path Shortener] Invalid shortening method: " << method;
+    }
+    params.param("shortening_num_threads", num_threads_, num_threads_);
+  }
+
   void setConstraints(const PhysicalConstraints& constraints) {
     constraints_ = constraints;
   }
@@ -29,24 +52,68 @@ class EsdfPathShortener {
       voxel_size_ = esdf_layer_->voxel_size();
     }
   }
+  // Optional, OWNED BY ANOTHER OBJECT and kept up to date with the ESDF layer
+  // by it. Lets line checks skip through open space block by block.
+  void setDistancePyramid(const EsdfDistancePyramid* distance_pyramid) {
+    distance_pyramid_ = distance_pyramid;
+  }
+
+  // How many threads to shorten independent parts of the path on. 0 means
+  // use all hardware threads, 1 is fully serial.
+  void setNumThreads(int num_threads) { num_threads_ = num_threads; }
+
+  void setShorteningMethod(ShorteningMethod method) { method_ = method; }
+  ShorteningMethod getShorteningMethod() const { return method_; }
+
+  // Names as used in the params: "bisection" and "greedy".
+  static std::string shorteningMethodToString(ShorteningMethod method);
+  static bool shorteningMethodFromString(const std::string& name,
+                                         ShorteningMethod* method);
 
   bool shortenPath(const mav_msgs::EigenTrajectoryPointVector& path,
                    mav_msgs::EigenTrajectoryPointVector* shortened_path) const;
 
-  bool shortenPathList(const EigenTrajectoryPointList::iterator& start_iter,
-                       const EigenTrajectoryPointList::iterator& end_iter,
-                       EigenTrajectoryPointList* path_list) const;
-
   bool isLineInCollision(const Eigen::Vector3d& start,
                          const Eigen::Vector3d& end) const;
 
  private:
+  bool shortenPathBisection(
+      const mav_msgs::EigenTrajectoryPointVector& path,
+      mav_msgs::EigenTrajectoryPointVector* shortened_path) const;
+  bool shortenPathGreedy(
+      const mav_msgs::EigenTrajectoryPointVector& path,
+      mav_msgs::EigenTrajectoryPointVector* shortened_path) const;
+
+  // Index of the farthest waypoint after anchor that can be reached in a
+  // straight line. Visibility isn't monotonic along the path, so this is
+  // the farthest one the search finds, not necessarily the farthest overall.
+  size_t findFarthestVisible(const mav_msgs::EigenTrajectoryPointVector& path,
+                             size_t anchor) const;
+
+  // Line check results between two indices of the input path, so the same
+  // lines are not checked again in later rounds.
+  typedef std::unordered_map<size_t, bool> LineCollisionCache;
+
+  // Shortens the path between indices[first] and indices[last] (inclusive),
+  // leaving those two the same. Clears keep for all removed points. Reads old
+  // line checks from cache and writes new ones to new_checks.
+  bool shortenPathRange(const mav_msgs::EigenTrajectoryPointVector& path,
+                        const std::vector<size_t>& indices, size_t first,
+                        size_t last, int parallel_depth,
+                        const LineCollisionCache& cache,
+                        LineCollisionCache* new_checks,
+                        std::vector<char>* keep) const;
+
   PhysicalConstraints constraints_;
 
   voxblox::Layer<voxblox::EsdfVoxel>* esdf_layer_;
+  const EsdfDistancePyramid* distance_pyramid_;
 
   // Cache the voxel size, as a double.
   double voxel_size_;
+
+  ShorteningMethod method_;
+  int num_threads_;
 };
 
 }  // namespace mav_planning
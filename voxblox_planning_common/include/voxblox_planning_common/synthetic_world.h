@@ -0,0 +1,151 @@
+#ifndef VOXBLOX_PLANNING_COMMON_SYNTHETIC_WORLD_H_
+#define VOXBLOX_PLANNING_COMMON_SYNTHETIC_WORLD_H_
+
+#include <string>
+
+#include <glog/logging.h>
+#include <voxblox/core/layer.h>
+#include <voxblox/core/voxel.h>
+#include <voxblox/simulation/simulation_world.h>
+
+namespace mav_planning {
+
+// A procedurally generated world. All the randomness comes from the seed, so
+// the same spec always gives the same world, on any machine, and generated
+// maps can be cached by getHash().
+struct SyntheticWorldSpec {
+  enum WorldType {
+    // Cylinders of random size and position on the floor.
+    kForest = 0,
+    // A grid of rooms with a door in every wall, some walls left out.
+    kRooms,
+    // Parallel corridors joined at alternating ends, one long snake.
+    kCorridors
+  };
+
+  WorldType type = kForest;
+  int seed = 0;
+  // The world goes from the origin to size, and is closed off by walls on
+  // the sides and a floor. The height is also the height of walls and the
+  // tallest obstacle.
+  Eigen::Vector3d size = Eigen::Vector3d(15.0, 15.0, 5.0);
+  bool add_ceiling = false;
+
+  // Forest: cylinders per square meter, only placed at least free_border_m
+  // from the sides.
+  double density = 0.1;
+  double free_border_m = 4.0;
+  double min_radius_m = 0.25;
+  double max_radius_m = 1.0;
+  double min_height_m = 2.0;
+
+  // Rooms and corridors.
+  double room_size_m = 5.0;
+  double corridor_width_m = 2.0;
+  double wall_thickness_m = 0.3;
+  double door_width_m = 1.2;
+  // Chance that a wall between two rooms is left out entirely.
+  double corridor_probability = 0.2;
+  // Rooms: random boxes and cylinders in every room, away from the walls.
+  int obstacles_per_room = 0;
+
+  // Generated map.
+  double voxel_size = 0.1;
+  int voxels_per_side = 16;
+  // TSDF distances are clamped to this, 0 is 4 voxels.
+  double truncation_distance_m = 0.0;
+  double esdf_max_distance_m = 5.0;
+
+  template <typename ParamSource>
+  void setParameters(const ParamSource& params) {
+    std::string type_name = worldTypeToString(type);
+    params.param("world_type", type_name, type_name);
+    if (!worldTypeFromString(type_name, &type)) {
+      LOG(ERROR) << "Unknown world type: " << type_name << ", using "
+                 << worldTypeToString(type);
+    }
+    params.param("world_seed", seed, seed);
+    params.param("world_size_x", size.x(), size.x());
+    params.param("world_size_y", size.y(), size.y());
+    params.param("world_size_z", size.z(), size.z());
+    params.param("world_add_ceiling", add_ceiling, add_ceiling);
+    params.param("world_density", density, density);
+    params.param("world_free_border", free_border_m, free_border_m);
+    params.param("world_min_radius", min_radius_m, min_radius_m);
+    params.param("world_max_radius", max_radius_m, max_radius_m);
+    params.param("world_min_height", min_height_m, min_height_m);
+    params.param("world_room_size", room_size_m, room_size_m);
+    params.param("world_corridor_width", corridor_width_m, corridor_width_m);
+    params.param("world_wall_thickness", wall_thickness_m, wall_thickness_m);
+    params.param("world_door_width", door_width_m, door_width_m);
+    params.param("world_corridor_probability", corridor_probability,
+                 corridor_probability);
+    params.param("world_obstacles_per_room", obstacles_per_room,
+                 obstacles_per_room);
+    params.param("world_voxel_size", voxel_size, voxel_size);
+    params.param("world_voxels_per_side", voxels_per_side, voxels_per_side);
+    params.param("world_truncation_distance", truncation_distance_m,
+                 truncation_distance_m);
+    params.param("world_esdf_max_distance", esdf_max_distance_m,
+                 esdf_max_distance_m);
+  }
+
+  double getTruncationDistance() const;
+
+  // Every setting, in a fixed format. Two specs give the same world if and
+  // only if these are equal.
+  std::string toString() const;
+  // Stable across runs and machines (unlike std::hash), for cache file names.
+  std::string getHash() const;
+
+  static std::string worldTypeToString(WorldType type);
+  static bool worldTypeFromString(const std::string& name, WorldType* type);
+};
+
+// Adds all the objects of the world, i.e. to simulate a sensor in it.
+void addSyntheticWorldObjects(const SyntheticWorldSpec& spec,
+                              voxblox::SimulationWorld* world);
+
+// Builds ground truth maps of synthetic worlds directly: every voxel in the
+// world bounds gets its distance to the closest object, computed in parallel,
+// without going through a sensor, integrator or ROS. With a cache directory
+// set, maps are saved there by spec hash and loaded back the next time.
+class SyntheticWorldGenerator {
+ public:
+  SyntheticWorldGenerator();
+
+  // Empty (the default) disables caching. Created if it doesn't exist.
+  void setCacheDirectory(const std::string& cache_directory) {
+    cache_directory_ = cache_directory;
+  }
+  const std::string& getCacheDirectory() const { return cache_directory_; }
+
+  // 0 uses one per core.
+  void setNumThreads(int num_threads) { num_threads_ = num_threads; }
+  int getNumThreads() const { return num_threads_; }
+
+  void generate(const SyntheticWorldSpec& spec,
+                voxblox::Layer<voxblox::TsdfVoxel>::Ptr* tsdf_layer,
+                voxblox::Layer<voxblox::EsdfVoxel>::Ptr* esdf_layer);
+
+  // Whether the last generate() call loaded the maps from the cache.
+  bool wasLoadedFromCache() const { return loaded_from_cache_; }
+
+ private:
+  std::string getCachePath(const SyntheticWorldSpec& spec) const;
+  bool loadFromCache(const SyntheticWorldSpec& spec,
+                     voxblox::Layer<voxblox::TsdfVoxel>::Ptr* tsdf_layer,
+                     voxblox::Layer<voxblox::EsdfVoxel>::Ptr* esdf_layer) const;
+  void saveToCache(const SyntheticWorldSpec& spec,
+                   const voxblox::Layer<voxblox::TsdfVoxel>& tsdf_layer,
+                   const voxblox::Layer<voxblox::EsdfVoxel>& esdf_layer) const;
+
+  std::string cache_directory_;
+  int num_threads_;
+
+  bool loaded_from_cache_;
+};
+
+}  // namespace mav_planning
+
+#endif  // VOXBLOX_PLANNING_COMMON_SYNTHETIC_WORLD_H_
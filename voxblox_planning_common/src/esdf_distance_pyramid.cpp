@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include "voxblox_planning_common/esdf_distance_pyramid.h"
+
+namespace mav_planning {
+
+namespace {
+
+// Less than any distance, for blocks and groups that aren't free at all.
+constexpr voxblox::FloatingPoint kNotFree =
+    -std::numeric_limits<voxblox::FloatingPoint>::max();
+
+// Integer division rounding down, also for negative indices.
+template <typename IndexElement>
+IndexElement floorDivide(IndexElement index, IndexElement divisor) {
+  return (index >= 0 ? index : index - divisor + 1) / divisor;
+}
+
+}  // namespace
+
+EsdfDistancePyramid::EsdfDistancePyramid()
+    : esdf_layer_(nullptr),
+      voxel_size_(0.0f),
+      block_size_(0.0f),
+      block_size_inv_(0.0f),
+      voxels_per_side_(0),
+      levels_(kNumLevels) {}
+
+void EsdfDistancePyramid::setEsdfLayer(
+    const voxblox::Layer<voxblox::EsdfVoxel>* esdf_layer) {
+  esdf_layer_ = esdf_layer;
+  clear();
+  if (esdf_layer_ == nullptr) {
+    return;
+  }
+  voxel_size_ = esdf_layer_->voxel_size();
+  block_size_ = esdf_layer_->block_size();
+  block_size_inv_ = 1.0 / block_size_;
+  voxels_per_side_ = static_cast<int>(esdf_layer_->voxels_per_side());
+}
+
+void EsdfDistancePyramid::clear() {
+  for (LevelMap& level : levels_) {
+    level.clear();
+  }
+}
+
+voxblox::BlockIndex EsdfDistancePyramid::getParentIndex(
+    const voxblox::BlockIndex& block_index) {
+  return voxblox::BlockIndex(floorDivide(block_index.x(), 2),
+                             floorDivide(block_index.y(), 2),
+                             floorDivide(block_index.z(), 2));
+}
+
+voxblox::FloatingPoint EsdfDistancePyramid::getMinDistance(
+    int level, const voxblox::BlockIndex& index) const {
+  LevelMap::const_iterator it = levels_[level].find(index);
+  if (it == levels_[level].end()) {
+    return kNotFree;
+  }
+  return it->second;
+}
+
+bool EsdfDistancePyramid::updateLevelZero(
+    const voxblox::BlockIndex& block_index) {
+  const voxblox::Block<voxblox::EsdfVoxel>::ConstPtr block_ptr =
+      esdf_layer_->getBlockPtrByIndex(block_index);
+  if (!block_ptr) {
+    return levels_[0].erase(block_index) > 0u;
+  }
+
+  voxblox::FloatingPoint min_distance =
+      std::numeric_limits<voxblox::FloatingPoint>::max();
+  const size_t num_voxels_per_block = block_ptr->num_voxels();
+  for (size_t lin_index = 0u; lin_index < num_voxels_per_block; ++lin_index) {
+    const voxblox::EsdfVoxel& voxel =
+        block_ptr->getVoxelByLinearIndex(lin_index);
+    min_distance = std::min(min_distance, voxel.observed ? voxel.distance
+                                                         : 0.0f);
+  }
+  std::pair<LevelMap::iterator, bool> inserted =
+      levels_[0].emplace(block_index, min_distance);
+  if (inserted.second) {
+    return true;
+  }
+  if (inserted.first->second == min_distance) {
+    return false;
+  }
+  inserted.first->second = min_distance;
+  return true;
+}
+
+void EsdfDistancePyramid::updateGroup(int level,
+                                      const voxblox::BlockIndex& group_index) {
+  voxblox::FloatingPoint min_distance =
+      std::numeric_limits<voxblox::FloatingPoint>::max();
+  bool any_child = false;
+  const voxblox::BlockIndex first_child = 2 * group_index;
+  voxblox::BlockIndex offset;
+  for (offset.x() = 0; offset.x() < 2; ++offset.x()) {
+    for (offset.y() = 0; offset.y() < 2; ++offset.y()) {
+      for (offset.z() = 0; offset.z() < 2; ++offset.z()) {
+        LevelMap::const_iterator it =
+            levels_[level - 1].find(first_child + offset);
+        if (it == levels_[level - 1].end()) {
+          min_distance = kNotFree;
+          continue;
+        }
+        any_child = true;
+        min_distance = std::min(min_distance, it->second);
+      }
+    }
+  }
+
+  if (!any_child) {
+    levels_[level].erase(group_index);
+    return;
+  }
+  levels_[level][group_index] = min_distance;
+}
+
+void EsdfDistancePyramid::updateGroupsAbove(
+    const voxblox::BlockIndex& block_index) {
+  voxblox::BlockIndex group_index = block_index;
+  for (int level = 1; level < kNumLevels; ++level) {
+    group_index = getParentIndex(group_index);
+    updateGroup(level, group_index);
+  }
+}
+
+void EsdfDistancePyramid::updateBlock(const voxblox::BlockIndex& block_index) {
+  CHECK_NOTNULL(esdf_layer_);
+  updateLevelZero(block_index);
+  updateGroupsAbove(block_index);
+}
+
+void EsdfDistancePyramid::updateBlocks(
+    const voxblox::BlockIndexList& block_indices) {
+  for (const voxblox::BlockIndex& block_index : block_indices) {
+    updateBlock(block_index);
+  }
+}
+
+void EsdfDistancePyramid::updateAllBlocks() {
+  CHECK_NOTNULL(esdf_layer_);
+  clear();
+
+  voxblox::BlockIndexList blocks;
+  esdf_layer_->getAllAllocatedBlocks(&blocks);
+  updateBlocks(blocks);
+}
+
+void EsdfDistancePyramid::updateChangedBlocks() {
+  CHECK_NOTNULL(esdf_layer_);
+  voxblox::BlockIndexList changed_blocks;
+  for (const std::pair<const voxblox::BlockIndex, voxblox::FloatingPoint>&
+           kv : levels_[0]) {
+    if (!esdf_layer_->hasBlock(kv.first)) {
+      changed_blocks.push_back(kv.first);
+    }
+  }
+  for (const voxblox::BlockIndex& block_index : changed_blocks) {
+    levels_[0].erase(block_index);
+  }
+
+  // Reading every voxel is as cheap as comparing them against a copy, and the
+  // minimum is all the pyramid keeps of a block anyway.
+  voxblox::BlockIndexList blocks;
+  esdf_layer_->getAllAllocatedBlocks(&blocks);
+  for (const voxblox::BlockIndex& block_index : blocks) {
+    if (updateLevelZero(block_index)) {
+      changed_blocks.push_back(block_index);
+    }
+  }
+
+  for (const voxblox::BlockIndex& block_index : changed_blocks) {
+    updateGroupsAbove(block_index);
+  }
+}
+
+bool EsdfDistancePyramid::getFreeBlockRegion(
+    const voxblox::BlockIndex& block_index,
+    voxblox::FloatingPoint min_distance, voxblox::BlockIndex* region_min,
+    voxblox::BlockIndex* region_max) const {
+  CHECK_NOTNULL(region_min);
+  CHECK_NOTNULL(region_max);
+  // A group is never more free than the blocks in it, so go up from the
+  // block until a level isn't free anymore.
+  if (getMinDistance(0, block_index) <= min_distance) {
+    return false;
+  }
+  *region_min = block_index;
+  *region_max = block_index;
+
+  voxblox::BlockIndex group_index = block_index;
+  for (int level = 1; level < kNumLevels; ++level) {
+    group_index = getParentIndex(group_index);
+    if (getMinDistance(level, group_index) <= min_distance) {
+      break;
+    }
+    const int group_size = 1 << level;
+    *region_min = group_index * group_size;
+    *region_max =
+        *region_min + voxblox::BlockIndex::Constant(group_size - 1);
+  }
+  return true;
+}
+
+bool EsdfDistancePyramid::getFreeVoxelRegion(
+    const voxblox::GlobalIndex& voxel_index,
+    voxblox::FloatingPoint min_distance, voxblox::GlobalIndex* region_min,
+    voxblox::GlobalIndex* region_max) const {
+  CHECK_NOTNULL(region_min);
+  CHECK_NOTNULL(region_max);
+  const voxblox::LongIndexElement voxels_per_side = voxels_per_side_;
+  const voxblox::BlockIndex block_index(
+      floorDivide(voxel_index.x(), voxels_per_side),
+      floorDivide(voxel_index.y(), voxels_per_side),
+      floorDivide(voxel_index.z(), voxels_per_side));
+
+  voxblox::BlockIndex block_min = block_index;
+  voxblox::BlockIndex block_max = block_index;
+  const bool free =
+      getFreeBlockRegion(block_index, min_distance, &block_min, &block_max);
+
+  *region_min = block_min.cast<voxblox::LongIndexElement>() * voxels_per_side;
+  *region_max =
+      (block_max.cast<voxblox::LongIndexElement>() +
+       voxblox::GlobalIndex::Ones()) *
+          voxels_per_side -
+      voxblox::GlobalIndex::Ones();
+  return free;
+}
+
+bool EsdfDistancePyramid::getFreeRegion(const Eigen::Vector3d& position,
+                                        double min_distance,
+                                        Eigen::AlignedBox3d* region) const {
+  CHECK_NOTNULL(region);
+  const voxblox::BlockIndex block_index =
+      voxblox::getGridIndexFromPoint<voxblox::BlockIndex>(
+          position.cast<voxblox::FloatingPoint>(), block_size_inv_);
+
+  voxblox::BlockIndex block_min = block_index;
+  voxblox::BlockIndex block_max = block_index;
+  const bool free = getFreeBlockRegion(
+      block_index, static_cast<voxblox::FloatingPoint>(min_distance),
+      &block_min, &block_max);
+
+  *region = Eigen::AlignedBox3d(
+      block_min.cast<double>() * block_size_,
+      (block_max + voxblox::BlockIndex::Ones()).cast<double>() * block_size_);
+  return free;
+}
+
+double EsdfDistancePyramid::getFreeLengthAlongRay(
+    const Eigen::Vector3d& start, const Eigen::Vector3d& direction,
+    double max_length, double min_distance) const {
+  // Past the end of one region, the next one is looked up this much further
+  // along, so that it isn't the same one again.
+  const double kStepPastRegion = 1e-3 * voxel_size_;
+
+  double length = 0.0;
+  Eigen::AlignedBox3d region;
+  while (length < max_length) {
+    const double lookup_length = length > 0.0 ? length + kStepPastRegion : 0.0;
+    if (!getFreeRegion(start + lookup_length * direction, min_distance,
+                       &region)) {
+      break;
+    }
+
+    double exit_length = max_length;
+    for (int i = 0; i < 3; ++i) {
+      if (direction(i) > 0.0) {
+        exit_length = std::min(
+            exit_length, (region.max()(i) - start(i)) / direction(i));
+      } else if (direction(i) < 0.0) {
+        exit_length = std::min(
+            exit_length, (region.min()(i) - start(i)) / direction(i));
+      }
+    }
+    if (exit_length <= length) {
+      break;
+    }
+    length = exit_length;
+  }
+  return std::min(length, max_length);
+}
+
+}  // namespace mav_planning
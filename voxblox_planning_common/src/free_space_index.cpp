@@ -0,0 +1,320 @@
+#include <algorithm>
+#include <utility>
+
+#include "voxblox_planning_common/free_space_index.h"
+
+namespace mav_planning {
+
+FreeSpaceIndex::FreeSpaceIndex()
+    : tsdf_layer_(nullptr),
+      voxel_size_(0.0f),
+      block_size_(0.0f),
+      block_size_inv_(0.0f),
+      num_free_voxels_(0u),
+      query_valid_(false),
+      query_radius_(0.0f) {}
+
+void FreeSpaceIndex::setTsdfLayer(
+    const voxblox::Layer<voxblox::TsdfVoxel>* tsdf_layer) {
+  tsdf_layer_ = tsdf_layer;
+  clear();
+  if (tsdf_layer_ == nullptr) {
+    return;
+  }
+  voxel_size_ = tsdf_layer_->voxel_size();
+  block_size_ = tsdf_layer_->block_size();
+  block_size_inv_ = 1.0 / block_size_;
+}
+
+void FreeSpaceIndex::clear() {
+  free_points_.clear();
+  free_masks_.clear();
+  num_free_voxels_ = 0u;
+  query_valid_ = false;
+}
+
+bool FreeSpaceIndex::isVoxelFree(const voxblox::TsdfVoxel& voxel) const {
+  // Same definition of free as the goal selector has always used.
+  return voxel.weight >= 1e-6 && voxel.distance > 0.0;
+}
+
+void FreeSpaceIndex::getFreeMask(
+    const voxblox::Block<voxblox::TsdfVoxel>& block,
+    FreeMask* free_mask) const {
+  const size_t num_voxels_per_block = block.num_voxels();
+  free_mask->assign((num_voxels_per_block + 63u) / 64u, 0u);
+  for (size_t lin_index = 0u; lin_index < num_voxels_per_block; ++lin_index) {
+    if (isVoxelFree(block.getVoxelByLinearIndex(lin_index))) {
+      (*free_mask)[lin_index / 64u] |= uint64_t(1) << (lin_index % 64u);
+    }
+  }
+}
+
+void FreeSpaceIndex::addIndexedBlock(
+    const voxblox::BlockIndex& block_index,
+    const voxblox::Block<voxblox::TsdfVoxel>& block,
+    const FreeMask& free_mask) {
+  voxblox::Pointcloud free_points;
+  const size_t num_voxels_per_block = block.num_voxels();
+  for (size_t lin_index = 0u; lin_index < num_voxels_per_block; ++lin_index) {
+    if (free_mask[lin_index / 64u] & (uint64_t(1) << (lin_index % 64u))) {
+      free_points.push_back(
+          block.computeCoordinatesFromLinearIndex(lin_index));
+    }
+  }
+
+  if (free_points.empty()) {
+    return;
+  }
+  query_valid_ = false;
+  num_free_voxels_ += free_points.size();
+  free_points_[block_index].swap(free_points);
+  free_masks_[block_index] = free_mask;
+}
+
+void FreeSpaceIndex::removeIndexedBlock(
+    const voxblox::BlockIndex& block_index) {
+  BlockToFreePointsMap::iterator it = free_points_.find(block_index);
+  if (it == free_points_.end()) {
+    return;
+  }
+  query_valid_ = false;
+  num_free_voxels_ -= it->second.size();
+  free_points_.erase(it);
+  free_masks_.erase(block_index);
+}
+
+void FreeSpaceIndex::updateBlock(const voxblox::BlockIndex& block_index) {
+  CHECK_NOTNULL(tsdf_layer_);
+  query_valid_ = false;
+  removeIndexedBlock(block_index);
+
+  const voxblox::Block<voxblox::TsdfVoxel>::ConstPtr block_ptr =
+      tsdf_layer_->getBlockPtrByIndex(block_index);
+  if (!block_ptr) {
+    return;
+  }
+  FreeMask free_mask;
+  getFreeMask(*block_ptr, &free_mask);
+  addIndexedBlock(block_index, *block_ptr, free_mask);
+}
+
+void FreeSpaceIndex::updateBlocks(
+    const voxblox::BlockIndexList& block_indices) {
+  for (const voxblox::BlockIndex& block_index : block_indices) {
+    updateBlock(block_index);
+  }
+}
+
+void FreeSpaceIndex::updateAllBlocks() {
+  CHECK_NOTNULL(tsdf_layer_);
+  clear();
+
+  voxblox::BlockIndexList blocks;
+  tsdf_layer_->getAllAllocatedBlocks(&blocks);
+  updateBlocks(blocks);
+}
+
+void FreeSpaceIndex::updateChangedBlocks() {
+  CHECK_NOTNULL(tsdf_layer_);
+  voxblox::BlockIndexList removed_blocks;
+  for (const std::pair<const voxblox::BlockIndex, voxblox::Pointcloud>& kv :
+       free_points_) {
+    if (!tsdf_layer_->hasBlock(kv.first)) {
+      removed_blocks.push_back(kv.first);
+    }
+  }
+  for (const voxblox::BlockIndex& block_index : removed_blocks) {
+    removeIndexedBlock(block_index);
+  }
+
+  voxblox::BlockIndexList blocks;
+  tsdf_layer_->getAllAllocatedBlocks(&blocks);
+  FreeMask free_mask;
+  for (const voxblox::BlockIndex& block_index : blocks) {
+    const voxblox::Block<voxblox::TsdfVoxel>::ConstPtr block_ptr =
+        tsdf_layer_->getBlockPtrByIndex(block_index);
+    getFreeMask(*block_ptr, &free_mask);
+
+    BlockToFreeMaskMap::const_iterator it = free_masks_.find(block_index);
+    if (it == free_masks_.end()) {
+      if (std::none_of(free_mask.begin(), free_mask.end(),
+                       [](uint64_t word) { return word != 0u; })) {
+        continue;
+      }
+    } else if (it->second == free_mask) {
+      continue;
+    }
+    removeIndexedBlock(block_index);
+    addIndexedBlock(block_index, *block_ptr, free_mask);
+  }
+}
+
+bool FreeSpaceIndex::isQuerySphere(const voxblox::Point& center,
+                                   voxblox::FloatingPoint radius) const {
+  return query_valid_ && query_center_ == center && query_radius_ == radius;
+}
+
+bool FreeSpaceIndex::setQuerySphere(const voxblox::Point& center,
+                                    voxblox::FloatingPoint radius) {
+  query_valid_ = false;
+  query_center_ = center;
+  query_radius_ = radius;
+  query_bins_.clear();
+  boundary_points_.clear();
+
+  if (free_points_.empty()) {
+    return false;
+  }
+
+  const voxblox::FloatingPoint radius_sq = radius * radius;
+  const voxblox::Point half_block =
+      voxblox::Point::Constant(block_size_ / 2.0);
+
+  // Go over the block index range of the sphere's AABB, rather than over all
+  // indexed blocks.
+  const voxblox::BlockIndex min_index =
+      voxblox::getGridIndexFromPoint<voxblox::BlockIndex>(
+          center - voxblox::Point::Constant(radius), block_size_inv_);
+  const voxblox::BlockIndex max_index =
+      voxblox::getGridIndexFromPoint<voxblox::BlockIndex>(
+          center + voxblox::Point::Constant(radius), block_size_inv_);
+
+  std::vector<double> weights;
+  voxblox::BlockIndex block_index;
+  for (block_index.x() = min_index.x(); block_index.x() <= max_index.x();
+       ++block_index.x()) {
+    for (block_index.y() = min_index.y(); block_index.y() <= max_index.y();
+         ++block_index.y()) {
+      for (block_index.z() = min_index.z(); block_index.z() <= max_index.z();
+           ++block_index.z()) {
+        BlockToFreePointsMap::const_iterator it =
+            free_points_.find(block_index);
+        if (it == free_points_.end()) {
+          continue;
+        }
+        // Distance from the sphere center to the nearest and farthest point
+        // of the block.
+        const voxblox::Point block_center =
+            voxblox::getCenterPointFromGridIndex(block_index, block_size_);
+        const voxblox::Point offset = (center - block_center).cwiseAbs();
+        const voxblox::FloatingPoint nearest_sq =
+            (offset - half_block).cwiseMax(0.0f).squaredNorm();
+        const voxblox::FloatingPoint farthest_sq =
+            (offset + half_block).squaredNorm();
+
+        if (nearest_sq > radius_sq) {
+          continue;
+        }
+        if (farthest_sq <= radius_sq) {
+          // Whole block is inside, use the indexed points directly.
+          query_bins_.push_back(&it->second);
+          weights.push_back(it->second.size());
+          continue;
+        }
+        // Otherwise only keep the free voxels inside the sphere.
+        voxblox::Pointcloud inside_points;
+        for (const voxblox::Point& point : it->second) {
+          if ((point - center).squaredNorm() <= radius_sq) {
+            inside_points.push_back(point);
+          }
+        }
+        if (!inside_points.empty()) {
+          boundary_points_.push_back(voxblox::Pointcloud());
+          boundary_points_.back().swap(inside_points);
+        }
+      }
+    }
+  }
+
+  // Only take pointers to the boundary clouds once the vector stops growing.
+  for (const voxblox::Pointcloud& points : boundary_points_) {
+    query_bins_.push_back(&points);
+    weights.push_back(points.size());
+  }
+
+  if (query_bins_.empty()) {
+    return false;
+  }
+
+  buildAliasTable(weights);
+  query_valid_ = true;
+  return true;
+}
+
+bool FreeSpaceIndex::sampleFreePoint(voxblox::Point* sample) const {
+  CHECK_NOTNULL(sample);
+  if (!query_valid_) {
+    return false;
+  }
+
+  const voxblox::Pointcloud& points = *query_bins_[sampleAliasTable()];
+  const size_t point_index =
+      std::min(static_cast<size_t>(randMToN(0.0, points.size())),
+               points.size() - 1);
+
+  // Jitter within the voxel, the whole voxel is free. Voxels on the boundary
+  // of the sphere can stick out of it though, and then it's just the center.
+  const double half_voxel = voxel_size_ / 2.0;
+  *sample = points[point_index] +
+            voxblox::Point(randMToN(-half_voxel, half_voxel),
+                           randMToN(-half_voxel, half_voxel),
+                           randMToN(-half_voxel, half_voxel));
+  if ((*sample - query_center_).squaredNorm() >
+      query_radius_ * query_radius_) {
+    *sample = points[point_index];
+  }
+  return true;
+}
+
+void FreeSpaceIndex::buildAliasTable(const std::vector<double>& weights) {
+  const size_t num_bins = weights.size();
+  alias_prob_.assign(num_bins, 1.0);
+  alias_index_.resize(num_bins);
+
+  double total_weight = 0.0;
+  for (double weight : weights) {
+    total_weight += weight;
+  }
+
+  // Vose's method: split bins into ones under and over the average weight,
+  // and pair each small bin with a large one to fill it up.
+  std::vector<double> scaled(num_bins);
+  std::vector<size_t> small, large;
+  for (size_t i = 0; i < num_bins; ++i) {
+    alias_index_[i] = i;
+    scaled[i] = weights[i] * num_bins / total_weight;
+    if (scaled[i] < 1.0) {
+      small.push_back(i);
+    } else {
+      large.push_back(i);
+    }
+  }
+
+  while (!small.empty() && !large.empty()) {
+    const size_t less = small.back();
+    small.pop_back();
+    const size_t more = large.back();
+
+    alias_prob_[less] = scaled[less];
+    alias_index_[less] = more;
+    scaled[more] = (scaled[more] + scaled[less]) - 1.0;
+    if (scaled[more] < 1.0) {
+      large.pop_back();
+      small.push_back(more);
+    }
+  }
+  // Whatever is left over is (up to rounding) exactly full.
+}
+
+size_t FreeSpaceIndex::sampleAliasTable() const {
+  const size_t num_bins = alias_prob_.size();
+  const size_t bin =
+      std::min(static_cast<size_t>(randMToN(0.0, num_bins)), num_bins - 1);
+  if (randMToN(0.0, 1.0) < alias_prob_[bin]) {
+    return bin;
+  }
+  return alias_index_[bin];
+}
+
+}  // namespace mav_planning
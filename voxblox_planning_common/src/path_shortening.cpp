@@ -1,82 +1,241 @@
+#include <algorithm>
+#include <functional>
+#include <future>
+#include <string>
+#include <thread>
+
+#include <mav_planning_common/planning_counters.h>
+#include <mav_trajectory_generation/timing.h>
+
+#include "voxblox_planning_common/layer_query_cache.h"
 #include "voxblox_planning_common/path_shortening.h"
 
 namespace mav_planning {
 
-EsdfPathShortener::EsdfPathShortener() : voxel_size_(0.0) {}
+EsdfPathShortener::EsdfPathShortener()
+    : esdf_layer_(nullptr),
+      distance_pyramid_(nullptr),
+      voxel_size_(0.0),
+      method_(kBisection),
+      num_threads_(0) {}
+
+std::string EsdfPathShortener::shorteningMethodToString(
+    ShorteningMethod method) {
+  if (method == kGreedy) {
+    return "greedy";
+  }
+  return "bisection";
+}
+
+bool EsdfPathShortener::shorteningMethodFromString(const std::string& name,
+                                                   ShorteningMethod* method) {
+  CHECK_NOTNULL(method);
+  if (name == "bisection") {
+    *method = kBisection;
+  } else if (name == "greedy") {
+    *method = kGreedy;
+  } else {
+    return false;
+  }
+  return true;
+}
 
 bool EsdfPathShortener::shortenPath(
     const mav_msgs::EigenTrajectoryPointVector& path,
     mav_msgs::EigenTrajectoryPointVector* shortened_path) const {
   CHECK_NOTNULL(shortened_path);
-  // Convert it to a list...
-  EigenTrajectoryPointList path_list(path.begin(), path.end());
+  if (path.size() < 3) {
+    *shortened_path = path;
+    return false;
+  }
 
-  // Do one round of path shorterning.
-  int i = 0;
-  constexpr int kMaxShortens = 10;
+  mav_trajectory_generation::timing::MiniTimer timer;
+  bool success = false;
+  if (method_ == kGreedy) {
+    success = shortenPathGreedy(path, shortened_path);
+  } else {
+    success = shortenPathBisection(path, shortened_path);
+  }
+  getPlanningCounters().shortening_time_sec += timer.stop();
+  return success;
+}
+
+bool EsdfPathShortener::shortenPathGreedy(
+    const mav_msgs::EigenTrajectoryPointVector& path,
+    mav_msgs::EigenTrajectoryPointVector* shortened_path) const {
+  shortened_path->clear();
+  shortened_path->push_back(path.front());
+
+  const size_t last = path.size() - 1;
+  size_t anchor = 0;
+  while (anchor < last) {
+    anchor = findFarthestVisible(path, anchor);
+    shortened_path->push_back(path[anchor]);
+  }
+  return shortened_path->size() < path.size();
+}
+
+size_t EsdfPathShortener::findFarthestVisible(
+    const mav_msgs::EigenTrajectoryPointVector& path, size_t anchor) const {
+  const size_t last = path.size() - 1;
+  const Eigen::Vector3d& start = path[anchor].position_W;
 
+  // Consecutive waypoints are always assumed to be connected.
+  size_t visible = anchor + 1;
+  size_t blocked = last + 1;
+
+  // Exponential search: double the jump until we hit something.
+  size_t step = 2;
+  while (visible < last) {
+    const size_t candidate = std::min(anchor + step, last);
+    if (isLineInCollision(start, path[candidate].position_W)) {
+      blocked = candidate;
+      break;
+    }
+    visible = candidate;
+    step *= 2;
+  }
+  if (visible == last) {
+    return last;
+  }
+
+  // Then binary search between the last visible and first blocked one.
+  while (blocked - visible > 1) {
+    const size_t middle = visible + (blocked - visible) / 2;
+    if (isLineInCollision(start, path[middle].position_W)) {
+      blocked = middle;
+    } else {
+      visible = middle;
+    }
+  }
+  return visible;
+}
+
+bool EsdfPathShortener::shortenPathBisection(
+    const mav_msgs::EigenTrajectoryPointVector& path,
+    mav_msgs::EigenTrajectoryPointVector* shortened_path) const {
+  // Only split off new threads for the top few levels of the recursion, enough
+  // to give every thread its own subrange.
+  int num_threads = num_threads_;
+  if (num_threads <= 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  int parallel_depth = 0;
+  while ((1 << parallel_depth) < num_threads) {
+    parallel_depth++;
+  }
+
+  // Work on indices into the original path rather than copying points around.
+  std::vector<size_t> indices(path.size());
+  for (size_t i = 0; i < path.size(); ++i) {
+    indices[i] = i;
+  }
+  std::vector<char> keep(path.size(), true);
+  LineCollisionCache cache;
+
+  constexpr int kMaxShortens = 10;
   bool any_success = false;
 
   for (int i = 0; i < kMaxShortens; i++) {
+    LineCollisionCache new_checks;
     bool success =
-        shortenPathList(path_list.begin(), path_list.end(), &path_list);
+        shortenPathRange(path, indices, 0, indices.size() - 1, parallel_depth,
+                         cache, &new_checks, &keep);
+    cache.insert(new_checks.begin(), new_checks.end());
     any_success |= success;
     if (!success) {
       break;
     }
+
+    // Drop whatever got removed this round.
+    size_t num_kept = 0;
+    for (size_t j = 0; j < indices.size(); ++j) {
+      if (keep[indices[j]]) {
+        indices[num_kept++] = indices[j];
+      }
+    }
+    indices.resize(num_kept);
   }
 
-  shortened_path->assign(path_list.begin(), path_list.end());
+  shortened_path->clear();
+  shortened_path->reserve(indices.size());
+  for (size_t index : indices) {
+    shortened_path->push_back(path[index]);
+  }
   return any_success;
 }
 
-// Shortens the path inside the iterator, leaving start and end the same.
-bool EsdfPathShortener::shortenPathList(
-    const EigenTrajectoryPointList::iterator& start_iter,
-    const EigenTrajectoryPointList::iterator& end_iter,
-    EigenTrajectoryPointList* path_list) const {
-  if (start_iter == end_iter) {
+bool EsdfPathShortener::shortenPathRange(
+    const mav_msgs::EigenTrajectoryPointVector& path,
+    const std::vector<size_t>& indices, size_t first, size_t last,
+    int parallel_depth, const LineCollisionCache& cache,
+    LineCollisionCache* new_checks, std::vector<char>* keep) const {
+  // Nothing in between to remove.
+  if (last <= first + 1) {
     return false;
   }
 
-  EigenTrajectoryPointList::iterator iter = start_iter;
-  EigenTrajectoryPointList::iterator last_iter = end_iter;
-  last_iter--;
+  const size_t start_index = indices[first];
+  const size_t end_index = indices[last];
+  const size_t key = start_index * path.size() + end_index;
 
-  // If we can shortcut this...
-  if (!isLineInCollision(start_iter->position_W, last_iter->position_W)) {
-    // Then we remove everything between start iter and end iter.
-    iter++;
-    int i = 0;
-    while (iter != last_iter && iter != end_iter) {
-      iter = path_list->erase(iter);
-      i++;
-    }
-    return i > 0;
+  bool in_collision = false;
+  LineCollisionCache::const_iterator cached = cache.find(key);
+  if (cached != cache.end()) {
+    in_collision = cached->second;
   } else {
-    // Recursively split the remaining path list into left and right half.
-    EigenTrajectoryPointList::iterator middle_iter = start_iter;
-    for (int i = 0; iter != last_iter; ++iter, ++i) {
-      if (i % 2 == 0) {
-        middle_iter++;
-      }
-    }
+    in_collision = isLineInCollision(path[start_index].position_W,
+                                     path[end_index].position_W);
+    (*new_checks)[key] = in_collision;
+  }
 
-    if (middle_iter == start_iter || middle_iter == end_iter) {
-      return false;
+  // If we can shortcut this, remove everything in between.
+  if (!in_collision) {
+    for (size_t i = first + 1; i < last; ++i) {
+      (*keep)[indices[i]] = false;
     }
+    return true;
+  }
 
-    bool left_success = shortenPathList(start_iter, middle_iter, path_list);
-    bool right_success = shortenPathList(middle_iter, end_iter, path_list);
+  // Otherwise split into a left and right half. The halves touch disjoint
+  // parts of keep, so they can run in parallel, as long as the range is long
+  // enough to be worth starting a thread for.
+  constexpr size_t kMinParallelRange = 64;
+  const size_t middle = first + (last - first + 1) / 2;
+  if (parallel_depth > 0 && last - first >= kMinParallelRange) {
+    LineCollisionCache left_checks;
+    // Counters are per thread, so bring the left half's back with it.
+    PlanningCounters left_counters;
+    std::future<bool> left_future = std::async(std::launch::async, [&]() {
+      const PlanningCounters counters_before = getPlanningCounters();
+      bool success =
+          shortenPathRange(path, indices, first, middle - 1,
+                           parallel_depth - 1, cache, &left_checks, keep);
+      left_counters = getPlanningCounters() - counters_before;
+      return success;
+    });
+    bool right_success =
+        shortenPathRange(path, indices, middle, last, parallel_depth - 1,
+                         cache, new_checks, keep);
+    bool left_success = left_future.get();
+    new_checks->insert(left_checks.begin(), left_checks.end());
+    getPlanningCounters() += left_counters;
     return left_success || right_success;
   }
-  return false;
+
+  bool left_success = shortenPathRange(path, indices, first, middle - 1, 0,
+                                       cache, new_checks, keep);
+  bool right_success = shortenPathRange(path, indices, middle, last, 0, cache,
+                                        new_checks, keep);
+  return left_success || right_success;
 }
 
 bool EsdfPathShortener::isLineInCollision(const Eigen::Vector3d& start,
                                           const Eigen::Vector3d& end) const {
   CHECK_NOTNULL(esdf_layer_);
   CHECK_GT(voxel_size_, 0.0);
+  PlanningCounters& counters = getPlanningCounters();
+  ++counters.collision_checks;
 
   Eigen::Vector3d direction = (end - start);
   double distance = direction.norm();
@@ -90,10 +249,22 @@ bool EsdfPathShortener::isLineInCollision(const Eigen::Vector3d& start,
   // Start at the start, keep going by distance increments...
   Eigen::Vector3d current_position = start;
   double distance_so_far = 0.0;
+  // Consecutive samples are mostly in the same or neighboring blocks.
+  LayerQueryCache<voxblox::EsdfVoxel> cache(esdf_layer_);
 
   while (distance_so_far <= distance) {
-    voxblox::EsdfVoxel* esdf_voxel = esdf_layer_->getVoxelPtrByCoordinates(
+    if (distance_pyramid_ != nullptr) {
+      // Skip straight through blocks that are far enough from everything.
+      const double free_length = distance_pyramid_->getFreeLengthAlongRay(
+          current_position, direction, distance - distance_so_far,
+          constraints_.robot_radius);
+      current_position += direction * free_length;
+      distance_so_far += free_length;
+    }
+
+    const voxblox::EsdfVoxel* esdf_voxel = cache.getVoxelPtrByCoordinates(
         current_position.cast<voxblox::FloatingPoint>());
+    ++counters.distance_queries;
     if (esdf_voxel == nullptr) {
       return true;
     }
@@ -0,0 +1,474 @@
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <voxblox/core/common.h>
+#include <voxblox/io/layer_io.h>
+
+#include "voxblox_planning_common/synthetic_world.h"
+
+namespace mav_planning {
+
+namespace {
+
+// Bump this whenever the same spec would generate a different world, so that
+// old cached maps aren't used anymore.
+const int kSyntheticWorldVersion = 1;
+
+// std::uniform_real_distribution isn't the same across standard libraries,
+// but mt19937 is, so worlds only depend on the seed.
+class WorldRandom {
+ public:
+  explicit WorldRandom(int seed) : engine_(static_cast<uint32_t>(seed)) {}
+
+  double uniform(double min, double max) {
+    return min + (max - min) * (engine_() / 4294967296.0);
+  }
+
+ private:
+  std::mt19937 engine_;
+};
+
+void addBox(const Eigen::Vector3d& center, const Eigen::Vector3d& size,
+            voxblox::SimulationWorld* world) {
+  world->addObject(std::unique_ptr<voxblox::Object>(new voxblox::Cube(
+      center.cast<voxblox::FloatingPoint>(),
+      size.cast<voxblox::FloatingPoint>(), voxblox::Color::Gray())));
+}
+
+void addForest(const SyntheticWorldSpec& spec, WorldRandom* random,
+               voxblox::SimulationWorld* world) {
+  const double usable_x = spec.size.x() - 2 * spec.free_border_m;
+  const double usable_y = spec.size.y() - 2 * spec.free_border_m;
+  if (usable_x <= 0.0 || usable_y <= 0.0) {
+    return;
+  }
+  const int num_objects =
+      static_cast<int>(std::floor(spec.density * usable_x * usable_y));
+  for (int i = 0; i < num_objects; ++i) {
+    // First select size; pose depends on size in z.
+    const double height = random->uniform(spec.min_height_m, spec.size.z());
+    const double radius =
+        random->uniform(spec.min_radius_m, spec.max_radius_m);
+    const Eigen::Vector3d position(
+        random->uniform(spec.free_border_m, spec.size.x() - spec.free_border_m),
+        random->uniform(spec.free_border_m, spec.size.y() - spec.free_border_m),
+        height / 2.0);
+    world->addObject(std::unique_ptr<voxblox::Object>(new voxblox::Cylinder(
+        position.cast<voxblox::FloatingPoint>(), radius, height,
+        voxblox::Color(165, 42, 42))));
+  }
+}
+
+// A wall along x (or y) from start, with a door at a random spot, or left out
+// entirely with the corridor probability.
+void addWallWithDoor(const SyntheticWorldSpec& spec,
+                     const Eigen::Vector3d& start, double length, bool along_x,
+                     WorldRandom* random, voxblox::SimulationWorld* world) {
+  if (random->uniform(0.0, 1.0) < spec.corridor_probability) {
+    return;
+  }
+  const double door_start =
+      random->uniform(spec.wall_thickness_m,
+                      length - spec.door_width_m - spec.wall_thickness_m);
+  const double segment_starts[2] = {0.0, door_start + spec.door_width_m};
+  const double segment_lengths[2] = {door_start,
+                                     length - door_start - spec.door_width_m};
+  for (int i = 0; i < 2; ++i) {
+    Eigen::Vector3d center = start;
+    Eigen::Vector3d size(spec.wall_thickness_m, spec.wall_thickness_m,
+                         spec.size.z());
+    center.z() = spec.size.z() / 2.0;
+    if (along_x) {
+      center.x() += segment_starts[i] + segment_lengths[i] / 2.0;
+      size.x() = segment_lengths[i];
+    } else {
+      center.y() += segment_starts[i] + segment_lengths[i] / 2.0;
+      size.y() = segment_lengths[i];
+    }
+    addBox(center, size, world);
+  }
+}
+
+void addRooms(const SyntheticWorldSpec& spec, WorldRandom* random,
+              voxblox::SimulationWorld* world) {
+  const int num_rooms_x =
+      std::max(1, static_cast<int>(spec.size.x() / spec.room_size_m));
+  const int num_rooms_y =
+      std::max(1, static_cast<int>(spec.size.y() / spec.room_size_m));
+  // Walls between neighboring rooms: along y between columns of rooms, then
+  // along x between rows.
+  for (int i = 1; i < num_rooms_x; ++i) {
+    for (int j = 0; j < num_rooms_y; ++j) {
+      const Eigen::Vector3d wall_start(i * spec.room_size_m,
+                                       j * spec.room_size_m, 0.0);
+      addWallWithDoor(spec, wall_start, spec.room_size_m, false, random,
+                      world);
+    }
+  }
+  for (int j = 1; j < num_rooms_y; ++j) {
+    for (int i = 0; i < num_rooms_x; ++i) {
+      const Eigen::Vector3d wall_start(i * spec.room_size_m,
+                                       j * spec.room_size_m, 0.0);
+      addWallWithDoor(spec, wall_start, spec.room_size_m, true, random,
+                      world);
+    }
+  }
+
+  const double kMargin = 1.0;
+  const double free_size = spec.room_size_m - 2 * kMargin;
+  if (free_size <= 0.0) {
+    return;
+  }
+  for (int i = 0; i < num_rooms_x; ++i) {
+    for (int j = 0; j < num_rooms_y; ++j) {
+      const double min_x = i * spec.room_size_m + kMargin;
+      const double min_y = j * spec.room_size_m + kMargin;
+      for (int k = 0; k < spec.obstacles_per_room; ++k) {
+        const double height = random->uniform(0.5, spec.size.z());
+        const Eigen::Vector3d center(random->uniform(min_x, min_x + free_size),
+                                     random->uniform(min_y, min_y + free_size),
+                                     height / 2.0);
+        if (random->uniform(0.0, 1.0) < 0.5) {
+          const Eigen::Vector3d size(random->uniform(0.5, 1.5),
+                                     random->uniform(0.5, 1.5), height);
+          world->addObject(std::unique_ptr<voxblox::Object>(new voxblox::Cube(
+              center.cast<voxblox::FloatingPoint>(),
+              size.cast<voxblox::FloatingPoint>(), voxblox::Color::Green())));
+        } else {
+          world->addObject(
+              std::unique_ptr<voxblox::Object>(new voxblox::Cylinder(
+                  center.cast<voxblox::FloatingPoint>(),
+                  random->uniform(0.25, 0.75), height,
+                  voxblox::Color::Pink())));
+        }
+      }
+    }
+  }
+}
+
+void addCorridors(const SyntheticWorldSpec& spec,
+                  voxblox::SimulationWorld* world) {
+  const int num_corridors =
+      std::max(1, static_cast<int>(spec.size.y() / spec.corridor_width_m));
+  const double wall_length = spec.size.x() - spec.corridor_width_m;
+  if (wall_length <= 0.0) {
+    return;
+  }
+  for (int i = 1; i < num_corridors; ++i) {
+    // Open at the far end for odd walls and at the near end for even ones.
+    const double wall_start = (i % 2 == 1) ? 0.0 : spec.corridor_width_m;
+    addBox(Eigen::Vector3d(wall_start + wall_length / 2.0,
+                           i * spec.corridor_width_m, spec.size.z() / 2.0),
+           Eigen::Vector3d(wall_length, spec.wall_thickness_m, spec.size.z()),
+           world);
+  }
+}
+
+template <typename VoxelType>
+void setVoxelFromDistance(const SyntheticWorldSpec& spec, double distance,
+                          VoxelType* voxel);
+
+template <>
+void setVoxelFromDistance(const SyntheticWorldSpec& spec, double distance,
+                          voxblox::TsdfVoxel* voxel) {
+  const double truncation_distance = spec.getTruncationDistance();
+  voxel->distance = static_cast<voxblox::FloatingPoint>(
+      std::max(-truncation_distance, std::min(truncation_distance, distance)));
+  voxel->weight = 1.0;
+}
+
+template <>
+void setVoxelFromDistance(const SyntheticWorldSpec& spec, double distance,
+                          voxblox::EsdfVoxel* voxel) {
+  voxel->distance = static_cast<voxblox::FloatingPoint>(
+      std::max(-spec.esdf_max_distance_m,
+               std::min(spec.esdf_max_distance_m, distance)));
+  voxel->observed = true;
+}
+
+}  // namespace
+
+double SyntheticWorldSpec::getTruncationDistance() const {
+  if (truncation_distance_m > 0.0) {
+    return truncation_distance_m;
+  }
+  return 4 * voxel_size;
+}
+
+std::string SyntheticWorldSpec::toString() const {
+  // Doubles with all their digits, so that nearly equal specs don't collide.
+  char buffer[1024];
+  snprintf(buffer, sizeof(buffer),
+           "version: %d\ntype: %s\nseed: %d\nsize: %.17g %.17g %.17g\n"
+           "add_ceiling: %d\ndensity: %.17g\nfree_border: %.17g\n"
+           "radius: %.17g %.17g\nmin_height: %.17g\nroom_size: %.17g\n"
+           "corridor_width: %.17g\nwall_thickness: %.17g\n"
+           "door_width: %.17g\ncorridor_probability: %.17g\n"
+           "obstacles_per_room: %d\n"
+           "voxel_size: %.17g\nvoxels_per_side: %d\n"
+           "truncation_distance: %.17g\nesdf_max_distance: %.17g\n",
+           kSyntheticWorldVersion, worldTypeToString(type).c_str(), seed,
+           size.x(), size.y(), size.z(), add_ceiling, density, free_border_m,
+           min_radius_m, max_radius_m, min_height_m, room_size_m,
+           corridor_width_m, wall_thickness_m, door_width_m,
+           corridor_probability, obstacles_per_room, voxel_size,
+           voxels_per_side, getTruncationDistance(), esdf_max_distance_m);
+  return std::string(buffer);
+}
+
+std::string SyntheticWorldSpec::getHash() const {
+  // 64-bit FNV-1a.
+  uint64_t hash = 14695981039346656037ull;
+  for (const char c : toString()) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ull;
+  }
+  char buffer[17];
+  snprintf(buffer, sizeof(buffer), "%016llx",
+           static_cast<unsigned long long>(hash));
+  return std::string(buffer);
+}
+
+std::string SyntheticWorldSpec::worldTypeToString(WorldType type) {
+  switch (type) {
+    case kForest:
+      return "forest";
+    case kRooms:
+      return "rooms";
+    case kCorridors:
+      return "corridors";
+  }
+  return "unknown";
+}
+
+bool SyntheticWorldSpec::worldTypeFromString(const std::string& name,
+                                             WorldType* type) {
+  CHECK_NOTNULL(type);
+  for (int i = kForest; i <= kCorridors; ++i) {
+    if (name == worldTypeToString(static_cast<WorldType>(i))) {
+      *type = static_cast<WorldType>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+void addSyntheticWorldObjects(const SyntheticWorldSpec& spec,
+                              voxblox::SimulationWorld* world) {
+  CHECK_NOTNULL(world);
+  WorldRandom random(spec.seed);
+
+  world->addPlaneBoundaries(0.0, spec.size.x(), 0.0, spec.size.y());
+  world->addGroundLevel(0.0);
+  if (spec.add_ceiling) {
+    world->addObject(
+        std::unique_ptr<voxblox::Object>(new voxblox::PlaneObject(
+            voxblox::Point(0.0, 0.0, spec.size.z()),
+            voxblox::Point(0.0, 0.0, -1.0))));
+  }
+  // Sets the display bounds.
+  world->setBounds(
+      voxblox::Point(-1.0, -1.0, -1.0),
+      spec.size.cast<voxblox::FloatingPoint>() + voxblox::Point(1.0, 1.0, 1.0));
+
+  switch (spec.type) {
+    case SyntheticWorldSpec::kForest:
+      addForest(spec, &random, world);
+      break;
+    case SyntheticWorldSpec::kRooms:
+      addRooms(spec, &random, world);
+      break;
+    case SyntheticWorldSpec::kCorridors:
+      addCorridors(spec, world);
+      break;
+  }
+}
+
+SyntheticWorldGenerator::SyntheticWorldGenerator()
+    : num_threads_(0), loaded_from_cache_(false) {}
+
+void SyntheticWorldGenerator::generate(
+    const SyntheticWorldSpec& spec,
+    voxblox::Layer<voxblox::TsdfVoxel>::Ptr* tsdf_layer,
+    voxblox::Layer<voxblox::EsdfVoxel>::Ptr* esdf_layer) {
+  CHECK_NOTNULL(tsdf_layer);
+  CHECK_NOTNULL(esdf_layer);
+  CHECK_GT(spec.voxel_size, 0.0);
+  CHECK_GT(spec.voxels_per_side, 0);
+
+  loaded_from_cache_ = false;
+  if (!cache_directory_.empty() &&
+      loadFromCache(spec, tsdf_layer, esdf_layer)) {
+    loaded_from_cache_ = true;
+    return;
+  }
+
+  voxblox::SimulationWorld world;
+  addSyntheticWorldObjects(spec, &world);
+
+  tsdf_layer->reset(new voxblox::Layer<voxblox::TsdfVoxel>(
+      spec.voxel_size, spec.voxels_per_side));
+  esdf_layer->reset(new voxblox::Layer<voxblox::EsdfVoxel>(
+      spec.voxel_size, spec.voxels_per_side));
+
+  // Allocate every block in the world (plus a voxel of margin so the outer
+  // walls are in the map) up front, the layers can't allocate in parallel.
+  const voxblox::FloatingPoint block_size_inv =
+      1.0 / (*tsdf_layer)->block_size();
+  const voxblox::Point margin =
+      voxblox::Point::Constant(static_cast<float>(spec.voxel_size));
+  const voxblox::BlockIndex min_index =
+      voxblox::getGridIndexFromPoint<voxblox::BlockIndex>(-margin,
+                                                          block_size_inv);
+  const voxblox::BlockIndex max_index =
+      voxblox::getGridIndexFromPoint<voxblox::BlockIndex>(
+          spec.size.cast<voxblox::FloatingPoint>() + margin, block_size_inv);
+  std::vector<voxblox::Block<voxblox::TsdfVoxel>::Ptr> tsdf_blocks;
+  std::vector<voxblox::Block<voxblox::EsdfVoxel>::Ptr> esdf_blocks;
+  voxblox::BlockIndex block_index;
+  for (block_index.x() = min_index.x(); block_index.x() <= max_index.x();
+       ++block_index.x()) {
+    for (block_index.y() = min_index.y(); block_index.y() <= max_index.y();
+         ++block_index.y()) {
+      for (block_index.z() = min_index.z(); block_index.z() <= max_index.z();
+           ++block_index.z()) {
+        tsdf_blocks.push_back(
+            (*tsdf_layer)->allocateBlockPtrByIndex(block_index));
+        esdf_blocks.push_back(
+            (*esdf_layer)->allocateBlockPtrByIndex(block_index));
+      }
+    }
+  }
+
+  // The world is only read from here on, so every thread can take blocks.
+  // Distances past the ESDF max distance don't matter, which lets the world
+  // skip far away objects.
+  const voxblox::FloatingPoint max_distance =
+      static_cast<voxblox::FloatingPoint>(
+          std::max(spec.esdf_max_distance_m, spec.getTruncationDistance()));
+  std::atomic<size_t> next_block(0);
+  auto fill_blocks = [&]() {
+    size_t i;
+    while ((i = next_block++) < tsdf_blocks.size()) {
+      voxblox::Block<voxblox::TsdfVoxel>& tsdf_block = *tsdf_blocks[i];
+      voxblox::Block<voxblox::EsdfVoxel>& esdf_block = *esdf_blocks[i];
+      for (size_t j = 0; j < tsdf_block.num_voxels(); ++j) {
+        const voxblox::Point position =
+            tsdf_block.computeCoordinatesFromLinearIndex(j);
+        const double distance = world.getDistanceToPoint(position,
+                                                         max_distance);
+        setVoxelFromDistance(spec, distance,
+                             &tsdf_block.getVoxelByLinearIndex(j));
+        setVoxelFromDistance(spec, distance,
+                             &esdf_block.getVoxelByLinearIndex(j));
+      }
+      tsdf_block.set_has_data(true);
+      esdf_block.set_has_data(true);
+    }
+  };
+
+  int num_threads = num_threads_;
+  if (num_threads <= 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  std::vector<std::thread> threads;
+  for (int i = 1; i < num_threads; ++i) {
+    threads.emplace_back(fill_blocks);
+  }
+  fill_blocks();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  if (!cache_directory_.empty()) {
+    saveToCache(spec, **tsdf_layer, **esdf_layer);
+  }
+}
+
+std::string SyntheticWorldGenerator::getCachePath(
+    const SyntheticWorldSpec& spec) const {
+  return cache_directory_ + "/synthetic_world_" + spec.getHash();
+}
+
+bool SyntheticWorldGenerator::loadFromCache(
+    const SyntheticWorldSpec& spec,
+    voxblox::Layer<voxblox::TsdfVoxel>::Ptr* tsdf_layer,
+    voxblox::Layer<voxblox::EsdfVoxel>::Ptr* esdf_layer) const {
+  CHECK_NOTNULL(tsdf_layer);
+  CHECK_NOTNULL(esdf_layer);
+  const std::string path = getCachePath(spec);
+
+  // The full spec is saved next to the map, in case two specs ever hash the
+  // same.
+  std::ifstream spec_file(path + ".spec");
+  if (!spec_file.is_open()) {
+    return false;
+  }
+  std::stringstream saved_spec;
+  saved_spec << spec_file.rdbuf();
+  if (saved_spec.str() != spec.toString()) {
+    LOG(WARNING) << "Cached synthetic world " << path
+                 << " is for a different spec, regenerating.";
+    return false;
+  }
+
+  const bool kMultipleLayerSupport = true;
+  if (!voxblox::io::LoadLayer<voxblox::TsdfVoxel>(
+          path + ".voxblox", kMultipleLayerSupport, tsdf_layer) ||
+      !voxblox::io::LoadLayer<voxblox::EsdfVoxel>(
+          path + ".voxblox", kMultipleLayerSupport, esdf_layer)) {
+    LOG(WARNING) << "Couldn't load cached synthetic world " << path
+                 << ", regenerating.";
+    return false;
+  }
+  return true;
+}
+
+void SyntheticWorldGenerator::saveToCache(
+    const SyntheticWorldSpec& spec,
+    const voxblox::Layer<voxblox::TsdfVoxel>& tsdf_layer,
+    const voxblox::Layer<voxblox::EsdfVoxel>& esdf_layer) const {
+  if (mkdir(cache_directory_.c_str(), 0755) != 0 && errno != EEXIST) {
+    LOG(WARNING) << "Couldn't create synthetic world cache directory: "
+                 << cache_directory_;
+    return;
+  }
+
+  // Written under a temporary name and renamed, so that other processes
+  // never see half a map. The spec goes last, since it's what marks the map
+  // as valid.
+  const std::string path = getCachePath(spec);
+  const std::string tmp_suffix = ".tmp" + std::to_string(getpid());
+  const bool kClearFile = true;
+  if (!voxblox::io::SaveLayer(tsdf_layer, path + ".voxblox" + tmp_suffix,
+                              kClearFile) ||
+      !voxblox::io::SaveLayer(esdf_layer, path + ".voxblox" + tmp_suffix,
+                              !kClearFile)) {
+    LOG(WARNING) << "Couldn't save synthetic world to cache: " << path;
+    remove((path + ".voxblox" + tmp_suffix).c_str());
+    return;
+  }
+  {
+    std::ofstream spec_file(path + ".spec" + tmp_suffix);
+    spec_file << spec.toString();
+  }
+  if (rename((path + ".voxblox" + tmp_suffix).c_str(),
+             (path + ".voxblox").c_str()) != 0 ||
+      rename((path + ".spec" + tmp_suffix).c_str(),
+             (path + ".spec").c_str()) != 0) {
+    LOG(WARNING) << "Couldn't move synthetic world into the cache: " << path;
+  }
+}
+
+}  // namespace mav_planning
@@ -0,0 +1,221 @@
+#include <gtest/gtest.h>
+
+#include "voxblox_planning_common/esdf_distance_pyramid.h"
+
+namespace mav_planning {
+
+class EsdfDistancePyramidTest : public ::testing::Test {
+ protected:
+  static constexpr voxblox::FloatingPoint kVoxelSize = 0.1f;
+  static constexpr size_t kVoxelsPerSide = 4u;
+  static constexpr voxblox::FloatingPoint kFree = 1.0f;
+  static constexpr voxblox::FloatingPoint kMinDistance = 0.5f;
+
+  EsdfDistancePyramidTest() : layer_(kVoxelSize, kVoxelsPerSide) {}
+
+  virtual void SetUp() { pyramid_.setEsdfLayer(&layer_); }
+
+  // Allocates the block with every voxel observed at the distance.
+  voxblox::Block<voxblox::EsdfVoxel>& setBlock(
+      const voxblox::BlockIndex& block_index,
+      voxblox::FloatingPoint distance) {
+    voxblox::Block<voxblox::EsdfVoxel>::Ptr block =
+        layer_.allocateBlockPtrByIndex(block_index);
+    for (size_t i = 0u; i < block->num_voxels(); ++i) {
+      voxblox::EsdfVoxel& voxel = block->getVoxelByLinearIndex(i);
+      voxel.distance = distance;
+      voxel.observed = true;
+    }
+    return *block;
+  }
+
+  // All blocks from min to max, inclusive.
+  void setBlocks(const voxblox::BlockIndex& min,
+                 const voxblox::BlockIndex& max,
+                 voxblox::FloatingPoint distance) {
+    voxblox::BlockIndex index;
+    for (index.x() = min.x(); index.x() <= max.x(); ++index.x()) {
+      for (index.y() = min.y(); index.y() <= max.y(); ++index.y()) {
+        for (index.z() = min.z(); index.z() <= max.z(); ++index.z()) {
+          setBlock(index, distance);
+        }
+      }
+    }
+  }
+
+  void expectRegion(const voxblox::BlockIndex& block_index,
+                    const voxblox::BlockIndex& expected_min,
+                    const voxblox::BlockIndex& expected_max) {
+    voxblox::BlockIndex region_min, region_max;
+    ASSERT_TRUE(pyramid_.getFreeBlockRegion(block_index, kMinDistance,
+                                            &region_min, &region_max));
+    EXPECT_EQ(expected_min, region_min);
+    EXPECT_EQ(expected_max, region_max);
+  }
+
+  bool isFree(const voxblox::BlockIndex& block_index) {
+    voxblox::BlockIndex region_min, region_max;
+    return pyramid_.getFreeBlockRegion(block_index, kMinDistance, &region_min,
+                                       &region_max);
+  }
+
+  voxblox::Layer<voxblox::EsdfVoxel> layer_;
+  EsdfDistancePyramid pyramid_;
+};
+
+TEST_F(EsdfDistancePyramidTest, BlockAndGroupRegions) {
+  // One full 4x4x4 group, with an obstacle in the block at the origin.
+  setBlocks(voxblox::BlockIndex(0, 0, 0), voxblox::BlockIndex(3, 3, 3), kFree);
+  setBlock(voxblox::BlockIndex(0, 0, 0), 0.0f);
+  pyramid_.updateAllBlocks();
+  EXPECT_EQ(64u, pyramid_.getNumBlocks());
+
+  EXPECT_FALSE(isFree(voxblox::BlockIndex(0, 0, 0)));
+  // Shares its 2x2x2 group with the obstacle, so only the block is free.
+  expectRegion(voxblox::BlockIndex(1, 1, 1), voxblox::BlockIndex(1, 1, 1),
+               voxblox::BlockIndex(1, 1, 1));
+  // In a free 2x2x2 group, but the 4x4x4 one has the obstacle.
+  expectRegion(voxblox::BlockIndex(3, 2, 3), voxblox::BlockIndex(2, 2, 2),
+               voxblox::BlockIndex(3, 3, 3));
+
+  // Without the obstacle, the whole top level group is free.
+  setBlock(voxblox::BlockIndex(0, 0, 0), kFree);
+  pyramid_.updateBlock(voxblox::BlockIndex(0, 0, 0));
+  expectRegion(voxblox::BlockIndex(1, 1, 1), voxblox::BlockIndex(0, 0, 0),
+               voxblox::BlockIndex(3, 3, 3));
+}
+
+TEST_F(EsdfDistancePyramidTest, UnobservedCountsAsZero) {
+  setBlocks(voxblox::BlockIndex(0, 0, 0), voxblox::BlockIndex(1, 1, 1), kFree);
+  // Far from everything, but unknown.
+  voxblox::Block<voxblox::EsdfVoxel>& block =
+      setBlock(voxblox::BlockIndex(1, 0, 0), kFree);
+  block.getVoxelByLinearIndex(5).observed = false;
+  pyramid_.updateAllBlocks();
+
+  EXPECT_FALSE(isFree(voxblox::BlockIndex(1, 0, 0)));
+  expectRegion(voxblox::BlockIndex(0, 0, 0), voxblox::BlockIndex(0, 0, 0),
+               voxblox::BlockIndex(0, 0, 0));
+
+  // Anything is further than an unknown voxel from a negative distance.
+  voxblox::BlockIndex region_min, region_max;
+  EXPECT_TRUE(pyramid_.getFreeBlockRegion(voxblox::BlockIndex(1, 0, 0), -1.0f,
+                                          &region_min, &region_max));
+}
+
+TEST_F(EsdfDistancePyramidTest, MissingChildBlocksGroup) {
+  setBlocks(voxblox::BlockIndex(0, 0, 0), voxblox::BlockIndex(1, 1, 1), kFree);
+  layer_.removeBlock(voxblox::BlockIndex(1, 1, 1));
+  pyramid_.updateAllBlocks();
+  EXPECT_EQ(7u, pyramid_.getNumBlocks());
+
+  EXPECT_FALSE(isFree(voxblox::BlockIndex(1, 1, 1)));
+  expectRegion(voxblox::BlockIndex(0, 1, 0), voxblox::BlockIndex(0, 1, 0),
+               voxblox::BlockIndex(0, 1, 0));
+}
+
+TEST_F(EsdfDistancePyramidTest, NegativeIndicesGroupLikePositive) {
+  // -2 and -1 are in the same 2x2x2 group, and -4 to -1 in the same 4x4x4
+  // group, as long as the parent index rounds down.
+  setBlocks(voxblox::BlockIndex(-4, -4, -4), voxblox::BlockIndex(-1, -1, -1),
+            kFree);
+  setBlock(voxblox::BlockIndex(-4, -4, -4), 0.0f);
+  pyramid_.updateAllBlocks();
+
+  expectRegion(voxblox::BlockIndex(-1, -1, -1),
+               voxblox::BlockIndex(-2, -2, -2),
+               voxblox::BlockIndex(-1, -1, -1));
+  expectRegion(voxblox::BlockIndex(-3, -4, -4), voxblox::BlockIndex(-3, -4, -4),
+               voxblox::BlockIndex(-3, -4, -4));
+
+  // Voxel regions round down the same way.
+  voxblox::GlobalIndex voxel_min, voxel_max;
+  EXPECT_TRUE(pyramid_.getFreeVoxelRegion(voxblox::GlobalIndex(-1, -1, -1),
+                                          kMinDistance, &voxel_min,
+                                          &voxel_max));
+  EXPECT_EQ(voxblox::GlobalIndex(-8, -8, -8), voxel_min);
+  EXPECT_EQ(voxblox::GlobalIndex(-1, -1, -1), voxel_max);
+}
+
+TEST_F(EsdfDistancePyramidTest, RayStopsAtOccupiedBlock) {
+  // A row of blocks along x, the fourth one with an obstacle. A single row
+  // has no full groups, so the ray goes block by block.
+  setBlocks(voxblox::BlockIndex(0, 0, 0), voxblox::BlockIndex(5, 0, 0), kFree);
+  setBlock(voxblox::BlockIndex(3, 0, 0), 0.0f);
+  pyramid_.updateAllBlocks();
+
+  const double block_size = layer_.block_size();
+  const Eigen::Vector3d start(0.5 * block_size, 0.5 * block_size,
+                              0.5 * block_size);
+  const double kMaxLength = 10.0;
+  EXPECT_NEAR(2.5 * block_size,
+              pyramid_.getFreeLengthAlongRay(start, Eigen::Vector3d::UnitX(),
+                                             kMaxLength, kMinDistance),
+              1e-6);
+  // Never past the max length.
+  EXPECT_NEAR(block_size,
+              pyramid_.getFreeLengthAlongRay(start, Eigen::Vector3d::UnitX(),
+                                             block_size, kMinDistance),
+              1e-6);
+  // Out of the map right away.
+  EXPECT_NEAR(0.5 * block_size,
+              pyramid_.getFreeLengthAlongRay(start, -Eigen::Vector3d::UnitX(),
+                                             kMaxLength, kMinDistance),
+              1e-6);
+  // Starting in the obstacle block.
+  const Eigen::Vector3d blocked_start = start + 3.0 * block_size *
+                                                    Eigen::Vector3d::UnitX();
+  EXPECT_EQ(0.0, pyramid_.getFreeLengthAlongRay(blocked_start,
+                                                Eigen::Vector3d::UnitX(),
+                                                kMaxLength, kMinDistance));
+}
+
+TEST_F(EsdfDistancePyramidTest, PicksUpChangesWithoutFlags) {
+  setBlocks(voxblox::BlockIndex(0, 0, 0), voxblox::BlockIndex(1, 1, 1), kFree);
+  pyramid_.updateChangedBlocks();
+  EXPECT_EQ(8u, pyramid_.getNumBlocks());
+
+  const double block_size = layer_.block_size();
+  const Eigen::Vector3d position = 0.5 * block_size * Eigen::Vector3d::Ones();
+  Eigen::AlignedBox3d region;
+  ASSERT_TRUE(pyramid_.getFreeRegion(position, kMinDistance, &region));
+  EXPECT_NEAR(2.0 * block_size, region.sizes().minCoeff(), 1e-6);
+
+  // A single voxel gets closer to an obstacle, and nothing flags its block.
+  // Flags set by others are left alone.
+  voxblox::Block<voxblox::EsdfVoxel>& block =
+      layer_.getBlockByIndex(voxblox::BlockIndex(1, 0, 0));
+  block.getVoxelByLinearIndex(7).distance = 0.0f;
+  voxblox::Block<voxblox::EsdfVoxel>& other_block =
+      layer_.getBlockByIndex(voxblox::BlockIndex(0, 1, 0));
+  other_block.updated().set(voxblox::Update::kMap);
+  pyramid_.updateChangedBlocks();
+  EXPECT_TRUE(other_block.updated(voxblox::Update::kMap));
+  ASSERT_TRUE(pyramid_.getFreeRegion(position, kMinDistance, &region));
+  EXPECT_NEAR(block_size, region.sizes().maxCoeff(), 1e-6);
+  EXPECT_FALSE(pyramid_.getFreeRegion(
+      position + block_size * Eigen::Vector3d::UnitX(), kMinDistance,
+      &region));
+
+  // Freed up again, and the region grows back.
+  block.getVoxelByLinearIndex(7).distance = kFree;
+  pyramid_.updateChangedBlocks();
+  ASSERT_TRUE(pyramid_.getFreeRegion(position, kMinDistance, &region));
+  EXPECT_NEAR(2.0 * block_size, region.sizes().minCoeff(), 1e-6);
+
+  // Removed blocks are dropped, and take their group with them.
+  layer_.removeBlock(voxblox::BlockIndex(1, 1, 1));
+  pyramid_.updateChangedBlocks();
+  EXPECT_EQ(7u, pyramid_.getNumBlocks());
+  ASSERT_TRUE(pyramid_.getFreeRegion(position, kMinDistance, &region));
+  EXPECT_NEAR(block_size, region.sizes().maxCoeff(), 1e-6);
+}
+
+}  // namespace mav_planning
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  google::InitGoogleLogging(argv[0]);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,222 @@
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <mav_planning_common/map_query_scope.h>
+
+#include "voxblox_planning_common/esdf_distance_source.h"
+#include "voxblox_planning_common/synthetic_world.h"
+
+namespace mav_planning {
+
+class EsdfDistanceSourceTest : public ::testing::Test {
+ protected:
+  static constexpr double kGradientTolerance = 1e-6;
+
+  virtual void SetUp() {
+    SyntheticWorldSpec spec;
+    spec.type = SyntheticWorldSpec::kRooms;
+    spec.seed = 7;
+    spec.size = Eigen::Vector3d(6.0, 6.0, 2.0);
+    spec.obstacles_per_room = 1;
+    spec.room_size_m = 3.0;
+    spec.voxel_size = 0.25;
+    spec.voxels_per_side = 8;
+    spec.esdf_max_distance_m = 2.0;
+    world_size_ = spec.size;
+
+    SyntheticWorldGenerator generator;
+    voxblox::Layer<voxblox::TsdfVoxel>::Ptr tsdf_layer;
+    voxblox::Layer<voxblox::EsdfVoxel>::Ptr esdf_layer;
+    generator.generate(spec, &tsdf_layer, &esdf_layer);
+    ASSERT_TRUE(esdf_layer);
+    voxel_size_ = esdf_layer->voxel_size();
+    block_size_ = esdf_layer->block_size();
+
+    // The generator observes every voxel it allocates. Leave a hole in the
+    // middle of the world, and a block that's only half observed, so that
+    // lookups (and the neighbors of gradient lookups) fail inside the world
+    // too, not just outside of it.
+    const voxblox::BlockIndex kRemovedBlock(1, 0, 0);
+    ASSERT_TRUE(esdf_layer->hasBlock(kRemovedBlock));
+    esdf_layer->removeBlock(kRemovedBlock);
+    const voxblox::BlockIndex kHalfObservedBlock(1, 1, 0);
+    ASSERT_TRUE(esdf_layer->hasBlock(kHalfObservedBlock));
+    voxblox::Block<voxblox::EsdfVoxel>& block =
+        esdf_layer->getBlockByIndex(kHalfObservedBlock);
+    for (size_t i = 0u; i < block.num_voxels(); ++i) {
+      const voxblox::VoxelIndex voxel_index =
+          block.computeVoxelIndexFromLinearIndex(i);
+      if (voxel_index.x() < static_cast<int>(block.voxels_per_side() / 2u)) {
+        block.getVoxelByLinearIndex(i).observed = false;
+      }
+    }
+
+    esdf_map_.reset(new voxblox::EsdfMap(esdf_layer));
+    distance_source_.setEsdfMap(esdf_map_.get());
+    positions_ = getPositions();
+  }
+
+  // A lattice that doesn't line up with the voxels, over the world and a
+  // margin past its allocated blocks, plus lines across every block boundary
+  // with points on it and just off either side.
+  std::vector<Eigen::Vector3d> getPositions() const {
+    std::vector<Eigen::Vector3d> positions;
+    const double kMargin = 1.5 * block_size_;
+    const double kStep = 1.3 * voxel_size_;
+    for (double x = -kMargin; x < world_size_.x() + kMargin; x += kStep) {
+      for (double y = -kMargin; y < world_size_.y() + kMargin; y += kStep) {
+        for (double z = -kMargin; z < world_size_.z() + kMargin; z += kStep) {
+          positions.emplace_back(x, y, z);
+        }
+      }
+    }
+
+    const double kOffsets[] = {-0.5 * voxel_size_, -1e-4, 0.0, 1e-4,
+                               0.5 * voxel_size_};
+    // Through the observed half of the half observed block, so the lines
+    // also cross its other half and the removed block.
+    const Eigen::Vector3d kThrough = 0.6 * world_size_;
+    for (int axis = 0; axis < 3; ++axis) {
+      for (double boundary = -block_size_;
+           boundary <= world_size_(axis) + block_size_;
+           boundary += block_size_) {
+        for (double offset : kOffsets) {
+          Eigen::Vector3d position = kThrough;
+          position(axis) = boundary + offset;
+          positions.push_back(position);
+        }
+      }
+    }
+    return positions;
+  }
+
+  enum LookupKind { kObserved = 0, kUnobserved, kUnallocated };
+
+  LookupKind getLookupKind(const Eigen::Vector3d& position) const {
+    const voxblox::EsdfVoxel* voxel =
+        esdf_map_->getEsdfLayer().getVoxelPtrByCoordinates(
+            position.cast<voxblox::FloatingPoint>());
+    if (voxel == nullptr) {
+      return kUnallocated;
+    }
+    return voxel->observed ? kObserved : kUnobserved;
+  }
+
+  // Every kind of lookup has to actually come up, or the comparisons below
+  // don't cover it.
+  void expectAllLookupKinds() const {
+    size_t counts[3] = {0u, 0u, 0u};
+    for (const Eigen::Vector3d& position : positions_) {
+      ++counts[getLookupKind(position)];
+    }
+    EXPECT_LT(0u, counts[kObserved]);
+    EXPECT_LT(0u, counts[kUnobserved]);
+    EXPECT_LT(0u, counts[kUnallocated]);
+  }
+
+  // What the source should return: the map's distance, or 0 where the map
+  // has none.
+  double getExpectedDistance(const Eigen::Vector3d& position) const {
+    double distance = 0.0;
+    if (!esdf_map_->getDistanceAtPosition(position, false, &distance)) {
+      return 0.0;
+    }
+    return distance;
+  }
+
+  // Same, plus a zero gradient where the map fails.
+  double getExpectedDistanceAndGradient(const Eigen::Vector3d& position,
+                                        Eigen::Vector3d* gradient) const {
+    double distance = 0.0;
+    if (!esdf_map_->getDistanceAndGradientAtPosition(position, false,
+                                                     &distance, gradient)) {
+      gradient->setZero();
+      return 0.0;
+    }
+    return distance;
+  }
+
+  void expectGradient(const Eigen::Vector3d& expected,
+                      const Eigen::Vector3d& actual,
+                      const Eigen::Vector3d& position) const {
+    for (int i = 0; i < 3; ++i) {
+      EXPECT_NEAR(expected(i), actual(i), kGradientTolerance)
+          << "at " << position.transpose();
+    }
+  }
+
+  Eigen::Vector3d world_size_;
+  double voxel_size_;
+  double block_size_;
+  std::shared_ptr<voxblox::EsdfMap> esdf_map_;
+  EsdfDistanceSource distance_source_;
+  std::vector<Eigen::Vector3d> positions_;
+};
+
+TEST_F(EsdfDistanceSourceTest, SingleLookupsMatchMap) {
+  expectAllLookupKinds();
+
+  // Inside a scope these go through the source's own cache, outside of one
+  // through the map. Both have to give what the map does.
+  for (int in_scope = 0; in_scope < 2; ++in_scope) {
+    std::unique_ptr<MapQueryScope> scope;
+    if (in_scope) {
+      scope.reset(new MapQueryScope);
+    }
+    for (const Eigen::Vector3d& position : positions_) {
+      EXPECT_EQ(getExpectedDistance(position),
+                distance_source_.getDistance(position))
+          << "at " << position.transpose() << ", in scope: " << in_scope;
+
+      Eigen::Vector3d expected_gradient, gradient;
+      const double expected_distance =
+          getExpectedDistanceAndGradient(position, &expected_gradient);
+      EXPECT_EQ(expected_distance,
+                distance_source_.getDistanceAndGradient(position, &gradient))
+          << "at " << position.transpose() << ", in scope: " << in_scope;
+      expectGradient(expected_gradient, gradient, position);
+    }
+  }
+}
+
+TEST_F(EsdfDistanceSourceTest, BatchLookupsMatchMap) {
+  std::vector<double> distances;
+  distance_source_.getDistances(positions_, &distances);
+  ASSERT_EQ(positions_.size(), distances.size());
+  for (size_t i = 0u; i < positions_.size(); ++i) {
+    EXPECT_EQ(getExpectedDistance(positions_[i]), distances[i])
+        << "at " << positions_[i].transpose();
+  }
+
+  std::vector<Eigen::Vector3d> gradients;
+  distance_source_.getDistancesAndGradients(positions_, &distances,
+                                            &gradients);
+  ASSERT_EQ(positions_.size(), distances.size());
+  ASSERT_EQ(positions_.size(), gradients.size());
+  for (size_t i = 0u; i < positions_.size(); ++i) {
+    Eigen::Vector3d expected_gradient;
+    EXPECT_EQ(getExpectedDistanceAndGradient(positions_[i],
+                                             &expected_gradient),
+              distances[i])
+        << "at " << positions_[i].transpose();
+    expectGradient(expected_gradient, gradients[i], positions_[i]);
+  }
+
+  // Without gradients, just the distances.
+  std::vector<double> distances_only;
+  distance_source_.getDistancesAndGradients(positions_, &distances_only,
+                                            nullptr);
+  std::vector<double> expected_distances;
+  distance_source_.getDistances(positions_, &expected_distances);
+  EXPECT_EQ(expected_distances, distances_only);
+}
+
+}  // namespace mav_planning
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  google::InitGoogleLogging(argv[0]);
+
+  return RUN_ALL_TESTS();
+}
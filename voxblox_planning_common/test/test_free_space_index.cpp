@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+
+#include "voxblox_planning_common/free_space_index.h"
+
+namespace mav_planning {
+
+class FreeSpaceIndexTest : public ::testing::Test {
+ protected:
+  static constexpr voxblox::FloatingPoint kVoxelSize = 0.1f;
+  static constexpr size_t kVoxelsPerSide = 4u;
+  static constexpr size_t kNumSamples = 20000u;
+
+  FreeSpaceIndexTest() : layer_(kVoxelSize, kVoxelsPerSide) {}
+
+  virtual void SetUp() {
+    seedRandom(5u);
+    index_.setTsdfLayer(&layer_);
+  }
+
+  // Allocates the block with its first num_free voxels free, and the rest
+  // occupied.
+  voxblox::Block<voxblox::TsdfVoxel>& setBlock(
+      const voxblox::BlockIndex& block_index, size_t num_free) {
+    voxblox::Block<voxblox::TsdfVoxel>::Ptr block =
+        layer_.allocateBlockPtrByIndex(block_index);
+    for (size_t i = 0u; i < block->num_voxels(); ++i) {
+      voxblox::TsdfVoxel& voxel = block->getVoxelByLinearIndex(i);
+      voxel.weight = 1.0f;
+      voxel.distance = i < num_free ? 0.2f : -0.05f;
+    }
+    return *block;
+  }
+
+  voxblox::BlockIndex getBlockIndex(const voxblox::Point& point) const {
+    return voxblox::getGridIndexFromPoint<voxblox::BlockIndex>(
+        point, 1.0f / layer_.block_size());
+  }
+
+  bool isFree(const voxblox::Point& point) const {
+    const voxblox::TsdfVoxel* voxel = layer_.getVoxelPtrByCoordinates(point);
+    return voxel != nullptr && voxel->weight > 0.0f && voxel->distance > 0.0f;
+  }
+
+  // Center of a sphere that holds all of blocks (0, 0, 0) and (1, 0, 0).
+  voxblox::Point getCenter() const {
+    return voxblox::Point(layer_.block_size(), 0.5f * layer_.block_size(),
+                          0.5f * layer_.block_size());
+  }
+
+  voxblox::Layer<voxblox::TsdfVoxel> layer_;
+  FreeSpaceIndex index_;
+};
+
+TEST_F(FreeSpaceIndexTest, WeightsBlocksByFreeVoxels) {
+  const size_t kNumFreeA = 48u;
+  const size_t kNumFreeB = 16u;
+  setBlock(voxblox::BlockIndex(0, 0, 0), kNumFreeA);
+  setBlock(voxblox::BlockIndex(1, 0, 0), kNumFreeB);
+  // Unobserved voxels aren't free, however far from the surface.
+  voxblox::Block<voxblox::TsdfVoxel>& unobserved_block =
+      setBlock(voxblox::BlockIndex(0, 1, 0), 64u);
+  for (size_t i = 0u; i < unobserved_block.num_voxels(); ++i) {
+    unobserved_block.getVoxelByLinearIndex(i).weight = 0.0f;
+  }
+  index_.updateAllBlocks();
+  EXPECT_EQ(kNumFreeA + kNumFreeB, index_.getNumFreeVoxels());
+
+  ASSERT_TRUE(index_.setQuerySphere(getCenter(), 10.0f));
+  size_t num_in_a = 0u;
+  for (size_t i = 0u; i < kNumSamples; ++i) {
+    voxblox::Point sample;
+    ASSERT_TRUE(index_.sampleFreePoint(&sample));
+    ASSERT_TRUE(isFree(sample)) << sample.transpose();
+    const voxblox::BlockIndex block_index = getBlockIndex(sample);
+    if (block_index == voxblox::BlockIndex(0, 0, 0)) {
+      ++num_in_a;
+    } else {
+      EXPECT_EQ(voxblox::BlockIndex(1, 0, 0), block_index);
+    }
+  }
+  // Uniform over the free voxels, so 3/4 of the samples are in block A.
+  const double kExpectedFraction =
+      static_cast<double>(kNumFreeA) / (kNumFreeA + kNumFreeB);
+  EXPECT_NEAR(kExpectedFraction, static_cast<double>(num_in_a) / kNumSamples,
+              0.02);
+}
+
+TEST_F(FreeSpaceIndexTest, SamplesOnlyInsideSphere) {
+  for (int x = 0; x < 4; ++x) {
+    setBlock(voxblox::BlockIndex(x, 0, 0), 64u);
+  }
+  index_.updateAllBlocks();
+
+  // Cuts through the voxels of the first block.
+  const voxblox::Point center(0.0f, 0.0f, 0.0f);
+  const voxblox::FloatingPoint kRadius = 0.25f;
+  ASSERT_TRUE(index_.setQuerySphere(center, kRadius));
+  EXPECT_TRUE(index_.isQuerySphere(center, kRadius));
+  EXPECT_FALSE(index_.isQuerySphere(center, 2.0f * kRadius));
+  for (size_t i = 0u; i < kNumSamples; ++i) {
+    voxblox::Point sample;
+    ASSERT_TRUE(index_.sampleFreePoint(&sample));
+    EXPECT_LE((sample - center).norm(), kRadius + 1e-6f);
+    EXPECT_TRUE(isFree(sample)) << sample.transpose();
+  }
+
+  // Nothing indexed anywhere near.
+  EXPECT_FALSE(index_.setQuerySphere(voxblox::Point(10.0f, 10.0f, 10.0f),
+                                     kRadius));
+  EXPECT_FALSE(index_.hasQuery());
+  voxblox::Point sample;
+  EXPECT_FALSE(index_.sampleFreePoint(&sample));
+}
+
+TEST_F(FreeSpaceIndexTest, DropsBlocksThatBecameOccupied) {
+  setBlock(voxblox::BlockIndex(0, 0, 0), 64u);
+  setBlock(voxblox::BlockIndex(1, 0, 0), 64u);
+  index_.updateChangedBlocks();
+  EXPECT_EQ(128u, index_.getNumFreeVoxels());
+  ASSERT_TRUE(index_.setQuerySphere(getCenter(), 10.0f));
+
+  // Nothing changed, so the query is still good.
+  index_.updateChangedBlocks();
+  EXPECT_TRUE(index_.hasQuery());
+
+  // Block B fills up. Nothing flags it, the index has to notice by itself.
+  setBlock(voxblox::BlockIndex(1, 0, 0), 0u);
+  index_.updateChangedBlocks();
+  EXPECT_EQ(64u, index_.getNumFreeVoxels());
+  EXPECT_FALSE(index_.hasQuery());
+  ASSERT_TRUE(index_.setQuerySphere(getCenter(), 10.0f));
+  for (size_t i = 0u; i < kNumSamples; ++i) {
+    voxblox::Point sample;
+    ASSERT_TRUE(index_.sampleFreePoint(&sample));
+    EXPECT_EQ(voxblox::BlockIndex(0, 0, 0), getBlockIndex(sample));
+  }
+
+  // Partly occupied blocks keep only their free voxels.
+  setBlock(voxblox::BlockIndex(0, 0, 0), 10u);
+  index_.updateChangedBlocks();
+  EXPECT_EQ(10u, index_.getNumFreeVoxels());
+
+  // And removed blocks go away.
+  layer_.removeBlock(voxblox::BlockIndex(0, 0, 0));
+  index_.updateChangedBlocks();
+  EXPECT_EQ(0u, index_.getNumFreeVoxels());
+  EXPECT_FALSE(index_.setQuerySphere(getCenter(), 10.0f));
+}
+
+}  // namespace mav_planning
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  google::InitGoogleLogging(argv[0]);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,185 @@
+#include <algorithm>
+#include <cmath>
+
+#include <gtest/gtest.h>
+#include <mav_planning_common/utils.h>
+
+#include "voxblox_planning_common/path_shortening.h"
+#include "voxblox_planning_common/synthetic_world.h"
+
+namespace mav_planning {
+
+class PathShorteningTest : public ::testing::Test {
+ protected:
+  static constexpr double kRobotRadius = 0.3;
+  // Distance between the waypoints of the input path, and how far it wiggles
+  // off the middle of the corridors.
+  static constexpr double kWaypointSpacing = 0.1;
+  static constexpr double kWiggle = 0.25;
+
+  virtual void SetUp() {
+    spec_.type = SyntheticWorldSpec::kCorridors;
+    spec_.size = Eigen::Vector3d(10.0, 8.0, 2.0);
+    spec_.corridor_width_m = 2.0;
+    spec_.voxel_size = 0.2;
+    spec_.voxels_per_side = 8;
+    spec_.esdf_max_distance_m = 2.0;
+
+    SyntheticWorldGenerator generator;
+    voxblox::Layer<voxblox::TsdfVoxel>::Ptr tsdf_layer;
+    generator.generate(spec_, &tsdf_layer, &esdf_layer_);
+
+    PhysicalConstraints constraints;
+    constraints.robot_radius = kRobotRadius;
+    shortener_.setConstraints(constraints);
+    shortener_.setEsdfLayer(esdf_layer_.get());
+
+    path_ = makeCorridorPath();
+  }
+
+  // Snakes through every corridor, wiggling from side to side on the way,
+  // through the open ends of the walls in between.
+  mav_msgs::EigenTrajectoryPointVector makeCorridorPath() const {
+    const double width = spec_.corridor_width_m;
+    const int num_corridors = static_cast<int>(spec_.size.y() / width);
+    const double near_x = 0.5 * width;
+    const double far_x = spec_.size.x() - 0.5 * width;
+    const double z = 0.5 * spec_.size.z();
+
+    mav_msgs::EigenTrajectoryPointVector path;
+    for (int i = 0; i < num_corridors; ++i) {
+      const double y = (i + 0.5) * width;
+      const double start_x = (i % 2 == 0) ? near_x : far_x;
+      const double end_x = (i % 2 == 0) ? far_x : near_x;
+      const int num_steps =
+          static_cast<int>(std::abs(end_x - start_x) / kWaypointSpacing);
+      for (int j = 0; j <= num_steps; ++j) {
+        const double t = static_cast<double>(j) / num_steps;
+        addWaypoint(Eigen::Vector3d(start_x + t * (end_x - start_x),
+                                    y + kWiggle * std::sin(6.0 * M_PI * t), z),
+                    &path);
+      }
+      // Over to the next corridor.
+      if (i + 1 < num_corridors) {
+        const int num_up_steps = static_cast<int>(width / kWaypointSpacing);
+        for (int j = 1; j < num_up_steps; ++j) {
+          const double t = static_cast<double>(j) / num_up_steps;
+          addWaypoint(Eigen::Vector3d(end_x, y + t * width, z), &path);
+        }
+      }
+    }
+    return path;
+  }
+
+  static void addWaypoint(const Eigen::Vector3d& position,
+                          mav_msgs::EigenTrajectoryPointVector* path) {
+    mav_msgs::EigenTrajectoryPoint point;
+    point.position_W = position;
+    path->push_back(point);
+  }
+
+  double getDistance(const Eigen::Vector3d& position) const {
+    const voxblox::EsdfVoxel* voxel = esdf_layer_->getVoxelPtrByCoordinates(
+        position.cast<voxblox::FloatingPoint>());
+    return voxel == nullptr ? -1.0 : voxel->distance;
+  }
+
+  // Checked independently of the shortener's own line checks, in steps of
+  // half a voxel. Nearest voxel lookups can be off by up to a voxel.
+  bool isPathFree(const mav_msgs::EigenTrajectoryPointVector& path) const {
+    const double step = 0.5 * spec_.voxel_size;
+    for (size_t i = 0u; i + 1u < path.size(); ++i) {
+      const Eigen::Vector3d& start = path[i].position_W;
+      const Eigen::Vector3d& end = path[i + 1u].position_W;
+      const int num_steps =
+          static_cast<int>(std::ceil((end - start).norm() / step));
+      for (int j = 0; j <= num_steps; ++j) {
+        const Eigen::Vector3d position =
+            start + (end - start) * j / std::max(num_steps, 1);
+        if (getDistance(position) < kRobotRadius - spec_.voxel_size) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  void expectShortened(const mav_msgs::EigenTrajectoryPointVector& shortened) {
+    ASSERT_GE(shortened.size(), 2u);
+    EXPECT_LT(shortened.size(), path_.size());
+    EXPECT_EQ(path_.front().position_W, shortened.front().position_W);
+    EXPECT_EQ(path_.back().position_W, shortened.back().position_W);
+    EXPECT_LE(computePathLength(shortened), computePathLength(path_));
+    EXPECT_TRUE(isPathFree(shortened));
+    // Can't cut through the walls, so at least a turn per wall end.
+    const int num_walls =
+        static_cast<int>(spec_.size.y() / spec_.corridor_width_m) - 1;
+    EXPECT_LE(static_cast<size_t>(num_walls + 2), shortened.size());
+    for (size_t i = 0u; i + 1u < shortened.size(); ++i) {
+      EXPECT_FALSE(shortener_.isLineInCollision(shortened[i].position_W,
+                                                shortened[i + 1u].position_W))
+          << "segment " << i;
+    }
+  }
+
+  void expectSamePath(const mav_msgs::EigenTrajectoryPointVector& expected,
+                      const mav_msgs::EigenTrajectoryPointVector& actual) {
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t i = 0u; i < expected.size(); ++i) {
+      EXPECT_EQ(expected[i].position_W, actual[i].position_W) << "point " << i;
+    }
+  }
+
+  SyntheticWorldSpec spec_;
+  voxblox::Layer<voxblox::EsdfVoxel>::Ptr esdf_layer_;
+  EsdfPathShortener shortener_;
+  mav_msgs::EigenTrajectoryPointVector path_;
+};
+
+TEST_F(PathShorteningTest, InputPathIsFree) {
+  // Long enough that the bisection splits off threads.
+  EXPECT_LT(200u, path_.size());
+  EXPECT_TRUE(isPathFree(path_));
+  for (const mav_msgs::EigenTrajectoryPoint& point : path_) {
+    EXPECT_LE(0.0, getDistance(point.position_W) - kRobotRadius)
+        << point.position_W.transpose();
+  }
+}
+
+TEST_F(PathShorteningTest, Bisection) {
+  shortener_.setShorteningMethod(EsdfPathShortener::kBisection);
+  shortener_.setNumThreads(1);
+  mav_msgs::EigenTrajectoryPointVector serial_path;
+  EXPECT_TRUE(shortener_.shortenPath(path_, &serial_path));
+  expectShortened(serial_path);
+
+  // Splitting the recursion over threads doesn't change what gets removed.
+  for (int num_threads : {2, 4, 8}) {
+    shortener_.setNumThreads(num_threads);
+    mav_msgs::EigenTrajectoryPointVector parallel_path;
+    EXPECT_TRUE(shortener_.shortenPath(path_, &parallel_path));
+    expectSamePath(serial_path, parallel_path);
+  }
+}
+
+TEST_F(PathShorteningTest, Greedy) {
+  shortener_.setShorteningMethod(EsdfPathShortener::kGreedy);
+  shortener_.setNumThreads(1);
+  mav_msgs::EigenTrajectoryPointVector serial_path;
+  EXPECT_TRUE(shortener_.shortenPath(path_, &serial_path));
+  expectShortened(serial_path);
+
+  shortener_.setNumThreads(4);
+  mav_msgs::EigenTrajectoryPointVector parallel_path;
+  EXPECT_TRUE(shortener_.shortenPath(path_, &parallel_path));
+  expectSamePath(serial_path, parallel_path);
+}
+
+}  // namespace mav_planning
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  google::InitGoogleLogging(argv[0]);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+
+#include "voxblox_planning_common/synthetic_world.h"
+
+namespace mav_planning {
+
+class SyntheticWorldTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    // Small and coarse, so generating it a few times is quick.
+    spec_.type = SyntheticWorldSpec::kRooms;
+    spec_.seed = 3;
+    spec_.size = Eigen::Vector3d(10.0, 10.0, 3.0);
+    spec_.add_ceiling = true;
+    spec_.obstacles_per_room = 1;
+    spec_.voxel_size = 0.25;
+    spec_.voxels_per_side = 8;
+    spec_.esdf_max_distance_m = 2.0;
+  }
+
+  void generate(const SyntheticWorldSpec& spec,
+                voxblox::Layer<voxblox::TsdfVoxel>::Ptr* tsdf_layer,
+                voxblox::Layer<voxblox::EsdfVoxel>::Ptr* esdf_layer) {
+    SyntheticWorldGenerator generator;
+    generator.setNumThreads(2);
+    generator.generate(spec, tsdf_layer, esdf_layer);
+    ASSERT_FALSE(generator.wasLoadedFromCache());
+  }
+
+  // Number of ESDF voxels whose distance differs between the two layers,
+  // which have to have the same blocks.
+  size_t countDifferentVoxels(const voxblox::Layer<voxblox::EsdfVoxel>& a,
+                              const voxblox::Layer<voxblox::EsdfVoxel>& b) {
+    voxblox::BlockIndexList blocks;
+    a.getAllAllocatedBlocks(&blocks);
+    EXPECT_EQ(a.getNumberOfAllocatedBlocks(), b.getNumberOfAllocatedBlocks());
+    size_t num_different = 0u;
+    for (const voxblox::BlockIndex& block_index : blocks) {
+      if (!b.hasBlock(block_index)) {
+        ADD_FAILURE() << "Block missing: " << block_index.transpose();
+        continue;
+      }
+      const voxblox::Block<voxblox::EsdfVoxel>& block_a =
+          a.getBlockByIndex(block_index);
+      const voxblox::Block<voxblox::EsdfVoxel>& block_b =
+          b.getBlockByIndex(block_index);
+      for (size_t i = 0u; i < block_a.num_voxels(); ++i) {
+        if (block_a.getVoxelByLinearIndex(i).distance !=
+            block_b.getVoxelByLinearIndex(i).distance) {
+          ++num_different;
+        }
+      }
+    }
+    return num_different;
+  }
+
+  SyntheticWorldSpec spec_;
+};
+
+TEST_F(SyntheticWorldTest, SameSpecSameWorld) {
+  voxblox::Layer<voxblox::TsdfVoxel>::Ptr tsdf_a, tsdf_b;
+  voxblox::Layer<voxblox::EsdfVoxel>::Ptr esdf_a, esdf_b;
+  generate(spec_, &tsdf_a, &esdf_a);
+
+  // A copy, not the same object, and generated with a different number of
+  // threads.
+  SyntheticWorldSpec spec_copy = spec_;
+  SyntheticWorldGenerator generator;
+  generator.setNumThreads(1);
+  generator.generate(spec_copy, &tsdf_b, &esdf_b);
+
+  EXPECT_EQ(spec_.toString(), spec_copy.toString());
+  EXPECT_EQ(spec_.getHash(), spec_copy.getHash());
+  EXPECT_EQ(0u, countDifferentVoxels(*esdf_a, *esdf_b));
+}
+
+TEST_F(SyntheticWorldTest, DifferentSeedDifferentWorld) {
+  voxblox::Layer<voxblox::TsdfVoxel>::Ptr tsdf_a, tsdf_b;
+  voxblox::Layer<voxblox::EsdfVoxel>::Ptr esdf_a, esdf_b;
+  generate(spec_, &tsdf_a, &esdf_a);
+
+  SyntheticWorldSpec other_spec = spec_;
+  other_spec.seed = spec_.seed + 1;
+  generate(other_spec, &tsdf_b, &esdf_b);
+
+  EXPECT_NE(spec_.getHash(), other_spec.getHash());
+  EXPECT_LT(0u, countDifferentVoxels(*esdf_a, *esdf_b));
+}
+
+TEST_F(SyntheticWorldTest, HashCoversEverySetting) {
+  SyntheticWorldSpec other_spec = spec_;
+  EXPECT_EQ(spec_.getHash(), other_spec.getHash());
+
+  other_spec.obstacles_per_room = 2;
+  EXPECT_NE(spec_.getHash(), other_spec.getHash());
+
+  other_spec = spec_;
+  other_spec.door_width_m += 1e-9;
+  EXPECT_NE(spec_.getHash(), other_spec.getHash());
+
+  other_spec = spec_;
+  other_spec.type = SyntheticWorldSpec::kForest;
+  EXPECT_NE(spec_.getHash(), other_spec.getHash());
+}
+
+}  // namespace mav_planning
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  google::InitGoogleLogging(argv[0]);
+
+  return RUN_ALL_TESTS();
+}
@@ -77,16 +77,20 @@ class MavSetup : public geometric::SimpleSetup {
             getSpaceInformation(), validity_checker)));
   }
 
+  // The distance pyramid is optional, see VoxbloxMotionValidator.
   void setEsdfVoxbloxCollisionChecking(
-      double robot_radius, voxblox::Layer<voxblox::EsdfVoxel>* esdf_layer) {
+      double robot_radius, voxblox::Layer<voxblox::EsdfVoxel>* esdf_layer,
+      const mav_planning::EsdfDistancePyramid* distance_pyramid) {
     std::shared_ptr<EsdfVoxbloxValidityChecker> validity_checker(
         new EsdfVoxbloxValidityChecker(getSpaceInformation(), robot_radius,
                                        esdf_layer));
 
     setStateValidityChecker(base::StateValidityCheckerPtr(validity_checker));
-    si_->setMotionValidator(
-        base::MotionValidatorPtr(new VoxbloxMotionValidator<voxblox::EsdfVoxel>(
-            getSpaceInformation(), validity_checker)));
+    VoxbloxMotionValidator<voxblox::EsdfVoxel>* motion_validator =
+        new VoxbloxMotionValidator<voxblox::EsdfVoxel>(getSpaceInformation(),
+                                                       validity_checker);
+    motion_validator->setDistancePyramid(distance_pyramid);
+    si_->setMotionValidator(base::MotionValidatorPtr(motion_validator));
   }
 
   void constructPrmRoadmap(double num_seconds_to_construct) {
@@ -3,10 +3,12 @@
 
 #include <ompl/base/StateValidityChecker.h>
 
+#include <mav_planning_common/planning_counters.h>
 #include <voxblox/core/esdf_map.h>
 #include <voxblox/core/tsdf_map.h>
 #include <voxblox/integrator/integrator_utils.h>
 #include <voxblox/utils/planning_utils.h>
+#include <voxblox_planning_common/esdf_distance_pyramid.h>
 
 #include "voxblox_rrt_planner/ompl/ompl_types.h"
 
@@ -26,6 +28,7 @@ class VoxbloxValidityChecker : public base::StateValidityChecker {
   }
 
   virtual bool isValid(const base::State* state) const {
+    ++mav_planning::getPlanningCounters().collision_checks;
     Eigen::Vector3d robot_position = omplToEigen(state);
     if (!si_->satisfiesBounds(state)) {
       return false;
@@ -47,6 +50,7 @@ class VoxbloxValidityChecker : public base::StateValidityChecker {
   }
 
   float voxel_size() const { return voxel_size_; }
+  double robot_radius() const { return robot_radius_; }
 
  protected:
   voxblox::Layer<VoxelType>* layer_;
@@ -72,6 +76,7 @@ class TsdfVoxbloxValidityChecker
   virtual bool checkCollisionWithRobot(
       const Eigen::Vector3d& robot_position) const {
     voxblox::Point robot_point = robot_position.cast<voxblox::FloatingPoint>();
+    ++mav_planning::getPlanningCounters().distance_queries;
 
     voxblox::HierarchicalIndexMap block_voxel_list;
     voxblox::utils::getSphereAroundPoint(*layer_, robot_point, robot_radius_,
@@ -130,6 +135,7 @@ class EsdfVoxbloxValidityChecker
   virtual bool checkCollisionWithRobot(
       const Eigen::Vector3d& robot_position) const {
     voxblox::Point robot_point = robot_position.cast<voxblox::FloatingPoint>();
+    ++mav_planning::getPlanningCounters().distance_queries;
     constexpr bool interpolate = false;
     voxblox::FloatingPoint distance;
     bool success = interpolator_.getDistance(
@@ -144,6 +150,7 @@ class EsdfVoxbloxValidityChecker
   virtual bool checkCollisionWithRobotAtVoxel(
       const voxblox::GlobalIndex& global_index) const {
     voxblox::EsdfVoxel* voxel = layer_->getVoxelPtrByGlobalIndex(global_index);
+    ++mav_planning::getPlanningCounters().distance_queries;
 
     if (voxel == nullptr) {
       return true;
@@ -165,10 +172,20 @@ class VoxbloxMotionValidator : public base::MotionValidator {
       const base::SpaceInformationPtr& space_info,
       typename std::shared_ptr<VoxbloxValidityChecker<VoxelType> >
           validity_checker)
-      : base::MotionValidator(space_info), validity_checker_(validity_checker) {
+      : base::MotionValidator(space_info),
+        validity_checker_(validity_checker),
+        distance_pyramid_(nullptr) {
     CHECK(validity_checker);
   }
 
+  // Optional, and only meaningful with the ESDF validity checker. OWNED BY
+  // ANOTHER OBJECT, which keeps it up to date with the layer. Voxels in blocks
+  // that are all further than the robot radius from obstacles aren't checked.
+  void setDistancePyramid(
+      const mav_planning::EsdfDistancePyramid* distance_pyramid) {
+    distance_pyramid_ = distance_pyramid;
+  }
+
   virtual bool checkMotion(const base::State* s1, const base::State* s2) const {
     std::pair<base::State*, double> unused;
     return checkMotion(s1, s2, unused);
@@ -180,6 +197,7 @@ class VoxbloxMotionValidator : public base::MotionValidator {
   // a valid state.
   virtual bool checkMotion(const base::State* s1, const base::State* s2,
                            std::pair<base::State*, double>& last_valid) const {
+    ++mav_planning::getPlanningCounters().collision_checks;
     Eigen::Vector3d start = omplToEigen(s1);
     Eigen::Vector3d goal = omplToEigen(s2);
     double voxel_size = validity_checker_->voxel_size();
@@ -194,9 +212,28 @@ class VoxbloxMotionValidator : public base::MotionValidator {
 
     voxblox::castRay(start_scaled, goal_scaled, &indices);
 
+    // Last region looked up in the pyramid, and whether it was free. Only
+    // looked up again once the ray leaves it.
+    bool region_valid = false;
+    bool region_free = false;
+    voxblox::GlobalIndex region_min, region_max;
+
     for (size_t i = 0; i < indices.size(); i++) {
       const voxblox::GlobalIndex& global_index = indices[i];
 
+      if (distance_pyramid_ != nullptr) {
+        if (!region_valid ||
+            (global_index.array() < region_min.array()).any() ||
+            (global_index.array() > region_max.array()).any()) {
+          region_free = distance_pyramid_->getFreeVoxelRegion(
+              global_index, validity_checker_->robot_radius(), &region_min,
+              &region_max);
+          region_valid = true;
+        }
+        if (region_free) {
+          continue;
+        }
+      }
 
       Eigen::Vector3d pos = global_index.cast<double>() * voxel_size;
       bool collision =
@@ -224,6 +261,7 @@ class VoxbloxMotionValidator : public base::MotionValidator {
  protected:
   typename std::shared_ptr<VoxbloxValidityChecker<VoxelType> >
       validity_checker_;
+  const mav_planning::EsdfDistancePyramid* distance_pyramid_;
 };
 
 }  // namespace mav
@@ -1,6 +1,9 @@
 #ifndef VOXBLOX_RRT_PLANNER_VOXBLOX_OMPL_RRT_H_
 #define VOXBLOX_RRT_PLANNER_VOXBLOX_OMPL_RRT_H_
 
+#include <chrono>
+#include <vector>
+
 #include <mav_msgs/conversions.h>
 #include <mav_msgs/eigen_mav_msgs.h>
 #include <ros/ros.h>
@@ -19,9 +22,29 @@ class VoxbloxOmplRrt {
     kPrm
   };
 
+  // How the best path improved during one planning call, for the anytime
+  // planners (RRT*, informed RRT*, BIT*) that keep going after the first
+  // solution. See setRecordCostTrace().
+  struct CostTracePoint {
+    // Since the start of the solve, not counting the time spent recording
+    // the earlier points.
+    double time_sec = 0.0;
+    // Path length of the best solution so far.
+    double cost = 0.0;
+    // Vertices in the planner's graph.
+    size_t tree_size = 0;
+    // Since the start of the solve, counted on the planning thread.
+    size_t collision_checks = 0;
+  };
+  typedef std::vector<CostTracePoint> CostTrace;
+
+  // Doesn't need ROS running, everything can be set through the setters.
+  VoxbloxOmplRrt();
   VoxbloxOmplRrt(const ros::NodeHandle& nh, const ros::NodeHandle& nh_private);
   virtual ~VoxbloxOmplRrt() {}
 
+  void setParametersFromRos(const ros::NodeHandle& nh);
+
   inline void setRobotRadius(double robot_radius) {
     robot_radius_ = robot_radius;
   }
@@ -32,6 +55,11 @@ class VoxbloxOmplRrt {
   // scope while this object exists.
   void setTsdfLayer(voxblox::Layer<voxblox::TsdfVoxel>* tsdf_layer);
   void setEsdfLayer(voxblox::Layer<voxblox::EsdfVoxel>* esdf_layer);
+  // Optional, same ownership. Speeds up motion checks against the ESDF, and
+  // has to be kept up to date with it by the owner.
+  void setDistancePyramid(const EsdfDistancePyramid* distance_pyramid) {
+    distance_pyramid_ = distance_pyramid;
+  }
 
   inline void setOptimistic(bool optimistic) { optimistic_ = optimistic; }
   bool getOptimistic() const { return optimistic_; }
@@ -41,6 +69,32 @@ class VoxbloxOmplRrt {
     num_seconds_to_plan_ = num_seconds;
   }
 
+  bool getSimplifySolution() const { return simplify_solution_; }
+  void setSimplifySolution(bool simplify_solution) {
+    simplify_solution_ = simplify_solution;
+  }
+
+  bool getTrustApproxSolution() const { return trust_approx_solution_; }
+  void setTrustApproxSolution(bool trust_approx_solution) {
+    trust_approx_solution_ = trust_approx_solution;
+  }
+
+  void setVerbose(bool verbose) { verbose_ = verbose; }
+
+  // Records a point in the cost trace every time the planner reports a better
+  // solution, and one for the final solution. Off by default, since getting
+  // the tree size copies the planner's graph every time. That happens on the
+  // planning thread and within the time to plan, so the planner gets less
+  // done in the same time, and whatever times the solve from outside counts
+  // the copies too: computation times of traced runs aren't comparable to
+  // untraced ones. The trace's own times leave the copies out.
+  bool getRecordCostTrace() const { return record_cost_trace_; }
+  void setRecordCostTrace(bool record_cost_trace) {
+    record_cost_trace_ = record_cost_trace;
+  }
+  // Of the last getPathBetweenWaypoints() or getBestPathTowardGoal() call.
+  const CostTrace& getCostTrace() const { return cost_trace_; }
+
   RrtPlannerType getPlanner() const { return planner_type_; }
   void setPlanner(RrtPlannerType planner) { planner_type_ = planner; }
 
@@ -76,8 +130,9 @@ class VoxbloxOmplRrt {
   double getDistanceEigenToState(const Eigen::Vector3d& eigen,
                                  const ompl::base::State* state_ptr);
 
-  ros::NodeHandle nh_;
-  ros::NodeHandle nh_private_;
+  // Solves and fills in the cost trace, if it's being recorded.
+  bool solve();
+  void addCostTracePoint(double cost);
 
   // Setup the problem in OMPL.
   ompl::mav::MavSetup problem_setup_;
@@ -97,6 +152,14 @@ class VoxbloxOmplRrt {
   // the exact goal state).
   bool trust_approx_solution_;
 
+  bool record_cost_trace_;
+  CostTrace cost_trace_;
+  // When the current solve started, and the collision check count then.
+  std::chrono::steady_clock::time_point solve_start_time_;
+  size_t solve_start_collision_checks_;
+  // Time the current solve spent in addCostTracePoint() so far.
+  double cost_trace_overhead_sec_;
+
   // Planning bounds, if set.
   Eigen::Vector3d lower_bound_;
   Eigen::Vector3d upper_bound_;
@@ -105,6 +168,7 @@ class VoxbloxOmplRrt {
   // ESDF only used if pessimistic.
   voxblox::Layer<voxblox::TsdfVoxel>* tsdf_layer_;
   voxblox::Layer<voxblox::EsdfVoxel>* esdf_layer_;
+  const EsdfDistancePyramid* distance_pyramid_;
 
   double voxel_size_;
 };
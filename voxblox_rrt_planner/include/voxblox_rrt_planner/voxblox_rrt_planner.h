@@ -3,8 +3,10 @@
 
 #include <ros/package.h>
 #include <ros/ros.h>
+#include <atomic>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <mav_msgs/conversions.h>
 #include <mav_path_smoothing/polynomial_smoother.h>
@@ -18,16 +20,40 @@
 #include <mav_trajectory_generation_ros/ros_visualization.h>
 #include <mav_visualization/helpers.h>
 #include <minkindr_conversions/kindr_msg.h>
+#include <voxblox_planning_common/esdf_distance_pyramid.h>
+#include <voxblox_planning_common/esdf_distance_source.h>
 #include <voxblox_ros/esdf_server.h>
 
 #include "voxblox_rrt_planner/voxblox_ompl_rrt.h"
 
 namespace mav_planning {
 
+// The smoothers run in parallel on the RRT* waypoints, on up to
+// num_smoothing_threads threads (0 is one per smoother). Which trajectory gets
+// published is up to the smoother_selection param, and the smoothers that
+// can't win anymore are cancelled.
 class VoxbloxRrtPlanner {
  public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
+  enum SmootherSelection {
+    // The first collision-free trajectory to come out.
+    kFirstFeasible = 0,
+    // The fastest collision-free trajectory out of the ones done by
+    // smoothing_deadline (or all of them, without a deadline).
+    kBestDuration
+  };
+
+  // The output of one of the smoothers, each writes to its own.
+  struct SmoothingCandidate {
+    std::string name;
+    bool success = false;
+    // Successful and collision-free.
+    bool feasible = false;
+    mav_trajectory_generation::Trajectory trajectory;
+    mav_msgs::EigenTrajectoryPointVector path;
+  };
+
   VoxbloxRrtPlanner(const ros::NodeHandle& nh,
                     const ros::NodeHandle& nh_private);
   virtual ~VoxbloxRrtPlanner() {}
@@ -39,18 +65,17 @@ class VoxbloxRrtPlanner {
   bool publishPathCallback(std_srvs::EmptyRequest& request,
                            std_srvs::EmptyResponse& response);
 
-  // Tools for trajectory smoothing and checking.
-  bool generateFeasibleTrajectory(
-      const mav_msgs::EigenTrajectoryPointVector& coordinate_path,
-      mav_msgs::EigenTrajectoryPointVector* path);
-  bool generateFeasibleTrajectoryLoco(
-      const mav_msgs::EigenTrajectoryPointVector& coordinate_path,
-      mav_msgs::EigenTrajectoryPointVector* path);
-  bool generateFeasibleTrajectoryLoco2(
-      const mav_msgs::EigenTrajectoryPointVector& coordinate_path,
-      mav_msgs::EigenTrajectoryPointVector* path);
+  // Runs all the smoothers and returns the selected candidate, nullptr if
+  // none is collision-free. Candidates are in the order poly, loco, loco2;
+  // cancelled ones aren't successful.
+  const SmoothingCandidate* runSmoothers(
+      const mav_msgs::EigenTrajectoryPointVector& waypoints,
+      std::vector<SmoothingCandidate>* candidates);
 
   double getMapDistance(const Eigen::Vector3d& position) const;
+  // Free region callback for the smoothers, see PolynomialSmoother.
+  bool getFreeRegion(const Eigen::Vector3d& position, double min_distance,
+                     Eigen::AlignedBox3d* region) const;
   bool checkPathForCollisions(const mav_msgs::EigenTrajectoryPointVector& path,
                               double* t) const;
   bool checkPhysicalConstraints(
@@ -68,6 +93,10 @@ class VoxbloxRrtPlanner {
   void computeMapBounds(Eigen::Vector3d* lower_bound,
                         Eigen::Vector3d* upper_bound) const;
 
+  void smoothWaypoints(const PolynomialSmoother& smoother,
+                       const mav_msgs::EigenTrajectoryPointVector& waypoints,
+                       SmoothingCandidate* candidate) const;
+
   ros::NodeHandle nh_;
   ros::NodeHandle nh_private_;
 
@@ -82,6 +111,12 @@ class VoxbloxRrtPlanner {
   std::string frame_id_;
   bool visualize_;
   bool do_smoothing_;
+  int num_smoothing_threads_;
+  SmootherSelection smoother_selection_;
+  // Seconds to wait for the smoothers, 0 is no limit.
+  double smoothing_deadline_;
+  // If set, tracing is on and the trace is written here after every request.
+  std::string trace_file_;
 
   // Robot parameters -- v max, a max, radius, etc.
   PhysicalConstraints constraints_;
@@ -106,6 +141,11 @@ class VoxbloxRrtPlanner {
   // Shortcuts to the maps:
   voxblox::EsdfMap::Ptr esdf_map_;
   voxblox::TsdfMap::Ptr tsdf_map_;
+  // Lookups in the server's ESDF, for getMapDistance() and LOCO.
+  EsdfDistanceSource distance_source_;
+  // Minimum ESDF distances over blocks, for skipping through open space in
+  // collision checks. Brought up to date on every plan request.
+  EsdfDistancePyramid distance_pyramid_;
 
   // Planners!
   VoxbloxOmplRrt rrt_;
@@ -113,6 +153,10 @@ class VoxbloxRrtPlanner {
   // Smoothing!
   PolynomialSmoother smoother_;
   LocoSmoother loco_smoother_;
+  // Same as loco_smoother_, but resamples the trajectory.
+  LocoSmoother loco2_smoother_;
+  // Set once the smoothers still running can't be selected anymore.
+  std::atomic<bool> cancel_smoothing_;
 };
 
 }  // namespace mav_planning
@@ -1,27 +1,37 @@
+#include <mav_planning_common/scoped_trace.h>
+
 #include "voxblox_rrt_planner/voxblox_ompl_rrt.h"
 
 namespace mav_planning {
 
-VoxbloxOmplRrt::VoxbloxOmplRrt(const ros::NodeHandle& nh,
-                               const ros::NodeHandle& nh_private)
-    : nh_(nh),
-      nh_private_(nh_private),
-      planner_type_(kRrtStar),
+VoxbloxOmplRrt::VoxbloxOmplRrt()
+    : planner_type_(kRrtStar),
       num_seconds_to_plan_(2.5),
       simplify_solution_(true),
       robot_radius_(1.0),
       verbose_(false),
       optimistic_(true),
       trust_approx_solution_(false),
+      record_cost_trace_(false),
+      solve_start_collision_checks_(0),
+      cost_trace_overhead_sec_(0.0),
       lower_bound_(Eigen::Vector3d::Zero()),
-      upper_bound_(Eigen::Vector3d::Zero()) {
-  nh_private_.param("robot_radius", robot_radius_, robot_radius_);
-  nh_private_.param("num_seconds_to_plan", num_seconds_to_plan_,
-                    num_seconds_to_plan_);
-  nh_private_.param("simplify_solution", simplify_solution_,
-                    simplify_solution_);
-  nh_private_.param("trust_approx_solution", trust_approx_solution_,
-                    trust_approx_solution_);
+      upper_bound_(Eigen::Vector3d::Zero()),
+      distance_pyramid_(nullptr) {}
+
+VoxbloxOmplRrt::VoxbloxOmplRrt(const ros::NodeHandle& nh,
+                               const ros::NodeHandle& nh_private)
+    : VoxbloxOmplRrt() {
+  setParametersFromRos(nh_private);
+}
+
+void VoxbloxOmplRrt::setParametersFromRos(const ros::NodeHandle& nh) {
+  nh.param("robot_radius", robot_radius_, robot_radius_);
+  nh.param("num_seconds_to_plan", num_seconds_to_plan_, num_seconds_to_plan_);
+  nh.param("simplify_solution", simplify_solution_, simplify_solution_);
+  nh.param("trust_approx_solution", trust_approx_solution_,
+           trust_approx_solution_);
+  nh.param("record_cost_trace", record_cost_trace_, record_cost_trace_);
 }
 
 void VoxbloxOmplRrt::setBounds(const Eigen::Vector3d& lower_bound,
@@ -50,7 +60,8 @@ void VoxbloxOmplRrt::setupProblem() {
     problem_setup_.setTsdfVoxbloxCollisionChecking(robot_radius_, tsdf_layer_);
   } else {
     CHECK_NOTNULL(esdf_layer_);
-    problem_setup_.setEsdfVoxbloxCollisionChecking(robot_radius_, esdf_layer_);
+    problem_setup_.setEsdfVoxbloxCollisionChecking(robot_radius_, esdf_layer_,
+                                                   distance_pyramid_);
   }
   problem_setup_.setDefaultObjective();
   if (planner_type_ == kRrtConnect) {
@@ -102,13 +113,14 @@ bool VoxbloxOmplRrt::getPathBetweenWaypoints(
   setupFromStartAndGoal(start, goal);
 
   // Solvin' time!
-  if (problem_setup_.solve(num_seconds_to_plan_)) {
+  if (solve()) {
     if (problem_setup_.haveExactSolutionPath()) {
       // Simplify and print.
       // TODO(helenol): look more into this. Appears to actually prefer more
       // vertices with presumably shorter total path length, which is
       // detrimental to polynomial planning.
       if (simplify_solution_) {
+        ScopedTrace trace("rrt/simplify", "rrt");
         problem_setup_.reduceVertices();
       }
       if (verbose_) {
@@ -156,6 +168,62 @@ void VoxbloxOmplRrt::setupFromStartAndGoal(
   }
 }
 
+bool VoxbloxOmplRrt::solve() {
+  ScopedTrace trace("rrt/solve", "rrt");
+  cost_trace_.clear();
+  const ompl::base::ProblemDefinitionPtr& problem_definition =
+      problem_setup_.getProblemDefinition();
+  if (!record_cost_trace_) {
+    problem_definition->setIntermediateSolutionCallback(
+        ompl::base::ReportIntermediateSolutionFn());
+    return problem_setup_.solve(num_seconds_to_plan_);
+  }
+
+  // Only the anytime planners report intermediate solutions, the others just
+  // get the final one.
+  problem_definition->setIntermediateSolutionCallback(
+      [this](const ompl::base::Planner* /*planner*/,
+             const std::vector<const ompl::base::State*>& /*states*/,
+             const ompl::base::Cost cost) { addCostTracePoint(cost.value()); });
+  solve_start_time_ = std::chrono::steady_clock::now();
+  solve_start_collision_checks_ = getPlanningCounters().collision_checks;
+  cost_trace_overhead_sec_ = 0.0;
+
+  const bool success = problem_setup_.solve(num_seconds_to_plan_);
+  if (problem_setup_.haveSolutionPath()) {
+    const double cost =
+        problem_setup_.getSolutionPath()
+            .cost(problem_definition->getOptimizationObjective())
+            .value();
+    if (cost_trace_.empty() || cost < cost_trace_.back().cost) {
+      addCostTracePoint(cost);
+    }
+  }
+  return success;
+}
+
+void VoxbloxOmplRrt::addCostTracePoint(double cost) {
+  const std::chrono::steady_clock::time_point start_time =
+      std::chrono::steady_clock::now();
+  CostTracePoint point;
+  point.time_sec =
+      std::chrono::duration<double>(start_time - solve_start_time_).count() -
+      cost_trace_overhead_sec_;
+  point.cost = cost;
+  point.collision_checks =
+      getPlanningCounters().collision_checks - solve_start_collision_checks_;
+  // Has to copy the whole graph, but there's no common way to ask the
+  // planners for their size.
+  ompl::base::PlannerData planner_data(problem_setup_.getSpaceInformation());
+  problem_setup_.getPlanner()->getPlannerData(planner_data);
+  point.tree_size = planner_data.numVertices();
+  cost_trace_.push_back(point);
+  cost_trace_overhead_sec_ += std::chrono::duration<double>(
+                                  std::chrono::steady_clock::now() -
+                                  start_time)
+                                  .count();
+}
+
 void VoxbloxOmplRrt::solutionPathToTrajectoryPoints(
     ompl::geometric::PathGeometric& path,
     mav_msgs::EigenTrajectoryPointVector* trajectory_points) const {
@@ -187,11 +255,12 @@ bool VoxbloxOmplRrt::getBestPathTowardGoal(
 
   // Solvin' time!
   bool solution_found = false;
-  solution_found = problem_setup_.solve(num_seconds_to_plan_);
+  solution_found = solve();
   if (solution_found) {
     if (problem_setup_.haveSolutionPath()) {
       // Simplify and print.
       if (simplify_solution_) {
+        ScopedTrace trace("rrt/simplify", "rrt");
         problem_setup_.reduceVertices();
       }
       if (verbose_) {
@@ -1,10 +1,18 @@
 #include <geometry_msgs/PoseArray.h>
+#include <mav_planning_common/map_query_scope.h>
 #include <mav_planning_common/path_visualization.h>
+#include <mav_planning_common/scoped_trace.h>
 #include <mav_planning_common/utils.h>
 #include <mav_trajectory_generation/polynomial_optimization_nonlinear.h>
 #include <mav_trajectory_generation/timing.h>
 #include <mav_trajectory_generation_ros/feasibility_analytic.h>
 #include <voxblox/utils/planning_utils.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <utility>
 
 #include "voxblox_rrt_planner/voxblox_rrt_planner.h"
 
@@ -17,11 +25,15 @@ VoxbloxRrtPlanner::VoxbloxRrtPlanner(const ros::NodeHandle& nh,
       frame_id_("odom"),
       visualize_(true),
       do_smoothing_(true),
+      num_smoothing_threads_(0),
+      smoother_selection_(kFirstFeasible),
+      smoothing_deadline_(0.0),
       last_trajectory_valid_(false),
       lower_bound_(Eigen::Vector3d::Zero()),
       upper_bound_(Eigen::Vector3d::Zero()),
       voxblox_server_(nh_, nh_private_),
-      rrt_(nh_, nh_private_) {
+      rrt_(nh_, nh_private_),
+      cancel_smoothing_(false) {
   constraints_.setParametersFromRos(nh_private_);
 
   std::string input_filepath;
@@ -29,6 +41,25 @@ VoxbloxRrtPlanner::VoxbloxRrtPlanner(const ros::NodeHandle& nh,
   nh_private_.param("visualize", visualize_, visualize_);
   nh_private_.param("frame_id", frame_id_, frame_id_);
   nh_private_.param("do_smoothing", do_smoothing_, do_smoothing_);
+  nh_private_.param("num_smoothing_threads", num_smoothing_threads_,
+                    num_smoothing_threads_);
+  nh_private_.param("smoothing_deadline", smoothing_deadline_,
+                    smoothing_deadline_);
+  std::string smoother_selection = "first_feasible";
+  nh_private_.param("smoother_selection", smoother_selection,
+                    smoother_selection);
+  if (smoother_selection == "first_feasible") {
+    smoother_selection_ = kFirstFeasible;
+  } else if (smoother_selection == "best_duration") {
+    smoother_selection_ = kBestDuration;
+  } else {
+    ROS_ERROR_STREAM("Unknown smoother selection: "
+                     << smoother_selection << ", using first_feasible.");
+  }
+  nh_private_.param("trace_file", trace_file_, trace_file_);
+  if (!trace_file_.empty()) {
+    setTracingEnabled(true);
+  }
 
   path_marker_pub_ =
       nh_private_.advertise<visualization_msgs::MarkerArray>("path", 1, true);
@@ -46,6 +77,7 @@ VoxbloxRrtPlanner::VoxbloxRrtPlanner(const ros::NodeHandle& nh,
 
   esdf_map_ = voxblox_server_.getEsdfMapPtr();
   CHECK(esdf_map_);
+  distance_source_.setEsdfMap(esdf_map_.get());
   tsdf_map_ = voxblox_server_.getTsdfMapPtr();
   CHECK(tsdf_map_);
 
@@ -80,6 +112,9 @@ VoxbloxRrtPlanner::VoxbloxRrtPlanner(const ros::NodeHandle& nh,
 
   rrt_.setTsdfLayer(voxblox_server_.getTsdfMapPtr()->getTsdfLayerPtr());
   rrt_.setEsdfLayer(voxblox_server_.getEsdfMapPtr()->getEsdfLayerPtr());
+  distance_pyramid_.setEsdfLayer(
+      voxblox_server_.getEsdfMapPtr()->getEsdfLayerPtr());
+  rrt_.setDistancePyramid(&distance_pyramid_);
 
   voxblox_server_.setTraversabilityRadius(constraints_.robot_radius);
 
@@ -88,12 +123,26 @@ VoxbloxRrtPlanner::VoxbloxRrtPlanner(const ros::NodeHandle& nh,
   smoother_.setMinCollisionCheckResolution(voxel_size);
   smoother_.setMapDistanceCallback(std::bind(&VoxbloxRrtPlanner::getMapDistance,
                                              this, std::placeholders::_1));
+  smoother_.setFreeRegionCallback(std::bind(
+      &VoxbloxRrtPlanner::getFreeRegion, this, std::placeholders::_1,
+      std::placeholders::_2, std::placeholders::_3));
+  smoother_.setCancelFlag(&cancel_smoothing_);
 
   // Loco smoother!
   loco_smoother_.setParametersFromRos(nh_private_);
   loco_smoother_.setMinCollisionCheckResolution(voxel_size);
   loco_smoother_.setMapDistanceCallback(std::bind(
       &VoxbloxRrtPlanner::getMapDistance, this, std::placeholders::_1));
+  loco_smoother_.setDistanceSource(&distance_source_);
+  loco_smoother_.setFreeRegionCallback(std::bind(
+      &VoxbloxRrtPlanner::getFreeRegion, this, std::placeholders::_1,
+      std::placeholders::_2, std::placeholders::_3));
+  loco_smoother_.setCancelFlag(&cancel_smoothing_);
+  loco_smoother_.setAddWaypoints(false);
+  // The smoothers run at the same time, so each variant gets its own.
+  loco2_smoother_ = loco_smoother_;
+  loco_smoother_.setResampleTrajectory(false);
+  loco2_smoother_.setResampleTrajectory(true);
 
   if (visualize_) {
     voxblox_server_.generateMesh();
@@ -165,6 +214,12 @@ bool VoxbloxRrtPlanner::plannerServiceCallback(
   // Figure out map bounds!
   computeMapBounds(&lower_bound_, &upper_bound_);
 
+  // Only the groups above ESDF blocks that changed since the last request
+  // get recomputed.
+  mav_trajectory_generation::timing::Timer pyramid_timer("plan/pyramid");
+  distance_pyramid_.updateChangedBlocks();
+  pyramid_timer.Stop();
+
   ROS_INFO_STREAM("Map bounds: " << lower_bound_.transpose() << " to "
                                  << upper_bound_.transpose() << " size: "
                                  << (upper_bound_ - lower_bound_).transpose());
@@ -201,6 +256,9 @@ bool VoxbloxRrtPlanner::plannerServiceCallback(
            path_length, num_vertices);
 
   if (!success) {
+    if (!trace_file_.empty()) {
+      writeChromeTrace(trace_file_);
+    }
     return false;
   }
 
@@ -219,43 +277,34 @@ bool VoxbloxRrtPlanner::plannerServiceCallback(
   if (!do_smoothing_) {
     last_trajectory_valid_ = true;
   } else {
-    mav_msgs::EigenTrajectoryPointVector poly_path;
-    mav_trajectory_generation::timing::Timer poly_timer("plan/poly");
-    bool poly_has_collisions =
-        !generateFeasibleTrajectory(waypoints, &poly_path);
-    poly_timer.Stop();
-
-    mav_msgs::EigenTrajectoryPointVector loco_path;
-    mav_trajectory_generation::timing::Timer loco_timer("plan/loco");
-    bool loco_has_collisions =
-        !generateFeasibleTrajectoryLoco(waypoints, &loco_path);
-    loco_timer.Stop();
-
-    mav_msgs::EigenTrajectoryPointVector loco2_path;
-    mav_trajectory_generation::timing::Timer loco2_timer("plan/loco2");
-    bool loco2_has_collisions =
-        !generateFeasibleTrajectoryLoco2(waypoints, &loco2_path);
-    loco2_timer.Stop();
-
-    ROS_INFO(
-        "Poly Smoothed Path has collisions? %d Loco Path has collisions? %d "
-        "Loco 2 has collisions? %d",
-        poly_has_collisions, loco_has_collisions, loco2_has_collisions);
-
-    if (!poly_has_collisions) {
-      last_trajectory_valid_ = true;
+    std::vector<SmoothingCandidate> candidates;
+    mav_trajectory_generation::timing::Timer smoothing_timer("plan/smoothing");
+    const SmoothingCandidate* selected = runSmoothers(waypoints, &candidates);
+    smoothing_timer.Stop();
+
+    for (const SmoothingCandidate& candidate : candidates) {
+      ROS_INFO("Smoother %s success? %d collision free? %d duration: %f",
+               candidate.name.c_str(), candidate.success, candidate.feasible,
+               candidate.success ? candidate.trajectory.getMaxTime() : 0.0);
+    }
+    last_trajectory_valid_ = selected != nullptr;
+    if (selected != nullptr) {
+      ROS_INFO("Selected %s trajectory.", selected->name.c_str());
+      last_trajectory_ = selected->trajectory;
+    } else {
+      ROS_WARN("No smoother found a collision-free trajectory.");
     }
 
     if (visualize_) {
-      marker_array.markers.push_back(createMarkerForPath(
-          poly_path, frame_id_, mav_visualization::Color::Orange(), "poly",
-          0.075));
-      marker_array.markers.push_back(
-          createMarkerForPath(loco_path, frame_id_,
-                              mav_visualization::Color::Pink(), "loco", 0.075));
-      marker_array.markers.push_back(createMarkerForPath(
-          loco2_path, frame_id_, mav_visualization::Color::Teal(), "loco2",
-          0.075));
+      // Same order as the candidates.
+      const std::vector<mav_visualization::Color> colors = {
+          mav_visualization::Color::Orange(), mav_visualization::Color::Pink(),
+          mav_visualization::Color::Teal()};
+      for (size_t i = 0; i < candidates.size(); ++i) {
+        marker_array.markers.push_back(
+            createMarkerForPath(candidates[i].path, frame_id_, colors[i],
+                                candidates[i].name, 0.075));
+      }
     }
   }
 
@@ -271,56 +320,128 @@ bool VoxbloxRrtPlanner::plannerServiceCallback(
   ROS_INFO_STREAM("Finished planning with start point: "
                   << start_pose.position_W.transpose()
                   << " and goal point: " << goal_pose.position_W.transpose());
+  if (!trace_file_.empty()) {
+    writeChromeTrace(trace_file_);
+  }
   return success;
 }
 
-bool VoxbloxRrtPlanner::generateFeasibleTrajectory(
-    const mav_msgs::EigenTrajectoryPointVector& coordinate_path,
-    mav_msgs::EigenTrajectoryPointVector* path) {
-  smoother_.getPathBetweenWaypoints(coordinate_path, path);
-
-  bool path_in_collision = checkPathForCollisions(*path, NULL);
-
-  if (path_in_collision) {
-    return false;
+const VoxbloxRrtPlanner::SmoothingCandidate* VoxbloxRrtPlanner::runSmoothers(
+    const mav_msgs::EigenTrajectoryPointVector& waypoints,
+    std::vector<SmoothingCandidate>* candidates) {
+  CHECK_NOTNULL(candidates);
+  const std::vector<std::pair<std::string, const PolynomialSmoother*> >
+      smoothers = {{"poly", &smoother_},
+                   {"loco", &loco_smoother_},
+                   {"loco2", &loco2_smoother_}};
+  candidates->clear();
+  candidates->resize(smoothers.size());
+  for (size_t i = 0; i < smoothers.size(); ++i) {
+    (*candidates)[i].name = smoothers[i].first;
   }
-  return true;
-}
-
-bool VoxbloxRrtPlanner::generateFeasibleTrajectoryLoco(
-    const mav_msgs::EigenTrajectoryPointVector& coordinate_path,
-    mav_msgs::EigenTrajectoryPointVector* path) {
-  loco_smoother_.setResampleTrajectory(false);
-  loco_smoother_.setAddWaypoints(false);
 
-  loco_smoother_.getPathBetweenWaypoints(coordinate_path, path);
+  int num_threads = num_smoothing_threads_;
+  if (num_threads <= 0) {
+    num_threads = smoothers.size();
+  }
+  num_threads = std::min(num_threads, static_cast<int>(smoothers.size()));
+
+  // Indices of the candidates in the order they finished in.
+  std::vector<size_t> finished;
+  std::mutex finished_mutex;
+  std::condition_variable finished_condition;
+  std::atomic<size_t> next_smoother(0);
+  cancel_smoothing_ = false;
+
+  std::vector<std::future<void> > futures;
+  for (int i = 0; i < num_threads; ++i) {
+    futures.push_back(std::async(std::launch::async, [&]() {
+      size_t index;
+      while ((index = next_smoother++) < smoothers.size()) {
+        // Not worth starting once it's decided.
+        if (cancel_smoothing_) {
+          return;
+        }
+        smoothWaypoints(*smoothers[index].second, waypoints,
+                        &(*candidates)[index]);
+        std::lock_guard<std::mutex> lock(finished_mutex);
+        finished.push_back(index);
+        finished_condition.notify_all();
+      }
+    }));
+  }
 
-  bool path_in_collision = checkPathForCollisions(*path, NULL);
+  // Wait until the selection can't change anymore (or the deadline), then
+  // cancel the rest. Only the candidates done by then are considered.
+  size_t num_considered = 0;
+  {
+    std::unique_lock<std::mutex> lock(finished_mutex);
+    auto is_decided = [&]() {
+      if (finished.size() == smoothers.size()) {
+        return true;
+      }
+      if (smoother_selection_ == kFirstFeasible) {
+        for (size_t index : finished) {
+          if ((*candidates)[index].feasible) {
+            return true;
+          }
+        }
+      }
+      return false;
+    };
+    if (smoothing_deadline_ > 0.0) {
+      const std::chrono::steady_clock::time_point deadline =
+          std::chrono::steady_clock::now() +
+          std::chrono::microseconds(
+              static_cast<int64_t>(smoothing_deadline_ * 1e6));
+      finished_condition.wait_until(lock, deadline, is_decided);
+    } else {
+      finished_condition.wait(lock, is_decided);
+    }
+    num_considered = finished.size();
+    cancel_smoothing_ = true;
+  }
+  for (std::future<void>& future : futures) {
+    future.get();
+  }
+  cancel_smoothing_ = false;
 
-  if (path_in_collision) {
-    return false;
+  const SmoothingCandidate* selected = nullptr;
+  for (size_t i = 0; i < num_considered; ++i) {
+    const SmoothingCandidate& candidate = (*candidates)[finished[i]];
+    if (!candidate.feasible) {
+      continue;
+    }
+    if (smoother_selection_ == kFirstFeasible) {
+      selected = &candidate;
+      break;
+    }
+    if (selected == nullptr || candidate.trajectory.getMaxTime() <
+                                   selected->trajectory.getMaxTime()) {
+      selected = &candidate;
+    }
   }
-  return true;
+  return selected;
 }
 
-bool VoxbloxRrtPlanner::generateFeasibleTrajectoryLoco2(
-    const mav_msgs::EigenTrajectoryPointVector& coordinate_path,
-    mav_msgs::EigenTrajectoryPointVector* path) {
-  loco_smoother_.setResampleTrajectory(true);
-  loco_smoother_.setAddWaypoints(false);
-
-  loco_smoother_.getPathBetweenWaypoints(coordinate_path, path);
-
-  bool path_in_collision = checkPathForCollisions(*path, NULL);
-
-  if (path_in_collision) {
-    return false;
+void VoxbloxRrtPlanner::smoothWaypoints(
+    const PolynomialSmoother& smoother,
+    const mav_msgs::EigenTrajectoryPointVector& waypoints,
+    SmoothingCandidate* candidate) const {
+  CHECK_NOTNULL(candidate);
+  candidate->success =
+      smoother.getTrajectoryBetweenWaypoints(waypoints, &candidate->trajectory);
+  if (!candidate->success) {
+    return;
   }
-  return true;
+  mav_trajectory_generation::sampleWholeTrajectory(
+      candidate->trajectory, constraints_.sampling_dt, &candidate->path);
+  candidate->feasible = !checkPathForCollisions(candidate->path, NULL);
 }
 
 bool VoxbloxRrtPlanner::checkPathForCollisions(
     const mav_msgs::EigenTrajectoryPointVector& path, double* t) const {
+  MapQueryScope scope;
   for (const mav_msgs::EigenTrajectoryPoint& point : path) {
     if (getMapDistance(point.position_W) < constraints_.robot_radius) {
       if (t != NULL) {
@@ -334,15 +455,21 @@ bool VoxbloxRrtPlanner::checkPathForCollisions(
 
 double VoxbloxRrtPlanner::getMapDistance(
     const Eigen::Vector3d& position) const {
-  if (!voxblox_server_.getEsdfMapPtr()) {
-    return 0.0;
-  }
-  double distance = 0.0;
-  if (!voxblox_server_.getEsdfMapPtr()->getDistanceAtPosition(position,
-                                                              &distance)) {
-    return 0.0;
+  return distance_source_.getDistance(position);
+}
+
+bool VoxbloxRrtPlanner::getFreeRegion(const Eigen::Vector3d& position,
+                                      double min_distance,
+                                      Eigen::AlignedBox3d* region) const {
+  if (!distance_pyramid_.getFreeRegion(position, min_distance, region)) {
+    return false;
   }
-  return distance;
+  // Map distances are interpolated, so stay a voxel away from the edges,
+  // where the neighbors would be outside of the region.
+  const double voxel_size = esdf_map_->voxel_size();
+  region->min() += Eigen::Vector3d::Constant(voxel_size);
+  region->max() -= Eigen::Vector3d::Constant(voxel_size);
+  return true;
 }
 
 bool VoxbloxRrtPlanner::checkPhysicalConstraints(
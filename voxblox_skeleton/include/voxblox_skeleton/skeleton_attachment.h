@@ -0,0 +1,61 @@
+#ifndef VOXBLOX_SKELETON_SKELETON_ATTACHMENT_H_
+#define VOXBLOX_SKELETON_SKELETON_ATTACHMENT_H_
+
+#include <voxblox/core/common.h>
+#include <voxblox/core/layer.h>
+#include <voxblox/core/voxel.h>
+
+#include "voxblox_skeleton/skeleton.h"
+#include "voxblox_skeleton/skeleton_voxel.h"
+
+namespace voxblox {
+
+// Builds the attachment field of a sparse graph: for every free voxel, the
+// shortest path through free space to the closest (along that path) graph
+// vertex, stored as one step per voxel. Connecting a start or goal to the
+// graph is then just following the steps, instead of an A* through the ESDF
+// for every query.
+//
+// Built with one multi-source Dijkstra out from all the vertices, so the
+// field belongs to that exact graph (vertex IDs) and has to be rebuilt with
+// it.
+class SkeletonAttachmentGenerator {
+ public:
+  SkeletonAttachmentGenerator();
+
+  // Owned by someone else.
+  void setEsdfLayer(const Layer<EsdfVoxel>* esdf_layer) {
+    CHECK_NOTNULL(esdf_layer);
+    esdf_layer_ = esdf_layer;
+  }
+
+  // Voxels closer than this to obstacles aren't free. Should be the same
+  // robot radius the graph was built with.
+  float getMinEsdfDistance() const { return min_esdf_distance_; }
+  void setMinEsdfDistance(float min_esdf_distance) {
+    min_esdf_distance_ = min_esdf_distance;
+  }
+
+  // Clears the attachment layer and fills it for every allocated ESDF block.
+  // The layers must have the same voxel size and voxels per side.
+  void generate(const SparseSkeletonGraph& graph,
+                Layer<SkeletonAttachmentVoxel>* attachment_layer) const;
+
+ private:
+  float min_esdf_distance_;
+
+  const Layer<EsdfVoxel>* esdf_layer_;
+};
+
+// Follows the field from the voxel of position to its vertex. The path
+// starts at position, goes through the voxel centers and ends at the vertex
+// voxel. Returns false if position isn't attached (outside the map, not free
+// or cut off from the graph).
+bool getSkeletonAttachmentPath(
+    const Layer<SkeletonAttachmentVoxel>& attachment_layer,
+    const Point& position, AlignedVector<Point>* coordinate_path,
+    int64_t* vertex_id);
+
+}  // namespace voxblox
+
+#endif  // VOXBLOX_SKELETON_SKELETON_ATTACHMENT_H_
@@ -15,9 +15,24 @@ struct SkeletonVoxel {
   int64_t vertex_id = -1;
 };
 
+// One step of the shortest free path from this voxel to the sparse graph,
+// see SkeletonAttachmentGenerator.
+struct SkeletonAttachmentVoxel {
+  static constexpr uint8_t kNoParent = 0xFF;
+
+  // Length of the path to the vertex.
+  float distance = 0.0f;
+  // Index into Neighborhood<>::kOffsets of the next voxel on the path,
+  // kNoParent on the vertex itself.
+  uint8_t parent_direction = kNoParent;
+  // Vertex the path ends at, -1 if no path reaches this voxel.
+  int64_t vertex_id = -1;
+};
+
 // Used for serialization only.
 namespace voxel_types {
 const std::string kSkeleton = "skeleton";
+const std::string kSkeletonAttachment = "skeleton_attachment";
 }
 
 template <>
@@ -25,6 +40,11 @@ inline std::string getVoxelType<SkeletonVoxel>() {
   return voxel_types::kSkeleton;
 }
 
+template <>
+inline std::string getVoxelType<SkeletonAttachmentVoxel>() {
+  return voxel_types::kSkeletonAttachment;
+}
+
 }  // namespace voxblox
 
 #endif  // VOXBLOX_SKELETON_SKELETON_VOXEL_H_
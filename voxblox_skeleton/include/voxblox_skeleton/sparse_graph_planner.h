@@ -1,6 +1,10 @@
 #ifndef VOXBLOX_SKELETON_SPARSE_GRAPH_PLANNER_H_
 #define VOXBLOX_SKELETON_SPARSE_GRAPH_PLANNER_H_
 
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 #include <voxblox/core/common.h>
 #include <voxblox/utils/neighbor_tools.h>
 
@@ -17,14 +21,26 @@ class SparseGraphPlanner {
       DirectSkeletonVertexMapAdapter, 3>
       VertexGraphKdTree;
 
+  // Made by getDistancesToVertices(), for getting paths from it, and only
+  // meaningful to the planner that made it.
+  struct SearchTree {
+    int64_t start_vertex_id = -1;
+    // Index of the parent of each vertex (see vertex_ids_), -1 for none.
+    std::vector<int> parent_indices;
+  };
+
   SparseGraphPlanner();
 
-  void setGraph(SparseSkeletonGraph* graph) {
+  // The graph is only read, and the queries below don't change the planner,
+  // so any number of threads can plan on it at once after setup().
+  void setGraph(const SparseSkeletonGraph* graph) {
     CHECK_NOTNULL(graph);
     graph_ = graph;
   }
+  const SparseSkeletonGraph* getGraph() const { return graph_; }
 
-  // Creates the kD trees. MUST be called before the first planning iteration.
+  // Creates the kD trees and the compact copy of the graph. MUST be called
+  // before the first planning iteration.
   void setup();
 
   // Creates a path from the nearest vertex to the start position to the nearest
@@ -39,6 +55,22 @@ class SparseGraphPlanner {
   // Gets the path between vertex IDs.
   bool getPathBetweenVertices(int64_t start_vertex_id, int64_t end_vertex_id,
                               std::vector<int64_t>* vertex_path) const;
+  // Same, as the vertex positions.
+  bool getPathBetweenVertices(int64_t start_vertex_id, int64_t end_vertex_id,
+                              AlignedVector<Point>* coordinate_path) const;
+
+  // Graph distances from the start vertex to all the target vertices at once
+  // (max() for the ones it can't reach), with a Dijkstra search that stops
+  // once it got to all of them. If search_tree isn't null, it gets what
+  // getPathFromSearchTree() needs to get the paths to them.
+  void getDistancesToVertices(int64_t start_vertex_id,
+                              const std::vector<int64_t>& target_vertex_ids,
+                              std::vector<FloatingPoint>* distances,
+                              SearchTree* search_tree) const;
+  // Path from the start of the search to the end vertex.
+  bool getPathFromSearchTree(const SearchTree& search_tree,
+                             int64_t end_vertex_id,
+                             AlignedVector<Point>* coordinate_path) const;
 
  private:
   int64_t popSmallestFromOpen(
@@ -49,7 +81,15 @@ class SparseGraphPlanner {
                        const std::map<int64_t, int64_t>& parent_map,
                        std::vector<int64_t>* vertex_path) const;
 
-  SparseSkeletonGraph* graph_;
+  const SparseSkeletonGraph* graph_;
+
+  // Compact copy of the graph, for searches that go through much of it. The
+  // vertex IDs by index, and the neighbors of the vertex at index i, with
+  // the distances to them, from adjacency_start_[i] to adjacency_start_[i+1].
+  std::vector<int64_t> vertex_ids_;
+  std::unordered_map<int64_t, int> vertex_indices_;
+  std::vector<size_t> adjacency_start_;
+  std::vector<std::pair<int, FloatingPoint> > adjacency_;
 
   std::unique_ptr<VertexGraphKdTree> kd_tree_;
   std::unique_ptr<DirectSkeletonVertexMapAdapter> kd_tree_adapter_;
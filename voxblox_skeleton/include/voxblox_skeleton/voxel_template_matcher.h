@@ -1,6 +1,7 @@
 #ifndef VOXBLOX_SKELETON_VOXEL_TEMPLATE_MATCHER_H_
 #define VOXBLOX_SKELETON_VOXEL_TEMPLATE_MATCHER_H_
 
+#include <stdint.h>
 #include <bitset>
 #include <vector>
 
@@ -17,6 +18,8 @@ struct VoxelTemplate {
 
 // Does binary matching against a 3D (3x3x3) voxel template. The template has
 // 2 parts: an attention mask and the actual template values.
+// Neighbors, masks and templates can also be given as the lowest 27 bits of
+// an integer, same bit order as the bitsets.
 class VoxelTemplateMatcher {
  public:
   VoxelTemplateMatcher();
@@ -28,6 +31,14 @@ class VoxelTemplateMatcher {
 
   // Returns true if ANY template is matched.
   bool fitsTemplates(const std::bitset<27>& voxel_neighbors) const;
+  bool fitsTemplates(uint32_t voxel_neighbors) const;
+  // Matches many voxels at once, much faster per voxel than one at a time:
+  // fits[i] is 1 if voxel_neighbors[i] matches ANY template, 0 otherwise.
+  void fitsTemplates(const std::vector<uint32_t>& voxel_neighbors,
+                     std::vector<uint8_t>* fits) const;
+
+  size_t getNumTemplates() const { return num_templates_; }
+  std::vector<VoxelTemplate> getTemplates() const;
 
   // Default deletion templates from She et al.
   void setDeletionTemplates();
@@ -41,9 +52,13 @@ class VoxelTemplateMatcher {
   std::bitset<27> get6ConnNeighborMask() const;
   std::bitset<27> get18ConnNeighborMask() const;
 
-
  private:
-  std::vector<VoxelTemplate> templates_;
+  // One entry per template, in separate arrays, so that matching is the same
+  // operation over consecutive integers (SSE2 where available). Padded with
+  // templates that never match to a multiple of 4 entries.
+  std::vector<uint32_t> neighbor_masks_;
+  std::vector<uint32_t> neighbor_templates_;
+  size_t num_templates_;
 };
 
 }  // namespace voxblox
@@ -0,0 +1,148 @@
+#include <functional>
+#include <queue>
+#include <vector>
+
+#include <voxblox/utils/neighbor_tools.h>
+
+#include "voxblox_skeleton/skeleton_attachment.h"
+
+namespace voxblox {
+
+namespace {
+
+struct OpenVoxel {
+  FloatingPoint distance;
+  GlobalIndex global_index;
+
+  bool operator>(const OpenVoxel& other) const {
+    return distance > other.distance;
+  }
+};
+
+}  // namespace
+
+SkeletonAttachmentGenerator::SkeletonAttachmentGenerator()
+    : min_esdf_distance_(0.0f), esdf_layer_(nullptr) {}
+
+void SkeletonAttachmentGenerator::generate(
+    const SparseSkeletonGraph& graph,
+    Layer<SkeletonAttachmentVoxel>* attachment_layer) const {
+  CHECK_NOTNULL(esdf_layer_);
+  CHECK_NOTNULL(attachment_layer);
+  CHECK_NEAR(esdf_layer_->voxel_size(), attachment_layer->voxel_size(),
+             1e-6);
+  CHECK_EQ(esdf_layer_->voxels_per_side(),
+           attachment_layer->voxels_per_side());
+
+  // Allocate everything up front, so the search only has to look up voxels.
+  attachment_layer->removeAllBlocks();
+  BlockIndexList blocks;
+  esdf_layer_->getAllAllocatedBlocks(&blocks);
+  for (const BlockIndex& block_index : blocks) {
+    attachment_layer->allocateBlockPtrByIndex(block_index);
+  }
+
+  const FloatingPoint voxel_size = esdf_layer_->voxel_size();
+  const FloatingPoint voxel_size_inv = 1.0 / voxel_size;
+
+  // Voxels store the direction back towards the vertex, i.e. the opposite of
+  // the direction the search went.
+  Neighborhood<>::IndexMatrix neighbors;
+  const int num_neighbors = neighbors.cols();
+  std::vector<uint8_t> opposite_direction(num_neighbors);
+  for (int i = 0; i < num_neighbors; ++i) {
+    for (int j = 0; j < num_neighbors; ++j) {
+      if (Neighborhood<>::kOffsets.col(i) == -Neighborhood<>::kOffsets.col(j)) {
+        opposite_direction[i] = static_cast<uint8_t>(j);
+      }
+    }
+  }
+
+  std::priority_queue<OpenVoxel, std::vector<OpenVoxel>,
+                      std::greater<OpenVoxel> >
+      open_set;
+  for (const std::pair<const int64_t, SkeletonVertex>& kv :
+       graph.getVertexMap()) {
+    const GlobalIndex global_index =
+        getGridIndexFromPoint<GlobalIndex>(kv.second.point, voxel_size_inv);
+    SkeletonAttachmentVoxel* voxel =
+        attachment_layer->getVoxelPtrByGlobalIndex(global_index);
+    // If two vertices share a voxel, the first one gets it.
+    if (voxel == nullptr || voxel->vertex_id >= 0) {
+      continue;
+    }
+    voxel->distance = 0.0f;
+    voxel->parent_direction = SkeletonAttachmentVoxel::kNoParent;
+    voxel->vertex_id = kv.first;
+    open_set.push(OpenVoxel{0.0f, global_index});
+  }
+
+  while (!open_set.empty()) {
+    const OpenVoxel current = open_set.top();
+    open_set.pop();
+    const SkeletonAttachmentVoxel* current_voxel =
+        attachment_layer->getVoxelPtrByGlobalIndex(current.global_index);
+    // Already reached through a shorter path since this was queued.
+    if (current.distance > current_voxel->distance) {
+      continue;
+    }
+
+    Neighborhood<>::getFromGlobalIndex(current.global_index, &neighbors);
+    for (int i = 0; i < num_neighbors; ++i) {
+      const GlobalIndex neighbor_index = neighbors.col(i);
+      SkeletonAttachmentVoxel* neighbor_voxel =
+          attachment_layer->getVoxelPtrByGlobalIndex(neighbor_index);
+      if (neighbor_voxel == nullptr) {
+        continue;
+      }
+      const FloatingPoint distance =
+          current.distance + Neighborhood<>::kDistances(i) * voxel_size;
+      if (neighbor_voxel->vertex_id >= 0 &&
+          neighbor_voxel->distance <= distance) {
+        continue;
+      }
+      const EsdfVoxel* esdf_voxel =
+          esdf_layer_->getVoxelPtrByGlobalIndex(neighbor_index);
+      if (esdf_voxel == nullptr || !esdf_voxel->observed ||
+          esdf_voxel->distance < min_esdf_distance_) {
+        continue;
+      }
+      neighbor_voxel->distance = distance;
+      neighbor_voxel->parent_direction = opposite_direction[i];
+      neighbor_voxel->vertex_id = current_voxel->vertex_id;
+      open_set.push(OpenVoxel{distance, neighbor_index});
+    }
+  }
+}
+
+bool getSkeletonAttachmentPath(
+    const Layer<SkeletonAttachmentVoxel>& attachment_layer,
+    const Point& position, AlignedVector<Point>* coordinate_path,
+    int64_t* vertex_id) {
+  CHECK_NOTNULL(coordinate_path);
+  CHECK_NOTNULL(vertex_id);
+  const FloatingPoint voxel_size = attachment_layer.voxel_size();
+  GlobalIndex global_index =
+      getGridIndexFromPoint<GlobalIndex>(position, 1.0 / voxel_size);
+  const SkeletonAttachmentVoxel* voxel =
+      attachment_layer.getVoxelPtrByGlobalIndex(global_index);
+  if (voxel == nullptr || voxel->vertex_id < 0) {
+    return false;
+  }
+
+  coordinate_path->clear();
+  coordinate_path->push_back(position);
+  *vertex_id = voxel->vertex_id;
+  // The distance goes down with every step, so this always ends.
+  while (voxel->parent_direction != SkeletonAttachmentVoxel::kNoParent) {
+    global_index += Neighborhood<>::kOffsets.col(voxel->parent_direction)
+                        .cast<LongIndexElement>();
+    voxel = attachment_layer.getVoxelPtrByGlobalIndex(global_index);
+    CHECK_NOTNULL(voxel);
+    coordinate_path->push_back(
+        getCenterPointFromGridIndex(global_index, voxel_size));
+  }
+  return true;
+}
+
+}  // namespace voxblox
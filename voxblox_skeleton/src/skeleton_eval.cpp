@@ -1,15 +1,20 @@
 #include <ros/ros.h>
+#include <sys/resource.h>
+#include <chrono>
 #include <memory>
+#include <random>
 #include <string>
+#include <vector>
 
+#include <voxblox/core/esdf_map.h>
+#include <voxblox/core/tsdf_map.h>
 #include <voxblox/integrator/esdf_integrator.h>
 #include <voxblox/integrator/tsdf_integrator.h>
-#include <voxblox/mesh/mesh_integrator.h>
 #include <voxblox/simulation/simulation_world.h>
+#include <voxblox/utils/timing.h>
 #include <voxblox_ros/conversions.h>
-#include <voxblox_ros/esdf_server.h>
-#include <voxblox_ros/mesh_vis.h>
 #include <voxblox_ros/ptcloud_vis.h>
+#include <voxblox_planning_common/synthetic_world.h>
 #include <voxblox_ros/ros_params.h>
 
 #include "voxblox_skeleton/ros/skeleton_vis.h"
@@ -17,18 +22,69 @@
 
 namespace voxblox {
 
+// Skeletonization throughput benchmark. Sweeps voxel size, world size (a
+// square grid of procedurally generated rooms and corridors), sensor noise and
+// generate_by_layer_neighbors, runs every combination a number of times and
+// writes the time and voxels per second of every skeletonization stage to a
+// CSV. Single-valued lists give a single run, as the old eval did.
 class SkeletonEvalNode {
  public:
+  // Stages of the skeleton generator, by the timer tags it records them under.
+  enum Stage {
+    kGvd = 0,
+    kThinning,
+    kVertexPruning,
+    kGraphFloodfill,
+    kSplitEdges,
+    kRepair,
+    kNumStages
+  };
+
+  struct EvalResult {
+    int repetition = 0;
+    int seed = 0;
+    double voxel_size = 0.0;
+    int num_rooms_per_side = 0;
+    double world_size_m = 0.0;
+    double noise_sigma = 0.0;
+    bool generate_by_layer_neighbors = false;
+
+    // ESDF voxels in allocated blocks, the amount of work every stage has to
+    // go through.
+    size_t num_voxels = 0;
+    double map_time_sec = 0.0;
+    double stage_time_sec[kNumStages] = {0.0};
+    double total_time_sec = 0.0;
+
+    size_t num_diagram_edge_points = 0;
+    size_t num_diagram_vertex_points = 0;
+    size_t num_graph_vertices = 0;
+    size_t num_graph_edges = 0;
+    // Process-wide peak resident set size after this run, and how much this
+    // run raised it.
+    size_t peak_rss_kb = 0;
+    size_t peak_rss_delta_kb = 0;
+  };
+
   SkeletonEvalNode(const ros::NodeHandle& nh,
                    const ros::NodeHandle& nh_private);
 
-  void generateWorld();
-  void generateSkeleton();
+  // Runs every combination of the sweep parameters num_repetitions times.
+  void runBenchmark();
+  void outputResults(const std::string& filename) const;
+
+  const std::string& getResultsPath() const { return results_path_; }
 
-  void generateMapFromGroundTruth();
-  void generateMapFromRobotPoses(int num_poses, int seed);
+  void generateWorld(int num_rooms_per_side, int seed);
+  void generateMapFromGroundTruth(Layer<TsdfVoxel>* tsdf_layer);
+  void generateMapFromRobotPoses(int num_poses, int seed,
+                                 FloatingPoint noise_sigma,
+                                 Layer<TsdfVoxel>* tsdf_layer);
+  void generateSkeleton(Layer<EsdfVoxel>* esdf_layer,
+                        bool generate_by_layer_neighbors,
+                        EvalResult* result);
 
-  // Utility functions.
+  // Utility functions. Draws from the engine seeded for the current map.
   double randMToN(double m, double n) const;
 
   bool selectRandomFreePose(const Point& min_bound, const Point& max_bound,
@@ -37,7 +93,14 @@ class SkeletonEvalNode {
                            const voxblox::Pointcloud& ptcloud,
                            voxblox::Pointcloud* ptcloud_out) const;
 
+  static const char* getStageName(Stage stage);
+
  private:
+  // Total seconds recorded under each stage's timer tags so far, with nested
+  // stages taken out of the ones they're called from.
+  void getStageTimes(double* stage_times) const;
+  size_t getPeakRssKb() const;
+
   ros::NodeHandle nh_;
   ros::NodeHandle nh_private_;
 
@@ -48,6 +111,7 @@ class SkeletonEvalNode {
 
   bool visualize_;
   bool full_euclidean_distance_;
+  bool generate_from_robot_poses_;
 
   double esdf_max_distance_;
   double tsdf_max_distance_;
@@ -56,11 +120,29 @@ class SkeletonEvalNode {
   double camera_fov_h_rad_;
   double camera_max_dist_;
 
-  bool apply_noise_;
-  FloatingPoint noise_sigma_;
+  // World generation: a synthetic rooms world with a ceiling and an obstacle
+  // in every room. Size and seed are set per run.
+  mav_planning::SyntheticWorldSpec world_spec_;
+  int num_poses_per_room_;
+
+  // Sweep.
+  std::vector<double> voxel_sizes_;
+  std::vector<int> num_rooms_per_side_;
+  std::vector<double> noise_sigmas_;
+  std::vector<bool> generate_by_layer_neighbors_;
+  int num_repetitions_;
+  std::string results_path_;
+
+  // Layer settings that aren't swept.
+  int voxels_per_side_;
+  TsdfIntegratorBase::Config tsdf_integrator_config_;
+  EsdfIntegrator::Config esdf_integrator_config_;
 
-  voxblox::EsdfServer voxblox_server_;
   voxblox::SimulationWorld world_;
+  FloatingPoint world_size_m_;
+  mutable std::mt19937 random_engine_;
+
+  std::vector<EvalResult> results_;
 };
 
 SkeletonEvalNode::SkeletonEvalNode(const ros::NodeHandle& nh,
@@ -70,94 +152,141 @@ SkeletonEvalNode::SkeletonEvalNode(const ros::NodeHandle& nh,
       frame_id_("world"),
       visualize_(true),
       full_euclidean_distance_(true),
+      generate_from_robot_poses_(true),
       esdf_max_distance_(5.0),
       tsdf_max_distance_(0.4),
       camera_resolution_(320, 240),
       camera_fov_h_rad_(1.5708),  // 90 deg
       camera_max_dist_(10.0),
-      apply_noise_(false),
-      noise_sigma_(0.0),
-      voxblox_server_(nh_, nh_private_) {
+      num_poses_per_room_(20),
+      voxel_sizes_({0.1}),
+      num_rooms_per_side_({3}),
+      noise_sigmas_({0.0}),
+      generate_by_layer_neighbors_({false}),
+      num_repetitions_(1),
+      voxels_per_side_(16),
+      world_size_m_(0.0) {
   nh_private_.param("visualize", visualize_, visualize_);
   nh_private_.param("full_euclidean_distance", full_euclidean_distance_,
                     full_euclidean_distance_);
+  nh_private_.param("generate_from_robot_poses", generate_from_robot_poses_,
+                    generate_from_robot_poses_);
   nh_private_.param("esdf_max_distance", esdf_max_distance_,
                     esdf_max_distance_);
   nh_private_.param("tsdf_max_distance", tsdf_max_distance_,
                     tsdf_max_distance_);
-  nh_private_.param("apply_noise", apply_noise_, apply_noise_);
-  nh_private_.param("noise_sigma", noise_sigma_, noise_sigma_);
   nh_private_.param("frame_id", frame_id_, frame_id_);
 
+  world_spec_.type = mav_planning::SyntheticWorldSpec::kRooms;
+  world_spec_.size.z() = 3.0;
+  world_spec_.add_ceiling = true;
+  world_spec_.obstacles_per_room = 1;
+  nh_private_.param("room_size", world_spec_.room_size_m,
+                    world_spec_.room_size_m);
+  nh_private_.param("wall_height", world_spec_.size.z(),
+                    world_spec_.size.z());
+  nh_private_.param("wall_thickness", world_spec_.wall_thickness_m,
+                    world_spec_.wall_thickness_m);
+  nh_private_.param("door_width", world_spec_.door_width_m,
+                    world_spec_.door_width_m);
+  nh_private_.param("corridor_probability", world_spec_.corridor_probability,
+                    world_spec_.corridor_probability);
+  nh_private_.param("num_poses_per_room", num_poses_per_room_,
+                    num_poses_per_room_);
+
+  nh_private_.param("voxel_sizes", voxel_sizes_, voxel_sizes_);
+  nh_private_.param("num_rooms_per_side", num_rooms_per_side_,
+                    num_rooms_per_side_);
+  nh_private_.param("noise_sigmas", noise_sigmas_, noise_sigmas_);
+  nh_private_.param("generate_by_layer_neighbors_values",
+                    generate_by_layer_neighbors_,
+                    generate_by_layer_neighbors_);
+  nh_private_.param("num_repetitions", num_repetitions_, num_repetitions_);
+  nh_private_.param("results_path", results_path_, results_path_);
+  nh_private_.param("tsdf_voxels_per_side", voxels_per_side_,
+                    voxels_per_side_);
+
+  tsdf_integrator_config_ = getTsdfIntegratorConfigFromRosParam(nh_private_);
+  esdf_integrator_config_ = getEsdfIntegratorConfigFromRosParam(nh_private_);
+  esdf_integrator_config_.max_distance_m = esdf_max_distance_;
+
   skeleton_pub_ = nh_private_.advertise<pcl::PointCloud<pcl::PointXYZ> >(
       "skeleton", 1, true);
   sparse_graph_pub_ = nh_private_.advertise<visualization_msgs::MarkerArray>(
       "sparse_graph", 1, true);
 }
 
-void SkeletonEvalNode::generateWorld() {
-  voxblox_server_.clear();
-  world_.clear();
+const char* SkeletonEvalNode::getStageName(Stage stage) {
+  switch (stage) {
+    case kGvd:
+      return "gvd";
+    case kThinning:
+      return "thinning";
+    case kVertexPruning:
+      return "vertex_pruning";
+    case kGraphFloodfill:
+      return "graph_floodfill";
+    case kSplitEdges:
+      return "split_edges";
+    case kRepair:
+      return "repair";
+    default:
+      return "unknown";
+  }
+}
 
-  world_.addPlaneBoundaries(0.0, 15.0, 0.0, 10.0);
-  world_.addGroundLevel(0.0);
-  world_.addObject(std::unique_ptr<voxblox::Object>(
-      new PlaneObject(Point(0.0, 0.0, 5.0), Point(0.0, 0.0, -1.0))));
-
-  // Sets the display bounds.
-  world_.setBounds(Point(-1.0, -1.0, -1.0), Point(16.0, 11.0, 6.0));
-
-  // Corridor/room walls. Horizontal first, vertical second, top to bottom.
-  world_.addObject(std::unique_ptr<voxblox::Object>(new voxblox::Cube(
-      Point(3.75, 5.0, 2.5), Point(7.5, 0.5, 5.0), voxblox::Color::Gray())));
-  world_.addObject(std::unique_ptr<voxblox::Object>(new voxblox::Cube(
-      Point(9.5, 5.0, 2.5), Point(1, 0.5, 5.0), voxblox::Color::Gray())));
-
-  world_.addObject(std::unique_ptr<voxblox::Object>(new voxblox::Cube(
-      Point(1.25, 7.5, 2.5), Point(2.5, 0.5, 5.0), voxblox::Color::Gray())));
-  world_.addObject(std::unique_ptr<voxblox::Object>(new voxblox::Cube(
-      Point(6.5, 7.5, 2.5), Point(5, 0.5, 5.0), voxblox::Color::Gray())));
-  world_.addObject(std::unique_ptr<voxblox::Object>(new voxblox::Cube(
-      Point(12.5, 7.5, 2.5), Point(5, 0.5, 5.0), voxblox::Color::Gray())));
-
-  world_.addObject(std::unique_ptr<voxblox::Object>(new voxblox::Cube(
-      Point(10, 2.5, 2.5), Point(0.5, 5.0, 5.0), voxblox::Color::Gray())));
-  world_.addObject(std::unique_ptr<voxblox::Object>(new voxblox::Cube(
-      Point(8, 8.75, 2.5), Point(0.5, 2.5, 5.0), voxblox::Color::Gray())));
-  world_.addObject(std::unique_ptr<voxblox::Object>(new voxblox::Cube(
-      Point(5, 8.25, 2.5), Point(0.5, 1.5, 5.0), voxblox::Color::Gray())));
-
-  // Random objects.
-  world_.addObject(std::unique_ptr<voxblox::Object>(new voxblox::Cube(
-      Point(2.5, 2.5, 2.5), Point(1.0, 1.0, 5.0), voxblox::Color::Gray())));
-  world_.addObject(std::unique_ptr<voxblox::Object>(new voxblox::Cube(
-      Point(3.5, 2.5, 1.25), Point(1.0, 1.0, 2.5), voxblox::Color::Green())));
-  world_.addObject(std::unique_ptr<voxblox::Object>(new voxblox::Cube(
-      Point(13.75, 8.5, 1.25), Point(2.5, 2.0, 2.5), voxblox::Color::Green())));
-
-  world_.addObject(std::unique_ptr<voxblox::Object>(new voxblox::Cylinder(
-      Point(12.5, 5.0, 1.25), 0.5, 2.5, voxblox::Color::Pink())));
-  world_.addObject(std::unique_ptr<voxblox::Object>(new voxblox::Sphere(
-      Point(11.5, 1.5, 1.25), 1.0, voxblox::Color::Pink())));
-  world_.addObject(std::unique_ptr<voxblox::Object>(new voxblox::Sphere(
-      Point(13.5, 1.5, 1.25), 1.0, voxblox::Color::Pink())));
+void SkeletonEvalNode::getStageTimes(double* stage_times) const {
+  CHECK_NOTNULL(stage_times);
+  // generateSkeleton() is timed as a whole under skeleton/gvd, so the
+  // thinning and vertex pruning it calls come out of that. The graph timer
+  // stops before splitting and repairing.
+  const double prune_edges =
+      timing::Timing::GetTotalSeconds("skeleton/prune_edges");
+  const double prune_vertices =
+      timing::Timing::GetTotalSeconds("skeleton/prune_vertices");
+  stage_times[kGvd] = timing::Timing::GetTotalSeconds("skeleton/gvd") -
+                      prune_edges - prune_vertices;
+  stage_times[kThinning] = prune_edges;
+  stage_times[kVertexPruning] = prune_vertices;
+  stage_times[kGraphFloodfill] =
+      timing::Timing::GetTotalSeconds("skeleton/graph");
+  stage_times[kSplitEdges] =
+      timing::Timing::GetTotalSeconds("skeleton/split_edges");
+  stage_times[kRepair] =
+      timing::Timing::GetTotalSeconds("skeleton/repair_graph");
 }
 
-void SkeletonEvalNode::generateMapFromGroundTruth() {
-  voxblox_server_.setSliceLevel(1.5);
-  world_.generateSdfFromWorld<voxblox::TsdfVoxel>(
-      tsdf_max_distance_, voxblox_server_.getTsdfMapPtr()->getTsdfLayerPtr());
-  voxblox_server_.setEsdfMaxDistance(esdf_max_distance_);
-  voxblox_server_.updateEsdfBatch(full_euclidean_distance_);
-  if (visualize_) {
-    voxblox_server_.generateMesh();
-    voxblox_server_.publishSlices();
-    voxblox_server_.publishPointclouds();
+size_t SkeletonEvalNode::getPeakRssKb() const {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
   }
+  // Kilobytes on Linux.
+  return static_cast<size_t>(usage.ru_maxrss);
+}
+
+void SkeletonEvalNode::generateWorld(int num_rooms_per_side, int seed) {
+  world_.clear();
+
+  mav_planning::SyntheticWorldSpec spec = world_spec_;
+  spec.seed = seed;
+  world_size_m_ = num_rooms_per_side * spec.room_size_m;
+  spec.size.x() = world_size_m_;
+  spec.size.y() = world_size_m_;
+  mav_planning::addSyntheticWorldObjects(spec, &world_);
+}
+
+void SkeletonEvalNode::generateMapFromGroundTruth(
+    Layer<TsdfVoxel>* tsdf_layer) {
+  CHECK_NOTNULL(tsdf_layer);
+  world_.generateSdfFromWorld<voxblox::TsdfVoxel>(tsdf_max_distance_,
+                                                  tsdf_layer);
 }
 
 double SkeletonEvalNode::randMToN(double m, double n) const {
-  return m + (rand() / (RAND_MAX / (n - m)));
+  // Not std::uniform_real_distribution, so poses are the same with any
+  // standard library.
+  return m + (n - m) * (random_engine_() / 4294967296.0);
 }
 
 bool SkeletonEvalNode::selectRandomFreePose(const Point& min_bound,
@@ -191,15 +320,23 @@ void SkeletonEvalNode::transformPointcloud(
   }
 }
 
-void SkeletonEvalNode::generateMapFromRobotPoses(int num_poses, int seed) {
-  voxblox_server_.setSliceLevel(1.5);
-  voxblox_server_.setClearSphere(true);
-  voxblox_server_.setEsdfMaxDistance(esdf_max_distance_);
+void SkeletonEvalNode::generateMapFromRobotPoses(int num_poses, int seed,
+                                                 FloatingPoint noise_sigma,
+                                                 Layer<TsdfVoxel>* tsdf_layer) {
+  CHECK_NOTNULL(tsdf_layer);
+  // Voxel size is swept, so keep the truncation distance at voxblox's default
+  // of 4 voxels rather than a fixed distance from the params.
+  TsdfIntegratorBase::Config tsdf_integrator_config = tsdf_integrator_config_;
+  tsdf_integrator_config.default_truncation_distance =
+      4 * tsdf_layer->voxel_size();
+  MergedTsdfIntegrator tsdf_integrator(tsdf_integrator_config, tsdf_layer);
 
-  srand(seed);
+  random_engine_.seed(static_cast<uint32_t>(seed));
 
-  Point min_boundary(1.0, 1.0, 1.0);
-  Point max_boundary(14.0, 10.0, 5.0);
+  const FloatingPoint kMargin = 0.5;
+  Point min_boundary(kMargin, kMargin, kMargin);
+  Point max_boundary(world_size_m_ - kMargin, world_size_m_ - kMargin,
+                     world_spec_.size.z() - kMargin);
 
   for (int i = 0; i < num_poses; i++) {
     Point view_origin = Point::Zero();
@@ -217,44 +354,35 @@ void SkeletonEvalNode::generateMapFromRobotPoses(int num_poses, int seed) {
     // Step 2: actually get the pointcloud.
     voxblox::Pointcloud ptcloud, ptcloud_C;
     voxblox::Colors colors;
-    if (!apply_noise_) {
+    if (noise_sigma <= 0.0) {
       world_.getPointcloudFromViewpoint(view_origin, view_direction,
                                         camera_resolution_, camera_fov_h_rad_,
                                         camera_max_dist_, &ptcloud, &colors);
     } else {
       world_.getNoisyPointcloudFromViewpoint(
           view_origin, view_direction, camera_resolution_, camera_fov_h_rad_,
-          camera_max_dist_, noise_sigma_, &ptcloud, &colors);
+          camera_max_dist_, noise_sigma, &ptcloud, &colors);
     }
 
     // Step 3: integrate into the map.
     // Transform back into camera frame.
     transformPointcloud(T_G_C.inverse(), ptcloud, &ptcloud_C);
-    voxblox_server_.integratePointcloud(T_G_C, ptcloud_C, colors);
-  }
-
-  voxblox_server_.updateEsdfBatch(full_euclidean_distance_);
-
-  if (visualize_) {
-    voxblox_server_.generateMesh();
-    voxblox_server_.publishSlices();
-    voxblox_server_.publishPointclouds();
+    tsdf_integrator.integratePointCloud(T_G_C, ptcloud_C, colors);
   }
 }
 
-void SkeletonEvalNode::generateSkeleton() {
-  SkeletonGenerator skeleton_generator(
-      voxblox_server_.getEsdfMapPtr()->getEsdfLayerPtr());
+void SkeletonEvalNode::generateSkeleton(Layer<EsdfVoxel>* esdf_layer,
+                                        bool generate_by_layer_neighbors,
+                                        EvalResult* result) {
+  CHECK_NOTNULL(esdf_layer);
+  CHECK_NOTNULL(result);
+  SkeletonGenerator skeleton_generator(esdf_layer);
 
   FloatingPoint min_separation_angle =
       skeleton_generator.getMinSeparationAngle();
   nh_private_.param("min_separation_angle", min_separation_angle,
                     min_separation_angle);
   skeleton_generator.setMinSeparationAngle(min_separation_angle);
-  bool generate_by_layer_neighbors =
-      skeleton_generator.getGenerateByLayerNeighbors();
-  nh_private_.param("generate_by_layer_neighbors", generate_by_layer_neighbors,
-                    generate_by_layer_neighbors);
   skeleton_generator.setGenerateByLayerNeighbors(generate_by_layer_neighbors);
 
   int num_neighbors_for_edge = skeleton_generator.getNumNeighborsForEdge();
@@ -266,44 +394,176 @@ void SkeletonEvalNode::generateSkeleton() {
   nh_private_.param("min_gvd_distance", min_gvd_distance, min_gvd_distance);
   skeleton_generator.setMinGvdDistance(min_gvd_distance);
 
+  double stage_times_before[kNumStages], stage_times_after[kNumStages];
+  getStageTimes(stage_times_before);
   skeleton_generator.generateSkeleton();
-  Pointcloud pointcloud;
-  std::vector<float> distances;
-  skeleton_generator.getSkeleton().getEdgePointcloudWithDistances(&pointcloud,
-                                                                  &distances);
-
-  // Publish the skeleton.
-  pcl::PointCloud<pcl::PointXYZI> ptcloud_pcl;
-  pointcloudToPclXYZI(pointcloud, distances, &ptcloud_pcl);
-  ptcloud_pcl.header.frame_id = frame_id_;
-  skeleton_pub_.publish(ptcloud_pcl);
-  ROS_INFO("Finished generating skeleton.");
-
   skeleton_generator.generateSparseGraph();
-  ROS_INFO("Finished generating sparse graph.");
+  getStageTimes(stage_times_after);
 
-  ROS_INFO_STREAM("Total Timings: " << std::endl << timing::Timing::Print());
-
-  // Now visualize the graph.
-  const SparseSkeletonGraph& graph = skeleton_generator.getSparseGraph();
-  visualization_msgs::MarkerArray marker_array;
-  visualizeSkeletonGraph(graph, frame_id_, &marker_array);
-  sparse_graph_pub_.publish(marker_array);
+  for (int i = 0; i < kNumStages; ++i) {
+    result->stage_time_sec[i] = stage_times_after[i] - stage_times_before[i];
+    result->total_time_sec += result->stage_time_sec[i];
+  }
 
   std::vector<int64_t> vertex_ids, edge_ids;
   skeleton_generator.getSparseGraph().getAllEdgeIds(&edge_ids);
   skeleton_generator.getSparseGraph().getAllVertexIds(&vertex_ids);
+  result->num_diagram_edge_points =
+      skeleton_generator.getSkeleton().getEdgePoints().size();
+  result->num_diagram_vertex_points =
+      skeleton_generator.getSkeleton().getVertexPoints().size();
+  result->num_graph_edges = edge_ids.size();
+  result->num_graph_vertices = vertex_ids.size();
+
+  if (visualize_) {
+    // Only the last run stays up, which is the only one if nothing's swept.
+    Pointcloud pointcloud;
+    std::vector<float> distances;
+    skeleton_generator.getSkeleton().getEdgePointcloudWithDistances(
+        &pointcloud, &distances);
+    pcl::PointCloud<pcl::PointXYZI> ptcloud_pcl;
+    pointcloudToPclXYZI(pointcloud, distances, &ptcloud_pcl);
+    ptcloud_pcl.header.frame_id = frame_id_;
+    skeleton_pub_.publish(ptcloud_pcl);
+
+    visualization_msgs::MarkerArray marker_array;
+    visualizeSkeletonGraph(skeleton_generator.getSparseGraph(), frame_id_,
+                           &marker_array);
+    sparse_graph_pub_.publish(marker_array);
+  }
+}
+
+void SkeletonEvalNode::runBenchmark() {
+  results_.clear();
+  for (int num_rooms : num_rooms_per_side_) {
+    for (int repetition = 0; repetition < num_repetitions_; ++repetition) {
+      if (!ros::ok()) {
+        return;
+      }
+      // Same world for everything else in the sweep, so that only the swept
+      // parameter changes.
+      const int seed = repetition;
+      generateWorld(num_rooms, seed);
+
+      for (double voxel_size : voxel_sizes_) {
+        for (double noise_sigma : noise_sigmas_) {
+          // Noise only applies to simulated sensor data.
+          if (!generate_from_robot_poses_ && noise_sigma > 0.0) {
+            continue;
+          }
+          for (bool generate_by_layer_neighbors :
+               generate_by_layer_neighbors_) {
+            if (!ros::ok()) {
+              return;
+            }
+            EvalResult result;
+            result.repetition = repetition;
+            result.seed = seed;
+            result.voxel_size = voxel_size;
+            result.num_rooms_per_side = num_rooms;
+            result.world_size_m = world_size_m_;
+            result.noise_sigma = noise_sigma;
+            result.generate_by_layer_neighbors = generate_by_layer_neighbors;
+            const size_t peak_rss_before_kb = getPeakRssKb();
+
+            TsdfMap::Config tsdf_config;
+            tsdf_config.tsdf_voxel_size = voxel_size;
+            tsdf_config.tsdf_voxels_per_side = voxels_per_side_;
+            EsdfMap::Config esdf_config;
+            esdf_config.esdf_voxel_size = voxel_size;
+            esdf_config.esdf_voxels_per_side = voxels_per_side_;
+            TsdfMap tsdf_map(tsdf_config);
+            EsdfMap esdf_map(esdf_config);
+
+            const std::chrono::steady_clock::time_point map_start =
+                std::chrono::steady_clock::now();
+            if (generate_from_robot_poses_) {
+              generateMapFromRobotPoses(
+                  num_poses_per_room_ * num_rooms * num_rooms, seed,
+                  noise_sigma, tsdf_map.getTsdfLayerPtr());
+            } else {
+              generateMapFromGroundTruth(tsdf_map.getTsdfLayerPtr());
+            }
+            EsdfIntegrator esdf_integrator(esdf_integrator_config_,
+                                           tsdf_map.getTsdfLayerPtr(),
+                                           esdf_map.getEsdfLayerPtr());
+            esdf_integrator.setFullEuclidean(full_euclidean_distance_);
+            esdf_integrator.updateFromTsdfLayerBatch();
+            result.map_time_sec = std::chrono::duration<double>(
+                                      std::chrono::steady_clock::now() -
+                                      map_start)
+                                      .count();
+
+            const Layer<EsdfVoxel>& esdf_layer = esdf_map.getEsdfLayer();
+            result.num_voxels = esdf_layer.getNumberOfAllocatedBlocks() *
+                                esdf_layer.voxels_per_side() *
+                                esdf_layer.voxels_per_side() *
+                                esdf_layer.voxels_per_side();
+
+            generateSkeleton(esdf_map.getEsdfLayerPtr(),
+                             generate_by_layer_neighbors, &result);
+
+            result.peak_rss_kb = getPeakRssKb();
+            result.peak_rss_delta_kb = result.peak_rss_kb - peak_rss_before_kb;
+            results_.push_back(result);
+
+            ROS_INFO(
+                "[Skeleton Eval] Rooms: %d Voxel size: %f Noise: %f Layer "
+                "neighbors: %d Rep: %d Voxels: %zu Total: %f s (%.0f "
+                "voxels/s) Graph vertices: %zu edges: %zu",
+                num_rooms, voxel_size, noise_sigma,
+                generate_by_layer_neighbors, repetition, result.num_voxels,
+                result.total_time_sec,
+                result.total_time_sec > 0.0
+                    ? result.num_voxels / result.total_time_sec
+                    : 0.0,
+                result.num_graph_vertices, result.num_graph_edges);
+          }
+        }
+      }
+    }
+  }
+}
 
-  // Now output some staaaaats.
-  ROS_INFO("Map voxel size: %f Noise on? %d Noise level: %f",
-           voxblox_server_.getTsdfMapPtr()->getTsdfLayerPtr()->voxel_size(),
-           apply_noise_, noise_sigma_);
-  ROS_INFO(
-      "Diagram edges: %lu Diagram vertices: %lu Graph edges: %lu Graph "
-      "vertices: %lu",
-      skeleton_generator.getSkeleton().getEdgePoints().size(),
-      skeleton_generator.getSkeleton().getVertexPoints().size(),
-      edge_ids.size(), vertex_ids.size());
+void SkeletonEvalNode::outputResults(const std::string& filename) const {
+  FILE* fp = fopen(filename.c_str(), "w+");
+  if (fp == NULL) {
+    ROS_ERROR_STREAM("[Skeleton Eval] Couldn't open results file: "
+                     << filename);
+    return;
+  }
+  fprintf(fp,
+          "#repetition,seed,voxel_size,num_rooms_per_side,world_size_m,"
+          "noise_sigma,generate_by_layer_neighbors,num_voxels,map_time_sec,"
+          "total_time_sec,total_voxels_per_sec");
+  for (int i = 0; i < kNumStages; ++i) {
+    const char* name = getStageName(static_cast<Stage>(i));
+    fprintf(fp, ",%s_time_sec,%s_voxels_per_sec", name, name);
+  }
+  fprintf(fp,
+          ",num_diagram_edge_points,num_diagram_vertex_points,num_graph_"
+          "vertices,num_graph_edges,peak_rss_kb,peak_rss_delta_kb\n");
+
+  for (const EvalResult& result : results_) {
+    fprintf(fp, "%d,%d,%f,%d,%f,%f,%d,%zu,%f,%f,%f", result.repetition,
+            result.seed, result.voxel_size, result.num_rooms_per_side,
+            result.world_size_m, result.noise_sigma,
+            result.generate_by_layer_neighbors, result.num_voxels,
+            result.map_time_sec, result.total_time_sec,
+            result.total_time_sec > 0.0
+                ? result.num_voxels / result.total_time_sec
+                : 0.0);
+    for (int i = 0; i < kNumStages; ++i) {
+      const double time = result.stage_time_sec[i];
+      fprintf(fp, ",%f,%f", time, time > 0.0 ? result.num_voxels / time : 0.0);
+    }
+    fprintf(fp, ",%zu,%zu,%zu,%zu,%zu,%zu\n", result.num_diagram_edge_points,
+            result.num_diagram_vertex_points, result.num_graph_vertices,
+            result.num_graph_edges, result.peak_rss_kb,
+            result.peak_rss_delta_kb);
+  }
+  fclose(fp);
+  ROS_INFO_STREAM("[Skeleton Eval] Output results to: " << filename);
 }
 
 }  // namespace voxblox
@@ -320,20 +580,18 @@ int main(int argc, char** argv) {
 
   voxblox::SkeletonEvalNode node(nh, nh_private);
 
-  node.generateWorld();
-
-  bool generate_from_robot_poses = true;
+  node.runBenchmark();
+  if (!node.getResultsPath().empty()) {
+    node.outputResults(node.getResultsPath());
+  }
 
-  nh_private.param("generate_from_robot_poses", generate_from_robot_poses,
-                   generate_from_robot_poses);
+  ROS_INFO_STREAM("Total Timings: " << std::endl
+                                    << voxblox::timing::Timing::Print());
 
-  if (generate_from_robot_poses) {
-    node.generateMapFromRobotPoses(200, 1);
-  } else {
-    node.generateMapFromGroundTruth();
+  bool exit_at_end = false;
+  nh_private.param("exit_at_end", exit_at_end, exit_at_end);
+  if (!exit_at_end) {
+    ros::spin();
   }
-  node.generateSkeleton();
-
-  ros::spin();
   return 0;
 }
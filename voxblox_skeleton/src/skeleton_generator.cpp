@@ -1,3 +1,5 @@
+#include <mav_planning_common/scoped_trace.h>
+
 #include "voxblox_skeleton/io/skeleton_io.h"
 
 #include "voxblox_skeleton/skeleton_generator.h"
@@ -46,6 +48,7 @@ void SkeletonGenerator::updateSkeletonFromLayer() {
   CHECK(skeleton_layer_);
 
   timing::Timer update_timer("skeleton/update_from_layer");
+  mav_planning::ScopedTrace trace("skeleton/update_from_layer", "skeleton");
 
   // Clear whatever's in there.
   skeleton_.getSkeletonPoints().clear();
@@ -91,6 +94,7 @@ void SkeletonGenerator::updateSkeletonFromLayer() {
 
 void SkeletonGenerator::generateSkeleton() {
   timing::Timer generate_timer("skeleton/gvd");
+  mav_planning::ScopedTrace trace("skeleton/gvd", "skeleton");
 
   // Clear the skeleton and start over.
   skeleton_.getSkeletonPoints().clear();
@@ -242,6 +246,7 @@ void SkeletonGenerator::generateSkeleton() {
 
 void SkeletonGenerator::generateEdgesByLayerNeighbors() {
   timing::Timer generate_timer("skeleton/neighbor_gvd_edge");
+  mav_planning::ScopedTrace trace("skeleton/neighbor_gvd_edge", "skeleton");
 
   // Rather than iterate over the entire layer, let's just go over all the
   // points in the skeleton.
@@ -297,6 +302,7 @@ void SkeletonGenerator::generateEdgesByLayerNeighbors() {
 
 size_t SkeletonGenerator::pruneDiagramEdges() {
   timing::Timer timer("skeleton/prune_edges");
+  mav_planning::ScopedTrace trace("skeleton/prune_edges", "skeleton");
 
   // Go through all edge points, checking them against the templates. Remove
   // any that fit the template, and mark them in removal indices.
@@ -444,6 +450,7 @@ size_t SkeletonGenerator::mapNeighborIndexToBitsetIndex(
 
 void SkeletonGenerator::generateVerticesByLayerNeighbors() {
   timing::Timer generate_timer("skeleton/neighbor_gvd_vertex");
+  mav_planning::ScopedTrace trace("skeleton/neighbor_gvd_vertex", "skeleton");
 
   // Rather than iterate over the entire layer, let's just go over all the
   // points in the skeleton.
@@ -502,6 +509,7 @@ void SkeletonGenerator::generateVerticesByLayerNeighbors() {
 
 void SkeletonGenerator::generateSparseGraph() {
   timing::Timer generate_timer("skeleton/graph");
+  mav_planning::ScopedTrace trace("skeleton/graph", "skeleton");
 
   graph_.clear();
 
@@ -1020,6 +1028,7 @@ bool SkeletonGenerator::isEndPoint(const std::bitset<27>& neighbors) const {
 
 void SkeletonGenerator::pruneDiagramVertices() {
   timing::Timer generate_timer("skeleton/prune_vertices");
+  mav_planning::ScopedTrace trace("skeleton/prune_vertices", "skeleton");
 
   // Ok, first set up a kdtree/nanoflann instance using the skeleton point
   // wrapper.
@@ -1124,6 +1133,7 @@ void SkeletonGenerator::pruneDiagramVertices() {
 
 void SkeletonGenerator::splitEdges() {
   timing::Timer split_timer("skeleton/split_edges");
+  mav_planning::ScopedTrace trace("skeleton/split_edges", "skeleton");
 
   std::vector<int64_t> edge_ids;
   graph_.getAllEdgeIds(&edge_ids);
@@ -1355,6 +1365,7 @@ void SkeletonGenerator::setSkeletonLayer(Layer<SkeletonVoxel>* skeleton_layer) {
 
 void SkeletonGenerator::repairGraph() {
   timing::Timer repair_timer("skeleton/repair_graph");
+  mav_planning::ScopedTrace trace("skeleton/repair_graph", "skeleton");
 
   // Go over all the vertices in the sparse graph and flood fill to label
   // unconnected components.
@@ -1540,6 +1551,7 @@ void SkeletonGenerator::simplifyGraph() {
 
 void SkeletonGenerator::simplifyVertices() {
   timing::Timer simplify_timer("skeleton/simplify_vertices");
+  mav_planning::ScopedTrace trace("skeleton/simplify_vertices", "skeleton");
 
   // Build a kd tree again.
   constexpr int kMaxLeaf = 10;
@@ -1659,6 +1671,7 @@ void SkeletonGenerator::simplifyVertices() {
 
 void SkeletonGenerator::reconnectSubgraphsAlongEsdf() {
   timing::Timer reconnect_timer("skeleton/reconnect");
+  mav_planning::ScopedTrace trace("skeleton/reconnect", "skeleton");
 
   // Subgraph merging is done differently here... Just accumlate all the ones
   // that map to the same thing. Always map to the lowest.
@@ -72,4 +72,56 @@ void mergeVoxelAIntoVoxelB(const SkeletonVoxel& voxel_A,
   *voxel_B = voxel_A;
 }
 
+template <>
+void Block<SkeletonAttachmentVoxel>::deserializeFromIntegers(
+    const std::vector<uint32_t>& data) {
+  constexpr size_t kNumDataPacketsPerVoxel = 3u;
+  const size_t num_data_packets = data.size();
+  CHECK_EQ(num_voxels_ * kNumDataPacketsPerVoxel, num_data_packets);
+  for (size_t voxel_idx = 0u, data_idx = 0u;
+       voxel_idx < num_voxels_ && data_idx < num_data_packets;
+       ++voxel_idx, data_idx += kNumDataPacketsPerVoxel) {
+    const uint32_t bytes_1 = data[data_idx];
+    const uint32_t bytes_2 = data[data_idx + 1u];
+    const int32_t bytes_3 = data[data_idx + 2u];
+    SkeletonAttachmentVoxel& voxel = voxels_[voxel_idx];
+
+    memcpy(&(voxel.distance), &bytes_1, sizeof(bytes_1));
+    voxel.parent_direction = static_cast<uint8_t>(bytes_2 & 0x000000FF);
+    voxel.vertex_id = static_cast<int64_t>(bytes_3);
+  }
+}
+
+template <>
+void Block<SkeletonAttachmentVoxel>::serializeToIntegers(
+    std::vector<uint32_t>* data) const {
+  CHECK_NOTNULL(data);
+  constexpr size_t kNumDataPacketsPerVoxel = 3u;
+  data->clear();
+  data->reserve(num_voxels_ * kNumDataPacketsPerVoxel);
+  for (size_t voxel_idx = 0u; voxel_idx < num_voxels_; ++voxel_idx) {
+    const SkeletonAttachmentVoxel& voxel = voxels_[voxel_idx];
+
+    const uint32_t* bytes_1_ptr =
+        reinterpret_cast<const uint32_t*>(&voxel.distance);
+    data->push_back(*bytes_1_ptr);
+    data->push_back(static_cast<uint32_t>(voxel.parent_direction));
+    // Same 32-bit vertex IDs as the skeleton voxels.
+    int32_t bytes_3 = -1;
+    if (voxel.vertex_id >= 0) {
+      bytes_3 = static_cast<int32_t>(voxel.vertex_id);
+    }
+    data->push_back(bytes_3);
+  }
+
+  CHECK_EQ(num_voxels_ * kNumDataPacketsPerVoxel, data->size());
+}
+
+template <>
+void mergeVoxelAIntoVoxelB(const SkeletonAttachmentVoxel& voxel_A,
+                           SkeletonAttachmentVoxel* voxel_B) {
+  // Paths from different fields don't mix, same as the skeleton.
+  *voxel_B = voxel_A;
+}
+
 }  // namespace voxblox
@@ -10,6 +10,7 @@
 
 #include "voxblox_skeleton/io/skeleton_io.h"
 #include "voxblox_skeleton/ros/skeleton_vis.h"
+#include "voxblox_skeleton/skeleton_attachment.h"
 #include "voxblox_skeleton/skeleton_generator.h"
 
 namespace voxblox {
@@ -100,6 +101,22 @@ void SkeletonizerNode::init() {
       constexpr bool kClearFile = false;
       io::SaveLayer<SkeletonVoxel>(*skeleton_generator_.getSkeletonLayer(),
                                    output_filepath, kClearFile);
+      // The attachment field only works with the graph it was built from,
+      // so it's only worth saving along with the graph.
+      if (!sparse_graph_filepath.empty()) {
+        const Layer<EsdfVoxel>& esdf_layer =
+            *esdf_server_.getEsdfMapPtr()->getEsdfLayerPtr();
+        Layer<SkeletonAttachmentVoxel> attachment_layer(
+            esdf_layer.voxel_size(), esdf_layer.voxels_per_side());
+        SkeletonAttachmentGenerator attachment_generator;
+        attachment_generator.setEsdfLayer(&esdf_layer);
+        attachment_generator.setMinEsdfDistance(
+            skeleton_generator_.getMinGvdDistance());
+        attachment_generator.generate(skeleton_generator_.getSparseGraph(),
+                                      &attachment_layer);
+        io::SaveLayer<SkeletonAttachmentVoxel>(attachment_layer,
+                                               output_filepath, kClearFile);
+      }
       ROS_INFO("Output map to: %s", output_filepath.c_str());
     } else {
       ROS_ERROR("Couldn't output map to: %s", output_filepath.c_str());
@@ -1,11 +1,16 @@
 #include "voxblox_skeleton/sparse_graph_planner.h"
 
+#include <functional>
+#include <limits>
 #include <map>
+#include <queue>
 #include <set>
+#include <unordered_map>
+#include <utility>
 
 namespace voxblox {
 
-SparseGraphPlanner::SparseGraphPlanner() {}
+SparseGraphPlanner::SparseGraphPlanner() : graph_(nullptr) {}
 
 void SparseGraphPlanner::setup() {
   CHECK_NOTNULL(graph_);
@@ -25,6 +30,35 @@ void SparseGraphPlanner::setup() {
       nanoflann::KDTreeSingleIndexAdaptorParams(kMaxLeaf)));
 
   kd_tree_->buildIndex();
+
+  // Compact copy of the graph.
+  vertex_ids_.clear();
+  vertex_indices_.clear();
+  vertex_ids_.reserve(graph_->getVertexMap().size());
+  for (const std::pair<const int64_t, SkeletonVertex>& kv :
+       graph_->getVertexMap()) {
+    vertex_indices_[kv.first] = vertex_ids_.size();
+    vertex_ids_.push_back(kv.first);
+  }
+  adjacency_start_.assign(1, 0u);
+  adjacency_.clear();
+  for (int64_t vertex_id : vertex_ids_) {
+    const SkeletonVertex& vertex = graph_->getVertex(vertex_id);
+    for (int64_t edge_id : vertex.edge_list) {
+      const SkeletonEdge& edge = graph_->getEdge(edge_id);
+      const int64_t neighbor_vertex_id =
+          edge.start_vertex == vertex_id ? edge.end_vertex : edge.start_vertex;
+      std::unordered_map<int64_t, int>::const_iterator neighbor_it =
+          vertex_indices_.find(neighbor_vertex_id);
+      if (neighbor_it == vertex_indices_.end()) {
+        continue;
+      }
+      adjacency_.emplace_back(
+          neighbor_it->second,
+          (graph_->getVertex(neighbor_vertex_id).point - vertex.point).norm());
+    }
+    adjacency_start_.push_back(adjacency_.size());
+  }
 }
 
 bool SparseGraphPlanner::getPath(const Point& start_position,
@@ -39,6 +73,14 @@ bool SparseGraphPlanner::getPath(const Point& start_position,
   getNClosestVertices(end_position, 1, &end_vertex_inds);
   int64_t end_vertex_id = end_vertex_inds[0];
 
+  return getPathBetweenVertices(start_vertex_id, end_vertex_id,
+                                coordinate_path);
+}
+
+bool SparseGraphPlanner::getPathBetweenVertices(
+    int64_t start_vertex_id, int64_t end_vertex_id,
+    AlignedVector<Point>* coordinate_path) const {
+  CHECK_NOTNULL(coordinate_path);
   std::vector<int64_t> vertex_path;
   if (!getPathBetweenVertices(start_vertex_id, end_vertex_id, &vertex_path)) {
     return false;
@@ -123,6 +165,109 @@ bool SparseGraphPlanner::getPathBetweenVertices(
   return false;
 }
 
+void SparseGraphPlanner::getDistancesToVertices(
+    int64_t start_vertex_id, const std::vector<int64_t>& target_vertex_ids,
+    std::vector<FloatingPoint>* distances, SearchTree* search_tree) const {
+  CHECK_EQ(adjacency_start_.size(), vertex_ids_.size() + 1)
+      << "Call setup() first.";
+  CHECK_NOTNULL(distances);
+  constexpr FloatingPoint kUnreachable =
+      std::numeric_limits<FloatingPoint>::max();
+  distances->assign(target_vertex_ids.size(), kUnreachable);
+  const size_t num_vertices = vertex_ids_.size();
+  std::vector<int> parent_indices(num_vertices, -1);
+  std::unordered_map<int64_t, int>::const_iterator start_it =
+      vertex_indices_.find(start_vertex_id);
+  if (start_it == vertex_indices_.end()) {
+    return;
+  }
+
+  // The same vertex can be the target more than once.
+  std::unordered_map<int, std::vector<size_t> > target_indices;
+  for (size_t i = 0; i < target_vertex_ids.size(); ++i) {
+    std::unordered_map<int64_t, int>::const_iterator it =
+        vertex_indices_.find(target_vertex_ids[i]);
+    if (it != vertex_indices_.end()) {
+      target_indices[it->second].push_back(i);
+    }
+  }
+  size_t num_targets_left = target_indices.size();
+
+  // Entries are never updated, only added again with a lower distance, so
+  // the ones of vertices that are already done get skipped.
+  typedef std::pair<FloatingPoint, int> QueueEntry;
+  std::priority_queue<QueueEntry, std::vector<QueueEntry>,
+                      std::greater<QueueEntry> >
+      open_queue;
+  std::vector<FloatingPoint> vertex_distances(num_vertices, kUnreachable);
+  std::vector<bool> closed(num_vertices, false);
+
+  vertex_distances[start_it->second] = 0.0;
+  open_queue.emplace(0.0, start_it->second);
+  while (!open_queue.empty() && num_targets_left > 0) {
+    const FloatingPoint distance = open_queue.top().first;
+    const int index = open_queue.top().second;
+    open_queue.pop();
+    if (closed[index]) {
+      continue;
+    }
+    closed[index] = true;
+
+    std::unordered_map<int, std::vector<size_t> >::const_iterator target_it =
+        target_indices.find(index);
+    if (target_it != target_indices.end()) {
+      for (size_t target_index : target_it->second) {
+        (*distances)[target_index] = distance;
+      }
+      --num_targets_left;
+    }
+
+    for (size_t i = adjacency_start_[index]; i < adjacency_start_[index + 1];
+         ++i) {
+      const int neighbor_index = adjacency_[i].first;
+      const FloatingPoint neighbor_distance = distance + adjacency_[i].second;
+      if (closed[neighbor_index] ||
+          vertex_distances[neighbor_index] <= neighbor_distance) {
+        continue;
+      }
+      vertex_distances[neighbor_index] = neighbor_distance;
+      parent_indices[neighbor_index] = index;
+      open_queue.emplace(neighbor_distance, neighbor_index);
+    }
+  }
+
+  if (search_tree != nullptr) {
+    search_tree->start_vertex_id = start_vertex_id;
+    search_tree->parent_indices.swap(parent_indices);
+  }
+}
+
+bool SparseGraphPlanner::getPathFromSearchTree(
+    const SearchTree& search_tree, int64_t end_vertex_id,
+    AlignedVector<Point>* coordinate_path) const {
+  CHECK_NOTNULL(graph_);
+  CHECK_NOTNULL(coordinate_path);
+  coordinate_path->clear();
+  std::unordered_map<int64_t, int>::const_iterator end_it =
+      vertex_indices_.find(end_vertex_id);
+  if (end_it == vertex_indices_.end() ||
+      search_tree.parent_indices.size() != vertex_ids_.size()) {
+    return false;
+  }
+  int index = end_it->second;
+  coordinate_path->push_back(graph_->getVertex(end_vertex_id).point);
+  while (vertex_ids_[index] != search_tree.start_vertex_id) {
+    index = search_tree.parent_indices[index];
+    if (index < 0) {
+      coordinate_path->clear();
+      return false;
+    }
+    coordinate_path->push_back(graph_->getVertex(vertex_ids_[index]).point);
+  }
+  std::reverse(coordinate_path->begin(), coordinate_path->end());
+  return true;
+}
+
 int64_t SparseGraphPlanner::popSmallestFromOpen(
     const std::map<int64_t, FloatingPoint>& f_score_map,
     std::set<int64_t>* open_set) const {
@@ -1,11 +1,36 @@
 #include "voxblox_skeleton/voxel_template_matcher.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 namespace voxblox {
 
-VoxelTemplateMatcher::VoxelTemplateMatcher() {}
+namespace {
+
+// Padding entries never match: bit 31 is never set in a neighborhood.
+const uint32_t kPaddingMask = 0xFFFFFFFFu;
+const uint32_t kPaddingTemplate = 0x80000000u;
+const size_t kTemplateAlignment = 4u;
+const uint32_t kAllNeighbors = (1u << 27) - 1u;
+
+}  // namespace
+
+VoxelTemplateMatcher::VoxelTemplateMatcher() : num_templates_(0u) {}
 
 void VoxelTemplateMatcher::addTemplate(const VoxelTemplate& voxel_template) {
-  templates_.push_back(voxel_template);
+  // Drop the padding, add the template, pad up to a full SIMD register again.
+  neighbor_masks_.resize(num_templates_);
+  neighbor_templates_.resize(num_templates_);
+  neighbor_masks_.push_back(
+      static_cast<uint32_t>(voxel_template.neighbor_mask.to_ulong()));
+  neighbor_templates_.push_back(
+      static_cast<uint32_t>(voxel_template.neighbor_template.to_ulong()));
+  num_templates_++;
+  while (neighbor_masks_.size() % kTemplateAlignment != 0u) {
+    neighbor_masks_.push_back(kPaddingMask);
+    neighbor_templates_.push_back(kPaddingTemplate);
+  }
 }
 
 void VoxelTemplateMatcher::addIntegerTemplate(int32_t neighbor_mask_dec,
@@ -13,18 +38,92 @@ void VoxelTemplateMatcher::addIntegerTemplate(int32_t neighbor_mask_dec,
   VoxelTemplate voxel_template;
   voxel_template.neighbor_mask = neighbor_mask_dec;
   voxel_template.neighbor_template = neighbor_template_dec;
-  templates_.push_back(voxel_template);
+  addTemplate(voxel_template);
+}
+
+std::vector<VoxelTemplate> VoxelTemplateMatcher::getTemplates() const {
+  std::vector<VoxelTemplate> templates(num_templates_);
+  for (size_t i = 0; i < templates.size(); ++i) {
+    templates[i].neighbor_mask = neighbor_masks_[i];
+    templates[i].neighbor_template = neighbor_templates_[i];
+  }
+  return templates;
 }
 
 bool VoxelTemplateMatcher::fitsTemplates(
     const std::bitset<27>& voxel_neighbors) const {
-  for (const VoxelTemplate& temp : templates_) {
-    if (((voxel_neighbors ^ temp.neighbor_template) & temp.neighbor_mask)
-            .none()) {
+  return fitsTemplates(static_cast<uint32_t>(voxel_neighbors.to_ulong()));
+}
+
+bool VoxelTemplateMatcher::fitsTemplates(uint32_t voxel_neighbors) const {
+  // Anything above the 27 neighbors could match the padding.
+  voxel_neighbors &= kAllNeighbors;
+  const size_t num_entries = neighbor_masks_.size();
+  const uint32_t* masks = neighbor_masks_.data();
+  const uint32_t* templates = neighbor_templates_.data();
+#ifdef __SSE2__
+  // 4 templates per step, or-ing together the lanes that match and checking
+  // only once at the end: with ~40 templates, that beats stopping early.
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i neighbors = _mm_set1_epi32(voxel_neighbors);
+  __m128i fits = zero;
+  for (size_t i = 0u; i < num_entries; i += kTemplateAlignment) {
+    const __m128i mask =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(masks + i));
+    const __m128i neighbor_template =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(templates + i));
+    fits = _mm_or_si128(
+        fits, _mm_cmpeq_epi32(
+                  _mm_and_si128(_mm_xor_si128(neighbors, neighbor_template),
+                                mask),
+                  zero));
+  }
+  return _mm_movemask_epi8(fits) != 0;
+#else
+  for (size_t i = 0u; i < num_entries; ++i) {
+    if (((voxel_neighbors ^ templates[i]) & masks[i]) == 0u) {
       return true;
     }
   }
   return false;
+#endif
+}
+
+void VoxelTemplateMatcher::fitsTemplates(
+    const std::vector<uint32_t>& voxel_neighbors,
+    std::vector<uint8_t>* fits) const {
+  CHECK_NOTNULL(fits);
+  const size_t num_voxels = voxel_neighbors.size();
+  fits->assign(num_voxels, 0u);
+  const uint32_t* neighbors = voxel_neighbors.data();
+  uint8_t* fits_data = fits->data();
+  size_t j = 0u;
+#ifdef __SSE2__
+  // 4 voxels at a time against every template.
+  const __m128i zero = _mm_setzero_si128();
+  for (; j + 4u <= num_voxels; j += 4u) {
+    const __m128i neighbor_values =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(neighbors + j));
+    __m128i voxel_fits = zero;
+    for (size_t i = 0u; i < num_templates_; ++i) {
+      const __m128i mask = _mm_set1_epi32(neighbor_masks_[i]);
+      const __m128i neighbor_template = _mm_set1_epi32(neighbor_templates_[i]);
+      voxel_fits = _mm_or_si128(
+          voxel_fits,
+          _mm_cmpeq_epi32(
+              _mm_and_si128(_mm_xor_si128(neighbor_values, neighbor_template),
+                            mask),
+              zero));
+    }
+    const int lanes = _mm_movemask_ps(_mm_castsi128_ps(voxel_fits));
+    for (size_t k = 0u; k < 4u; ++k) {
+      fits_data[j + k] = static_cast<uint8_t>((lanes >> k) & 1);
+    }
+  }
+#endif
+  for (; j < num_voxels; ++j) {
+    fits_data[j] = static_cast<uint8_t>(fitsTemplates(neighbors[j]));
+  }
 }
 
 void VoxelTemplateMatcher::setDeletionTemplates() {
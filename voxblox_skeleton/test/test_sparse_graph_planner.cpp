@@ -0,0 +1,121 @@
+#include <limits>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "voxblox_skeleton/sparse_graph_planner.h"
+
+namespace voxblox {
+
+class SparseGraphPlannerTest : public ::testing::Test {
+ protected:
+  // A loop where the short way around has more vertices, plus one vertex
+  // that isn't connected to anything:
+  //
+  //   d ---- e
+  //   |      |
+  //   a - b - c        f
+  virtual void SetUp() {
+    a_ = addVertex(Point(0.0, 0.0, 0.0));
+    b_ = addVertex(Point(1.0, 0.0, 0.0));
+    c_ = addVertex(Point(2.0, 0.0, 0.0));
+    d_ = addVertex(Point(0.0, 3.0, 0.0));
+    e_ = addVertex(Point(2.0, 2.5, 0.0));
+    f_ = addVertex(Point(10.0, 10.0, 0.0));
+    addEdge(a_, b_);
+    addEdge(b_, c_);
+    addEdge(a_, d_);
+    addEdge(d_, e_);
+    addEdge(c_, e_);
+
+    planner_.setGraph(&graph_);
+    planner_.setup();
+  }
+
+  int64_t addVertex(const Point& point) {
+    SkeletonVertex vertex;
+    vertex.point = point;
+    return graph_.addVertex(vertex);
+  }
+
+  void addEdge(int64_t start_vertex_id, int64_t end_vertex_id) {
+    SkeletonEdge edge;
+    edge.start_vertex = start_vertex_id;
+    edge.end_vertex = end_vertex_id;
+    graph_.addEdge(edge);
+  }
+
+  void expectPath(const std::vector<int64_t>& expected_vertex_ids,
+                  const AlignedVector<Point>& coordinate_path) const {
+    ASSERT_EQ(expected_vertex_ids.size(), coordinate_path.size());
+    for (size_t i = 0; i < expected_vertex_ids.size(); ++i) {
+      EXPECT_EQ(graph_.getVertex(expected_vertex_ids[i]).point,
+                coordinate_path[i]);
+    }
+  }
+
+  SparseSkeletonGraph graph_;
+  SparseGraphPlanner planner_;
+  int64_t a_, b_, c_, d_, e_, f_;
+};
+
+TEST_F(SparseGraphPlannerTest, DistancesToVertices) {
+  const int64_t kMissingVertexId = 12345;
+  const FloatingPoint kUnreachable = std::numeric_limits<FloatingPoint>::max();
+  // Out of order, repeated, unreachable, the start itself, and not in the
+  // graph at all.
+  const std::vector<int64_t> targets = {e_, d_, f_, e_, a_, kMissingVertexId};
+  std::vector<FloatingPoint> distances;
+  SparseGraphPlanner::SearchTree search_tree;
+  planner_.getDistancesToVertices(a_, targets, &distances, &search_tree);
+
+  ASSERT_EQ(targets.size(), distances.size());
+  EXPECT_FLOAT_EQ(4.5f, distances[0]);
+  EXPECT_FLOAT_EQ(3.0f, distances[1]);
+  EXPECT_EQ(kUnreachable, distances[2]);
+  EXPECT_FLOAT_EQ(4.5f, distances[3]);
+  EXPECT_FLOAT_EQ(0.0f, distances[4]);
+  EXPECT_EQ(kUnreachable, distances[5]);
+  EXPECT_EQ(a_, search_tree.start_vertex_id);
+
+  // Same distances without a search tree.
+  std::vector<FloatingPoint> distances_no_tree;
+  planner_.getDistancesToVertices(a_, targets, &distances_no_tree, nullptr);
+  EXPECT_EQ(distances, distances_no_tree);
+}
+
+TEST_F(SparseGraphPlannerTest, PathsFromSearchTree) {
+  std::vector<FloatingPoint> distances;
+  SparseGraphPlanner::SearchTree search_tree;
+  planner_.getDistancesToVertices(a_, {d_, e_, f_}, &distances,
+                                  &search_tree);
+
+  AlignedVector<Point> coordinate_path;
+  ASSERT_TRUE(
+      planner_.getPathFromSearchTree(search_tree, e_, &coordinate_path));
+  expectPath({a_, b_, c_, e_}, coordinate_path);
+  ASSERT_TRUE(
+      planner_.getPathFromSearchTree(search_tree, d_, &coordinate_path));
+  expectPath({a_, d_}, coordinate_path);
+  ASSERT_TRUE(
+      planner_.getPathFromSearchTree(search_tree, a_, &coordinate_path));
+  expectPath({a_}, coordinate_path);
+
+  EXPECT_FALSE(
+      planner_.getPathFromSearchTree(search_tree, f_, &coordinate_path));
+  EXPECT_TRUE(coordinate_path.empty());
+
+  // The same path as a single A* search.
+  std::vector<int64_t> vertex_path;
+  ASSERT_TRUE(planner_.getPathBetweenVertices(a_, e_, &vertex_path));
+  EXPECT_EQ(std::vector<int64_t>({a_, b_, c_, e_}), vertex_path);
+}
+
+}  // namespace voxblox
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  google::InitGoogleLogging(argv[0]);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,112 @@
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "voxblox_skeleton/voxel_template_matcher.h"
+
+namespace voxblox {
+
+class VoxelTemplateMatcherTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    deletion_matcher_.setDeletionTemplates();
+    connectivity_matcher_.setConnectivityTemplates();
+    corner_matcher_.setCornerTemplates();
+  }
+
+  // The straightforward bitset version, to compare against.
+  bool fitsTemplatesScalar(const VoxelTemplateMatcher& matcher,
+                           const std::bitset<27>& voxel_neighbors) const {
+    for (const VoxelTemplate& temp : matcher.getTemplates()) {
+      if (((voxel_neighbors ^ temp.neighbor_template) & temp.neighbor_mask)
+              .none()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Random neighborhoods, plus every template exactly and with each of its
+  // bits flipped, which covers both sides of every template boundary.
+  std::vector<uint32_t> getTestNeighbors(
+      const VoxelTemplateMatcher& matcher) const {
+    const size_t kNumRandom = 100000u;
+    const uint32_t kAllNeighbors = (1u << 27) - 1u;
+    std::mt19937 random_engine(42u);
+    std::vector<uint32_t> neighbors;
+    for (size_t i = 0u; i < kNumRandom; ++i) {
+      neighbors.push_back(random_engine() & kAllNeighbors);
+    }
+    for (const VoxelTemplate& temp : matcher.getTemplates()) {
+      const uint32_t value =
+          static_cast<uint32_t>(temp.neighbor_template.to_ulong());
+      neighbors.push_back(value);
+      for (int bit = 0; bit < 27; ++bit) {
+        neighbors.push_back(value ^ (1u << bit));
+      }
+    }
+    return neighbors;
+  }
+
+  void expectSameAsScalar(const VoxelTemplateMatcher& matcher) const {
+    const std::vector<uint32_t> neighbors = getTestNeighbors(matcher);
+    std::vector<uint8_t> batch_fits;
+    matcher.fitsTemplates(neighbors, &batch_fits);
+    ASSERT_EQ(neighbors.size(), batch_fits.size());
+
+    size_t num_fits = 0u;
+    for (size_t i = 0u; i < neighbors.size(); ++i) {
+      const std::bitset<27> neighbor_bitset(neighbors[i]);
+      const bool expected = fitsTemplatesScalar(matcher, neighbor_bitset);
+      EXPECT_EQ(expected, matcher.fitsTemplates(neighbors[i])) << i;
+      EXPECT_EQ(expected, matcher.fitsTemplates(neighbor_bitset)) << i;
+      EXPECT_EQ(expected, batch_fits[i] != 0u) << i;
+      num_fits += expected;
+    }
+    // Make sure both outcomes were actually tested.
+    EXPECT_GT(num_fits, 0u);
+    EXPECT_LT(num_fits, neighbors.size());
+  }
+
+  VoxelTemplateMatcher deletion_matcher_;
+  VoxelTemplateMatcher connectivity_matcher_;
+  VoxelTemplateMatcher corner_matcher_;
+};
+
+TEST_F(VoxelTemplateMatcherTest, DeletionTemplatesMatchScalar) {
+  EXPECT_EQ(38u, deletion_matcher_.getNumTemplates());
+  expectSameAsScalar(deletion_matcher_);
+}
+
+TEST_F(VoxelTemplateMatcherTest, ConnectivityTemplatesMatchScalar) {
+  EXPECT_EQ(12u, connectivity_matcher_.getNumTemplates());
+  expectSameAsScalar(connectivity_matcher_);
+}
+
+TEST_F(VoxelTemplateMatcherTest, CornerTemplatesMatchScalar) {
+  EXPECT_EQ(20u, corner_matcher_.getNumTemplates());
+  expectSameAsScalar(corner_matcher_);
+}
+
+TEST_F(VoxelTemplateMatcherTest, EmptyMatcher) {
+  VoxelTemplateMatcher matcher;
+  EXPECT_FALSE(matcher.fitsTemplates(0u));
+  EXPECT_FALSE(matcher.fitsTemplates(std::bitset<27>()));
+
+  std::vector<uint8_t> fits;
+  matcher.fitsTemplates(std::vector<uint32_t>(10u, 0u), &fits);
+  ASSERT_EQ(10u, fits.size());
+  for (const uint8_t fit : fits) {
+    EXPECT_EQ(0u, fit);
+  }
+}
+
+}  // namespace voxblox
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  google::InitGoogleLogging(argv[0]);
+
+  return RUN_ALL_TESTS();
+}
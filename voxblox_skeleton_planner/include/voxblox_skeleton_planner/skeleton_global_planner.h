@@ -1,9 +1,11 @@
 #ifndef VOXBLOX_SKELETON_PLANNER_SKELETON_GLOBAL_PLANNER_H_
 #define VOXBLOX_SKELETON_PLANNER_SKELETON_GLOBAL_PLANNER_H_
 
+#include <ros/callback_queue.h>
 #include <ros/package.h>
 #include <ros/ros.h>
 #include <memory>
+#include <mutex>
 #include <string>
 
 #include <mav_msgs/conversions.h>
@@ -12,10 +14,13 @@
 #include <mav_planning_msgs/PlannerService.h>
 #include <mav_trajectory_generation/timing.h>
 #include <mav_visualization/helpers.h>
+#include <voxblox_planning_common/esdf_distance_pyramid.h>
+#include <voxblox_planning_common/esdf_distance_source.h>
 #include <voxblox_planning_common/path_shortening.h>
 #include <voxblox_ros/esdf_server.h>
 #include <voxblox_skeleton/ros/skeleton_vis.h>
 #include <voxblox_skeleton/skeleton.h>
+#include <voxblox_skeleton/skeleton_attachment.h>
 #include <voxblox_skeleton/skeleton_generator.h>
 #include <voxblox_skeleton/skeleton_planner.h>
 #include <voxblox_skeleton/sparse_graph_planner.h>
@@ -24,16 +29,47 @@
 
 namespace mav_planning {
 
+// Plan requests are served on their own callback queue, by
+// num_planning_threads threads (0 is one per core), once generateSparseGraph()
+// has built the graph. From then on the map, skeleton and graph are only
+// read, and every request keeps its state in its own PlanningContext, so
+// requests run in parallel. Map updates coming in through the voxblox server
+// are not supported while serving.
 class SkeletonGlobalPlanner {
  public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
+  // How the paths of the different planners are compared, lowest wins.
+  enum PathCost {
+    kPathLength = 0,
+    // Negated lowest map distance along the path.
+    kPathClearance
+  };
+
+  // Everything a single plan request writes to.
+  struct PlanningContext {
+    visualization_msgs::MarkerArray marker_array;
+    // Final (shortened) graph path, for publish_path.
+    mav_msgs::EigenTrajectoryPointVector waypoints;
+    mav_msgs::EigenTrajectoryPointVector smoothed_path;
+    // Which planner the waypoints come from.
+    std::string selected_candidate;
+  };
+
   SkeletonGlobalPlanner(const ros::NodeHandle& nh,
                         const ros::NodeHandle& nh_private);
   virtual ~SkeletonGlobalPlanner() {}
 
+  // Also starts serving plan requests.
   void generateSparseGraph();
 
+  // Runs the planners in parallel and keeps the cheapest path under the
+  // path_cost param. Safe to call from any number of threads at once after
+  // generateSparseGraph().
+  bool planPath(const mav_msgs::EigenTrajectoryPoint& start_pose,
+                const mav_msgs::EigenTrajectoryPoint& goal_pose,
+                PlanningContext* context) const;
+
   bool plannerServiceCallback(
       mav_planning_msgs::PlannerServiceRequest& request,
       mav_planning_msgs::PlannerServiceResponse& response);
@@ -48,6 +84,27 @@ class SkeletonGlobalPlanner {
   double getMapDistance(const Eigen::Vector3d& position) const;
 
  private:
+  // The output of one of the planners, each writes to its own.
+  struct PathCandidate {
+    std::string name;
+    bool success = false;
+    // Shortened, if the planner shortens.
+    mav_msgs::EigenTrajectoryPointVector path;
+    visualization_msgs::MarkerArray markers;
+  };
+
+  void planEsdfPath(const mav_msgs::EigenTrajectoryPoint& start_pose,
+                    const mav_msgs::EigenTrajectoryPoint& goal_pose,
+                    PathCandidate* candidate) const;
+  void planDiagramPath(const mav_msgs::EigenTrajectoryPoint& start_pose,
+                       const mav_msgs::EigenTrajectoryPoint& goal_pose,
+                       PathCandidate* candidate) const;
+  void planGraphPath(const mav_msgs::EigenTrajectoryPoint& start_pose,
+                     const mav_msgs::EigenTrajectoryPoint& goal_pose,
+                     PathCandidate* candidate) const;
+
+  double getPathCost(const mav_msgs::EigenTrajectoryPointVector& path) const;
+
   ros::NodeHandle nh_;
   ros::NodeHandle nh_private_;
 
@@ -60,24 +117,43 @@ class SkeletonGlobalPlanner {
   ros::ServiceServer planner_srv_;
   ros::ServiceServer path_pub_srv_;
 
+  // Plan requests only, everything else is on the global queue.
+  ros::CallbackQueue planning_queue_;
+  std::unique_ptr<ros::AsyncSpinner> planning_spinner_;
+  int num_planning_threads_;
+  PathCost path_cost_;
+  // Connect start and goal to the graph through the attachment field (from
+  // the map file if it has one for this graph, otherwise built on startup).
+  bool use_attachment_field_;
+
   // Settings for physical constriants.
   mav_planning::PhysicalConstraints constraints_;
 
   std::string sparse_graph_path_;
+  // If set, tracing is on and the trace is written here after every request.
+  std::string trace_file_;
   std::string frame_id_;
   bool visualize_;
   double voxel_size_;  // Cache the size of the voxels used by the map.
 
   voxblox::EsdfServer voxblox_server_;
+  // Lookups in the server's ESDF, for getMapDistance() and LOCO.
+  EsdfDistanceSource distance_source_;
   voxblox::SkeletonGenerator skeleton_generator_;
+  std::unique_ptr<voxblox::Layer<voxblox::SkeletonAttachmentVoxel> >
+      attachment_layer_;
+  bool attachment_loaded_;
 
   // Planners of all sorts.
   voxblox::SkeletonAStar skeleton_planner_;
   SkeletonGraphPlanner skeleton_graph_planner_;
   EsdfPathShortener path_shortener_;
   LocoSmoother loco_smoother_;
+  // Built once the map is loaded, since it doesn't change after.
+  EsdfDistancePyramid distance_pyramid_;
 
-  // Waypoints
+  // Waypoints of the last successful request to finish.
+  std::mutex last_waypoints_mutex_;
   mav_msgs::EigenTrajectoryPointVector last_waypoints_;
 };
 
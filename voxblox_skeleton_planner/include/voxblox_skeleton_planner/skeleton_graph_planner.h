@@ -2,11 +2,13 @@
 #define VOXBLOX_SKELETON_PLANNER_SKELETON_GRAPH_PLANNER_H_
 
 #include <ros/ros.h>
+#include <vector>
 
 #include <mav_msgs/conversions.h>
 #include <mav_msgs/eigen_mav_msgs.h>
 #include <voxblox_skeleton/ros/skeleton_vis.h>
 #include <voxblox_skeleton/skeleton.h>
+#include <voxblox_skeleton/skeleton_attachment.h>
 #include <voxblox_skeleton/skeleton_generator.h>
 #include <voxblox_skeleton/skeleton_planner.h>
 #include <voxblox_skeleton/sparse_graph_planner.h>
@@ -18,27 +20,72 @@ class SkeletonGraphPlanner {
  public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
+  // Doesn't need ROS running, everything can be set through the setters.
+  SkeletonGraphPlanner();
   SkeletonGraphPlanner(const ros::NodeHandle& nh,
                        const ros::NodeHandle& nh_private);
   virtual ~SkeletonGraphPlanner() {}
 
+  void setParametersFromRos(const ros::NodeHandle& nh) { setParameters(nh); }
+  // Same, from anything with a ros::NodeHandle-style param(key, value,
+  // default).
+  template <typename ParamSource>
+  void setParameters(const ParamSource& params) {
+    params.param("robot_radius", robot_radius_, robot_radius_);
+    params.param("verbose", verbose_, verbose_);
+    params.param("shorten_path", shorten_path_, shorten_path_);
+    params.param("tour_num_threads", num_threads_, num_threads_);
+
+    setRobotRadius(robot_radius_);
+    path_shortener_.setParameters(params);
+  }
+
+  void setVerbose(bool verbose) { verbose_ = verbose; }
+
   double getRobotRadius() const { return robot_radius_; }
   void setRobotRadius(double robot_radius);
 
   bool getShortenPath() const { return shorten_path_; }
   void setShortenPath(bool shorten_path) { shorten_path_ = shorten_path; }
 
+  // For getTourThroughGoals(), 0 is one per core.
+  int getNumThreads() const { return num_threads_; }
+  void setNumThreads(int num_threads) { num_threads_ = num_threads; }
+
   // Both are expected to be OWNED BY ANOTHER OBJECT that shouldn't go out of
   // scope while this object exists.
   void setEsdfLayer(voxblox::Layer<voxblox::EsdfVoxel>* esdf_layer);
   void setSkeletonLayer(voxblox::Layer<voxblox::SkeletonVoxel>* skeleton_layer);
-  void setSparseGraph(voxblox::SparseSkeletonGraph* sparse_graph);
+  void setSparseGraph(const voxblox::SparseSkeletonGraph* sparse_graph);
+  // Optional, must be built from the same sparse graph. With it, start and
+  // goal are connected to the graph by following the field rather than by an
+  // A* through the ESDF; positions it doesn't cover still use the A*.
+  void setAttachmentLayer(
+      const voxblox::Layer<voxblox::SkeletonAttachmentVoxel>*
+          attachment_layer) {
+    attachment_layer_ = attachment_layer;
+  }
 
   // Fixed start and end locations, returns list of waypoints between.
+  // Keeps all its state on the stack, so once everything is set, any number
+  // of threads can call this at once.
   bool getPathBetweenWaypoints(
       const mav_msgs::EigenTrajectoryPoint& start,
       const mav_msgs::EigenTrajectoryPoint& goal,
-      mav_msgs::EigenTrajectoryPoint::Vector* solution);
+      mav_msgs::EigenTrajectoryPoint::Vector* solution) const;
+
+  // Visits all the goals, starting at the first, in the order that makes the
+  // tour the shortest on the graph as far as orderTour() can tell (see
+  // mav_planning_common/tour_ordering.h). Every goal is connected to the graph
+  // once, then one search per goal gets the distances to all the others.
+  // Returns the order the goals are visited in as indices into goals, and
+  // the path through all of them; each leg between two goals is shortened on
+  // its own, so the path still goes through every goal. Same as
+  // getPathBetweenWaypoints(), any number of threads can call this at once.
+  bool getTourThroughGoals(const mav_msgs::EigenTrajectoryPoint::Vector& goals,
+                           bool return_to_start, std::vector<size_t>* order,
+                           mav_msgs::EigenTrajectoryPoint::Vector* solution)
+      const;
 
   // Utilities...
   void convertCoordinatePathToPath(
@@ -49,16 +96,23 @@ class SkeletonGraphPlanner {
                    mav_msgs::EigenTrajectoryPoint::Vector* path_out) const;
 
  protected:
-  ros::NodeHandle nh_;
-  ros::NodeHandle nh_private_;
+  // Path from the position to the closest graph vertex it can get to, through
+  // the attachment field if there is one, and by an A* through the ESDF
+  // otherwise.
+  bool attachToGraph(const voxblox::Point& position,
+                     voxblox::AlignedVector<voxblox::Point>* path,
+                     int64_t* vertex_id) const;
 
   double robot_radius_;
   bool verbose_;
   bool shorten_path_;
+  int num_threads_;
 
   voxblox::SkeletonAStar skeleton_planner_;
   voxblox::SparseGraphPlanner sparse_graph_planner_;
   EsdfPathShortener path_shortener_;
+
+  const voxblox::Layer<voxblox::SkeletonAttachmentVoxel>* attachment_layer_;
 };
 
 }  // namespace mav_planning
@@ -1,5 +1,12 @@
+#include <algorithm>
+#include <future>
+#include <limits>
+#include <vector>
+
 #include <geometry_msgs/PoseArray.h>
 #include <mav_planning_common/path_visualization.h>
+#include <mav_planning_common/planning_counters.h>
+#include <mav_planning_common/scoped_trace.h>
 #include <mav_planning_common/utils.h>
 
 #include "voxblox_skeleton_planner/skeleton_global_planner.h"
@@ -12,16 +19,38 @@ SkeletonGlobalPlanner::SkeletonGlobalPlanner(const ros::NodeHandle& nh,
       nh_private_(nh_private),
       frame_id_("map"),
       visualize_(true),
+      num_planning_threads_(0),
+      path_cost_(kPathLength),
+      use_attachment_field_(true),
       voxblox_server_(nh_, nh_private_),
       skeleton_graph_planner_(nh_, nh_private_),
-      skeleton_generator_() {
+      skeleton_generator_(),
+      attachment_loaded_(false) {
   constraints_.setParametersFromRos(nh_private_);
+  distance_source_.setEsdfMap(voxblox_server_.getEsdfMapPtr().get());
 
   std::string voxblox_path;
   nh_private_.param("voxblox_path", voxblox_path, voxblox_path);
   nh_private_.param("sparse_graph_path", sparse_graph_path_,
                     sparse_graph_path_);
   nh_private_.param("visualize", visualize_, visualize_);
+  nh_private_.param("use_attachment_field", use_attachment_field_,
+                    use_attachment_field_);
+  nh_private_.param("num_planning_threads", num_planning_threads_,
+                    num_planning_threads_);
+  nh_private_.param("trace_file", trace_file_, trace_file_);
+  if (!trace_file_.empty()) {
+    setTracingEnabled(true);
+  }
+  std::string path_cost = "length";
+  nh_private_.param("path_cost", path_cost, path_cost);
+  if (path_cost == "length") {
+    path_cost_ = kPathLength;
+  } else if (path_cost == "clearance") {
+    path_cost_ = kPathClearance;
+  } else {
+    ROS_ERROR_STREAM("Unknown path cost: " << path_cost << ", using length.");
+  }
 
   path_marker_pub_ =
       nh_private_.advertise<visualization_msgs::MarkerArray>("path", 1, true);
@@ -33,8 +62,14 @@ SkeletonGlobalPlanner::SkeletonGlobalPlanner(const ros::NodeHandle& nh,
   waypoint_list_pub_ =
       nh_.advertise<geometry_msgs::PoseArray>("waypoint_list", 1);
 
-  planner_srv_ = nh_private_.advertiseService(
-      "plan", &SkeletonGlobalPlanner::plannerServiceCallback, this);
+  // Needs advanced options to put it on the planning queue.
+  ros::AdvertiseServiceOptions planner_srv_options =
+      ros::AdvertiseServiceOptions::create<mav_planning_msgs::PlannerService>(
+          "plan",
+          boost::bind(&SkeletonGlobalPlanner::plannerServiceCallback, this, _1,
+                      _2),
+          ros::VoidConstPtr(), &planning_queue_);
+  planner_srv_ = nh_private_.advertiseService(planner_srv_options);
   path_pub_srv_ = nh_private_.advertiseService(
       "publish_path", &SkeletonGlobalPlanner::publishPathCallback, this);
 
@@ -75,6 +110,19 @@ SkeletonGlobalPlanner::SkeletonGlobalPlanner(const ros::NodeHandle& nh,
     return;
   }
 
+  // The attachment field is optional, and only saved along with a sparse
+  // graph.
+  if (use_attachment_field_) {
+    attachment_layer_.reset(
+        new voxblox::Layer<voxblox::SkeletonAttachmentVoxel>(
+            skeleton_layer->voxel_size(), skeleton_layer->voxels_per_side()));
+    attachment_loaded_ =
+        voxblox::io::LoadBlocksFromFile<voxblox::SkeletonAttachmentVoxel>(
+            voxblox_path, voxblox::Layer<voxblox::SkeletonAttachmentVoxel>::
+                              BlockMergingStrategy::kReplace,
+            true, attachment_layer_.get());
+  }
+
   voxblox_server_.setTraversabilityRadius(constraints_.robot_radius);
 
   // Now set up the skeleton generator.
@@ -93,11 +141,17 @@ SkeletonGlobalPlanner::SkeletonGlobalPlanner(const ros::NodeHandle& nh,
   // Set up skeleton graph planner.
   skeleton_graph_planner_.setEsdfLayer(
       voxblox_server_.getEsdfMapPtr()->getEsdfLayerPtr());
+  skeleton_graph_planner_.setShortenPath(false);
 
   // Set up shortener.
+  distance_pyramid_.setEsdfLayer(
+      voxblox_server_.getEsdfMapPtr()->getEsdfLayerPtr());
+  distance_pyramid_.updateAllBlocks();
   path_shortener_.setEsdfLayer(
       voxblox_server_.getEsdfMapPtr()->getEsdfLayerPtr());
+  path_shortener_.setDistancePyramid(&distance_pyramid_);
   path_shortener_.setConstraints(constraints_);
+  path_shortener_.setParametersFromRos(nh_private_);
 
   // Loco smoother!
   loco_smoother_.setParametersFromRos(nh_private_);
@@ -105,6 +159,10 @@ SkeletonGlobalPlanner::SkeletonGlobalPlanner(const ros::NodeHandle& nh,
       voxblox_server_.getEsdfMapPtr()->getEsdfLayerPtr()->voxel_size());
   loco_smoother_.setMapDistanceCallback(std::bind(
       &SkeletonGlobalPlanner::getMapDistance, this, std::placeholders::_1));
+  loco_smoother_.setDistanceSource(&distance_source_);
+  loco_smoother_.setResampleVisibility(true);
+  loco_smoother_.setAddWaypoints(false);
+  loco_smoother_.setNumSegments(5);
 
   if (visualize_) {
     voxblox_server_.generateMesh();
@@ -114,6 +172,7 @@ SkeletonGlobalPlanner::SkeletonGlobalPlanner(const ros::NodeHandle& nh,
 }
 
 void SkeletonGlobalPlanner::generateSparseGraph() {
+  ScopedTrace trace("skeleton/generate_sparse_graph", "skeleton");
   ROS_INFO("About to generate skeleton graph.");
   skeleton_generator_.updateSkeletonFromLayer();
   ROS_INFO("Re-populated from layer.");
@@ -124,6 +183,21 @@ void SkeletonGlobalPlanner::generateSparseGraph() {
   } else {
     skeleton_generator_.generateSparseGraph();
     ROS_INFO("Generated skeleton graph.");
+    // A saved field goes with the saved graph, not this one.
+    attachment_loaded_ = false;
+  }
+
+  if (attachment_layer_ && !attachment_loaded_) {
+    mav_trajectory_generation::timing::Timer attachment_timer(
+        "plan/graph/attachment");
+    voxblox::SkeletonAttachmentGenerator attachment_generator;
+    attachment_generator.setEsdfLayer(
+        voxblox_server_.getEsdfMapPtr()->getEsdfLayerPtr());
+    attachment_generator.setMinEsdfDistance(constraints_.robot_radius);
+    attachment_generator.generate(skeleton_generator_.getSparseGraph(),
+                                  attachment_layer_.get());
+    attachment_timer.Stop();
+    ROS_INFO("Generated skeleton attachment field.");
   }
   if (visualize_) {
     voxblox::Pointcloud pointcloud;
@@ -148,10 +222,17 @@ void SkeletonGlobalPlanner::generateSparseGraph() {
   // Set up the graph planner.
   mav_trajectory_generation::timing::Timer kd_tree_init("plan/graph/setup");
   skeleton_graph_planner_.setSparseGraph(&skeleton_generator_.getSparseGraph());
+  skeleton_graph_planner_.setAttachmentLayer(attachment_layer_.get());
   kd_tree_init.Stop();
 
   ROS_INFO_STREAM("Generation timings: " << std::endl
                                          << voxblox::timing::Timing::Print());
+
+  // Nothing writes to the map or graph from here on, so plan requests can
+  // start.
+  planning_spinner_.reset(
+      new ros::AsyncSpinner(num_planning_threads_, &planning_queue_));
+  planning_spinner_->start();
 }
 
 bool SkeletonGlobalPlanner::plannerServiceCallback(
@@ -162,6 +243,34 @@ bool SkeletonGlobalPlanner::plannerServiceCallback(
   mav_msgs::eigenTrajectoryPointFromPoseMsg(request.start_pose, &start_pose);
   mav_msgs::eigenTrajectoryPointFromPoseMsg(request.goal_pose, &goal_pose);
 
+  PlanningContext context;
+  bool success = planPath(start_pose, goal_pose, &context);
+
+  if (visualize_) {
+    path_marker_pub_.publish(context.marker_array);
+  }
+  if (success) {
+    std::lock_guard<std::mutex> lock(last_waypoints_mutex_);
+    last_waypoints_ = context.waypoints;
+  }
+
+  response.success = success;
+
+  ROS_INFO_STREAM("All timings: "
+                  << std::endl
+                  << mav_trajectory_generation::timing::Timing::Print());
+  if (!trace_file_.empty()) {
+    writeChromeTrace(trace_file_);
+  }
+  return success;
+}
+
+bool SkeletonGlobalPlanner::planPath(
+    const mav_msgs::EigenTrajectoryPoint& start_pose,
+    const mav_msgs::EigenTrajectoryPoint& goal_pose,
+    PlanningContext* context) const {
+  CHECK_NOTNULL(context);
+  ScopedTrace trace("plan", "skeleton_planner");
   ROS_INFO("Planning path.");
 
   if (getMapDistance(start_pose.position_W) < constraints_.robot_radius) {
@@ -173,144 +282,217 @@ bool SkeletonGlobalPlanner::plannerServiceCallback(
     return false;
   }
 
-  voxblox::Point start_point =
-      start_pose.position_W.cast<voxblox::FloatingPoint>();
-  voxblox::Point goal_point =
-      goal_pose.position_W.cast<voxblox::FloatingPoint>();
-
-  visualization_msgs::MarkerArray marker_array;
-
   bool run_astar_esdf = false;
   bool run_astar_diagram = true;
   bool run_astar_graph = true;
-  bool shorten_graph = true;
-  bool exact_start_and_goal = true;
   bool smooth_path = true;
 
+  // The planners don't depend on each other, so the A*s run on their own
+  // threads while the graph planner runs on this one.
+  PathCandidate esdf_candidate, diagram_candidate, graph_candidate;
+  std::vector<std::future<void> > futures;
+  // Counters are per thread, so bring the others' back.
+  std::vector<PlanningCounters> thread_counters(2);
   if (run_astar_esdf) {
-    // First, run just the ESDF A*...
-    voxblox::AlignedVector<voxblox::Point> esdf_coordinate_path;
-    mav_trajectory_generation::timing::Timer astar_esdf_timer(
-        "plan/astar_esdf");
-    bool success = skeleton_planner_.getPathInEsdf(start_point, goal_point,
-                                                   &esdf_coordinate_path);
-    mav_msgs::EigenTrajectoryPointVector esdf_path;
-    convertCoordinatePathToPath(esdf_coordinate_path, &esdf_path);
-    double path_length = computePathLength(esdf_path);
-    int num_vertices = esdf_path.size();
-    astar_esdf_timer.Stop();
-    ROS_INFO("ESDF A* Success? %d Path length: %f Vertices: %d", success,
-             path_length, num_vertices);
-
-    if (visualize_) {
-      marker_array.markers.push_back(createMarkerForPath(
-          esdf_path, frame_id_, mav_visualization::Color::Yellow(),
-          "astar_esdf", 0.1));
-    }
+    futures.push_back(std::async(std::launch::async, [&]() {
+      const PlanningCounters counters_before = getPlanningCounters();
+      planEsdfPath(start_pose, goal_pose, &esdf_candidate);
+      thread_counters[0] = getPlanningCounters() - counters_before;
+    }));
   }
-
   if (run_astar_diagram) {
-    voxblox::AlignedVector<voxblox::Point> diagram_coordinate_path;
-    mav_trajectory_generation::timing::Timer astar_diag_timer(
-        "plan/astar_diag");
-    bool success = skeleton_planner_.getPathUsingEsdfAndDiagram(
-        start_point, goal_point, &diagram_coordinate_path);
-    mav_msgs::EigenTrajectoryPointVector diagram_path;
-    convertCoordinatePathToPath(diagram_coordinate_path, &diagram_path);
-    double path_length = computePathLength(diagram_path);
-    int num_vertices = diagram_path.size();
-    astar_diag_timer.Stop();
-    ROS_INFO("Diag A* Success? %d Path length: %f Vertices: %d", success,
-             path_length, num_vertices);
+    futures.push_back(std::async(std::launch::async, [&]() {
+      const PlanningCounters counters_before = getPlanningCounters();
+      planDiagramPath(start_pose, goal_pose, &diagram_candidate);
+      thread_counters[1] = getPlanningCounters() - counters_before;
+    }));
+  }
+  if (run_astar_graph) {
+    planGraphPath(start_pose, goal_pose, &graph_candidate);
+  }
+  for (std::future<void>& future : futures) {
+    future.get();
+  }
+  for (const PlanningCounters& counters : thread_counters) {
+    getPlanningCounters() += counters;
+  }
 
+  // Pick the cheapest successful candidate. Ties go to the graph, then the
+  // diagram.
+  const PathCandidate* best_candidate = nullptr;
+  double best_cost = std::numeric_limits<double>::max();
+  for (const PathCandidate* candidate :
+       {&graph_candidate, &diagram_candidate, &esdf_candidate}) {
+    context->marker_array.markers.insert(context->marker_array.markers.end(),
+                                         candidate->markers.markers.begin(),
+                                         candidate->markers.markers.end());
+    if (!candidate->success || candidate->path.empty()) {
+      continue;
+    }
+    const double cost = getPathCost(candidate->path);
+    ROS_INFO("Candidate %s cost: %f", candidate->name.c_str(), cost);
+    if (cost < best_cost) {
+      best_cost = cost;
+      best_candidate = candidate;
+    }
+  }
+  if (best_candidate == nullptr) {
+    ROS_ERROR("No planner found a path!");
+    return false;
+  }
+  ROS_INFO("Selected %s path.", best_candidate->name.c_str());
+  context->selected_candidate = best_candidate->name;
+  context->waypoints = best_candidate->path;
+
+  if (smooth_path) {
+    mav_trajectory_generation::timing::Timer loco_timer("plan/loco");
+    loco_smoother_.getPathBetweenWaypoints(context->waypoints,
+                                           &context->smoothed_path);
+    loco_timer.Stop();
     if (visualize_) {
-      marker_array.markers.push_back(createMarkerForPath(
-          diagram_path, frame_id_, mav_visualization::Color::Purple(),
-          "astar_diag", 0.1));
+      context->marker_array.markers.push_back(createMarkerForPath(
+          context->smoothed_path, frame_id_, mav_visualization::Color::Teal(),
+          "loco_plan", 0.1));
     }
+  }
+  return true;
+}
 
-    if (shorten_graph) {
-      mav_trajectory_generation::timing::Timer shorten_timer(
-          "plan/astar_diag/shorten");
-      mav_msgs::EigenTrajectoryPointVector short_path;
-      path_shortener_.shortenPath(diagram_path, &short_path);
-      path_length = computePathLength(short_path);
-      num_vertices = short_path.size();
-      ROS_INFO("Diagram Shorten Success? %d Path length: %f Vertices: %d",
-               success, path_length, num_vertices);
-      if (visualize_) {
-        marker_array.markers.push_back(createMarkerForPath(
-            short_path, frame_id_, mav_visualization::Color::Pink(),
-            "short_astar_plan", 0.1));
-      }
-      shorten_timer.Stop();
-    }
+void SkeletonGlobalPlanner::planEsdfPath(
+    const mav_msgs::EigenTrajectoryPoint& start_pose,
+    const mav_msgs::EigenTrajectoryPoint& goal_pose,
+    PathCandidate* candidate) const {
+  CHECK_NOTNULL(candidate);
+  candidate->name = "astar_esdf";
+  ScopedTrace trace("plan/astar_esdf", "skeleton_planner");
+
+  voxblox::AlignedVector<voxblox::Point> esdf_coordinate_path;
+  mav_trajectory_generation::timing::Timer astar_esdf_timer("plan/astar_esdf");
+  candidate->success = skeleton_planner_.getPathInEsdf(
+      start_pose.position_W.cast<voxblox::FloatingPoint>(),
+      goal_pose.position_W.cast<voxblox::FloatingPoint>(),
+      &esdf_coordinate_path);
+  convertCoordinatePathToPath(esdf_coordinate_path, &candidate->path);
+  astar_esdf_timer.Stop();
+  ROS_INFO("ESDF A* Success? %d Path length: %f Vertices: %zu",
+           candidate->success, computePathLength(candidate->path),
+           candidate->path.size());
+
+  if (visualize_) {
+    candidate->markers.markers.push_back(createMarkerForPath(
+        candidate->path, frame_id_, mav_visualization::Color::Yellow(),
+        "astar_esdf", 0.1));
   }
+}
 
-  if (run_astar_graph) {
-    mav_msgs::EigenTrajectoryPointVector graph_path;
-    mav_trajectory_generation::timing::Timer graph_timer("plan/graph");
-    skeleton_graph_planner_.setShortenPath(false);
-    bool success = skeleton_graph_planner_.getPathBetweenWaypoints(
-        start_pose, goal_pose, &graph_path);
-    double path_length = computePathLength(graph_path);
-    int num_vertices = graph_path.size();
-    graph_timer.Stop();
-    ROS_INFO("Graph Planning Success? %d Path length: %f Vertices: %d", success,
-             path_length, num_vertices);
+void SkeletonGlobalPlanner::planDiagramPath(
+    const mav_msgs::EigenTrajectoryPoint& start_pose,
+    const mav_msgs::EigenTrajectoryPoint& goal_pose,
+    PathCandidate* candidate) const {
+  CHECK_NOTNULL(candidate);
+  candidate->name = "astar_diag";
+  ScopedTrace trace("plan/astar_diag", "skeleton_planner");
+
+  voxblox::AlignedVector<voxblox::Point> diagram_coordinate_path;
+  mav_trajectory_generation::timing::Timer astar_diag_timer("plan/astar_diag");
+  candidate->success = skeleton_planner_.getPathUsingEsdfAndDiagram(
+      start_pose.position_W.cast<voxblox::FloatingPoint>(),
+      goal_pose.position_W.cast<voxblox::FloatingPoint>(),
+      &diagram_coordinate_path);
+  mav_msgs::EigenTrajectoryPointVector diagram_path;
+  convertCoordinatePathToPath(diagram_coordinate_path, &diagram_path);
+  astar_diag_timer.Stop();
+  ROS_INFO("Diag A* Success? %d Path length: %f Vertices: %zu",
+           candidate->success, computePathLength(diagram_path),
+           diagram_path.size());
 
-    if (visualize_) {
-      marker_array.markers.push_back(createMarkerForPath(
-          graph_path, frame_id_, mav_visualization::Color::Blue(), "graph_plan",
-          0.1));
-    }
+  if (visualize_) {
+    candidate->markers.markers.push_back(createMarkerForPath(
+        diagram_path, frame_id_, mav_visualization::Color::Purple(),
+        "astar_diag", 0.1));
+  }
 
-    last_waypoints_ = graph_path;
-
-    if (shorten_graph) {
-      mav_trajectory_generation::timing::Timer shorten_timer(
-          "plan/graph/shorten");
-      mav_msgs::EigenTrajectoryPointVector short_path;
-      success = path_shortener_.shortenPath(graph_path, &short_path);
-      path_length = computePathLength(short_path);
-      num_vertices = short_path.size();
-      ROS_INFO("Shorten Success? %d Path length: %f Vertices: %d", success,
-               path_length, num_vertices);
-      shorten_timer.Stop();
-
-      if (visualize_) {
-        marker_array.markers.push_back(createMarkerForPath(
-            short_path, frame_id_, mav_visualization::Color::Green(),
-            "short_plan", 0.1));
-      }
+  mav_trajectory_generation::timing::Timer shorten_timer(
+      "plan/astar_diag/shorten");
+  path_shortener_.shortenPath(diagram_path, &candidate->path);
+  shorten_timer.Stop();
+  ROS_INFO("Diagram Shorten Success? %d Path length: %f Vertices: %zu",
+           candidate->success, computePathLength(candidate->path),
+           candidate->path.size());
+  if (visualize_) {
+    candidate->markers.markers.push_back(createMarkerForPath(
+        candidate->path, frame_id_, mav_visualization::Color::Pink(),
+        "short_astar_plan", 0.1));
+  }
+}
 
-      last_waypoints_ = short_path;
-
-      if (smooth_path) {
-        mav_msgs::EigenTrajectoryPointVector loco_path;
-        mav_trajectory_generation::timing::Timer loco_timer("plan/graph/loco");
-        loco_smoother_.setResampleVisibility(true);
-        loco_smoother_.setAddWaypoints(false);
-        loco_smoother_.setNumSegments(5);
-        loco_smoother_.getPathBetweenWaypoints(short_path, &loco_path);
-
-        loco_timer.Stop();
-        if (visualize_) {
-          marker_array.markers.push_back(createMarkerForPath(
-              loco_path, frame_id_, mav_visualization::Color::Teal(),
-              "loco_plan", 0.1));
-        }
-      }
-    }
+void SkeletonGlobalPlanner::planGraphPath(
+    const mav_msgs::EigenTrajectoryPoint& start_pose,
+    const mav_msgs::EigenTrajectoryPoint& goal_pose,
+    PathCandidate* candidate) const {
+  CHECK_NOTNULL(candidate);
+  candidate->name = "graph";
+  ScopedTrace trace("plan/graph", "skeleton_planner");
+
+  mav_msgs::EigenTrajectoryPointVector graph_path;
+  mav_trajectory_generation::timing::Timer graph_timer("plan/graph");
+  candidate->success = skeleton_graph_planner_.getPathBetweenWaypoints(
+      start_pose, goal_pose, &graph_path);
+  graph_timer.Stop();
+  ROS_INFO("Graph Planning Success? %d Path length: %f Vertices: %zu",
+           candidate->success, computePathLength(graph_path),
+           graph_path.size());
+
+  if (visualize_) {
+    candidate->markers.markers.push_back(createMarkerForPath(
+        graph_path, frame_id_, mav_visualization::Color::Blue(), "graph_plan",
+        0.1));
   }
 
+  mav_trajectory_generation::timing::Timer shorten_timer("plan/graph/shorten");
+  bool success = path_shortener_.shortenPath(graph_path, &candidate->path);
+  shorten_timer.Stop();
+  ROS_INFO("Shorten Success? %d Path length: %f Vertices: %zu", success,
+           computePathLength(candidate->path), candidate->path.size());
+
   if (visualize_) {
-    path_marker_pub_.publish(marker_array);
+    candidate->markers.markers.push_back(createMarkerForPath(
+        candidate->path, frame_id_, mav_visualization::Color::Green(),
+        "short_plan", 0.1));
   }
+}
 
-  ROS_INFO_STREAM("All timings: "
-                  << std::endl
-                  << mav_trajectory_generation::timing::Timing::Print());
+double SkeletonGlobalPlanner::getPathCost(
+    const mav_msgs::EigenTrajectoryPointVector& path) const {
+  switch (path_cost_) {
+    case kPathLength:
+      return computePathLength(path);
+    case kPathClearance: {
+      // Lowest map distance along the path, checked at every voxel,
+      // negated so the safest path costs the least.
+      const double step =
+          voxblox_server_.getEsdfMapPtr()->getEsdfLayerPtr()->voxel_size();
+      double min_distance = std::numeric_limits<double>::max();
+      for (size_t i = 0; i < path.size(); ++i) {
+        min_distance =
+            std::min(min_distance, getMapDistance(path[i].position_W));
+        if (i + 1 == path.size()) {
+          break;
+        }
+        const Eigen::Vector3d segment =
+            path[i + 1].position_W - path[i].position_W;
+        const int num_steps = static_cast<int>(segment.norm() / step);
+        for (int j = 1; j < num_steps; ++j) {
+          min_distance = std::min(
+              min_distance,
+              getMapDistance(path[i].position_W +
+                             segment * static_cast<double>(j) / num_steps));
+        }
+      }
+      return -min_distance;
+    }
+  }
+  return computePathLength(path);
 }
 
 void SkeletonGlobalPlanner::convertCoordinatePathToPath(
@@ -329,21 +511,14 @@ void SkeletonGlobalPlanner::convertCoordinatePathToPath(
 
 double SkeletonGlobalPlanner::getMapDistance(
     const Eigen::Vector3d& position) const {
-  if (!voxblox_server_.getEsdfMapPtr()) {
-    return 0.0;
-  }
-  double distance = 0.0;
-  if (!voxblox_server_.getEsdfMapPtr()->getDistanceAtPosition(position,
-                                                              &distance)) {
-    return 0.0;
-  }
-  return distance;
+  return distance_source_.getDistance(position);
 }
 
 bool SkeletonGlobalPlanner::publishPathCallback(
     std_srvs::EmptyRequest& request, std_srvs::EmptyResponse& response) {
   ROS_INFO("Publishing waypoints.");
 
+  std::lock_guard<std::mutex> lock(last_waypoints_mutex_);
   geometry_msgs::PoseArray pose_array;
   pose_array.poses.reserve(last_waypoints_.size());
   for (const mav_msgs::EigenTrajectoryPoint& point : last_waypoints_) {
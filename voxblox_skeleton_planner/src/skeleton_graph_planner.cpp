@@ -1,3 +1,14 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <future>
+#include <limits>
+#include <thread>
+
+#include <mav_planning_common/planning_counters.h>
+#include <mav_planning_common/scoped_trace.h>
+#include <mav_planning_common/tour_ordering.h>
 #include <mav_planning_common/utils.h>
 #include <mav_trajectory_generation/timing.h>
 
@@ -5,21 +16,73 @@
 
 namespace mav_planning {
 
-SkeletonGraphPlanner::SkeletonGraphPlanner(const ros::NodeHandle& nh,
-                                           const ros::NodeHandle& nh_private)
-    : nh_(nh),
-      nh_private_(nh_private),
-      robot_radius_(1.0),
-      verbose_(true),
-      shorten_path_(true) {
-  nh_private_.param("robot_radius", robot_radius_, robot_radius_);
-  nh_private_.param("verbose", verbose_, verbose_);
-  nh_private_.param("shorten_path", shorten_path_, shorten_path_);
+namespace {
+
+// Runs task(i) for every i up to num_tasks on up to num_threads threads (0 is
+// one per core), this one included. Counters are per thread, so the other
+// threads' get added to this one's.
+void runInParallel(size_t num_tasks, int num_threads,
+                   const std::function<void(size_t)>& task) {
+  if (num_threads <= 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  num_threads = std::min(static_cast<size_t>(num_threads), num_tasks);
+
+  std::atomic<size_t> next_task(0);
+  auto run_tasks = [&]() {
+    size_t index;
+    while ((index = next_task++) < num_tasks) {
+      task(index);
+    }
+  };
+  std::vector<std::future<void> > futures;
+  std::vector<PlanningCounters> thread_counters(num_threads);
+  for (int i = 1; i < num_threads; ++i) {
+    futures.push_back(std::async(std::launch::async, [&, i]() {
+      const PlanningCounters counters_before = getPlanningCounters();
+      run_tasks();
+      thread_counters[i] = getPlanningCounters() - counters_before;
+    }));
+  }
+  run_tasks();
+  for (std::future<void>& future : futures) {
+    future.get();
+  }
+  for (int i = 1; i < num_threads; ++i) {
+    getPlanningCounters() += thread_counters[i];
+  }
+}
+
+// Length of the path from the position on.
+double getPathLengthFrom(const voxblox::Point& position,
+                         const voxblox::AlignedVector<voxblox::Point>& path) {
+  double length = 0.0;
+  voxblox::Point last_point = position;
+  for (const voxblox::Point& point : path) {
+    length += (point - last_point).norm();
+    last_point = point;
+  }
+  return length;
+}
+
+}  // namespace
 
+SkeletonGraphPlanner::SkeletonGraphPlanner()
+    : robot_radius_(1.0),
+      verbose_(true),
+      shorten_path_(true),
+      num_threads_(0),
+      attachment_layer_(nullptr) {
   setRobotRadius(robot_radius_);
   skeleton_planner_.setMaxIterations(10000);
 }
 
+SkeletonGraphPlanner::SkeletonGraphPlanner(const ros::NodeHandle& nh,
+                                           const ros::NodeHandle& nh_private)
+    : SkeletonGraphPlanner() {
+  setParametersFromRos(nh_private);
+}
+
 void SkeletonGraphPlanner::setRobotRadius(double robot_radius) {
   robot_radius_ = robot_radius;
 
@@ -45,7 +108,7 @@ void SkeletonGraphPlanner::setSkeletonLayer(
 }
 
 void SkeletonGraphPlanner::setSparseGraph(
-    voxblox::SparseSkeletonGraph* sparse_graph) {
+    const voxblox::SparseSkeletonGraph* sparse_graph) {
   sparse_graph_planner_.setGraph(sparse_graph);
   mav_trajectory_generation::timing::Timer kd_tree_init("skeleton_plan/setup");
   sparse_graph_planner_.setup();
@@ -56,35 +119,67 @@ void SkeletonGraphPlanner::setSparseGraph(
 bool SkeletonGraphPlanner::getPathBetweenWaypoints(
     const mav_msgs::EigenTrajectoryPoint& start,
     const mav_msgs::EigenTrajectoryPoint& goal,
-    mav_msgs::EigenTrajectoryPoint::Vector* solution) {
+    mav_msgs::EigenTrajectoryPoint::Vector* solution) const {
   voxblox::Point start_point = start.position_W.cast<voxblox::FloatingPoint>();
   voxblox::Point goal_point = goal.position_W.cast<voxblox::FloatingPoint>();
 
   mav_trajectory_generation::timing::Timer graph_timer("skeleton_plan");
   voxblox::AlignedVector<voxblox::Point> graph_coordinate_path;
-  bool success = sparse_graph_planner_.getPath(start_point, goal_point,
-                                               &graph_coordinate_path);
-  mav_msgs::EigenTrajectoryPointVector graph_path;
-  convertCoordinatePathToPath(graph_coordinate_path, &graph_path);
-  ROS_INFO("Got sparse graph path.");
-  if (!success) {
-    return false;
-  }
+  bool success = true;
 
   voxblox::AlignedVector<voxblox::Point> exact_start_path, exact_goal_path;
+  int64_t start_vertex_id = -1;
+  int64_t goal_vertex_id = -1;
+  if (attachment_layer_ != nullptr &&
+      voxblox::getSkeletonAttachmentPath(*attachment_layer_, start_point,
+                                         &exact_start_path,
+                                         &start_vertex_id) &&
+      voxblox::getSkeletonAttachmentPath(*attachment_layer_, goal_point,
+                                         &exact_goal_path, &goal_vertex_id)) {
+    // Both ends are connected to the graph already, only the graph is left
+    // to search.
+    if (!sparse_graph_planner_.getPathBetweenVertices(
+            start_vertex_id, goal_vertex_id, &graph_coordinate_path)) {
+      return false;
+    }
+    ROS_INFO("Got sparse graph path, attached start and goal.");
+    // The goal path leads to the graph, so it goes in backwards.
+    std::reverse(exact_goal_path.begin(), exact_goal_path.end());
+  } else {
+    // Either end might already be attached, but the A* connects both.
+    exact_start_path.clear();
+    exact_goal_path.clear();
+    success = sparse_graph_planner_.getPath(start_point, goal_point,
+                                            &graph_coordinate_path);
+    ROS_INFO("Got sparse graph path.");
+    if (!success) {
+      return false;
+    }
 
-  success &= skeleton_planner_.getPathInEsdf(
-      start_point, graph_coordinate_path.front(), &exact_start_path);
-  success &= skeleton_planner_.getPathInEsdf(graph_coordinate_path.back(),
-                                             goal_point, &exact_goal_path);
+    // The connections at both ends are independent, so get the start one on
+    // another thread. Counters are per thread, so bring its back with it.
+    PlanningCounters start_counters;
+    std::future<bool> start_future = std::async(std::launch::async, [&]() {
+      const PlanningCounters counters_before = getPlanningCounters();
+      bool start_success = skeleton_planner_.getPathInEsdf(
+          start_point, graph_coordinate_path.front(), &exact_start_path);
+      start_counters = getPlanningCounters() - counters_before;
+      return start_success;
+    });
+    success &= skeleton_planner_.getPathInEsdf(graph_coordinate_path.back(),
+                                               goal_point, &exact_goal_path);
+    success &= start_future.get();
+    getPlanningCounters() += start_counters;
+    ROS_INFO("Got ESDF path.");
+  }
 
   graph_coordinate_path.insert(graph_coordinate_path.begin(),
                                exact_start_path.begin(),
                                exact_start_path.end());
   graph_coordinate_path.insert(graph_coordinate_path.end(),
                                exact_goal_path.begin(), exact_goal_path.end());
+  mav_msgs::EigenTrajectoryPointVector graph_path;
   convertCoordinatePathToPath(graph_coordinate_path, &graph_path);
-  ROS_INFO("Got ESDF path.");
 
   if (shorten_path_) {
     shortenPath(graph_path, solution);
@@ -94,6 +189,160 @@ bool SkeletonGraphPlanner::getPathBetweenWaypoints(
   return success;
 }
 
+bool SkeletonGraphPlanner::getTourThroughGoals(
+    const mav_msgs::EigenTrajectoryPoint::Vector& goals, bool return_to_start,
+    std::vector<size_t>* order,
+    mav_msgs::EigenTrajectoryPoint::Vector* solution) const {
+  CHECK_NOTNULL(order);
+  CHECK_NOTNULL(solution);
+  order->clear();
+  solution->clear();
+  if (goals.empty()) {
+    return false;
+  }
+  mav_trajectory_generation::timing::Timer tour_timer("skeleton_plan/tour");
+  ScopedTrace trace("skeleton_plan/tour", "skeleton_planner");
+  const size_t num_goals = goals.size();
+
+  // Connect every goal to the graph. Their paths lead to the graph, so they
+  // go in backwards where a leg ends.
+  std::vector<voxblox::AlignedVector<voxblox::Point> > attachment_paths(
+      num_goals);
+  std::vector<int64_t> goal_vertex_ids(num_goals, -1);
+  std::vector<char> attached(num_goals, false);
+  voxblox::AlignedVector<voxblox::Point> goal_points;
+  goal_points.reserve(num_goals);
+  for (const mav_msgs::EigenTrajectoryPoint& goal : goals) {
+    goal_points.push_back(goal.position_W.cast<voxblox::FloatingPoint>());
+  }
+  runInParallel(num_goals, num_threads_, [&](size_t i) {
+    attached[i] = attachToGraph(goal_points[i], &attachment_paths[i],
+                                &goal_vertex_ids[i]);
+  });
+  std::vector<double> attachment_lengths(num_goals);
+  for (size_t i = 0; i < num_goals; ++i) {
+    if (!attached[i]) {
+      ROS_ERROR("Couldn't connect goal %zu to the graph.", i);
+      return false;
+    }
+    attachment_lengths[i] =
+        getPathLengthFrom(goal_points[i], attachment_paths[i]);
+  }
+
+  // Costs between all the goals, with one search per goal. Its search tree
+  // is kept for the legs that start at the goal.
+  mav_trajectory_generation::timing::Timer costs_timer(
+      "skeleton_plan/tour/costs");
+  Eigen::MatrixXd costs(num_goals, num_goals);
+  std::vector<voxblox::SparseGraphPlanner::SearchTree> search_trees(num_goals);
+  runInParallel(num_goals, num_threads_, [&](size_t i) {
+    std::vector<voxblox::FloatingPoint> distances;
+    sparse_graph_planner_.getDistancesToVertices(
+        goal_vertex_ids[i], goal_vertex_ids, &distances, &search_trees[i]);
+    for (size_t j = 0; j < num_goals; ++j) {
+      if (i == j) {
+        costs(i, j) = 0.0;
+      } else if (distances[j] ==
+                 std::numeric_limits<voxblox::FloatingPoint>::max()) {
+        costs(i, j) = std::numeric_limits<double>::infinity();
+      } else {
+        costs(i, j) =
+            attachment_lengths[i] + distances[j] + attachment_lengths[j];
+      }
+    }
+  });
+  costs_timer.Stop();
+
+  mav_trajectory_generation::timing::Timer order_timer(
+      "skeleton_plan/tour/order");
+  const double tour_cost = orderTour(costs, return_to_start, order);
+  order_timer.Stop();
+  if (!std::isfinite(tour_cost)) {
+    ROS_ERROR("Not all goals are connected to each other on the graph.");
+    return false;
+  }
+  ROS_INFO("Ordered %zu goals, tour length on the graph: %f", num_goals,
+           tour_cost);
+
+  // Every leg is made and shortened on its own.
+  const size_t num_legs = return_to_start ? num_goals : num_goals - 1;
+  std::vector<mav_msgs::EigenTrajectoryPointVector> leg_paths(num_legs);
+  std::vector<char> leg_success(num_legs, false);
+  runInParallel(num_legs, num_threads_, [&](size_t leg) {
+    const size_t from = (*order)[leg];
+    const size_t to = (*order)[(leg + 1) % num_goals];
+    voxblox::AlignedVector<voxblox::Point> graph_path;
+    if (!sparse_graph_planner_.getPathFromSearchTree(
+            search_trees[from], goal_vertex_ids[to], &graph_path)) {
+      return;
+    }
+    // Through the goals themselves, not just near them. The pieces can
+    // share their ends, which would only make for empty segments.
+    voxblox::AlignedVector<voxblox::Point> coordinate_path;
+    auto add_point = [&coordinate_path](const voxblox::Point& point) {
+      if (coordinate_path.empty() ||
+          (coordinate_path.back() - point).norm() > voxblox::kEpsilon) {
+        coordinate_path.push_back(point);
+      }
+    };
+    add_point(goal_points[from]);
+    std::for_each(attachment_paths[from].begin(), attachment_paths[from].end(),
+                  add_point);
+    std::for_each(graph_path.begin(), graph_path.end(), add_point);
+    std::for_each(attachment_paths[to].rbegin(), attachment_paths[to].rend(),
+                  add_point);
+    add_point(goal_points[to]);
+
+    mav_msgs::EigenTrajectoryPointVector leg_path;
+    convertCoordinatePathToPath(coordinate_path, &leg_path);
+    if (shorten_path_) {
+      shortenPath(leg_path, &leg_paths[leg]);
+    } else {
+      leg_paths[leg] = leg_path;
+    }
+    leg_success[leg] = true;
+  });
+
+  // Each leg starts where the one before ends.
+  for (size_t leg = 0; leg < num_legs; ++leg) {
+    if (!leg_success[leg] || leg_paths[leg].empty()) {
+      ROS_ERROR("Couldn't get the path of leg %zu of the tour.", leg);
+      solution->clear();
+      return false;
+    }
+    solution->insert(solution->end(),
+                     leg_paths[leg].begin() + (leg == 0 ? 0 : 1),
+                     leg_paths[leg].end());
+  }
+  if (num_legs == 0) {
+    solution->push_back(goals.front());
+  }
+  return true;
+}
+
+bool SkeletonGraphPlanner::attachToGraph(
+    const voxblox::Point& position,
+    voxblox::AlignedVector<voxblox::Point>* path, int64_t* vertex_id) const {
+  CHECK_NOTNULL(path);
+  CHECK_NOTNULL(vertex_id);
+  path->clear();
+  if (attachment_layer_ != nullptr &&
+      voxblox::getSkeletonAttachmentPath(*attachment_layer_, position, path,
+                                         vertex_id)) {
+    return true;
+  }
+  path->clear();
+  std::vector<int64_t> vertex_ids;
+  if (sparse_graph_planner_.getNClosestVertices(position, 1, &vertex_ids) ==
+      0) {
+    return false;
+  }
+  *vertex_id = vertex_ids[0];
+  return skeleton_planner_.getPathInEsdf(
+      position,
+      sparse_graph_planner_.getGraph()->getVertex(*vertex_id).point, path);
+}
+
 void SkeletonGraphPlanner::convertCoordinatePathToPath(
     const voxblox::AlignedVector<voxblox::Point>& coordinate_path,
     mav_msgs::EigenTrajectoryPointVector* path) const {